@@ -24,11 +24,16 @@
  */
 #include <stdlib.h>
 #include <stdio.h>
+#include <stddef.h>
 #include <stdarg.h>
 #include <string.h>
 
 #include "cutils.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 void pstrcpy(char *buf, int buf_size, const char *str)
 {
     int c;
@@ -238,6 +243,32 @@ int unicode_to_utf8(uint8_t *buf, unsigned int c)
     return q - buf;
 }
 
+/* return the number of leading bytes < 0x80 in 'buf' */
+size_t ascii_prefix_len(const uint8_t *buf, size_t len)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    int mask;
+
+    for(i = 0; i + 16 <= len; i += 16) {
+        mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(buf + i)));
+        if (mask)
+            return i + ctz32(mask);
+    }
+#else
+    uint64_t v;
+
+    for(i = 0; i + 8 <= len; i += 8) {
+        memcpy(&v, buf + i, 8);
+        if (v & 0x8080808080808080)
+            break;
+    }
+#endif
+    while (i < len && buf[i] < 0x80)
+        i++;
+    return i;
+}
+
 static const unsigned int utf8_min_code[5] = {
     0x80, 0x800, 0x10000, 0x00200000, 0x04000000,
 };
@@ -629,3 +660,499 @@ void rqsort(void *base, size_t nmemb, size_t size, cmp_f cmp, void *opaque)
 }
 
 #endif
+
+/* TimSort: stable merge sort exploiting the sorted runs of the input
+   (see listsort.txt in the CPython sources). It uses fewer comparisons
+   than rqsort(), which matters when they are costly. 'tmp' must hold
+   at least nmemb / 2 + 1 elements. The array is left in a valid state
+   (a permutation of the input) if the comparison function is
+   inconsistent. */
+
+#define TIMSORT_MIN_GALLOP 7
+/* enough for 2^64 elements since the run lengths grow faster than
+   the Fibonacci numbers */
+#define TIMSORT_MAX_PENDING 85
+
+typedef struct {
+    size_t base;
+    size_t len;
+} TimSortRun;
+
+typedef struct {
+    uint8_t *base;
+    size_t size;
+    int (*cmp)(const void *, const void *, void *);
+    void *opaque;
+    uint8_t *tmp;
+    size_t min_gallop;
+    int n;
+    TimSortRun pending[TIMSORT_MAX_PENDING];
+} TimSortState;
+
+#define TS_LT(s, a, b)  ((s)->cmp(a, b, (s)->opaque) < 0)
+
+/* sort a[0..n) using a binary insertion sort, a[0..start) being
+   already sorted */
+static void timsort_binsort(TimSortState *s, uint8_t *a, size_t n,
+                            size_t start)
+{
+    size_t size = s->size;
+    uint8_t *pivot = s->tmp;
+    size_t i, l, r, m;
+
+    for (i = start; i < n; i++) {
+        memcpy(pivot, a + i * size, size);
+        l = 0;
+        r = i;
+        while (l < r) {
+            m = l + ((r - l) >> 1);
+            if (TS_LT(s, pivot, a + m * size))
+                r = m;
+            else
+                l = m + 1;
+        }
+        memmove(a + (l + 1) * size, a + l * size, (i - l) * size);
+        memcpy(a + l * size, pivot, size);
+    }
+}
+
+/* return the length of the run starting at a[0]. Strictly descending
+   runs are reversed, which keeps the sort stable. */
+static size_t timsort_count_run(TimSortState *s, uint8_t *a, size_t n)
+{
+    size_t size = s->size;
+    size_t k, i, j;
+
+    if (n == 1)
+        return 1;
+    if (TS_LT(s, a + size, a)) {
+        for (k = 2; k < n && TS_LT(s, a + k * size, a + (k - 1) * size); k++)
+            continue;
+        for (i = 0, j = k - 1; i < j; i++, j--) {
+            memcpy(s->tmp, a + i * size, size);
+            memcpy(a + i * size, a + j * size, size);
+            memcpy(a + j * size, s->tmp, size);
+        }
+    } else {
+        for (k = 2; k < n && !TS_LT(s, a + k * size, a + (k - 1) * size); k++)
+            continue;
+    }
+    return k;
+}
+
+/* return k such that a[k - 1] < key <= a[k], starting the search at
+   a[hint] */
+static size_t timsort_gallop_left(TimSortState *s, const uint8_t *key,
+                                  const uint8_t *a, size_t n, size_t hint)
+{
+    size_t size = s->size;
+    ptrdiff_t ofs, lastofs, maxofs, k, m;
+
+    lastofs = 0;
+    ofs = 1;
+    if (TS_LT(s, a + hint * size, key)) {
+        /* a[hint] < key: gallop right until
+           a[hint + lastofs] < key <= a[hint + ofs] */
+        maxofs = n - hint;
+        while (ofs < maxofs && TS_LT(s, a + (hint + ofs) * size, key)) {
+            lastofs = ofs;
+            ofs = (ofs << 1) + 1;
+        }
+        if (ofs > maxofs)
+            ofs = maxofs;
+        lastofs += hint;
+        ofs += hint;
+    } else {
+        /* key <= a[hint]: gallop left until
+           a[hint - ofs] < key <= a[hint - lastofs] */
+        maxofs = hint + 1;
+        while (ofs < maxofs && !TS_LT(s, a + (hint - ofs) * size, key)) {
+            lastofs = ofs;
+            ofs = (ofs << 1) + 1;
+        }
+        if (ofs > maxofs)
+            ofs = maxofs;
+        k = lastofs;
+        lastofs = hint - ofs;
+        ofs = hint - k;
+    }
+    /* a[lastofs] < key <= a[ofs] */
+    lastofs++;
+    while (lastofs < ofs) {
+        m = lastofs + ((ofs - lastofs) >> 1);
+        if (TS_LT(s, a + m * size, key))
+            lastofs = m + 1;
+        else
+            ofs = m;
+    }
+    return ofs;
+}
+
+/* return k such that a[k - 1] <= key < a[k], starting the search at
+   a[hint] */
+static size_t timsort_gallop_right(TimSortState *s, const uint8_t *key,
+                                   const uint8_t *a, size_t n, size_t hint)
+{
+    size_t size = s->size;
+    ptrdiff_t ofs, lastofs, maxofs, k, m;
+
+    lastofs = 0;
+    ofs = 1;
+    if (TS_LT(s, key, a + hint * size)) {
+        /* key < a[hint]: gallop left until
+           a[hint - ofs] <= key < a[hint - lastofs] */
+        maxofs = hint + 1;
+        while (ofs < maxofs && TS_LT(s, key, a + (hint - ofs) * size)) {
+            lastofs = ofs;
+            ofs = (ofs << 1) + 1;
+        }
+        if (ofs > maxofs)
+            ofs = maxofs;
+        k = lastofs;
+        lastofs = hint - ofs;
+        ofs = hint - k;
+    } else {
+        /* a[hint] <= key: gallop right until
+           a[hint + lastofs] <= key < a[hint + ofs] */
+        maxofs = n - hint;
+        while (ofs < maxofs && !TS_LT(s, key, a + (hint + ofs) * size)) {
+            lastofs = ofs;
+            ofs = (ofs << 1) + 1;
+        }
+        if (ofs > maxofs)
+            ofs = maxofs;
+        lastofs += hint;
+        ofs += hint;
+    }
+    /* a[lastofs] <= key < a[ofs] */
+    lastofs++;
+    while (lastofs < ofs) {
+        m = lastofs + ((ofs - lastofs) >> 1);
+        if (TS_LT(s, key, a + m * size))
+            ofs = m;
+        else
+            lastofs = m + 1;
+    }
+    return ofs;
+}
+
+/* merge the adjacent runs a[0..na) and b[0..nb) with na <= nb: a is
+   copied to the temporary buffer and the merge goes upwards. a[0] is
+   known to belong to the start of the result and b[nb - 1] to its
+   end. */
+static void timsort_merge_lo(TimSortState *s, uint8_t *a, size_t na,
+                             uint8_t *b, size_t nb)
+{
+    size_t size = s->size;
+    size_t min_gallop, acount, bcount, k;
+    uint8_t *dest = a;
+
+    memcpy(s->tmp, a, na * size);
+    a = s->tmp;
+
+    memcpy(dest, b, size);
+    dest += size;
+    b += size;
+    if (--nb == 0)
+        goto done;
+    if (na == 1)
+        goto copy_b;
+
+    min_gallop = s->min_gallop;
+    for (;;) {
+        acount = 0;
+        bcount = 0;
+        /* one element at a time until one run wins consistently */
+        for (;;) {
+            if (TS_LT(s, b, a)) {
+                memcpy(dest, b, size);
+                dest += size;
+                b += size;
+                bcount++;
+                acount = 0;
+                if (--nb == 0)
+                    goto done;
+                if (bcount >= min_gallop)
+                    break;
+            } else {
+                memcpy(dest, a, size);
+                dest += size;
+                a += size;
+                acount++;
+                bcount = 0;
+                if (--na == 1)
+                    goto copy_b;
+                if (acount >= min_gallop)
+                    break;
+            }
+        }
+        /* galloping mode */
+        min_gallop++;
+        do {
+            min_gallop -= min_gallop > 1;
+            s->min_gallop = min_gallop;
+            k = timsort_gallop_right(s, b, a, na, 0);
+            acount = k;
+            if (k) {
+                memcpy(dest, a, k * size);
+                dest += k * size;
+                a += k * size;
+                na -= k;
+                if (na == 1)
+                    goto copy_b;
+                /* only possible with an inconsistent comparison */
+                if (na == 0)
+                    goto done;
+            }
+            memcpy(dest, b, size);
+            dest += size;
+            b += size;
+            if (--nb == 0)
+                goto done;
+
+            k = timsort_gallop_left(s, a, b, nb, 0);
+            bcount = k;
+            if (k) {
+                memmove(dest, b, k * size);
+                dest += k * size;
+                b += k * size;
+                nb -= k;
+                if (nb == 0)
+                    goto done;
+            }
+            memcpy(dest, a, size);
+            dest += size;
+            a += size;
+            if (--na == 1)
+                goto copy_b;
+        } while (acount >= TIMSORT_MIN_GALLOP || bcount >= TIMSORT_MIN_GALLOP);
+        min_gallop++;
+        s->min_gallop = min_gallop;
+    }
+ done:
+    if (na)
+        memcpy(dest, a, na * size);
+    return;
+ copy_b:
+    /* the last element of a belongs at the end of the merge */
+    memmove(dest, b, nb * size);
+    memcpy(dest + nb * size, a, size);
+}
+
+/* merge the adjacent runs a[0..na) and b[0..nb) with na >= nb: b is
+   copied to the temporary buffer and the merge goes downwards. */
+static void timsort_merge_hi(TimSortState *s, uint8_t *a, size_t na,
+                             uint8_t *b, size_t nb)
+{
+    size_t size = s->size;
+    size_t min_gallop, acount, bcount, k;
+    uint8_t *dest, *basea, *baseb;
+
+    dest = b + (nb - 1) * size;
+    memcpy(s->tmp, b, nb * size);
+    basea = a;
+    baseb = s->tmp;
+    b = s->tmp + (nb - 1) * size;
+    a += (na - 1) * size;
+
+    memcpy(dest, a, size);
+    dest -= size;
+    a -= size;
+    if (--na == 0)
+        goto done;
+    if (nb == 1)
+        goto copy_a;
+
+    min_gallop = s->min_gallop;
+    for (;;) {
+        acount = 0;
+        bcount = 0;
+        for (;;) {
+            if (TS_LT(s, b, a)) {
+                memcpy(dest, a, size);
+                dest -= size;
+                a -= size;
+                acount++;
+                bcount = 0;
+                if (--na == 0)
+                    goto done;
+                if (acount >= min_gallop)
+                    break;
+            } else {
+                memcpy(dest, b, size);
+                dest -= size;
+                b -= size;
+                bcount++;
+                acount = 0;
+                if (--nb == 1)
+                    goto copy_a;
+                if (bcount >= min_gallop)
+                    break;
+            }
+        }
+        min_gallop++;
+        do {
+            min_gallop -= min_gallop > 1;
+            s->min_gallop = min_gallop;
+            k = na - timsort_gallop_right(s, b, basea, na, na - 1);
+            acount = k;
+            if (k) {
+                dest -= k * size;
+                a -= k * size;
+                memmove(dest + size, a + size, k * size);
+                na -= k;
+                if (na == 0)
+                    goto done;
+            }
+            memcpy(dest, b, size);
+            dest -= size;
+            b -= size;
+            if (--nb == 1)
+                goto copy_a;
+
+            k = nb - timsort_gallop_left(s, a, baseb, nb, nb - 1);
+            bcount = k;
+            if (k) {
+                dest -= k * size;
+                b -= k * size;
+                memcpy(dest + size, b + size, k * size);
+                nb -= k;
+                if (nb == 1)
+                    goto copy_a;
+                /* only possible with an inconsistent comparison */
+                if (nb == 0)
+                    goto done;
+            }
+            memcpy(dest, a, size);
+            dest -= size;
+            a -= size;
+            if (--na == 0)
+                goto done;
+        } while (acount >= TIMSORT_MIN_GALLOP || bcount >= TIMSORT_MIN_GALLOP);
+        min_gallop++;
+        s->min_gallop = min_gallop;
+    }
+ done:
+    if (nb)
+        memcpy(dest - (nb - 1) * size, baseb, nb * size);
+    return;
+ copy_a:
+    /* the first element of b belongs at the start of the merge */
+    dest -= na * size;
+    a -= na * size;
+    memmove(dest + size, a + size, na * size);
+    memcpy(dest, b, size);
+}
+
+/* merge the pending runs i and i + 1 */
+static void timsort_merge_at(TimSortState *s, int i)
+{
+    size_t size = s->size;
+    uint8_t *a, *b;
+    size_t na, nb, k;
+
+    a = s->base + s->pending[i].base * size;
+    na = s->pending[i].len;
+    b = s->base + s->pending[i + 1].base * size;
+    nb = s->pending[i + 1].len;
+    s->pending[i].len = na + nb;
+    if (i == s->n - 3)
+        s->pending[i + 1] = s->pending[i + 2];
+    s->n--;
+
+    /* the elements of a lower than b[0] are already in place */
+    k = timsort_gallop_right(s, b, a, na, 0);
+    a += k * size;
+    na -= k;
+    if (na == 0)
+        return;
+    /* the elements of b greater than the last element of a too */
+    nb = timsort_gallop_left(s, a + (na - 1) * size, b, nb, nb - 1);
+    if (nb == 0)
+        return;
+    if (na <= nb)
+        timsort_merge_lo(s, a, na, b, nb);
+    else
+        timsort_merge_hi(s, a, na, b, nb);
+}
+
+/* restore the invariants on the lengths of the pending runs */
+static void timsort_merge_collapse(TimSortState *s)
+{
+    TimSortRun *p = s->pending;
+    int n;
+
+    while (s->n > 1) {
+        n = s->n - 2;
+        if ((n > 0 && p[n - 1].len <= p[n].len + p[n + 1].len) ||
+            (n > 1 && p[n - 2].len <= p[n - 1].len + p[n].len)) {
+            if (p[n - 1].len < p[n + 1].len)
+                n--;
+        } else if (p[n].len > p[n + 1].len) {
+            break;
+        }
+        timsort_merge_at(s, n);
+    }
+}
+
+static void timsort_merge_force_collapse(TimSortState *s)
+{
+    TimSortRun *p = s->pending;
+    int n;
+
+    while (s->n > 1) {
+        n = s->n - 2;
+        if (n > 0 && p[n - 1].len < p[n + 1].len)
+            n--;
+        timsort_merge_at(s, n);
+    }
+}
+
+/* minimum run length: between 32 and 64 so that n / minrun is a power
+   of two or slightly less */
+static size_t timsort_minrun(size_t n)
+{
+    size_t r = 0;
+
+    while (n >= 64) {
+        r |= n & 1;
+        n >>= 1;
+    }
+    return n + r;
+}
+
+void timsort(void *base, size_t nmemb, size_t size,
+             int (*cmp)(const void *, const void *, void *),
+             void *opaque, void *tmp)
+{
+    TimSortState s;
+    size_t lo, n, minrun, force;
+
+    if (nmemb < 2)
+        return;
+    s.base = base;
+    s.size = size;
+    s.cmp = cmp;
+    s.opaque = opaque;
+    s.tmp = tmp;
+    s.min_gallop = TIMSORT_MIN_GALLOP;
+    s.n = 0;
+
+    minrun = timsort_minrun(nmemb);
+    lo = 0;
+    while (lo < nmemb) {
+        n = timsort_count_run(&s, s.base + lo * size, nmemb - lo);
+        if (n < minrun) {
+            /* extend short runs with a binary insertion sort */
+            force = nmemb - lo < minrun ? nmemb - lo : minrun;
+            timsort_binsort(&s, s.base + lo * size, force, n);
+            n = force;
+        }
+        s.pending[s.n].base = lo;
+        s.pending[s.n].len = n;
+        s.n++;
+        timsort_merge_collapse(&s);
+        lo += n;
+    }
+    timsort_merge_force_collapse(&s);
+}
@@ -297,6 +297,7 @@ static inline void dbuf_set_error(DynBuf *s)
 
 int unicode_to_utf8(uint8_t *buf, unsigned int c);
 int unicode_from_utf8(const uint8_t *p, int max_len, const uint8_t **pp);
+size_t ascii_prefix_len(const uint8_t *buf, size_t len);
 
 static inline BOOL is_surrogate(uint32_t c)
 {
@@ -343,5 +344,8 @@ static inline int from_hex(int c)
 void rqsort(void *base, size_t nmemb, size_t size,
             int (*cmp)(const void *, const void *, void *),
             void *arg);
+void timsort(void *base, size_t nmemb, size_t size,
+             int (*cmp)(const void *, const void *, void *),
+             void *opaque, void *tmp);
 
 #endif  /* CUTILS_H */
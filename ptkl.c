@@ -283,6 +283,26 @@ int main(int argc, char **argv) {
 		JS_SetMemoryLimit(rt, opts.memory_limit);
 	if (opts.stack_size != 0)
 		JS_SetMaxStackSize(rt, opts.stack_size);
+	if (opts.gc_policy >= 0 || opts.gc_threshold != 0) {
+		JSGCPolicy policy;
+		JS_GetGCPolicy(rt, &policy);
+		switch (opts.gc_policy) {
+			case JS_GC_POLICY_GROWTH:
+				policy.growth = opts.gc_policy_param;
+				break;
+			case JS_GC_POLICY_OVERHEAD:
+				policy.overhead = opts.gc_policy_param;
+				break;
+			case JS_GC_POLICY_ALLOC_RATE:
+				policy.interval = opts.gc_policy_param;
+				break;
+		}
+		if (opts.gc_policy >= 0)
+			policy.kind = opts.gc_policy;
+		if (opts.gc_threshold != 0)
+			policy.min_threshold = opts.gc_threshold;
+		JS_SetGCPolicy(rt, &policy);
+	}
 
 	// Set bignum extension before creating main and worker contexts
 	bignum_ext = opts.bignum_ext;
@@ -290,7 +310,8 @@ int main(int argc, char **argv) {
 	// Workers
 	js_std_set_worker_new_context_func(JS_NewCustomContext);
 	js_std_init_handlers(rt);
-
+	if (opts.idle_gc >= 0)
+		js_std_set_idle_gc(rt, opts.idle_gc);
 
 	// Runtime context
 	JSContext *ctx = JS_NewCustomContext(rt);
@@ -346,6 +367,9 @@ int main(int argc, char **argv) {
 		js_std_loop(ctx);
 	}
 
+	if (opts.gc_stats)
+		JS_DumpGCStats(stderr, rt);
+
 	if (opts.dump_memory) {
 		JSMemoryUsage stats;
 		JS_ComputeMemoryUsage(rt, &stats);
@@ -28,6 +28,7 @@
 
 #include "ptklargs.h"
 #include "cutils.h"
+#include "quickjs.h"
 
 void help(const int exit_code) {
 	printf("Partikle Runtime (version " CONFIG_VERSION ")\n"
@@ -45,7 +46,13 @@ void help(const int exit_code) {
 		//           "    --bignum               enable the bignum extensions (BigFloat, BigDecimal)\n"
 		//           "-T  --trace                trace memory allocation\n"
 		//           "-d  --dump                 dump the memory usage stats\n"
+		//           "    --gc-stats             print the GC statistics at exit\n"
 		//           "    --memory-limit n       limit the memory usage to 'n' bytes\n"
+		//           "    --gc-growth n          run the GC when the heap grew by 'n' percent (default=50)\n"
+		//           "    --gc-overhead n        keep the GC time around 'n' percent of the running time\n"
+		//           "    --gc-interval n        run the GC after about 'n' ms of allocation\n"
+		//           "    --gc-threshold n       do not run the GC below 'n' bytes of heap (default=256K)\n"
+		//           "    --idle-gc n            run the GC when idle for 'n' ms (default=50, 0=never)\n"
 		//           "    --stack-size n         limit the stack size to 'n' bytes\n"
 		//           "    --unhandled-rejection  dump unhandled promise rejections\n"
 		//           "-q  --quit                 just instantiate the interpreter and quit\n"
@@ -64,6 +71,7 @@ int parse_runtime_args(const int argc, char **argv, struct runtime_opts *opts) {
 	opts->expr = nullptr;
 	opts->interactive = 0;
 	opts->dump_memory = 0;
+	opts->gc_stats = 0;
 	opts->trace_memory = 0;
 	opts->empty_run = 0;
 	// TODO: can't make module the default yet due to tests/test_closure.js::test_with()
@@ -71,6 +79,10 @@ int parse_runtime_args(const int argc, char **argv, struct runtime_opts *opts) {
 	opts->load_std = 1; // 0
 	opts->dump_unhandled_promise_rejection = 0;
 	opts->memory_limit = 0;
+	opts->gc_policy = -1;
+	opts->gc_policy_param = 0;
+	opts->gc_threshold = 0;
+	opts->idle_gc = -1;
 	opts->include_count = 0;
 	opts->stack_size = 0;
 	opts->bignum_ext = 0;
@@ -142,6 +154,10 @@ int parse_runtime_args(const int argc, char **argv, struct runtime_opts *opts) {
 				opts->dump_memory++;
 				continue;
 			}
+			if (!strcmp(longopt, "gc-stats")) {
+				opts->gc_stats = 1;
+				continue;
+			}
 			if (opt == 'T' || !strcmp(longopt, "trace")) {
 				opts->trace_memory++;
 				continue;
@@ -173,6 +189,43 @@ int parse_runtime_args(const int argc, char **argv, struct runtime_opts *opts) {
 					argv[optind++], nullptr);
 				continue;
 			}
+			if (!strcmp(longopt, "gc-growth") ||
+			    !strcmp(longopt, "gc-overhead") ||
+			    !strcmp(longopt, "gc-interval")) {
+				if (optind >= argc) {
+					fprintf(stderr, "expecting %s value",
+						longopt);
+					exit(1);
+				}
+				if (!strcmp(longopt, "gc-growth"))
+					opts->gc_policy = JS_GC_POLICY_GROWTH;
+				else if (!strcmp(longopt, "gc-overhead"))
+					opts->gc_policy = JS_GC_POLICY_OVERHEAD;
+				else
+					opts->gc_policy = JS_GC_POLICY_ALLOC_RATE;
+				opts->gc_policy_param = (int) strtod(
+					argv[optind++], nullptr);
+				continue;
+			}
+			if (!strcmp(longopt, "gc-threshold")) {
+				if (optind >= argc) {
+					fprintf(stderr,
+						"expecting GC threshold");
+					exit(1);
+				}
+				opts->gc_threshold = (size_t) strtod(
+					argv[optind++], nullptr);
+				continue;
+			}
+			if (!strcmp(longopt, "idle-gc")) {
+				if (optind >= argc) {
+					fprintf(stderr, "expecting idle delay");
+					exit(1);
+				}
+				opts->idle_gc = (int) strtod(argv[optind++],
+							     nullptr);
+				continue;
+			}
 			if (!strcmp(longopt, "stack-size")) {
 				if (optind >= argc) {
 					fprintf(stderr, "expecting stack size");
@@ -30,12 +30,17 @@ struct runtime_opts {
 	char *expr;
 	int interactive;
 	int dump_memory;
+	int gc_stats;
 	int trace_memory;
 	int empty_run;
 	int module;
 	int load_std;
 	int dump_unhandled_promise_rejection;
 	size_t memory_limit;
+	int gc_policy; /* JSGCPolicyEnum, -1 for the default */
+	int gc_policy_param;
+	size_t gc_threshold;
+	int idle_gc; /* -1 for the default */
 	char *include_list[32];
 	int include_count;
 	size_t stack_size;
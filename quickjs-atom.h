@@ -185,6 +185,11 @@ DEF(timed_out, "timed-out")
 DEF(ok, "ok")
 /* */
 DEF(toJSON, "toJSON")
+DEF(fatal, "fatal")
+DEF(ignoreBOM, "ignoreBOM")
+DEF(stream, "stream")
+DEF(read, "read")
+DEF(written, "written")
 /* class names */
 DEF(Object, "Object")
 DEF(Array, "Array")
@@ -243,6 +248,10 @@ DEF(AsyncFunctionResolve, "AsyncFunctionResolve")
 DEF(AsyncFunctionReject, "AsyncFunctionReject")
 DEF(AsyncGeneratorFunction, "AsyncGeneratorFunction")
 DEF(AsyncGenerator, "AsyncGenerator")
+DEF(TextEncoder, "TextEncoder")
+DEF(TextDecoder, "TextDecoder")
+DEF(WeakRef, "WeakRef")
+DEF(FinalizationRegistry, "FinalizationRegistry")
 DEF(EvalError, "EvalError")
 DEF(RangeError, "RangeError")
 DEF(ReferenceError, "ReferenceError")
@@ -95,6 +95,13 @@ typedef struct {
 	JSValue func;
 } JSOSTimer;
 
+typedef struct {
+	struct list_head link;
+	int callback_id;
+	int64_t timeout; /* 0 if none */
+	JSValue func;
+} JSOSIdleCallback;
+
 typedef struct {
 	struct list_head link;
 	uint8_t *data;
@@ -124,9 +131,14 @@ typedef struct JSThreadState {
 	struct list_head os_rw_handlers; /* list of JSOSRWHandler.link */
 	struct list_head os_signal_handlers; /* list JSOSSignalHandler.link */
 	struct list_head os_timers; /* list of JSOSTimer.link */
+	struct list_head os_idle_callbacks; /* list of JSOSIdleCallback.link */
 	struct list_head port_list; /* list of JSWorkerMessageHandler.link */
 	int eval_script_recurse; /* only used in the main thread */
 	int next_timer_id; /* for setTimeout() */
+	/* minimum idle time in ms before running the GC, 0 to disable */
+	int idle_gc_delay;
+	/* object allocation count at the last idle GC */
+	int64_t idle_gc_alloc_count;
 	/* not used in the main thread */
 	JSWorkerMessagePipe *recv_pipe, *send_pipe;
 } JSThreadState;
@@ -703,6 +715,94 @@ static JSValue js_std_gc(JSContext *ctx, JSValueConst this_val,
 	return JS_UNDEFINED;
 }
 
+static JSValue js_std_gcStats(JSContext *ctx, JSValueConst this_val,
+			      int argc, JSValueConst *argv) {
+	JSRuntime *rt = JS_GetRuntime(ctx);
+	JSValue obj, tab, classes, cobj;
+	JSGCStats s;
+	JSClassStats cs;
+	JSClassID class_id;
+	int i;
+
+	JS_GetGCStats(rt, &s);
+	obj = JS_NewObject(ctx);
+	if (JS_IsException(obj))
+		return obj;
+	JS_DefinePropertyValueStr(ctx, obj, "mallocSize",
+				  JS_NewInt64(ctx, s.malloc_size),
+				  JS_PROP_C_W_E);
+	JS_DefinePropertyValueStr(ctx, obj, "mallocCount",
+				  JS_NewInt64(ctx, s.malloc_count),
+				  JS_PROP_C_W_E);
+	JS_DefinePropertyValueStr(ctx, obj, "mallocLimit",
+				  JS_NewInt64(ctx, s.malloc_limit),
+				  JS_PROP_C_W_E);
+	JS_DefinePropertyValueStr(ctx, obj, "gcThreshold",
+				  JS_NewInt64(ctx, s.gc_threshold),
+				  JS_PROP_C_W_E);
+	JS_DefinePropertyValueStr(ctx, obj, "poolSize",
+				  JS_NewInt64(ctx, s.pool_size),
+				  JS_PROP_C_W_E);
+	JS_DefinePropertyValueStr(ctx, obj, "poolCount",
+				  JS_NewInt64(ctx, s.pool_count),
+				  JS_PROP_C_W_E);
+	JS_DefinePropertyValueStr(ctx, obj, "objectCount",
+				  JS_NewInt64(ctx, s.obj_count),
+				  JS_PROP_C_W_E);
+	JS_DefinePropertyValueStr(ctx, obj, "objectAllocCount",
+				  JS_NewInt64(ctx, s.obj_alloc_count),
+				  JS_PROP_C_W_E);
+	JS_DefinePropertyValueStr(ctx, obj, "hashedShapeCount",
+				  JS_NewInt64(ctx, s.hashed_shape_count),
+				  JS_PROP_C_W_E);
+	JS_DefinePropertyValueStr(ctx, obj, "gcCount",
+				  JS_NewInt64(ctx, s.gc_count),
+				  JS_PROP_C_W_E);
+	JS_DefinePropertyValueStr(ctx, obj, "gcAutoCount",
+				  JS_NewInt64(ctx, s.gc_auto_count),
+				  JS_PROP_C_W_E);
+	JS_DefinePropertyValueStr(ctx, obj, "gcFreedCount",
+				  JS_NewInt64(ctx, s.gc_freed_count),
+				  JS_PROP_C_W_E);
+	/* pause durations in ms */
+	JS_DefinePropertyValueStr(ctx, obj, "gcPauseTotal",
+				  JS_NewFloat64(ctx, s.gc_pause_total / 1e6),
+				  JS_PROP_C_W_E);
+	JS_DefinePropertyValueStr(ctx, obj, "gcPauseMax",
+				  JS_NewFloat64(ctx, s.gc_pause_max / 1e6),
+				  JS_PROP_C_W_E);
+	tab = JS_NewArray(ctx);
+	for (i = 0; i < JS_GC_PAUSE_HISTOGRAM_SIZE; i++) {
+		JS_DefinePropertyValueUint32(
+			ctx, tab, i, JS_NewInt64(ctx, s.gc_pause_histogram[i]),
+			JS_PROP_C_W_E);
+	}
+	JS_DefinePropertyValueStr(ctx, obj, "gcPauseHistogram", tab,
+				  JS_PROP_C_W_E);
+	/* several classes may have the same name */
+	classes = JS_NewArray(ctx);
+	i = 0;
+	for (class_id = 1; JS_GetClassStats(rt, class_id, &cs); class_id++) {
+		if (cs.obj_alloc_count == 0)
+			continue;
+		cobj = JS_NewObject(ctx);
+		JS_DefinePropertyValueStr(ctx, cobj, "name",
+					  JS_AtomToString(ctx, cs.class_name),
+					  JS_PROP_C_W_E);
+		JS_DefinePropertyValueStr(ctx, cobj, "allocCount",
+					  JS_NewInt64(ctx, cs.obj_alloc_count),
+					  JS_PROP_C_W_E);
+		JS_DefinePropertyValueStr(ctx, cobj, "count",
+					  JS_NewInt64(ctx, cs.obj_count),
+					  JS_PROP_C_W_E);
+		JS_DefinePropertyValueUint32(ctx, classes, i++, cobj,
+					     JS_PROP_C_W_E);
+	}
+	JS_DefinePropertyValueStr(ctx, obj, "classes", classes,
+				  JS_PROP_C_W_E);
+	return obj;
+}
+
 static int interrupt_handler(JSRuntime *rt, void *opaque) {
 	return (os_pending_signals >> SIGINT) & 1;
 }
@@ -1455,6 +1555,7 @@ static const JSCFunctionListEntry js_std_error_props[] = {
 static const JSCFunctionListEntry js_std_funcs[] = {
 	JS_CFUNC_DEF("exit", 1, js_std_exit),
 	JS_CFUNC_DEF("gc", 0, js_std_gc),
+	JS_CFUNC_DEF("gcStats", 0, js_std_gcStats),
 	JS_CFUNC_DEF("evalScript", 1, js_evalScript),
 	JS_CFUNC_DEF("loadScript", 1, js_loadScript),
 	JS_CFUNC_DEF("getenv", 1, js_std_getenv),
@@ -1986,6 +2087,145 @@ static JSValue js_os_sleepAsync(JSContext *ctx, JSValueConst this_val,
 	return promise;
 }
 
+static void free_idle_callback(JSRuntime *rt, JSOSIdleCallback *ic) {
+	list_del(&ic->link);
+	JS_FreeValueRT(rt, ic->func);
+	js_free_rt(rt, ic);
+}
+
+static JSValue js_os_requestIdleCallback(JSContext *ctx, JSValueConst this_val,
+					 int argc, JSValueConst *argv) {
+	JSRuntime *rt = JS_GetRuntime(ctx);
+	JSThreadState *ts = JS_GetRuntimeOpaque(rt);
+	int64_t timeout = 0;
+	JSValueConst func;
+	JSOSIdleCallback *ic;
+
+	func = argv[0];
+	if (!JS_IsFunction(ctx, func))
+		return JS_ThrowTypeError(ctx, "not a function");
+	if (argc >= 2 && JS_IsObject(argv[1])) {
+		JSValue val = JS_GetPropertyStr(ctx, argv[1], "timeout");
+		int res = JS_ToInt64(ctx, &timeout, val);
+		JS_FreeValue(ctx, val);
+		if (res)
+			return JS_EXCEPTION;
+	}
+	ic = js_mallocz(ctx, sizeof(*ic));
+	if (!ic)
+		return JS_EXCEPTION;
+	/* share the identifiers with the timers */
+	ic->callback_id = ts->next_timer_id;
+	if (ts->next_timer_id == INT32_MAX)
+		ts->next_timer_id = 1;
+	else
+		ts->next_timer_id++;
+	if (timeout > 0)
+		ic->timeout = get_time_ms() + timeout;
+	ic->func = JS_DupValue(ctx, func);
+	list_add_tail(&ic->link, &ts->os_idle_callbacks);
+	return JS_NewInt32(ctx, ic->callback_id);
+}
+
+static JSValue js_os_cancelIdleCallback(JSContext *ctx, JSValueConst this_val,
+					int argc, JSValueConst *argv) {
+	JSRuntime *rt = JS_GetRuntime(ctx);
+	JSThreadState *ts = JS_GetRuntimeOpaque(rt);
+	struct list_head *el;
+	int callback_id;
+
+	if (JS_ToInt32(ctx, &callback_id, argv[0]))
+		return JS_EXCEPTION;
+	list_for_each(el, &ts->os_idle_callbacks) {
+		JSOSIdleCallback *ic = list_entry(el, JSOSIdleCallback, link);
+		if (ic->callback_id == callback_id) {
+			free_idle_callback(rt, ic);
+			break;
+		}
+	}
+	return JS_UNDEFINED;
+}
+
+static JSValue js_os_idle_time_remaining(JSContext *ctx,
+					 JSValueConst this_val,
+					 int argc, JSValueConst *argv,
+					 int magic, JSValue *func_data) {
+	double deadline, remaining;
+
+	if (JS_ToFloat64(ctx, &deadline, func_data[0]))
+		return JS_EXCEPTION;
+	remaining = deadline - (double) get_time_ns() / 1e6;
+	return JS_NewFloat64(ctx, remaining > 0 ? remaining : 0);
+}
+
+/* call the idle callback 'ic' with an IdleDeadline-like object. The
+   deadline is in ms. */
+static void call_idle_callback(JSContext *ctx, JSOSIdleCallback *ic,
+			       double deadline, BOOL did_timeout) {
+	JSRuntime *rt = JS_GetRuntime(ctx);
+	JSValue func, obj, time_remaining, ret;
+
+	func = ic->func;
+	ic->func = JS_UNDEFINED;
+	free_idle_callback(rt, ic);
+
+	obj = JS_NewObject(ctx);
+	if (JS_IsException(obj))
+		goto fail;
+	JS_DefinePropertyValueStr(ctx, obj, "didTimeout",
+				  JS_NewBool(ctx, did_timeout), JS_PROP_C_W_E);
+	time_remaining = JS_NewFloat64(ctx, deadline);
+	JS_DefinePropertyValueStr(ctx, obj, "timeRemaining",
+				  JS_NewCFunctionData(ctx,
+						      js_os_idle_time_remaining,
+						      0, 0, 1, &time_remaining),
+				  JS_PROP_C_W_E);
+	ret = JS_Call(ctx, func, JS_UNDEFINED, 1, (JSValueConst *) &obj);
+	JS_FreeValue(ctx, obj);
+	if (JS_IsException(ret)) {
+	fail:
+		js_std_dump_error(ctx);
+	} else {
+		JS_FreeValue(ctx, ret);
+	}
+	JS_FreeValue(ctx, func);
+}
+
+/* maximum length of an idle period given to the idle callbacks, in ms */
+#define IDLE_PERIOD_MAX 50
+
+/* run some idle work if the event loop would otherwise wait for
+   'idle_delay' ms (-1 for ever). Return TRUE if something was done. */
+static BOOL js_os_run_idle(JSContext *ctx, int64_t idle_delay) {
+	JSRuntime *rt = JS_GetRuntime(ctx);
+	JSThreadState *ts = JS_GetRuntimeOpaque(rt);
+	JSGCStats stats;
+
+	if (!list_empty(&ts->os_idle_callbacks)) {
+		JSOSIdleCallback *ic = list_entry(ts->os_idle_callbacks.next,
+						  JSOSIdleCallback, link);
+		if (idle_delay < 0 || idle_delay > IDLE_PERIOD_MAX)
+			idle_delay = IDLE_PERIOD_MAX;
+		call_idle_callback(ctx, ic, (double) get_time_ns() / 1e6 +
+				   idle_delay, FALSE);
+		return TRUE;
+	}
+	if (ts->idle_gc_delay > 0 &&
+	    (idle_delay < 0 || idle_delay >= ts->idle_gc_delay)) {
+		/* only collect if objects were allocated since the last
+		   idle GC */
+		JS_GetGCStats(rt, &stats);
+		if (stats.obj_alloc_count != ts->idle_gc_alloc_count) {
+			JS_RunGC(rt);
+			JS_CompactMemory(rt);
+			fflush(stdout);
+			ts->idle_gc_alloc_count = stats.obj_alloc_count;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
 static void call_handler(JSContext *ctx, JSValueConst func) {
 	JSValue ret, func1;
 	/* 'func' might be destroyed when calling itself (if it frees the
@@ -2105,12 +2345,29 @@ static int js_os_poll(JSContext *ctx) {
 	}
 
 	if (list_empty(&ts->os_rw_handlers) && list_empty(&ts->os_timers) &&
-	    list_empty(&ts->port_list))
+	    list_empty(&ts->port_list) && list_empty(&ts->os_idle_callbacks))
 		return -1; /* no more events */
 
-	if (!list_empty(&ts->os_timers)) {
+	if (!list_empty(&ts->os_timers) ||
+	    !list_empty(&ts->os_idle_callbacks)) {
 		cur_time = get_time_ms();
 		min_delay = 10000;
+		list_for_each(el, &ts->os_idle_callbacks) {
+			JSOSIdleCallback *ic = list_entry(el, JSOSIdleCallback,
+							  link);
+			if (ic->timeout == 0)
+				continue;
+			delay = ic->timeout - cur_time;
+			if (delay <= 0) {
+				/* the loop stayed busy for too long */
+				call_idle_callback(ctx, ic,
+						   (double) get_time_ns() / 1e6,
+						   TRUE);
+				return 0;
+			} else if (delay < min_delay) {
+				min_delay = delay;
+			}
+		}
 		list_for_each(el, &ts->os_timers) {
 			JSOSTimer *th = list_entry(el, JSOSTimer, link);
 			delay = th->timeout - cur_time;
@@ -2131,6 +2388,7 @@ static int js_os_poll(JSContext *ctx) {
 		tv.tv_usec = (min_delay % 1000) * 1000;
 		tvp = &tv;
 	} else {
+		min_delay = -1; /* wait for ever */
 		tvp = nullptr;
 	}
 
@@ -2156,6 +2414,18 @@ static int js_os_poll(JSContext *ctx) {
 		}
 	}
 
+	/* probe only if js_os_run_idle() could do something: the loop is
+	   idle if no handler is ready now */
+	if (!list_empty(&ts->os_idle_callbacks) ||
+	    (ts->idle_gc_delay > 0 &&
+	     (min_delay < 0 || min_delay >= ts->idle_gc_delay))) {
+		fd_set rfds1 = rfds, wfds1 = wfds;
+		struct timeval tv1 = { 0, 0 };
+		if (select(fd_max + 1, &rfds1, &wfds1, nullptr, &tv1) == 0 &&
+		    js_os_run_idle(ctx, min_delay))
+			return 0;
+	}
+
 	ret = select(fd_max + 1, &rfds, &wfds, nullptr, tvp);
 	if (ret > 0) {
 		list_for_each(el, &ts->os_rw_handlers) {
@@ -3411,6 +3681,8 @@ static const JSCFunctionListEntry js_os_funcs[] = {
 	JS_CFUNC_DEF("setTimeout", 2, js_os_setTimeout),
 	JS_CFUNC_DEF("clearTimeout", 1, js_os_clearTimeout),
 	JS_CFUNC_DEF("sleepAsync", 1, js_os_sleepAsync),
+	JS_CFUNC_DEF("requestIdleCallback", 1, js_os_requestIdleCallback),
+	JS_CFUNC_DEF("cancelIdleCallback", 1, js_os_cancelIdleCallback),
 	JS_PROP_STRING_DEF("platform", OS_PLATFORM, 0),
 	JS_CFUNC_DEF("getcwd", 0, js_os_getcwd),
 	JS_CFUNC_DEF("chdir", 0, js_os_chdir),
@@ -3560,8 +3832,10 @@ void js_std_init_handlers(JSRuntime *rt) {
 	init_list_head(&ts->os_rw_handlers);
 	init_list_head(&ts->os_signal_handlers);
 	init_list_head(&ts->os_timers);
+	init_list_head(&ts->os_idle_callbacks);
 	init_list_head(&ts->port_list);
 	ts->next_timer_id = 1;
+	ts->idle_gc_delay = 50;
 
 	JS_SetRuntimeOpaque(rt, ts);
 
@@ -3578,6 +3852,11 @@ void js_std_init_handlers(JSRuntime *rt) {
 #endif
 }
 
+void js_std_set_idle_gc(JSRuntime *rt, int delay_ms) {
+	JSThreadState *ts = JS_GetRuntimeOpaque(rt);
+	ts->idle_gc_delay = max_int(delay_ms, 0);
+}
+
 void js_std_free_handlers(JSRuntime *rt) {
 	JSThreadState *ts = JS_GetRuntimeOpaque(rt);
 	struct list_head *el, *el1;
@@ -3597,6 +3876,11 @@ void js_std_free_handlers(JSRuntime *rt) {
 		free_timer(rt, th);
 	}
 
+	list_for_each_safe(el, el1, &ts->os_idle_callbacks) {
+		JSOSIdleCallback *ic = list_entry(el, JSOSIdleCallback, link);
+		free_idle_callback(rt, ic);
+	}
+
 #ifdef USE_WORKER
 	/* XXX: free port_list ? */
 	js_free_message_pipe(ts->recv_pipe);
@@ -3658,15 +3942,9 @@ void js_std_loop(JSContext *ctx) {
 
 	for (;;) {
 		/* execute the pending jobs */
-		for (;;) {
-			err = JS_ExecutePendingJob(JS_GetRuntime(ctx), &ctx1);
-			if (err <= 0) {
-				if (err < 0) {
-					js_std_dump_error(ctx1);
-				}
-				break;
-			}
-		}
+		err = JS_ExecutePendingJobs(JS_GetRuntime(ctx), -1, &ctx1);
+		if (err < 0)
+			js_std_dump_error(ctx1);
 
 		if (!os_poll_func || os_poll_func(ctx))
 			break;
@@ -47,6 +47,10 @@ void js_std_init_handlers(JSRuntime *rt);
 
 void js_std_free_handlers(JSRuntime *rt);
 
+/* run the GC when the event loop is idle for at least 'delay_ms' ms
+   (default = 50). 0 disables it. */
+void js_std_set_idle_gc(JSRuntime *rt, int delay_ms);
+
 void js_std_dump_error(JSContext *ctx);
 
 uint8_t *js_load_file(JSContext *ctx, size_t *pbuf_len, const char *filename);
@@ -76,6 +76,7 @@ DEF(      push_this, 1, 0, 1, none) /* only used at the start of a function */
 DEF(     push_false, 1, 0, 1, none)
 DEF(      push_true, 1, 0, 1, none)
 DEF(         object, 1, 0, 1, none)
+DEF( object_literal, 5, 0, 1, const) /* new object with the shape of a template object */
 DEF( special_object, 2, 0, 1, u8) /* only used at the start of a function */
 DEF(           rest, 3, 0, 1, u16) /* only used at the start of a function */
 
@@ -105,7 +106,7 @@ DEF(      tail_call, 3, 1, 0, npop) /* arguments are not counted in n_pop */
 DEF(    call_method, 3, 2, 1, npop) /* arguments are not counted in n_pop */
 DEF(tail_call_method, 3, 2, 0, npop) /* arguments are not counted in n_pop */
 DEF(     array_from, 3, 0, 1, npop) /* arguments are not counted in n_pop */
-DEF(          apply, 3, 3, 1, u16)
+DEF(          apply, 3, 3, 1, u16) /* func this array -> ret, see OP_APPLY_x */
 DEF(         return, 1, 1, 0, none)
 DEF(   return_undef, 1, 0, 0, none)
 DEF(check_ctor_return, 1, 1, 2, none)
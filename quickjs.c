@@ -39,6 +39,9 @@
 #elif defined(__FreeBSD__)
 #include <malloc_np.h>
 #endif
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "cutils.h"
 #include "list.h"
@@ -111,6 +114,7 @@
 #include <pthread.h>
 #include <stdatomic.h>
 #include <errno.h>
+#include <unistd.h>
 #endif
 
 enum {
@@ -169,11 +173,13 @@ enum {
 	JS_CLASS_PROMISE_RESOLVE_FUNCTION, /* u.promise_function_data */
 	JS_CLASS_PROMISE_REJECT_FUNCTION, /* u.promise_function_data */
 	JS_CLASS_ASYNC_FUNCTION, /* u.func */
-	JS_CLASS_ASYNC_FUNCTION_RESOLVE, /* u.async_function_data */
-	JS_CLASS_ASYNC_FUNCTION_REJECT, /* u.async_function_data */
 	JS_CLASS_ASYNC_FROM_SYNC_ITERATOR, /* u.async_from_sync_iterator_data */
 	JS_CLASS_ASYNC_GENERATOR_FUNCTION, /* u.func */
 	JS_CLASS_ASYNC_GENERATOR, /* u.async_generator_data */
+	JS_CLASS_TEXT_ENCODER, /* no data */
+	JS_CLASS_TEXT_DECODER, /* u.text_decoder */
+	JS_CLASS_WEAK_REF, /* u.weak_ref_data */
+	JS_CLASS_FINALIZATION_REGISTRY, /* u.fin_reg_data */
 
 	JS_CLASS_INIT_COUNT, /* last entry for predefined classes */
 };
@@ -200,9 +206,17 @@ typedef enum JSErrorEnum {
 #define JS_STACK_SIZE_MAX 65534
 #define JS_STRING_LEN_MAX ((1 << 30) - 1)
 
+/* the JSAsyncFunctionState blocks (with their stack frame) of up to
+   JS_ASYNC_FUNC_POOL_CLASSES * JS_ASYNC_FUNC_POOL_GRANULE bytes are
+   kept for reuse, at most JS_ASYNC_FUNC_POOL_MAX of each size */
+#define JS_ASYNC_FUNC_POOL_GRANULE 64
+#define JS_ASYNC_FUNC_POOL_CLASSES 16
+#define JS_ASYNC_FUNC_POOL_MAX 32
+
 #define __exception __attribute__((warn_unused_result))
 
 typedef struct JSShape JSShape;
+typedef struct JSShapeEnumCache JSShapeEnumCache;
 typedef struct JSString JSString;
 typedef struct JSString JSAtomStruct;
 
@@ -263,6 +277,18 @@ struct JSRuntime {
 	struct list_head tmp_obj_list; /* used during GC */
 	JSGCPhaseEnum gc_phase: 8;
 	size_t malloc_gc_threshold;
+	/* GC statistics, see JS_GetGCStats() */
+	int64_t gc_count;
+	int64_t gc_auto_count;
+	int64_t gc_freed_count;
+	int64_t gc_pause_total; /* in ns */
+	int64_t gc_pause_max; /* in ns */
+	int64_t gc_pause_histogram[JS_GC_PAUSE_HISTOGRAM_SIZE];
+	/* automatic GC threshold policy, see gc_update_threshold() */
+	JSGCPolicy gc_policy;
+	size_t gc_last_live_size; /* malloc_size after the last automatic GC */
+	int64_t gc_last_time; /* end of the last automatic GC in ns */
+	double gc_alloc_rate; /* smoothed heap growth rate in bytes per ns */
 #ifdef DUMP_LEAKS
     struct list_head string_list; /* list of JSString.link */
 #endif
@@ -283,7 +309,28 @@ struct JSRuntime {
 	JSHostPromiseRejectionTracker *host_promise_rejection_tracker;
 	void *host_promise_rejection_tracker_opaque;
 
-	struct list_head job_list; /* list of JSJobEntry.link */
+	/* pending jobs: ring buffer of job_queue_size entries (0 or a
+	   power of two), the first one being at job_queue_head */
+	struct JSJobEntry *job_queue;
+	uint32_t job_queue_size;
+	uint32_t job_queue_head;
+	uint32_t job_count;
+
+	/* free lists of JSAsyncFunctionState blocks by size class */
+	struct JSAsyncFuncBlock *async_func_pool[JS_ASYNC_FUNC_POOL_CLASSES];
+	uint8_t async_func_pool_count[JS_ASYNC_FUNC_POOL_CLASSES];
+	/* bytes in the pool. They are included in malloc_state but not
+	   counted as live memory by the GC */
+	size_t async_func_pool_size;
+
+	/* weak references: open addressing (linear probing) hash table
+	   indexed by the objects having JSObject.has_weak_ref set */
+	struct JSWeakRefSlot *weak_ref_hash;
+	uint32_t weak_ref_hash_size; /* 0 or a power of two */
+	uint32_t weak_ref_count; /* number of used slots */
+	/* WeakRef targets kept alive until the end of the current job
+	   (list of JSWeakRefData.kept_link) */
+	struct list_head weak_ref_kept_list;
 
 	JSModuleNormalizeFunc *module_normalize_func;
 	JSModuleLoaderFunc *module_loader_func;
@@ -300,6 +347,8 @@ struct JSRuntime {
 	int shape_hash_size;
 	int shape_hash_count; /* number of hashed shapes */
 	JSShape **shape_hash;
+	/* shared one character Latin-1 strings, see js_new_string_char8() */
+	JSString *char_strings[256];
 	bf_context_t bf_ctx;
 	JSNumericOperations bigint_ops;
 #ifdef CONFIG_BIGNUM
@@ -318,6 +367,9 @@ struct JSClass {
 	JSClassCall *call;
 	/* pointers for exotic behavior, can be nullptr if none are present */
 	const JSClassExoticMethods *exotic;
+	/* number of objects of this class allocated and freed */
+	int64_t obj_alloc_count;
+	int64_t obj_free_count;
 };
 
 #define JS_MODE_STRICT (1 << 0)
@@ -356,7 +408,8 @@ typedef enum {
 struct JSGCObjectHeader {
 	int ref_count; /* must come first, 32-bit */
 	JSGCObjectTypeEnum gc_obj_type: 4;
-	uint8_t mark: 4; /* used by the GC */
+	uint8_t mark: 1; /* used by the GC */
+	uint8_t dummy0: 3; /* not used by the GC */
 	uint8_t dummy1; /* not used by the GC */
 	uint16_t dummy2; /* not used by the GC */
 	struct list_head link;
@@ -421,6 +474,20 @@ typedef enum {
    enough to call the interrupt callback often. */
 #define JS_INTERRUPT_COUNTER_INIT 10000
 
+#define JS_GLOBAL_VAR_CELL_COUNT 256 /* must be a power of two */
+
+/* Location of a global variable resolved by a previous access. The cell
+   is valid as long as the property at 'prop_idx' still has the same
+   atom and is a plain data property. A cell in the global object is
+   also invalidated when a lexical variable is added because it might
+   shadow it. */
+typedef struct JSGlobalVarCell {
+	JSAtom atom; /* JS_ATOM_NULL if the cell is unused */
+	uint32_t prop_idx; /* property index in global_obj or global_var_obj */
+	uint32_t lexical_count; /* global_var_obj property count */
+	BOOL is_lexical; /* TRUE if the variable is in global_var_obj */
+} JSGlobalVarCell;
+
 struct JSContext {
 	JSGCObjectHeader header; /* must come first */
 	JSRuntime *rt;
@@ -446,6 +513,8 @@ struct JSContext {
 
 	JSValue global_obj; /* global object */
 	JSValue global_var_obj; /* contains the global let/const definitions */
+	/* global variable cells, indexed by atom */
+	JSGlobalVarCell global_var_cells[JS_GLOBAL_VAR_CELL_COUNT];
 
 	uint64_t random_state;
 	bf_context_t *bf_ctx; /* points to rt->bf_ctx, shared by all contexts */
@@ -518,6 +587,70 @@ struct JSString {
 	} u;
 };
 
+/* Latin-1 strings of 1 to JS_SHORT_STRING_MAX_LEN characters may be
+   stored in the value itself with the JS_TAG_SHORT_STRING tag: bits
+   0-7 of the payload hold the length and the following bytes the
+   characters. They are only created for values handed to the JS code:
+   JS_ToString() and the functions returning a JSString always give a
+   JS_TAG_STRING value. */
+#if defined(JS_NAN_BOXING) || defined(CONFIG_CHECK_JSVALUE)
+#define JS_SHORT_STRING_MAX_LEN 0
+#else
+#define JS_SHORT_STRING_MAX_LEN 7
+#endif
+
+/* read-only JSString copy of a short string */
+typedef union JSShortStringBuf {
+	JSString str;
+	uint8_t buf[sizeof(JSString) + JS_SHORT_STRING_MAX_LEN + 1];
+} JSShortStringBuf;
+
+static inline BOOL tag_is_string(uint32_t tag) {
+	return tag == JS_TAG_STRING || tag == JS_TAG_SHORT_STRING;
+}
+
+static inline uint64_t js_short_string_bits(JSValueConst v) {
+	return (uintptr_t) JS_VALUE_GET_PTR(v);
+}
+
+static inline int js_short_string_len(JSValueConst v) {
+	return js_short_string_bits(v) & 0xff;
+}
+
+static inline JSValue js_new_short_string(const uint8_t *buf, int len) {
+	uint64_t v = len;
+	int i;
+	for (i = 0; i < len; i++)
+		v |= (uint64_t) buf[i] << (8 * (i + 1));
+	return JS_MKPTR(JS_TAG_SHORT_STRING, (void *) (uintptr_t) v);
+}
+
+/* return the JSString of the string value 'v'. 'sbuf' holds it if 'v'
+   is a short string. */
+static JSString *js_get_string(JSShortStringBuf *sbuf, JSValueConst v) {
+	JSString *p;
+	uint64_t bits;
+	int i, len;
+
+	if (likely(JS_VALUE_GET_TAG(v) == JS_TAG_STRING))
+		return JS_VALUE_GET_PTR(v);
+	p = &sbuf->str;
+	bits = js_short_string_bits(v);
+	len = bits & 0xff;
+	p->header.ref_count = 1;
+	p->len = len;
+	p->is_wide_char = 0;
+	p->hash = 0;
+	p->atom_type = 0;
+	p->hash_next = 0;
+	for (i = 0; i < len; i++) {
+		bits >>= 8;
+		p->u.str8[i] = bits;
+	}
+	p->u.str8[len] = '\0';
+	return p;
+}
+
 typedef struct JSClosureVar {
 	uint8_t is_local: 1;
 	uint8_t is_arg: 1;
@@ -629,6 +762,12 @@ typedef struct JSFunctionBytecode {
 	uint16_t var_count;
 	uint16_t defined_arg_count; /* for length function property */
 	uint16_t stack_size; /* maximum stack size */
+	/* property count of the last object constructed with this function
+	   as new.target, used to size the next ones */
+	uint16_t ctor_prop_count;
+	/* empty shape sized from ctor_prop_count, shared by the objects
+	   constructed with this function as new.target */
+	JSShape *ctor_shape;
 	JSContext *realm; /* function realm */
 	JSValue *cpool; /* constant pool (self pointer) */
 	int cpool_count;
@@ -665,6 +804,8 @@ typedef struct JSForInIterator {
 	uint8_t in_prototype_chain;
 	uint8_t is_array;
 	JSPropertyEnum *tab_atom; /* is_array = FALSE */
+	/* if not nullptr, enumerable keys of 'obj' instead of tab_atom */
+	JSShapeEnumCache *enum_cache;
 } JSForInIterator;
 
 typedef struct JSRegExp {
@@ -701,6 +842,9 @@ typedef struct JSAsyncFunctionState {
 	JSGCObjectHeader header;
 	JSValue this_val; /* 'this' argument */
 	int argc; /* number of function arguments */
+	/* index in rt->async_func_pool or -1. The stack frame follows the
+	   structure in the same memory block */
+	int pool_idx;
 	BOOL throw_flag; /* used to throw an exception in JS_CallInternal() */
 	BOOL is_completed; /* TRUE if the function has returned. The stack
                           frame is no longer valid */
@@ -849,12 +993,22 @@ struct JSModuleDef {
 	JSValue meta_obj; /* for import.meta */
 };
 
+/* the arguments of the jobs are stored in the queue entry unless
+   there are more than JS_JOB_INLINE_ARGS of them */
+#define JS_JOB_INLINE_ARGS 5
+
 typedef struct JSJobEntry {
-	struct list_head link;
 	JSContext *ctx;
+	/* nullptr for the internal job resuming 'async_func' after an
+	   await. argv[0] is the awaited result and argv[1] is TRUE if it
+	   was rejected */
 	JSJobFunc *job_func;
+	struct JSAsyncFunctionState *async_func;
 	int argc;
-	JSValue argv[0];
+	union {
+		JSValue argv[JS_JOB_INLINE_ARGS];
+		JSValue *ext_argv; /* if argc > JS_JOB_INLINE_ARGS */
+	} u;
 } JSJobEntry;
 
 typedef struct JSProperty {
@@ -882,6 +1036,18 @@ typedef struct JSProperty {
 #define JS_PROP_INITIAL_SIZE 2
 #define JS_PROP_INITIAL_HASH_SIZE 4 /* must be a power of two */
 #define JS_ARRAY_INITIAL_SIZE 2
+/* objects with more properties than this no longer share their shape:
+   they are used as dictionaries */
+#define JS_PROP_DICT_THRESHOLD 64
+
+/* own enumerable string keys of the objects having a given shape, in
+   the Object.keys() order. It is also referenced by the for-in
+   iterators. */
+struct JSShapeEnumCache {
+	int ref_count;
+	uint32_t count;
+	JSAtom atoms[0];
+};
 
 typedef struct JSShapeProperty {
 	uint32_t hash_next: 26; /* 0 if last in list */
@@ -907,6 +1073,9 @@ struct JSShape {
 	int deleted_prop_count;
 	JSShape *shape_hash_next; /* in JSRuntime.shape_hash[h] list */
 	JSObject *proto;
+	/* enumerable string keys, nullptr if not computed. Freed when the
+	   shape is modified */
+	JSShapeEnumCache *enum_cache;
 	JSShapeProperty prop[0]; /* prop_size elements */
 };
 
@@ -917,8 +1086,10 @@ struct JSObject {
 		struct {
 			int __gc_ref_count;
 			/* corresponds to header.ref_count */
-			uint8_t __gc_mark;
+			uint8_t __gc_mark: 7;
 			/* corresponds to header.mark/gc_obj_type */
+			uint8_t has_weak_ref: 1;
+			/* TRUE if the object is in rt->weak_ref_hash */
 
 			uint8_t extensible: 1;
 			uint8_t free_mark: 1;
@@ -942,9 +1113,6 @@ struct JSObject {
 	JSShape *shape; /* prototype and property names + flag */
 	JSProperty *prop; /* array of properties */
 	/* byte offsets: 24/40 */
-	struct JSMapRecord *first_weak_ref;
-	/* XXX: use a bit and an external hash table? */
-	/* byte offsets: 28/48 */
 	union {
 		void *opaque;
 		struct JSBoundFunction *bound_function;
@@ -975,14 +1143,16 @@ struct JSObject {
 		struct JSPromiseData *promise_data; /* JS_CLASS_PROMISE */
 		struct JSPromiseFunctionData *promise_function_data;
 		/* JS_CLASS_PROMISE_RESOLVE_FUNCTION, JS_CLASS_PROMISE_REJECT_FUNCTION */
-		struct JSAsyncFunctionState *async_function_data;
-		/* JS_CLASS_ASYNC_FUNCTION_RESOLVE, JS_CLASS_ASYNC_FUNCTION_REJECT */
 		struct JSAsyncFromSyncIteratorData *
 		async_from_sync_iterator_data;
 		/* JS_CLASS_ASYNC_FROM_SYNC_ITERATOR */
 		struct JSAsyncGeneratorData *async_generator_data;
-
 		/* JS_CLASS_ASYNC_GENERATOR */
+		struct JSTextDecoder *text_decoder; /* JS_CLASS_TEXT_DECODER */
+		struct JSWeakRefData *weak_ref_data; /* JS_CLASS_WEAK_REF */
+		struct JSFinRegData *fin_reg_data;
+		/* JS_CLASS_FINALIZATION_REGISTRY */
+
 		struct {
 			/* JS_CLASS_BYTECODE_FUNCTION: 12/24 bytes */
 			/* also used by JS_CLASS_GENERATOR_FUNCTION, JS_CLASS_ASYNC_FUNCTION and JS_CLASS_ASYNC_GENERATOR_FUNCTION */
@@ -1033,12 +1203,18 @@ struct JSObject {
 
 			uint32_t count;
 			/* <= 2^31-1. 0 for a detached typed array */
-		} array; /* 12/20 bytes */
+			uint32_t hole_count : 30;
+			/* JS_CLASS_ARRAY: number of JS_ARRAY_HOLE values in
+			   values[0..count-1]. Always 0 for the other classes */
+			uint32_t kind : 2;
+			/* JS_CLASS_ARRAY: element storage (JSArrayKindEnum).
+			   Always JS_ARRAY_KIND_VALUE for the other classes */
+		} array; /* 16/24 bytes */
 		JSRegExp regexp; /* JS_CLASS_REGEXP: 8/16 bytes */
 		JSValue object_data; /* for JS_SetObjectData(): 8/16/16 bytes */
 	} u;
 
-	/* byte sizes: 40/48/72 */
+	/* byte sizes: 36/44/64 */
 };
 
 enum {
@@ -1265,6 +1441,9 @@ static JSValue js_regexp_constructor_internal(JSContext *ctx, JSValueConst ctor,
 					      JSValue pattern, JSValue bc);
 
 static void gc_decref(JSRuntime *rt);
+static int64_t get_monotonic_time_ns(void);
+static void gc_update_threshold(JSRuntime *rt, size_t size,
+				int64_t start_time);
 
 static int JS_NewClass1(JSRuntime *rt, JSClassID class_id,
 			const JSClassDef *class_def, JSAtom name);
@@ -1358,6 +1537,12 @@ static int js_string_memcmp(const JSString *p1, const JSString *p2, int len);
 
 static void reset_weak_ref(JSRuntime *rt, JSObject *p);
 
+static void fin_reg_enqueue_cleanup(JSRuntime *rt, JSObject *p);
+
+static void js_weak_ref_clear_kept(JSRuntime *rt);
+
+static void weak_ref_hash_shrink(JSRuntime *rt);
+
 static JSValue js_array_buffer_constructor3(JSContext *ctx,
 					    JSValueConst new_target,
 					    uint64_t len, JSClassID class_id,
@@ -1391,15 +1576,16 @@ static void __async_func_free(JSRuntime *rt, JSAsyncFunctionState *s);
 
 static void async_func_free(JSRuntime *rt, JSAsyncFunctionState *s);
 
+static void async_func_pool_free(JSRuntime *rt);
+
 static JSValue js_generator_function_call(JSContext *ctx, JSValueConst func_obj,
 					  JSValueConst this_obj,
 					  int argc, JSValueConst *argv,
 					  int flags);
 
-static void js_async_function_resolve_finalizer(JSRuntime *rt, JSValue val);
-
-static void js_async_function_resolve_mark(JSRuntime *rt, JSValueConst val,
-					   JS_MarkFunc *mark_func);
+static void js_async_function_await_resume(JSContext *ctx,
+					   JSAsyncFunctionState *s,
+					   BOOL is_reject, JSValueConst value);
 
 static JSValue JS_EvalInternal(JSContext *ctx, JSValueConst this_obj,
 			       const char *input, size_t input_len,
@@ -1425,6 +1611,10 @@ static __exception int perform_promise_then(JSContext *ctx,
 					    JSValueConst *resolve_reject,
 					    JSValueConst *cap_resolving_funcs);
 
+static __exception int perform_promise_await(JSContext *ctx,
+					     JSValueConst promise,
+					     JSAsyncFunctionState *s);
+
 static JSValue js_promise_resolve(JSContext *ctx, JSValueConst this_val,
 				  int argc, JSValueConst *argv, int magic);
 
@@ -1472,9 +1662,57 @@ static void free_arg_list(JSContext *ctx, JSValue *tab, uint32_t len);
 static JSValue *build_arg_list(JSContext *ctx, uint32_t *plen,
 			       JSValueConst array_arg);
 
+static JSValue js_apply_array(JSContext *ctx, JSValueConst func_obj,
+			      JSValueConst this_obj, JSValueConst array_arg,
+			      BOOL is_constructor);
+
+static int check_function(JSContext *ctx, JSValueConst obj);
+
 static BOOL js_get_fast_array(JSContext *ctx, JSValueConst obj,
 			      JSValue **arrpp, uint32_t *countp);
 
+/* missing elements of a fast array. It is never visible from JS code. */
+#define JS_ARRAY_HOLE JS_UNINITIALIZED
+
+/* 'idx' must be < p->u.array.count */
+static inline BOOL js_fast_array_is_hole(JSObject *p, uint32_t idx) {
+	return unlikely(p->u.array.hole_count != 0) &&
+		JS_VALUE_GET_TAG(p->u.array.u.values[idx]) ==
+		JS_TAG_UNINITIALIZED;
+}
+
+/* Element storage of the fast arrays. Arrays start with unboxed int32
+   elements and are converted to a more generic kind when a value which
+   does not fit is stored. Arrays with holes always use
+   JS_ARRAY_KIND_VALUE. */
+typedef enum {
+	JS_ARRAY_KIND_VALUE, /* JSValue values[] */
+	JS_ARRAY_KIND_INT32, /* int32_t int32_ptr[] */
+	JS_ARRAY_KIND_FLOAT64, /* double double_ptr[] */
+} JSArrayKindEnum;
+
+static const uint8_t js_array_kind_size[] = {
+	sizeof(JSValue),
+	sizeof(int32_t),
+	sizeof(double),
+};
+
+/* return the element 'idx' < p->u.array.count of a fast array */
+static inline JSValue js_fast_array_get(JSContext *ctx, JSObject *p,
+					uint32_t idx) {
+	switch (p->u.array.kind) {
+		case JS_ARRAY_KIND_INT32:
+			return JS_NewInt32(ctx, p->u.array.u.int32_ptr[idx]);
+		case JS_ARRAY_KIND_FLOAT64:
+			return JS_NewFloat64(ctx, p->u.array.u.double_ptr[idx]);
+		default:
+			return JS_DupValue(ctx, p->u.array.u.values[idx]);
+	}
+}
+
+static int js_fast_array_set(JSContext *ctx, JSObject *p, uint32_t idx,
+			     JSValue val, BOOL is_new);
+
 static JSValue JS_CreateAsyncFromSyncIterator(JSContext *ctx,
 					      JSValueConst sync_iter);
 
@@ -1513,22 +1751,31 @@ static const JSClassExoticMethods js_proxy_exotic_methods;
 static const JSClassExoticMethods js_module_ns_exotic_methods;
 static JSClassID js_class_id_alloc = JS_CLASS_INIT_COUNT;
 
+/* allocated memory compared with the GC threshold: the free blocks kept
+   for reuse are not counted */
+static size_t js_gc_heap_size(JSRuntime *rt) {
+	size_t size = rt->malloc_state.malloc_size;
+	return size > rt->async_func_pool_size ?
+		       size - rt->async_func_pool_size : 0;
+}
+
 static void js_trigger_gc(JSRuntime *rt, size_t size) {
 	BOOL force_gc;
 #ifdef FORCE_GC_AT_MALLOC
     force_gc = TRUE;
 #else
-	force_gc = ((rt->malloc_state.malloc_size + size) >
-		    rt->malloc_gc_threshold);
+	force_gc = ((js_gc_heap_size(rt) + size) > rt->malloc_gc_threshold);
 #endif
 	if (force_gc) {
 #ifdef DUMP_GC
         printf("GC: size=%" PRIu64 "\n",
                (uint64_t)rt->malloc_state.malloc_size);
 #endif
+		size_t old_size = js_gc_heap_size(rt);
+		int64_t start_time = get_monotonic_time_ns();
+		rt->gc_auto_count++;
 		JS_RunGC(rt);
-		rt->malloc_gc_threshold = rt->malloc_state.malloc_size +
-					  (rt->malloc_state.malloc_size >> 1);
+		gc_update_threshold(rt, old_size, start_time);
 	}
 }
 
@@ -1896,6 +2143,12 @@ JSRuntime *JS_NewRuntime2(const JSMallocFunctions *mf, void *opaque) {
 	}
 	rt->malloc_state = ms;
 	rt->malloc_gc_threshold = 256 * 1024;
+	rt->gc_policy.kind = JS_GC_POLICY_GROWTH;
+	rt->gc_policy.growth = 50;
+	rt->gc_policy.overhead = 5;
+	rt->gc_policy.interval = 100;
+	rt->gc_policy.min_threshold = 256 * 1024;
+	rt->gc_last_time = get_monotonic_time_ns();
 
 	bf_context_init(&rt->bf_ctx, js_bf_realloc, rt);
 	set_dummy_numeric_ops(&rt->bigint_ops);
@@ -1906,13 +2159,13 @@ JSRuntime *JS_NewRuntime2(const JSMallocFunctions *mf, void *opaque) {
 
 	init_list_head(&rt->context_list);
 	init_list_head(&rt->gc_obj_list);
+	init_list_head(&rt->weak_ref_kept_list);
 	init_list_head(&rt->gc_zero_ref_count_list);
 	rt->gc_phase = JS_GC_PHASE_NONE;
 
 #ifdef DUMP_LEAKS
     init_list_head(&rt->string_list);
 #endif
-	init_list_head(&rt->job_list);
 
 	if (JS_InitAtoms(rt))
 		goto fail;
@@ -2067,58 +2320,167 @@ void JS_SetSharedArrayBufferFunctions(JSRuntime *rt,
 	rt->sab_funcs = *sf;
 }
 
+#define JS_JOB_QUEUE_MIN_SIZE 16
+/* a larger queue is freed when it becomes empty */
+#define JS_JOB_QUEUE_MAX_IDLE_SIZE 1024
+
+static inline JSValue *js_job_argv(JSJobEntry *e) {
+	return e->argc > JS_JOB_INLINE_ARGS ? e->u.ext_argv : e->u.argv;
+}
+
+static int js_job_queue_resize(JSRuntime *rt) {
+	JSJobEntry *q;
+	uint32_t new_size, n;
+
+	new_size = max_int(rt->job_queue_size * 2, JS_JOB_QUEUE_MIN_SIZE);
+	q = js_malloc_rt(rt, new_size * sizeof(*q));
+	if (!q)
+		return -1;
+	/* the pending jobs are moved to the start of the new queue */
+	n = min_uint32(rt->job_count, rt->job_queue_size - rt->job_queue_head);
+	memcpy(q, rt->job_queue + rt->job_queue_head, n * sizeof(*q));
+	memcpy(q + n, rt->job_queue, (rt->job_count - n) * sizeof(*q));
+	js_free_rt(rt, rt->job_queue);
+	rt->job_queue = q;
+	rt->job_queue_size = new_size;
+	rt->job_queue_head = 0;
+	return 0;
+}
+
+/* return the entry following the last pending job, or nullptr if
+   exception. The job is added by incrementing rt->job_count. */
+static JSJobEntry *js_job_queue_next(JSContext *ctx) {
+	JSRuntime *rt = ctx->rt;
+
+	if (unlikely(rt->job_count == rt->job_queue_size)) {
+		if (js_job_queue_resize(rt)) {
+			JS_ThrowOutOfMemory(ctx);
+			return nullptr;
+		}
+	}
+	return &rt->job_queue[(rt->job_queue_head + rt->job_count) &
+			      (rt->job_queue_size - 1)];
+}
+
 /* return 0 if OK, < 0 if exception */
 int JS_EnqueueJob(JSContext *ctx, JSJobFunc *job_func,
 		  int argc, JSValueConst *argv) {
 	JSRuntime *rt = ctx->rt;
 	JSJobEntry *e;
+	JSValue *tab;
 	int i;
 
-	e = js_malloc(ctx, sizeof(*e) + argc * sizeof(JSValue));
+	e = js_job_queue_next(ctx);
 	if (!e)
 		return -1;
+	if (argc > JS_JOB_INLINE_ARGS) {
+		e->u.ext_argv = js_malloc(ctx, argc * sizeof(JSValue));
+		if (!e->u.ext_argv)
+			return -1;
+	}
 	e->ctx = ctx;
 	e->job_func = job_func;
 	e->argc = argc;
-	for (i = 0; i < argc; i++) {
-		e->argv[i] = JS_DupValue(ctx, argv[i]);
-	}
-	list_add_tail(&e->link, &rt->job_list);
+	tab = js_job_argv(e);
+	for (i = 0; i < argc; i++)
+		tab[i] = JS_DupValue(ctx, argv[i]);
+	rt->job_count++;
+	return 0;
+}
+
+/* enqueue the job resuming the async function 's' with the result of
+   an await. Return 0 if OK, < 0 if exception */
+static int js_enqueue_await_job(JSContext *ctx, JSAsyncFunctionState *s,
+				BOOL is_reject, JSValueConst value) {
+	JSJobEntry *e;
+
+	e = js_job_queue_next(ctx);
+	if (!e)
+		return -1;
+	e->ctx = ctx;
+	e->job_func = nullptr;
+	e->async_func = s;
+	s->header.ref_count++;
+	e->argc = 2;
+	e->u.argv[0] = JS_DupValue(ctx, value);
+	e->u.argv[1] = JS_NewBool(ctx, is_reject);
+	ctx->rt->job_count++;
 	return 0;
 }
 
 BOOL JS_IsJobPending(JSRuntime *rt) {
-	return !list_empty(&rt->job_list);
+	return rt->job_count != 0;
+}
+
+/* execute the first pending job */
+static int js_execute_job(JSRuntime *rt, JSContext **pctx) {
+	JSContext *ctx;
+	JSJobEntry e;
+	JSValue res, *argv;
+	int i;
+
+	/* the queue may be reallocated by the job */
+	e = rt->job_queue[rt->job_queue_head];
+	rt->job_queue_head = (rt->job_queue_head + 1) &
+			     (rt->job_queue_size - 1);
+	if (--rt->job_count == 0) {
+		rt->job_queue_head = 0;
+		if (rt->job_queue_size > JS_JOB_QUEUE_MAX_IDLE_SIZE) {
+			js_free_rt(rt, rt->job_queue);
+			rt->job_queue = nullptr;
+			rt->job_queue_size = 0;
+		}
+	}
+	ctx = e.ctx;
+	argv = js_job_argv(&e);
+	if (!e.job_func) {
+		js_async_function_await_resume(ctx, e.async_func,
+					       JS_VALUE_GET_BOOL(argv[1]),
+					       argv[0]);
+		async_func_free(rt, e.async_func);
+		res = JS_UNDEFINED;
+	} else {
+		res = e.job_func(ctx, e.argc, (JSValueConst *) argv);
+	}
+	for (i = 0; i < e.argc; i++)
+		JS_FreeValue(ctx, argv[i]);
+	if (e.argc > JS_JOB_INLINE_ARGS)
+		js_free(ctx, argv);
+	*pctx = ctx;
+	if (JS_IsException(res))
+		return -1;
+	JS_FreeValue(ctx, res);
+	js_weak_ref_clear_kept(rt);
+	return 1;
 }
 
 /* return < 0 if exception, 0 if no job pending, 1 if a job was
    executed successfully. the context of the job is stored in '*pctx' */
 int JS_ExecutePendingJob(JSRuntime *rt, JSContext **pctx) {
-	JSContext *ctx;
-	JSJobEntry *e;
-	JSValue res;
-	int i, ret;
-
-	if (list_empty(&rt->job_list)) {
+	/* end of the job which enqueued the pending jobs */
+	js_weak_ref_clear_kept(rt);
+	if (rt->job_count == 0) {
 		*pctx = nullptr;
 		return 0;
 	}
+	return js_execute_job(rt, pctx);
+}
 
-	/* get the first pending job and execute it */
-	e = list_entry(rt->job_list.next, JSJobEntry, link);
-	list_del(&e->link);
-	ctx = e->ctx;
-	res = e->job_func(e->ctx, e->argc, (JSValueConst *) e->argv);
-	for (i = 0; i < e->argc; i++)
-		JS_FreeValue(ctx, e->argv[i]);
-	if (JS_IsException(res))
-		ret = -1;
-	else
-		ret = 1;
-	JS_FreeValue(ctx, res);
-	js_free(ctx, e);
-	*pctx = ctx;
-	return ret;
+/* Execute the pending jobs, including the ones they enqueue, until
+   there is none left or 'max' jobs were executed ('max' < 0 means no
+   limit). Return the number of executed jobs, or < 0 if a job raised
+   an exception, its context being stored in '*pctx'. */
+int JS_ExecutePendingJobs(JSRuntime *rt, int max, JSContext **pctx) {
+	int n;
+
+	*pctx = nullptr;
+	/* end of the job which enqueued the pending jobs */
+	js_weak_ref_clear_kept(rt);
+	for (n = 0; n != max && rt->job_count != 0; n++) {
+		if (js_execute_job(rt, pctx) < 0)
+			return -1;
+	}
+	return n;
 }
 
 static inline uint32_t atom_get_free(const JSAtomStruct *p) {
@@ -2185,18 +2547,30 @@ void JS_SetRuntimeInfo(JSRuntime *rt, const char *s) {
 }
 
 void JS_FreeRuntime(JSRuntime *rt) {
+#ifdef DUMP_LEAKS
 	struct list_head *el, *el1;
+#endif
 	int i;
 
 	JS_FreeValueRT(rt, rt->current_exception);
+	js_weak_ref_clear_kept(rt);
 
-	list_for_each_safe(el, el1, &rt->job_list) {
-		JSJobEntry *e = list_entry(el, JSJobEntry, link);
+	while (rt->job_count != 0) {
+		JSJobEntry *e = &rt->job_queue[rt->job_queue_head];
+		JSValue *argv = js_job_argv(e);
 		for (i = 0; i < e->argc; i++)
-			JS_FreeValueRT(rt, e->argv[i]);
-		js_free_rt(rt, e);
-	}
-	init_list_head(&rt->job_list);
+			JS_FreeValueRT(rt, argv[i]);
+		if (e->argc > JS_JOB_INLINE_ARGS)
+			js_free_rt(rt, argv);
+		if (!e->job_func)
+			async_func_free(rt, e->async_func);
+		rt->job_queue_head = (rt->job_queue_head + 1) &
+				     (rt->job_queue_size - 1);
+		rt->job_count--;
+	}
+	js_free_rt(rt, rt->job_queue);
+	rt->job_queue = nullptr;
+	rt->job_queue_size = 0;
 
 	JS_RunGC(rt);
 
@@ -2240,6 +2614,13 @@ void JS_FreeRuntime(JSRuntime *rt) {
     }
 #endif
 	assert(list_empty(&rt->gc_obj_list));
+	assert(rt->weak_ref_count == 0);
+	async_func_pool_free(rt);
+
+	for (i = 0; i < countof(rt->char_strings); i++) {
+		if (rt->char_strings[i])
+			js_free_string(rt, rt->char_strings[i]);
+	}
 
 	/* free the classes */
 	for (i = 0; i < rt->class_count; i++) {
@@ -2552,6 +2933,9 @@ void JS_FreeContext(JSContext *ctx) {
 
 	JS_FreeValue(ctx, ctx->global_obj);
 	JS_FreeValue(ctx, ctx->global_var_obj);
+	for (i = 0; i < JS_GLOBAL_VAR_CELL_COUNT; i++) {
+		JS_FreeAtom(ctx, ctx->global_var_cells[i].atom);
+	}
 
 	JS_FreeValue(ctx, ctx->throw_type_error);
 	JS_FreeValue(ctx, ctx->eval_obj);
@@ -2712,6 +3096,34 @@ static uint32_t hash_string(const JSString *str, uint32_t h) {
 	return h;
 }
 
+/* Return the hash of the string contents. It is the same value as the
+   hash of the string atom with the same contents. The hash is cached
+   in the non atom strings, 0 meaning not computed yet. */
+static uint32_t js_string_hash(JSString *p) {
+	uint32_t h;
+
+	if (p->atom_type == JS_ATOM_TYPE_STRING ||
+	    (p->atom_type == 0 && p->hash != 0))
+		return p->hash;
+	h = hash_string(p, JS_ATOM_TYPE_STRING) & JS_ATOM_HASH_MASK;
+	if (p->atom_type == 0)
+		p->hash = h;
+	return h;
+}
+
+/* same as js_string_hash() for a short string */
+static uint32_t js_short_string_hash(JSValueConst v) {
+	uint64_t bits = js_short_string_bits(v);
+	uint32_t h = JS_ATOM_TYPE_STRING;
+	int i, len = bits & 0xff;
+
+	for (i = 0; i < len; i++) {
+		bits >>= 8;
+		h = h * 263 + (uint8_t) bits;
+	}
+	return h & JS_ATOM_HASH_MASK;
+}
+
 static __maybe_unused void JS_DumpChar(JSRuntime *rt, int c, int sep) {
 	if (c == sep || c == '\\') {
 		putchar('\\');
@@ -2925,8 +3337,12 @@ static JSAtom __JS_NewAtom(JSRuntime *rt, JSString *str, int atom_type) {
 		}
 		/* try and locate an already registered atom */
 		len = str->len;
-		h = hash_string(str, atom_type);
-		h &= JS_ATOM_HASH_MASK;
+		if (atom_type == JS_ATOM_TYPE_STRING) {
+			h = js_string_hash(str);
+		} else {
+			h = hash_string(str, atom_type);
+			h &= JS_ATOM_HASH_MASK;
+		}
 		h1 = h & (rt->atom_hash_size - 1);
 		i = rt->atom_hash[h1];
 		while (i != 0) {
@@ -3681,12 +4097,32 @@ int JS_NewClass(JSRuntime *rt, JSClassID class_id,
 	return ret;
 }
 
+/* The one character Latin-1 strings are shared. They are allocated on
+   first use and freed with the runtime. */
+static JSValue js_new_string_char8(JSContext *ctx, uint8_t c) {
+	JSRuntime *rt = ctx->rt;
+	JSString *str;
+
+	str = rt->char_strings[c];
+	if (unlikely(!str)) {
+		str = js_alloc_string(ctx, 1, 0);
+		if (!str)
+			return JS_EXCEPTION;
+		str->u.str8[0] = c;
+		str->u.str8[1] = '\0';
+		rt->char_strings[c] = str;
+	}
+	return JS_DupValue(ctx, JS_MKPTR(JS_TAG_STRING, str));
+}
+
 static JSValue js_new_string8(JSContext *ctx, const uint8_t *buf, int len) {
 	JSString *str;
 
 	if (len <= 0) {
 		return JS_AtomToString(ctx, JS_ATOM_empty_string);
 	}
+	if (len == 1)
+		return js_new_string_char8(ctx, buf[0]);
 	str = js_alloc_string(ctx, len, 0);
 	if (!str)
 		return JS_EXCEPTION;
@@ -3704,10 +4140,25 @@ static JSValue js_new_string16(JSContext *ctx, const uint16_t *buf, int len) {
 	return JS_MKPTR(JS_TAG_STRING, str);
 }
 
+/* same as js_new_string8() but return a short string if possible */
+static JSValue js_new_string8_short(JSContext *ctx, const uint8_t *buf,
+				    int len) {
+	if (len > 0 && len <= JS_SHORT_STRING_MAX_LEN)
+		return js_new_short_string(buf, len);
+	return js_new_string8(ctx, buf, len);
+}
+
+/* return a JS_TAG_STRING value with the contents of the short string 'v' */
+static JSValue js_short_string_to_string(JSContext *ctx, JSValueConst v) {
+	JSShortStringBuf sbuf;
+	JSString *p = js_get_string(&sbuf, v);
+	return js_new_string8(ctx, p->u.str8, p->len);
+}
+
 static JSValue js_new_string_char(JSContext *ctx, uint16_t c) {
 	if (c < 0x100) {
 		uint8_t ch8 = c;
-		return js_new_string8(ctx, &ch8, 1);
+		return js_new_string8_short(ctx, &ch8, 1);
 	} else {
 		uint16_t ch16 = c;
 		return js_new_string16(ctx, &ch16, 1);
@@ -3723,11 +4174,19 @@ static JSValue js_sub_string(JSContext *ctx, JSString *p, int start, int end) {
 		JSString *str;
 		int i;
 		uint16_t c = 0;
+		if (len == 1)
+			return js_new_string_char(ctx, p->u.str16[start]);
 		for (i = start; i < end; i++) {
 			c |= p->u.str16[i];
 		}
 		if (c > 0xFF)
 			return js_new_string16(ctx, p->u.str16 + start, len);
+		if (len <= JS_SHORT_STRING_MAX_LEN) {
+			uint8_t buf[JS_SHORT_STRING_MAX_LEN + 1];
+			for (i = 0; i < len; i++)
+				buf[i] = p->u.str16[start + i];
+			return js_new_short_string(buf, len);
+		}
 
 		str = js_alloc_string(ctx, len, 0);
 		if (!str)
@@ -3738,7 +4197,7 @@ static JSValue js_sub_string(JSContext *ctx, JSString *p, int start, int end) {
 		str->u.str8[len] = '\0';
 		return JS_MKPTR(JS_TAG_STRING, str);
 	} else {
-		return js_new_string8(ctx, p->u.str8 + start, len);
+		return js_new_string8_short(ctx, p->u.str8 + start, len);
 	}
 }
 
@@ -3988,6 +4447,11 @@ static int string_buffer_concat_value(StringBuffer *s, JSValueConst v) {
 		/* prevent exception overload */
 		return -1;
 	}
+	if (JS_VALUE_GET_TAG(v) == JS_TAG_SHORT_STRING) {
+		JSShortStringBuf sbuf;
+		p = js_get_string(&sbuf, v);
+		return string_buffer_concat(s, p, 0, p->len);
+	}
 	if (unlikely(JS_VALUE_GET_TAG(v) != JS_TAG_STRING)) {
 		v1 = JS_ToString(s->ctx, v);
 		if (JS_IsException(v1))
@@ -4010,6 +4474,8 @@ static int string_buffer_concat_value_free(StringBuffer *s, JSValue v) {
 		JS_FreeValue(s->ctx, v);
 		return -1;
 	}
+	if (JS_VALUE_GET_TAG(v) == JS_TAG_SHORT_STRING)
+		return string_buffer_concat_value(s, v);
 	if (unlikely(JS_VALUE_GET_TAG(v) != JS_TAG_STRING)) {
 		v = JS_ToStringFree(s->ctx, v);
 		if (JS_IsException(v))
@@ -4067,61 +4533,241 @@ static JSValue string_buffer_end(StringBuffer *s) {
 	return JS_MKPTR(JS_TAG_STRING, str);
 }
 
+#if defined(__SSE2__)
+/* TRUE if the 16 bytes at 'p' are ASCII */
+static inline BOOL is_ascii8x16(const uint8_t *p) {
+	return !_mm_movemask_epi8(_mm_loadu_si128((const __m128i *) p));
+}
+#endif
+
+/* Return the length of the well-formed UTF-8 sequence at 'p' whose
+   lead byte is >= 0x80 or 0 if it is invalid or truncated. Overlong
+   forms, surrogates and code points > 0x10FFFF are invalid. */
+static inline int utf8_seq_len(const uint8_t *p, const uint8_t *p_end) {
+	int c = p[0], lo = 0x80, hi = 0xbf;
+
+	if (c < 0xc2) {
+		return 0;
+	} else if (c < 0xe0) {
+		if (p_end - p < 2 || (p[1] & 0xc0) != 0x80)
+			return 0;
+		return 2;
+	} else if (c < 0xf0) {
+		if (c == 0xe0)
+			lo = 0xa0;
+		else if (c == 0xed)
+			hi = 0x9f;
+		if (p_end - p < 3 || p[1] < lo || p[1] > hi ||
+		    (p[2] & 0xc0) != 0x80)
+			return 0;
+		return 3;
+	} else if (c < 0xf5) {
+		if (c == 0xf0)
+			lo = 0x90;
+		else if (c == 0xf4)
+			hi = 0x8f;
+		if (p_end - p < 4 || p[1] < lo || p[1] > hi ||
+		    (p[2] & 0xc0) != 0x80 || (p[3] & 0xc0) != 0x80)
+			return 0;
+		return 4;
+	} else {
+		return 0;
+	}
+}
+
+/* Return the number of UTF-16 code units of the UTF-8 buffer or -1 if
+   it is not well-formed. '*pwide' is set to TRUE if a code point is
+   >= 0x100. The buffer is scanned by blocks of 16 bytes so that the
+   ASCII blocks are skipped at once. */
+static int64_t utf8_decode_len(const uint8_t *p, const uint8_t *p_end,
+			       BOOL *pwide) {
+	const uint8_t *p_block;
+	int64_t len = 0;
+	uint32_t c_or = 0;
+	int n;
+
+	while (p < p_end) {
+		p_block = p + min_int(16, p_end - p);
+#if defined(__SSE2__)
+		if (p_block - p == 16 && is_ascii8x16(p)) {
+			p += 16;
+			len += 16;
+			continue;
+		}
+#endif
+		while (p < p_block) {
+			if (*p < 0x80) {
+				p++;
+				len++;
+			} else {
+				n = utf8_seq_len(p, p_end);
+				if (n == 0)
+					return -1;
+				c_or |= *p;
+				p += n;
+				len += 1 + (n == 4);
+			}
+		}
+	}
+	/* lead bytes >= 0xc4 encode code points >= 0x100 */
+	*pwide = (c_or >= 0xc4);
+	return len;
+}
+
+/* the UTF-8 buffer must be well-formed and contain only code points
+   < 0x100 */
+static void utf8_decode8(uint8_t *q, const uint8_t *p, const uint8_t *p_end) {
+	const uint8_t *p_block;
+
+	while (p < p_end) {
+		p_block = p + min_int(16, p_end - p);
+#if defined(__SSE2__)
+		if (p_block - p == 16 && is_ascii8x16(p)) {
+			memcpy(q, p, 16);
+			p += 16;
+			q += 16;
+			continue;
+		}
+#endif
+		while (p < p_block) {
+			if (*p < 0x80) {
+				*q++ = *p++;
+			} else {
+				*q++ = ((p[0] & 0x1f) << 6) | (p[1] & 0x3f);
+				p += 2;
+			}
+		}
+	}
+}
+
+static void widen8to16(uint16_t *q, const uint8_t *p, size_t len) {
+	size_t i = 0;
+#if defined(__SSE2__)
+	__m128i v, zero = _mm_setzero_si128();
+	for (; i + 16 <= len; i += 16) {
+		v = _mm_loadu_si128((const __m128i *) (p + i));
+		_mm_storeu_si128((__m128i *) (q + i), _mm_unpacklo_epi8(v, zero));
+		_mm_storeu_si128((__m128i *) (q + i + 8),
+				 _mm_unpackhi_epi8(v, zero));
+	}
+#endif
+	for (; i < len; i++)
+		q[i] = p[i];
+}
+
+/* the UTF-8 buffer must be well-formed */
+static void utf8_decode16(uint16_t *q, const uint8_t *p, const uint8_t *p_end) {
+	const uint8_t *p_block;
+	uint32_t c;
+
+	while (p < p_end) {
+		p_block = p + min_int(16, p_end - p);
+#if defined(__SSE2__)
+		if (p_block - p == 16 && is_ascii8x16(p)) {
+			widen8to16(q, p, 16);
+			p += 16;
+			q += 16;
+			continue;
+		}
+#endif
+		while (p < p_block) {
+			c = *p;
+			if (c < 0x80) {
+				*q++ = c;
+				p++;
+			} else if (c < 0xe0) {
+				*q++ = ((c & 0x1f) << 6) | (p[1] & 0x3f);
+				p += 2;
+			} else if (c < 0xf0) {
+				*q++ = ((c & 0x0f) << 12) |
+				       ((p[1] & 0x3f) << 6) | (p[2] & 0x3f);
+				p += 3;
+			} else {
+				c = ((c & 0x07) << 18) | ((p[1] & 0x3f) << 12) |
+				    ((p[2] & 0x3f) << 6) | (p[3] & 0x3f);
+				*q++ = get_hi_surrogate(c);
+				*q++ = get_lo_surrogate(c);
+				p += 4;
+			}
+		}
+	}
+}
+
 /* create a string from a UTF-8 buffer */
 JSValue JS_NewStringLen(JSContext *ctx, const char *buf, size_t buf_len) {
 	const uint8_t *p, *p_end, *p_start, *p_next;
 	uint32_t c;
 	StringBuffer b_s, *b = &b_s;
 	size_t len1;
+	int64_t len;
+	BOOL is_wide;
+	JSString *str;
 
 	p_start = (const uint8_t *) buf;
 	p_end = p_start + buf_len;
-	p = p_start;
-	while (p < p_end && *p < 128)
-		p++;
-	len1 = p - p_start;
+	len1 = ascii_prefix_len(p_start, buf_len);
+	p = p_start + len1;
 	if (len1 > JS_STRING_LEN_MAX)
 		return JS_ThrowInternalError(ctx, "string too long");
 	if (p == p_end) {
 		/* ASCII string */
 		return js_new_string8(ctx, (const uint8_t *) buf, buf_len);
-	} else {
-		if (string_buffer_init(ctx, b, buf_len))
-			goto fail;
-		string_buffer_write8(b, p_start, len1);
-		while (p < p_end) {
-			if (*p < 128) {
-				string_buffer_putc8(b, *p++);
+	}
+	/* compute the exact length so that the string is allocated only
+	once. The invalid UTF-8 sequences are handled by the slow path */
+	len = utf8_decode_len(p, p_end, &is_wide);
+	if (len >= 0) {
+		len += len1;
+		if (len > JS_STRING_LEN_MAX)
+			return JS_ThrowInternalError(ctx, "string too long");
+		str = js_alloc_string(ctx, len, is_wide);
+		if (!str)
+			return JS_EXCEPTION;
+		if (!is_wide) {
+			memcpy(str->u.str8, p_start, len1);
+			utf8_decode8(str->u.str8 + len1, p, p_end);
+			str->u.str8[len] = '\0';
+		} else {
+			widen8to16(str->u.str16, p_start, len1);
+			utf8_decode16(str->u.str16 + len1, p, p_end);
+		}
+		return JS_MKPTR(JS_TAG_STRING, str);
+	}
+	if (string_buffer_init(ctx, b, buf_len))
+		goto fail;
+	string_buffer_write8(b, p_start, len1);
+	while (p < p_end) {
+		if (*p < 128) {
+			string_buffer_putc8(b, *p++);
+		} else {
+			/* parse utf-8 sequence, return 0xFFFFFFFF for error */
+			c = unicode_from_utf8(p, p_end - p, &p_next);
+			if (c < 0x10000) {
+				p = p_next;
+			} else if (c <= 0x10FFFF) {
+				p = p_next;
+				/* surrogate pair */
+				string_buffer_putc16(
+					b, get_hi_surrogate(c));
+				c = get_lo_surrogate(c);
 			} else {
-				/* parse utf-8 sequence, return 0xFFFFFFFF for error */
-				c = unicode_from_utf8(p, p_end - p, &p_next);
-				if (c < 0x10000) {
-					p = p_next;
-				} else if (c <= 0x10FFFF) {
-					p = p_next;
-					/* surrogate pair */
-					string_buffer_putc16(
-						b, get_hi_surrogate(c));
-					c = get_lo_surrogate(c);
-				} else {
-					/* invalid char */
-					c = 0xfffd;
-					/* skip the invalid chars */
-					/* XXX: seems incorrect. Why not just use c = *p++; ? */
+				/* invalid char */
+				c = 0xfffd;
+				/* skip the invalid chars */
+				/* XXX: seems incorrect. Why not just use c = *p++; ? */
+				while (p < p_end && (
+					       *p >= 0x80 && *p <
+					       0xc0))
+					p++;
+				if (p < p_end) {
+					p++;
 					while (p < p_end && (
-						       *p >= 0x80 && *p <
-						       0xc0))
-						p++;
-					if (p < p_end) {
+						       *p >= 0x80 && *p
+						       < 0xc0))
 						p++;
-						while (p < p_end && (
-							       *p >= 0x80 && *p
-							       < 0xc0))
-							p++;
-					}
 				}
-				string_buffer_putc16(b, c);
 			}
+			string_buffer_putc16(b, c);
 		}
 	}
 	return string_buffer_end(b);
@@ -4174,6 +4820,221 @@ JSValue JS_NewAtomString(JSContext *ctx, const char *str) {
 	return val;
 }
 
+#if defined(__SSE2__)
+/* TRUE if the 8 characters at 'src' are ASCII */
+static inline BOOL is_ascii16x8(const uint16_t *src) {
+	__m128i v = _mm_loadu_si128((const __m128i *) src);
+	v = _mm_and_si128(v, _mm_set1_epi16(0xff80));
+	return _mm_movemask_epi8(_mm_cmpeq_epi16(v, _mm_setzero_si128())) ==
+	       0xffff;
+}
+#endif
+
+/* return the number of non-ASCII characters of a 8 bit string */
+static size_t latin1_non_ascii_count(const uint8_t *src, int len) {
+	size_t count = 0;
+	int pos = 0;
+
+#if defined(__SSE2__)
+	__m128i zero = _mm_setzero_si128(), acc = zero;
+	for (; pos + 16 <= len; pos += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (src + pos));
+		v = _mm_and_si128(_mm_cmplt_epi8(v, zero), _mm_set1_epi8(1));
+		acc = _mm_add_epi64(acc, _mm_sad_epu8(v, zero));
+	}
+	count = _mm_cvtsi128_si32(acc) +
+		_mm_cvtsi128_si32(_mm_unpackhi_epi64(acc, acc));
+#endif
+	for (; pos < len; pos++)
+		count += src[pos] >> 7;
+	return count;
+}
+
+/* return the length of the UTF-8 encoding of a 16 bit string. If
+   'cesu8' is TRUE, the surrogate pairs are encoded as two 3 byte
+   sequences. */
+static size_t utf16_to_utf8_len(const uint16_t *src, int len, BOOL cesu8) {
+	size_t size = 0;
+	int pos = 0, c;
+	BOOL has_surrogates = FALSE;
+
+#if defined(__SSE2__)
+	/* each character takes 3 bytes minus one if < 0x800 and minus
+	   one if < 0x80 */
+	__m128i zero = _mm_setzero_si128(), acc = zero, surrogates = zero;
+	for (; pos + 8 <= len; pos += 8) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (src + pos));
+		__m128i a = _mm_cmpeq_epi16(
+			_mm_and_si128(v, _mm_set1_epi16(0xff80)), zero);
+		__m128i b = _mm_cmpeq_epi16(
+			_mm_and_si128(v, _mm_set1_epi16(0xf800)), zero);
+		surrogates = _mm_or_si128(surrogates, _mm_cmpeq_epi16(
+			_mm_and_si128(v, _mm_set1_epi16(0xf800)),
+			_mm_set1_epi16(0xd800)));
+		v = _mm_sub_epi16(zero, _mm_add_epi16(a, b));
+		acc = _mm_add_epi64(acc, _mm_sad_epu8(v, zero));
+	}
+	size = (size_t) pos * 3 - _mm_cvtsi128_si32(acc) -
+	       _mm_cvtsi128_si32(_mm_unpackhi_epi64(acc, acc));
+	has_surrogates = _mm_movemask_epi8(surrogates) != 0;
+#endif
+	for (; pos < len; pos++) {
+		c = src[pos];
+		size += 1 + (c >= 0x80) + (c >= 0x800);
+		has_surrogates |= is_surrogate(c);
+	}
+	if (has_surrogates && !cesu8) {
+		/* the surrogate pairs take 4 bytes instead of 6 */
+		for (pos = 0; pos < len - 1; pos++) {
+			if (is_hi_surrogate(src[pos]) &&
+			    is_lo_surrogate(src[pos + 1])) {
+				size -= 2;
+				pos++;
+			}
+		}
+	}
+	return size;
+}
+
+/* flags for utf8_encode16() */
+#define UTF8_ENCODE_CESU8   (1 << 0) /* encode each surrogate separately */
+#define UTF8_ENCODE_REPLACE (1 << 1) /* lone surrogates are output as U+FFFD */
+
+/* encode the character at 'src[*ppos]' to 'q' (at most 4 bytes) and
+   return the number of written bytes */
+static inline int utf8_encode_char16(uint8_t *q, const uint16_t *src,
+				     int *ppos, int len, int flags) {
+	int pos = *ppos, c, c1;
+
+	c = src[pos++];
+	if (c < 0x80) {
+		*q = c;
+		*ppos = pos;
+		return 1;
+	}
+	if (c < 0x800) {
+		q[0] = (c >> 6) | 0xc0;
+		q[1] = (c & 0x3f) | 0x80;
+		*ppos = pos;
+		return 2;
+	}
+	if (is_surrogate(c)) {
+		if (is_hi_surrogate(c) && pos < len &&
+		    is_lo_surrogate(c1 = src[pos]) &&
+		    !(flags & UTF8_ENCODE_CESU8)) {
+			c = from_surrogate(c, c1);
+			pos++;
+		} else if (flags & UTF8_ENCODE_REPLACE) {
+			c = 0xfffd;
+		}
+	}
+	*ppos = pos;
+	return unicode_to_utf8(q, c);
+}
+
+/* Encode the 8 bit string 'src' of length 'len' to UTF-8 in 'q'. The
+   encoding stops before the first character which does not fit in
+   'q_size' bytes. Return the number of written bytes and the number
+   of read characters in '*pread'. */
+static size_t utf8_encode8(uint8_t *q, size_t q_size, const uint8_t *src,
+			   int len, int *pread) {
+	uint8_t *q_start = q, *q_end = q + q_size;
+	int pos, end, c;
+
+	pos = ascii_prefix_len(src, min_int(len, q_size));
+	memcpy(q, src, pos);
+	q += pos;
+	while (pos < len) {
+		end = min_int(pos + 16, len);
+		if (unlikely(q_end - q < 2 * (end - pos))) {
+			/* the output may be full before the end of the block */
+			while (pos < len) {
+				c = src[pos];
+				if (q_end - q < 1 + (c >= 0x80))
+					goto done;
+				if (c < 0x80) {
+					*q++ = c;
+				} else {
+					*q++ = (c >> 6) | 0xc0;
+					*q++ = (c & 0x3f) | 0x80;
+				}
+				pos++;
+			}
+			break;
+		}
+#if defined(__SSE2__)
+		if (end - pos == 16) {
+			/* copy 16 ASCII characters at a time */
+			__m128i v = _mm_loadu_si128(
+				(const __m128i *) (src + pos));
+			if (!_mm_movemask_epi8(v)) {
+				_mm_storeu_si128((__m128i *) q, v);
+				q += 16;
+				pos += 16;
+				continue;
+			}
+		}
+#endif
+		while (pos < end) {
+			c = src[pos++];
+			if (c < 0x80) {
+				*q++ = c;
+			} else {
+				*q++ = (c >> 6) | 0xc0;
+				*q++ = (c & 0x3f) | 0x80;
+			}
+		}
+	}
+done:
+	*pread = pos;
+	return q - q_start;
+}
+
+/* Same as utf8_encode8() for a 16 bit string. Unless
+   UTF8_ENCODE_REPLACE is set, the lone surrogates are kept. */
+static size_t utf8_encode16(uint8_t *q, size_t q_size, const uint16_t *src,
+			    int len, int *pread, int flags) {
+	uint8_t *q_start = q, *q_end = q + q_size, buf[UTF8_CHAR_LEN_MAX];
+	int pos, pos_next, end, n;
+
+	pos = 0;
+	while (pos < len) {
+		end = min_int(pos + 8, len);
+		/* a surrogate pair may extend past the block */
+		if (unlikely(q_end - q < 3 * (end - pos) + 1)) {
+			/* the output may be full before the end of the block */
+			while (pos < len) {
+				pos_next = pos;
+				n = utf8_encode_char16(buf, src, &pos_next, len,
+						       flags);
+				if (q_end - q < n)
+					goto done;
+				memcpy(q, buf, n);
+				q += n;
+				pos = pos_next;
+			}
+			break;
+		}
+#if defined(__SSE2__)
+		if (end - pos == 8 && is_ascii16x8(src + pos)) {
+			/* convert 8 ASCII characters at a time */
+			__m128i v = _mm_loadu_si128(
+				(const __m128i *) (src + pos));
+			_mm_storel_epi64((__m128i *) q,
+					 _mm_packus_epi16(v, v));
+			q += 8;
+			pos += 8;
+			continue;
+		}
+#endif
+		while (pos < end)
+			q += utf8_encode_char16(q, src, &pos, len, flags);
+	}
+done:
+	*pread = pos;
+	return q - q_start;
+}
+
 /* return (nullptr, 0) if exception. */
 /* return pointer into a JSString with a live ref_count */
 /* cesu8 determines if non-BMP1 codepoints are encoded as 1 or 2 utf-8 sequences */
@@ -4181,8 +5042,8 @@ const char *JS_ToCStringLen2(JSContext *ctx, size_t *plen, JSValueConst val1,
 			     BOOL cesu8) {
 	JSValue val;
 	JSString *str, *str_new;
-	int pos, len, c, c1;
-	uint8_t *q;
+	int len, pos;
+	size_t size;
 
 	if (JS_VALUE_GET_TAG(val1) != JS_TAG_STRING) {
 		val = JS_ToString(ctx, val1);
@@ -4196,78 +5057,31 @@ const char *JS_ToCStringLen2(JSContext *ctx, size_t *plen, JSValueConst val1,
 	len = str->len;
 	if (!str->is_wide_char) {
 		const uint8_t *src = str->u.str8;
-		int count;
 
-		/* count the number of non-ASCII characters */
-		/* Scanning the whole string is required for ASCII strings,
-		and computing the number of non-ASCII bytes is less expensive
-		than testing each byte, hence this method is faster for ASCII
-		strings, which is the most common case.
-		*/
-		count = 0;
-		for (pos = 0; pos < len; pos++) {
-			count += src[pos] >> 7;
-		}
-		if (count == 0) {
+		pos = ascii_prefix_len(src, len);
+		if (pos == len) {
+			/* ASCII string: return the internal buffer */
 			if (plen)
 				*plen = len;
 			return (const char *) src;
 		}
-		str_new = js_alloc_string(ctx, len + count, 0);
+		size = len + latin1_non_ascii_count(src + pos, len - pos);
+		str_new = js_alloc_string(ctx, size, 0);
 		if (!str_new)
 			goto fail;
-		q = str_new->u.str8;
-		for (pos = 0; pos < len; pos++) {
-			c = src[pos];
-			if (c < 0x80) {
-				*q++ = c;
-			} else {
-				*q++ = (c >> 6) | 0xc0;
-				*q++ = (c & 0x3f) | 0x80;
-			}
-		}
+		utf8_encode8(str_new->u.str8, size, src, len, &pos);
 	} else {
-		const uint16_t *src = str->u.str16;
-		/* Allocate 3 bytes per 16 bit code point. Surrogate pairs may
-		produce 4 bytes but use 2 code points.
-		*/
-		str_new = js_alloc_string(ctx, len * 3, 0);
+		size = utf16_to_utf8_len(str->u.str16, len, cesu8);
+		str_new = js_alloc_string(ctx, size, 0);
 		if (!str_new)
 			goto fail;
-		q = str_new->u.str8;
-		pos = 0;
-		while (pos < len) {
-			c = src[pos++];
-			if (c < 0x80) {
-				*q++ = c;
-			} else {
-				if (is_hi_surrogate(c)) {
-					if (pos < len && !cesu8) {
-						c1 = src[pos];
-						if (is_lo_surrogate(c1)) {
-							pos++;
-							c = from_surrogate(
-								c, c1);
-						} else {
-							/* Keep unmatched surrogate code points */
-							/* c = 0xfffd; */
-							/* error */
-						}
-					} else {
-						/* Keep unmatched surrogate code points */
-						/* c = 0xfffd; */ /* error */
-					}
-				}
-				q += unicode_to_utf8(q, c);
-			}
-		}
+		utf8_encode16(str_new->u.str8, size, str->u.str16, len, &pos,
+			      cesu8 ? UTF8_ENCODE_CESU8 : 0);
 	}
-
-	*q = '\0';
-	str_new->len = q - str_new->u.str8;
+	str_new->u.str8[size] = '\0';
 	JS_FreeValue(ctx, val);
 	if (plen)
-		*plen = str_new->len;
+		*plen = size;
 	return (const char *) str_new->u.str8;
 fail:
 	if (plen)
@@ -4285,8 +5099,22 @@ void JS_FreeCString(JSContext *ctx, const char *ptr) {
 }
 
 static int memcmp16_8(const uint16_t *src1, const uint8_t *src2, int len) {
-	int c, i;
-	for (i = 0; i < len; i++) {
+	int c, i = 0;
+#if defined(__SSE2__)
+	__m128i zero = _mm_setzero_si128();
+	unsigned int mask;
+	for (; i + 8 <= len; i += 8) {
+		mask = _mm_movemask_epi8(_mm_cmpeq_epi16(
+			_mm_loadu_si128((const __m128i *) (src1 + i)),
+			_mm_unpacklo_epi8(_mm_loadl_epi64(
+				(const __m128i *) (src2 + i)), zero)));
+		if (mask != 0xffff) {
+			i += ctz32(~mask) >> 1;
+			return src1[i] - src2[i];
+		}
+	}
+#endif
+	for (; i < len; i++) {
 		c = src1[i] - src2[i];
 		if (c != 0)
 			return c;
@@ -4295,8 +5123,20 @@ static int memcmp16_8(const uint16_t *src1, const uint8_t *src2, int len) {
 }
 
 static int memcmp16(const uint16_t *src1, const uint16_t *src2, int len) {
-	int c, i;
-	for (i = 0; i < len; i++) {
+	int c, i = 0;
+#if defined(__SSE2__)
+	unsigned int mask;
+	for (; i + 8 <= len; i += 8) {
+		mask = _mm_movemask_epi8(_mm_cmpeq_epi16(
+			_mm_loadu_si128((const __m128i *) (src1 + i)),
+			_mm_loadu_si128((const __m128i *) (src2 + i))));
+		if (mask != 0xffff) {
+			i += ctz32(~mask) >> 1;
+			return src1[i] - src2[i];
+		}
+	}
+#endif
+	for (; i < len; i++) {
 		c = src1[i] - src2[i];
 		if (c != 0)
 			return c;
@@ -4321,6 +5161,24 @@ static int js_string_memcmp(const JSString *p1, const JSString *p2, int len) {
 	return res;
 }
 
+/* faster than js_string_compare() when only equality is needed */
+static BOOL js_string_eq(const JSString *p1, const JSString *p2) {
+	if (p1 == p2)
+		return TRUE;
+	if (p1->len != p2->len)
+		return FALSE;
+	if (p1->atom_type <= JS_ATOM_TYPE_STRING &&
+	    p2->atom_type <= JS_ATOM_TYPE_STRING) {
+		/* string atoms are unique */
+		if (p1->atom_type && p2->atom_type)
+			return FALSE;
+		/* compare the hashes when they are known */
+		if (p1->hash != 0 && p2->hash != 0 && p1->hash != p2->hash)
+			return FALSE;
+	}
+	return js_string_memcmp(p1, p2, p1->len) == 0;
+}
+
 /* return < 0, 0 or > 0 */
 static int js_string_compare(JSContext *ctx,
 			     const JSString *p1, const JSString *p2) {
@@ -4376,14 +5234,16 @@ static JSValue JS_ConcatString1(JSContext *ctx,
 
 static BOOL JS_ConcatStringInPlace(JSContext *ctx, JSString *p1,
 				   JSValueConst op2) {
-	if (JS_VALUE_GET_TAG(op2) == JS_TAG_STRING) {
-		JSString *p2 = JS_VALUE_GET_STRING(op2);
+	if (JS_IsString(op2)) {
+		JSShortStringBuf sbuf;
+		JSString *p2 = js_get_string(&sbuf, op2);
 		size_t size1;
 
 		if (p2->len == 0)
 			return TRUE;
-		if (p1->header.ref_count != 1)
+		if (p1->header.ref_count != 1 || p1->atom_type != 0)
 			return FALSE;
+		p1->hash = 0; /* the contents are modified */
 		size1 = js_malloc_usable_size(ctx, p1);
 		if (p1->is_wide_char) {
 			if (size1 >= sizeof(*p1) + ((p1->len + p2->len) << 1)) {
@@ -4417,30 +5277,42 @@ static BOOL JS_ConcatStringInPlace(JSContext *ctx, JSString *p1,
 /* op1 and op2 are converted to strings. For convenience, op1 or op2 =
    JS_EXCEPTION are accepted and return JS_EXCEPTION.  */
 static JSValue JS_ConcatString(JSContext *ctx, JSValue op1, JSValue op2) {
+	JSShortStringBuf sbuf1, sbuf2;
 	JSValue ret;
 	JSString *p1, *p2;
+	uint32_t len;
 
-	if (unlikely(JS_VALUE_GET_TAG(op1) != JS_TAG_STRING)) {
+	if (unlikely(!JS_IsString(op1))) {
 		op1 = JS_ToStringFree(ctx, op1);
 		if (JS_IsException(op1)) {
 			JS_FreeValue(ctx, op2);
 			return JS_EXCEPTION;
 		}
 	}
-	if (unlikely(JS_VALUE_GET_TAG(op2) != JS_TAG_STRING)) {
+	if (unlikely(!JS_IsString(op2))) {
 		op2 = JS_ToStringFree(ctx, op2);
 		if (JS_IsException(op2)) {
 			JS_FreeValue(ctx, op1);
 			return JS_EXCEPTION;
 		}
 	}
-	p1 = JS_VALUE_GET_STRING(op1);
-	if (JS_ConcatStringInPlace(ctx, p1, op2)) {
+	p1 = js_get_string(&sbuf1, op1);
+	if (JS_VALUE_GET_TAG(op1) == JS_TAG_STRING &&
+	    JS_ConcatStringInPlace(ctx, p1, op2)) {
 		JS_FreeValue(ctx, op2);
 		return op1;
 	}
-	p2 = JS_VALUE_GET_STRING(op2);
-	ret = JS_ConcatString1(ctx, p1, p2);
+	p2 = js_get_string(&sbuf2, op2);
+	len = p1->len + p2->len;
+	if (len <= JS_SHORT_STRING_MAX_LEN &&
+	    !p1->is_wide_char && !p2->is_wide_char) {
+		uint8_t buf[JS_SHORT_STRING_MAX_LEN + 1];
+		memcpy(buf, p1->u.str8, p1->len);
+		memcpy(buf + p1->len, p2->u.str8, p2->len);
+		ret = js_new_string8_short(ctx, buf, len);
+	} else {
+		ret = JS_ConcatString1(ctx, p1, p2);
+	}
 	JS_FreeValue(ctx, op1);
 	JS_FreeValue(ctx, op2);
 	return ret;
@@ -4570,6 +5442,7 @@ static no_inline JSShape *js_new_shape2(JSContext *ctx, JSObject *proto,
 	sh->prop_size = prop_size;
 	sh->prop_count = 0;
 	sh->deleted_prop_count = 0;
+	sh->enum_cache = nullptr;
 
 	/* insert in the hash table */
 	sh->hash = shape_initial_hash(proto);
@@ -4604,6 +5477,7 @@ static JSShape *js_clone_shape(JSContext *ctx, JSShape *sh1) {
 	sh->header.ref_count = 1;
 	add_gc_object(ctx->rt, &sh->header, JS_GC_OBJ_TYPE_SHAPE);
 	sh->is_hashed = FALSE;
+	sh->enum_cache = nullptr;
 	if (sh->proto) {
 		JS_DupValue(ctx, JS_MKPTR(JS_TAG_OBJECT, sh->proto));
 	}
@@ -4618,6 +5492,24 @@ static JSShape *js_dup_shape(JSShape *sh) {
 	return sh;
 }
 
+static void js_free_enum_cache(JSRuntime *rt, JSShapeEnumCache *ec) {
+	uint32_t i;
+
+	if (--ec->ref_count == 0) {
+		for (i = 0; i < ec->count; i++)
+			JS_FreeAtomRT(rt, ec->atoms[i]);
+		js_free_rt(rt, ec);
+	}
+}
+
+/* must be called before the properties of the shape are modified */
+static inline void js_shape_reset_enum_cache(JSRuntime *rt, JSShape *sh) {
+	if (unlikely(sh->enum_cache)) {
+		js_free_enum_cache(rt, sh->enum_cache);
+		sh->enum_cache = nullptr;
+	}
+}
+
 static void js_free_shape0(JSRuntime *rt, JSShape *sh) {
 	uint32_t i;
 	JSShapeProperty *pr;
@@ -4625,6 +5517,7 @@ static void js_free_shape0(JSRuntime *rt, JSShape *sh) {
 	assert(sh->header.ref_count == 0);
 	if (sh->is_hashed)
 		js_shape_hash_unlink(rt, sh);
+	js_shape_reset_enum_cache(rt, sh);
 	if (sh->proto != nullptr) {
 		JS_FreeValueRT(rt, JS_MKPTR(JS_TAG_OBJECT, sh->proto));
 	}
@@ -4786,6 +5679,7 @@ static int add_shape_property(JSContext *ctx, JSShape **psh,
 	uint32_t hash_mask, new_shape_hash = 0;
 	intptr_t h;
 
+	js_shape_reset_enum_cache(rt, sh);
 	/* update the shape hash */
 	if (sh->is_hashed) {
 		js_shape_hash_unlink(rt, sh);
@@ -4940,7 +5834,7 @@ static JSValue JS_NewObjectFromShape(JSContext *ctx, JSShape *sh,
 	p->is_uncatchable_error = 0;
 	p->tmp_mark = 0;
 	p->is_HTMLDDA = 0;
-	p->first_weak_ref = nullptr;
+	p->has_weak_ref = 0;
 	p->u.opaque = nullptr;
 	p->shape = sh;
 	p->prop = js_malloc(ctx, sizeof(JSProperty) * sh->prop_size);
@@ -4951,6 +5845,8 @@ static JSValue JS_NewObjectFromShape(JSContext *ctx, JSShape *sh,
 		return JS_EXCEPTION;
 	}
 
+	ctx->rt->class_array[class_id].obj_alloc_count++;
+
 	switch (class_id) {
 		case JS_CLASS_OBJECT:
 			break;
@@ -4960,6 +5856,8 @@ static JSValue JS_NewObjectFromShape(JSContext *ctx, JSShape *sh,
 			p->fast_array = 1;
 			p->u.array.u.values = nullptr;
 			p->u.array.count = 0;
+			p->u.array.hole_count = 0;
+			p->u.array.kind = JS_ARRAY_KIND_INT32;
 			p->u.array.u1.size = 0;
 			/* the length property is always the first one */
 			if (likely(sh == ctx->array_shape)) {
@@ -4993,6 +5891,8 @@ static JSValue JS_NewObjectFromShape(JSContext *ctx, JSShape *sh,
 			p->fast_array = 1;
 			p->u.array.u.ptr = nullptr;
 			p->u.array.count = 0;
+			p->u.array.hole_count = 0;
+			p->u.array.kind = JS_ARRAY_KIND_VALUE;
 			break;
 		case JS_CLASS_DATAVIEW:
 			p->u.array.u.ptr = nullptr;
@@ -5123,6 +6023,27 @@ JSValue JS_NewObject(JSContext *ctx) {
 				      JS_CLASS_OBJECT);
 }
 
+/* create an object with the shape of the object literal template 'tmpl'.
+   The properties are initialized to undefined. */
+static JSValue js_new_object_literal(JSContext *ctx, JSValueConst tmpl) {
+	JSShape *sh = JS_VALUE_GET_OBJ(tmpl)->shape;
+	JSValue obj;
+	JSObject *p;
+	int i;
+
+	/* the template may come from another realm */
+	if (unlikely(sh->proto !=
+		     JS_VALUE_GET_OBJ(ctx->class_proto[JS_CLASS_OBJECT])))
+		return JS_NewObject(ctx);
+	obj = JS_NewObjectFromShape(ctx, js_dup_shape(sh), JS_CLASS_OBJECT);
+	if (JS_IsException(obj))
+		return obj;
+	p = JS_VALUE_GET_OBJ(obj);
+	for (i = 0; i < sh->prop_count; i++)
+		p->prop[i].u.value = JS_UNDEFINED;
+	return obj;
+}
+
 static void js_function_set_properties(JSContext *ctx, JSValueConst func_obj,
 				       JSAtom name, int len) {
 	/* ES6 feature non compatible with ES5.1: length is configurable */
@@ -5440,8 +6361,10 @@ static void js_array_finalizer(JSRuntime *rt, JSValue val) {
 	JSObject *p = JS_VALUE_GET_OBJ(val);
 	int i;
 
-	for (i = 0; i < p->u.array.count; i++) {
-		JS_FreeValueRT(rt, p->u.array.u.values[i]);
+	if (p->u.array.kind == JS_ARRAY_KIND_VALUE) {
+		for (i = 0; i < p->u.array.count; i++) {
+			JS_FreeValueRT(rt, p->u.array.u.values[i]);
+		}
 	}
 	js_free_rt(rt, p->u.array.u.values);
 }
@@ -5451,6 +6374,8 @@ static void js_array_mark(JSRuntime *rt, JSValueConst val,
 	JSObject *p = JS_VALUE_GET_OBJ(val);
 	int i;
 
+	if (p->u.array.kind != JS_ARRAY_KIND_VALUE)
+		return;
 	for (i = 0; i < p->u.array.count; i++) {
 		JS_MarkValue(rt, p->u.array.u.values[i], mark_func);
 	}
@@ -5563,7 +6488,9 @@ static void js_for_in_iterator_finalizer(JSRuntime *rt, JSValue val) {
 	int i;
 
 	JS_FreeValueRT(rt, it->obj);
-	if (!it->is_array) {
+	if (it->enum_cache) {
+		js_free_enum_cache(rt, it->enum_cache);
+	} else if (!it->is_array) {
 		for (i = 0; i < it->atom_count; i++) {
 			JS_FreeAtomRT(rt, it->tab_atom[i].atom);
 		}
@@ -5587,6 +6514,7 @@ static void free_object(JSRuntime *rt, JSObject *p) {
 
 	p->free_mark = 1; /* used to tell the object is invalid when
                          freeing cycles */
+	rt->class_array[p->class_id].obj_free_count++;
 	/* free all the fields */
 	sh = p->shape;
 	pr = get_shape_prop(sh);
@@ -5603,7 +6531,7 @@ static void free_object(JSRuntime *rt, JSObject *p) {
 	p->shape = nullptr;
 	p->prop = nullptr;
 
-	if (unlikely(p->first_weak_ref)) {
+	if (unlikely(p->has_weak_ref)) {
 		reset_weak_ref(rt, p);
 	}
 
@@ -5837,6 +6765,8 @@ static void mark_children(JSRuntime *rt, JSGCObjectHeader *gp,
 			for (i = 0; i < b->cpool_count; i++) {
 				JS_MarkValue(rt, b->cpool[i], mark_func);
 			}
+			if (b->ctor_shape)
+				mark_func(rt, &b->ctor_shape->header);
 			if (b->realm)
 				mark_func(rt, &b->realm->header);
 		}
@@ -5976,6 +6906,7 @@ static void gc_free_cycles(JSRuntime *rt) {
 			case JS_GC_OBJ_TYPE_JS_OBJECT:
 			case JS_GC_OBJ_TYPE_FUNCTION_BYTECODE:
 			case JS_GC_OBJ_TYPE_ASYNC_FUNCTION:
+				rt->gc_freed_count++;
 #ifdef DUMP_GC_FREE
             if (!header_done) {
                 printf("Freeing cycles:\n");
@@ -6006,7 +6937,31 @@ static void gc_free_cycles(JSRuntime *rt) {
 	init_list_head(&rt->gc_zero_ref_count_list);
 }
 
+static int64_t get_monotonic_time_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void gc_update_stats(JSRuntime *rt, int64_t pause) {
+	int64_t us = pause / 1000;
+	int i;
+
+	rt->gc_count++;
+	rt->gc_pause_total += pause;
+	if (pause > rt->gc_pause_max)
+		rt->gc_pause_max = pause;
+	/* log2 buckets */
+	if (us == 0)
+		i = 0;
+	else
+		i = min_int(64 - clz64(us), JS_GC_PAUSE_HISTOGRAM_SIZE - 1);
+	rt->gc_pause_histogram[i]++;
+}
+
 void JS_RunGC(JSRuntime *rt) {
+	int64_t start_time = get_monotonic_time_ns();
+
 	/* decrement the reference of the children of each object. mark =
 	1 after this pass. */
 	gc_decref(rt);
@@ -6016,6 +6971,192 @@ void JS_RunGC(JSRuntime *rt) {
 
 	/* free the GC objects in a cycle */
 	gc_free_cycles(rt);
+	weak_ref_hash_shrink(rt);
+
+	gc_update_stats(rt, get_monotonic_time_ns() - start_time);
+}
+
+/* the heap may not grow by more than GC_MAX_GROWTH times its live size
+   between two automatic GCs with the rate based policies */
+#define GC_MAX_GROWTH 4
+
+/* compute the threshold of the next automatic GC. 'size' is malloc_size
+   before the GC which started at 'start_time'. */
+static void gc_update_threshold(JSRuntime *rt, size_t size,
+				int64_t start_time) {
+	JSGCPolicy *pol = &rt->gc_policy;
+	size_t live = js_gc_heap_size(rt);
+	size_t threshold;
+	int64_t end_time, pause, elapsed;
+	double rate, slack;
+
+	end_time = get_monotonic_time_ns();
+	pause = end_time - start_time;
+	elapsed = max_int64(start_time - rt->gc_last_time, 1);
+	/* net heap growth since the previous automatic GC */
+	rate = (double) (size > rt->gc_last_live_size ?
+			 size - rt->gc_last_live_size : 0) / elapsed;
+	if (rt->gc_alloc_rate == 0)
+		rt->gc_alloc_rate = rate;
+	else
+		rt->gc_alloc_rate = (rt->gc_alloc_rate + rate) / 2;
+	rt->gc_last_live_size = live;
+	rt->gc_last_time = end_time;
+
+	switch (pol->kind) {
+		case JS_GC_POLICY_OVERHEAD:
+			/* running time during which 'pause' is 'overhead' percent
+			   of the total time */
+			slack = rt->gc_alloc_rate * pause *
+				(100 - pol->overhead) / pol->overhead;
+			break;
+		case JS_GC_POLICY_ALLOC_RATE:
+			slack = rt->gc_alloc_rate * pol->interval * 1e6;
+			break;
+		case JS_GC_POLICY_CUSTOM: {
+			JSGCStats stats;
+			JS_GetGCStats(rt, &stats);
+			threshold = pol->threshold_func(rt, &stats,
+							pol->opaque);
+		}
+		break;
+		default:
+			threshold = live + (uint64_t) live * pol->growth / 100;
+			break;
+	}
+	if (pol->kind == JS_GC_POLICY_OVERHEAD ||
+	    pol->kind == JS_GC_POLICY_ALLOC_RATE) {
+		/* the rate based policies let the heap grow by 1/8 to
+		   GC_MAX_GROWTH times its live size */
+		slack = fmin(fmax(slack, live / 8.0),
+			     (double) live * GC_MAX_GROWTH);
+		threshold = live + (size_t) slack;
+	}
+	if (threshold < pol->min_threshold)
+		threshold = pol->min_threshold;
+	rt->malloc_gc_threshold = threshold;
+}
+
+void JS_CompactMemory(JSRuntime *rt) {
+	int hash_size, shape_hash_bits;
+
+	/* the initial sizes are the minimum ones */
+	hash_size = rt->atom_hash_size;
+	while (hash_size > 256 && rt->atom_count < hash_size / 8)
+		hash_size /= 2;
+	if (hash_size != rt->atom_hash_size)
+		JS_ResizeAtomHash(rt, hash_size);
+
+	shape_hash_bits = rt->shape_hash_bits;
+	while (shape_hash_bits > 4 &&
+	       8 * rt->shape_hash_count < (1 << shape_hash_bits))
+		shape_hash_bits--;
+	if (shape_hash_bits != rt->shape_hash_bits)
+		resize_shape_hash(rt, shape_hash_bits);
+}
+
+void JS_GetGCPolicy(JSRuntime *rt, JSGCPolicy *policy) {
+	*policy = rt->gc_policy;
+}
+
+void JS_SetGCPolicy(JSRuntime *rt, const JSGCPolicy *policy) {
+	JSGCPolicy *pol = &rt->gc_policy;
+
+	*pol = *policy;
+	pol->growth = max_int(pol->growth, 1);
+	pol->overhead = max_int(min_int(pol->overhead, 99), 1);
+	pol->interval = max_int(pol->interval, 1);
+	if (pol->kind == JS_GC_POLICY_CUSTOM && !pol->threshold_func)
+		pol->kind = JS_GC_POLICY_GROWTH;
+	/* the new policy applies from the next automatic GC */
+	if (rt->malloc_gc_threshold < pol->min_threshold)
+		rt->malloc_gc_threshold = pol->min_threshold;
+}
+
+void JS_GetGCStats(JSRuntime *rt, JSGCStats *s) {
+	int i;
+
+	memset(s, 0, sizeof(*s));
+	s->malloc_size = rt->malloc_state.malloc_size;
+	s->malloc_limit = rt->malloc_state.malloc_limit;
+	s->malloc_count = rt->malloc_state.malloc_count;
+	s->gc_threshold = rt->malloc_gc_threshold;
+	s->pool_size = rt->async_func_pool_size;
+	for (i = 0; i < JS_ASYNC_FUNC_POOL_CLASSES; i++)
+		s->pool_count += rt->async_func_pool_count[i];
+	s->hashed_shape_count = rt->shape_hash_count;
+	for (i = 0; i < rt->class_count; i++) {
+		s->obj_alloc_count += rt->class_array[i].obj_alloc_count;
+		s->obj_count += rt->class_array[i].obj_alloc_count -
+			rt->class_array[i].obj_free_count;
+	}
+	s->gc_count = rt->gc_count;
+	s->gc_auto_count = rt->gc_auto_count;
+	s->gc_freed_count = rt->gc_freed_count;
+	s->gc_pause_total = rt->gc_pause_total;
+	s->gc_pause_max = rt->gc_pause_max;
+	memcpy(s->gc_pause_histogram, rt->gc_pause_histogram,
+	       sizeof(s->gc_pause_histogram));
+}
+
+JS_BOOL JS_GetClassStats(JSRuntime *rt, JSClassID class_id, JSClassStats *s) {
+	JSClass *cl;
+
+	if (class_id >= rt->class_count)
+		return FALSE;
+	cl = &rt->class_array[class_id];
+	s->class_name = cl->class_id != 0 ? cl->class_name : JS_ATOM_NULL;
+	s->obj_alloc_count = cl->obj_alloc_count;
+	s->obj_count = cl->obj_alloc_count - cl->obj_free_count;
+	return TRUE;
+}
+
+void JS_DumpGCStats(FILE *fp, JSRuntime *rt) {
+	char buf[ATOM_GET_STR_BUF_SIZE];
+	JSGCStats s;
+	JSClassStats cs;
+	JSClassID class_id;
+	int64_t us;
+	int i;
+
+	JS_GetGCStats(rt, &s);
+	fprintf(fp, "%-20s %12"PRId64" bytes in %"PRId64" blocks\n",
+		"memory allocated", s.malloc_size, s.malloc_count);
+	fprintf(fp, "%-20s %12"PRId64" bytes in %"PRId64" blocks\n",
+		"  pooled for reuse", s.pool_size, s.pool_count);
+	fprintf(fp, "%-20s %12"PRId64" bytes\n", "GC threshold",
+		s.gc_threshold);
+	fprintf(fp, "%-20s %12"PRId64" (%"PRId64" live)\n",
+		"objects allocated", s.obj_alloc_count, s.obj_count);
+	fprintf(fp, "%-20s %12"PRId64"\n", "hashed shapes",
+		s.hashed_shape_count);
+	fprintf(fp, "%-20s %12"PRId64" (%"PRId64" automatic)\n",
+		"GC runs", s.gc_count, s.gc_auto_count);
+	fprintf(fp, "%-20s %12"PRId64"\n", "freed in cycles",
+		s.gc_freed_count);
+	fprintf(fp, "%-20s %12.3f ms (max %0.3f ms)\n", "GC pauses",
+		s.gc_pause_total / 1e6, s.gc_pause_max / 1e6);
+	for (i = 0; i < JS_GC_PAUSE_HISTOGRAM_SIZE; i++) {
+		if (!s.gc_pause_histogram[i])
+			continue;
+		us = (int64_t) 1 << i;
+		if (i == 0)
+			fprintf(fp, "  %12s < %-8"PRId64, "", us);
+		else if (i == JS_GC_PAUSE_HISTOGRAM_SIZE - 1)
+			fprintf(fp, "  %12"PRId64" <= %-7s", us / 2, "");
+		else
+			fprintf(fp, "  %12"PRId64" .. %-7"PRId64, us / 2, us);
+		fprintf(fp, " us %8"PRId64"\n", s.gc_pause_histogram[i]);
+	}
+	fprintf(fp, "\n%3s %-24s %12s %12s\n", "ID", "CLASS", "ALLOCATED",
+		"LIVE");
+	for (class_id = 1; JS_GetClassStats(rt, class_id, &cs); class_id++) {
+		if (cs.obj_alloc_count == 0)
+			continue;
+		fprintf(fp, "%3u %-24s %12"PRId64" %12"PRId64"\n", class_id,
+			JS_AtomGetStrRT(rt, buf, sizeof(buf), cs.class_name),
+			cs.obj_alloc_count, cs.obj_count);
+	}
 }
 
 /* Return false if not an object or if the object has already been
@@ -6237,13 +7378,15 @@ void JS_ComputeMemoryUsage(JSRuntime *rt, JSMemoryUsage *s) {
 						s->memory_used_count++;
 						s->memory_used_size += p->u.
 								array.count *
-								sizeof(*p->u.
-									array.u.
-									values);
+								js_array_kind_size[
+									p->u.
+									array.
+									kind];
 						s->fast_array_elements += p->u.
 								array.count;
 						for (i = 0; i < p->u.array.count
-						     ; i++) {
+						     && p->u.array.kind ==
+						     JS_ARRAY_KIND_VALUE; i++) {
 							compute_value_size(
 								p->u.array.u.
 								values[i], hp);
@@ -6407,10 +7550,6 @@ void JS_ComputeMemoryUsage(JSRuntime *rt, JSMemoryUsage *s) {
 			/* u.promise_function_data */
 			case JS_CLASS_PROMISE_REJECT_FUNCTION:
 			/* u.promise_function_data */
-			case JS_CLASS_ASYNC_FUNCTION_RESOLVE:
-			/* u.async_function_data */
-			case JS_CLASS_ASYNC_FUNCTION_REJECT:
-			/* u.async_function_data */
 			case JS_CLASS_ASYNC_FROM_SYNC_ITERATOR:
 			/* u.async_from_sync_iterator_data */
 			case JS_CLASS_ASYNC_GENERATOR:
@@ -6771,7 +7910,7 @@ static const char *get_func_name(JSContext *ctx, JSValueConst func) {
 	if ((prs->flags & JS_PROP_TMASK) != JS_PROP_NORMAL)
 		return nullptr;
 	val = pr->u.value;
-	if (JS_VALUE_GET_TAG(val) != JS_TAG_STRING)
+	if (!JS_IsString(val))
 		return nullptr;
 	return JS_ToCString(ctx, val);
 }
@@ -7205,6 +8344,7 @@ static JSValueConst JS_GetPrototypePrimitive(JSContext *ctx, JSValueConst val) {
 			val = ctx->class_proto[JS_CLASS_BOOLEAN];
 			break;
 		case JS_TAG_STRING:
+		case JS_TAG_SHORT_STRING:
 			val = ctx->class_proto[JS_CLASS_STRING];
 			break;
 		case JS_TAG_SYMBOL:
@@ -7406,8 +8546,10 @@ JSValue JS_GetPropertyInternal(JSContext *ctx, JSValueConst obj,
 					prop);
 			case JS_TAG_EXCEPTION:
 				return JS_EXCEPTION;
-			case JS_TAG_STRING: {
-				JSString *p1 = JS_VALUE_GET_STRING(obj);
+			case JS_TAG_STRING:
+			case JS_TAG_SHORT_STRING: {
+				JSShortStringBuf sbuf;
+				JSString *p1 = js_get_string(&sbuf, obj);
 				if (__JS_AtomIsTaggedInt(prop)) {
 					uint32_t idx, ch;
 					idx = __JS_AtomToUInt32(prop);
@@ -7483,6 +8625,11 @@ JSValue JS_GetPropertyInternal(JSContext *ctx, JSValueConst obj,
 				if (__JS_AtomIsTaggedInt(prop)) {
 					uint32_t idx = __JS_AtomToUInt32(prop);
 					if (idx < p->u.array.count) {
+						/* holes are looked up in the
+						   prototype chain */
+						if (js_fast_array_is_hole(
+							p, idx))
+							goto next_proto;
 						/* we avoid duplicating the code */
 						return JS_GetPropertyUint32(
 							ctx, JS_MKPTR(
@@ -7566,6 +8713,7 @@ JSValue JS_GetPropertyInternal(JSContext *ctx, JSValueConst obj,
 				}
 			}
 		}
+	next_proto:
 		p = p->shape->proto;
 		if (!p)
 			break;
@@ -7876,7 +9024,8 @@ static int __exception JS_GetOwnPropertyNamesInternal(JSContext *ctx,
 	if (p->is_exotic) {
 		if (p->fast_array) {
 			if (flags & JS_GPN_STRING_MASK) {
-				num_keys_count += p->u.array.count;
+				num_keys_count += p->u.array.count -
+						p->u.array.hole_count;
 			}
 		} else if (p->class_id == JS_CLASS_STRING) {
 			if (flags & JS_GPN_STRING_MASK) {
@@ -7993,6 +9142,9 @@ static int __exception JS_GetOwnPropertyNamesInternal(JSContext *ctx,
 					ctx, JS_MKPTR(JS_TAG_OBJECT, p));
 			add_array_keys:
 				for (i = 0; i < len; i++) {
+					if (p->fast_array &&
+					    js_fast_array_is_hole(p, i))
+						continue;
 					tab_atom[num_index].atom =
 							__JS_AtomFromUInt32(i);
 					if (tab_atom[num_index].atom ==
@@ -8042,6 +9194,35 @@ static int __exception JS_GetOwnPropertyNamesInternal(JSContext *ctx,
 	return 0;
 }
 
+/* return the enumerable string keys of the non exotic object 'p'. The
+   list is computed once per shape. Return nullptr if exception. */
+static JSShapeEnumCache *js_get_enum_cache(JSContext *ctx, JSObject *p) {
+	JSShape *sh = p->shape;
+	JSShapeEnumCache *ec;
+	JSPropertyEnum *tab_atom;
+	uint32_t len, i;
+
+	assert(!p->is_exotic);
+	if (likely(sh->enum_cache))
+		return sh->enum_cache;
+	if (JS_GetOwnPropertyNamesInternal(ctx, &tab_atom, &len, p,
+					   JS_GPN_STRING_MASK |
+					   JS_GPN_ENUM_ONLY))
+		return nullptr;
+	ec = js_malloc(ctx, sizeof(*ec) + sizeof(ec->atoms[0]) * len);
+	if (!ec) {
+		js_free_prop_enum(ctx, tab_atom, len);
+		return nullptr;
+	}
+	ec->ref_count = 1;
+	ec->count = len;
+	for (i = 0; i < len; i++)
+		ec->atoms[i] = tab_atom[i].atom;
+	js_free(ctx, tab_atom);
+	sh->enum_cache = ec;
+	return ec;
+}
+
 int JS_GetOwnPropertyNames(JSContext *ctx, JSPropertyEnum **ptab,
 			   uint32_t *plen, JSValueConst obj, int flags) {
 	if (JS_VALUE_GET_TAG(obj) != JS_TAG_OBJECT) {
@@ -8132,7 +9313,8 @@ retry:
 			if (__JS_AtomIsTaggedInt(prop)) {
 				uint32_t idx;
 				idx = __JS_AtomToUInt32(prop);
-				if (idx < p->u.array.count) {
+				if (idx < p->u.array.count &&
+				    !js_fast_array_is_hole(p, idx)) {
 					if (desc) {
 						desc->flags =
 								JS_PROP_WRITABLE
@@ -8266,6 +9448,22 @@ JSAtom JS_ValueToAtom(JSContext *ctx, JSValueConst val) {
 	} else if (tag == JS_TAG_SYMBOL) {
 		JSAtomStruct *p = JS_VALUE_GET_PTR(val);
 		atom = JS_DupAtom(ctx, js_get_atom_index(ctx->rt, p));
+	} else if (tag == JS_TAG_SHORT_STRING) {
+		JSShortStringBuf sbuf;
+		JSString *p = js_get_string(&sbuf, val);
+		JSValue str;
+		uint32_t n;
+		/* avoid allocating a string if the atom already exists */
+		if (is_num_string(&n, p) && n <= JS_ATOM_MAX_INT)
+			return __JS_AtomFromUInt32(n);
+		atom = __JS_FindAtom(ctx->rt, (const char *) p->u.str8, p->len,
+				     JS_ATOM_TYPE_STRING);
+		if (atom == JS_ATOM_NULL) {
+			str = js_short_string_to_string(ctx, val);
+			if (JS_IsException(str))
+				return JS_ATOM_NULL;
+			atom = JS_NewAtomStr(ctx, JS_VALUE_GET_STRING(str));
+		}
 	} else {
 		JSValue str;
 		str = JS_ToPropertyKey(ctx, val);
@@ -8295,11 +9493,11 @@ static JSValue JS_GetPropertyValue(JSContext *ctx, JSValueConst this_obj,
 		switch (p->class_id) {
 			case JS_CLASS_ARRAY:
 			case JS_CLASS_ARGUMENTS:
-				if (unlikely(idx >= p->u.array.count))
+				if (unlikely(idx >= p->u.array.count ||
+					js_fast_array_is_hole(p, idx)))
 					goto
 							slow_path;
-				return JS_DupValue(
-					ctx, p->u.array.u.values[idx]);
+				return js_fast_array_get(ctx, p, idx);
 			case JS_CLASS_INT8_ARRAY:
 				if (unlikely(idx >= p->u.array.count))
 					goto
@@ -8471,6 +9669,14 @@ static JSProperty *add_property(JSContext *ctx,
 			p->shape = js_dup_shape(new_sh);
 			js_free_shape(ctx->rt, sh);
 			return &p->prop[new_sh->prop_count - 1];
+		} else if (unlikely(sh->prop_count >= JS_PROP_DICT_THRESHOLD &&
+				    sh->header.ref_count == 1)) {
+			/* switch to dictionary mode: the shape is only used by
+			   this object so it is updated in place and no longer
+			   pollutes the shape hash table */
+			js_shape_hash_unlink(ctx->rt, sh);
+			sh->is_hashed = FALSE;
+			js_shape_reset_enum_cache(ctx->rt, sh);
 		} else if (sh->header.ref_count != 1) {
 			/* if the shape is shared, clone it */
 			new_sh = js_clone_shape(ctx, sh);
@@ -8489,6 +9695,121 @@ static JSProperty *add_property(JSContext *ctx,
 	return &p->prop[p->shape->prop_count - 1];
 }
 
+/* Fast arrays may contain holes as long as they are small or at least
+   half full. Otherwise the element vector would waste too much memory
+   and they are converted to normal arrays. */
+#define JS_ARRAY_HOLEY_SMALL_COUNT 1024
+
+static inline BOOL js_fast_array_holes_ok(uint32_t count,
+					  uint32_t hole_count) {
+	return count <= JS_ARRAY_HOLEY_SMALL_COUNT || hole_count <= count / 2;
+}
+
+/* remove the trailing holes of a fast array */
+static void js_fast_array_trim_holes(JSObject *p) {
+	while (p->u.array.hole_count != 0 &&
+	       JS_VALUE_GET_TAG(p->u.array.u.values[p->u.array.count - 1]) ==
+	       JS_TAG_UNINITIALIZED) {
+		p->u.array.count--;
+		p->u.array.hole_count--;
+	}
+}
+
+/* Convert the element storage of the fast array 'p' to the more
+   generic 'kind'. Return -1 if memory alloc error. No exception is
+   raised so that it can be used by the fast paths. */
+static no_inline int js_array_convert_kind(JSContext *ctx, JSObject *p,
+					   int kind) {
+	uint32_t i, count, size;
+	int old_kind;
+	void *ptr;
+
+	old_kind = p->u.array.kind;
+	if (old_kind == kind)
+		return 0;
+	count = p->u.array.count;
+	size = p->u.array.u1.size;
+	if (size != 0) {
+		ptr = js_realloc_rt(ctx->rt, p->u.array.u.ptr,
+				    js_array_kind_size[kind] * size);
+		if (!ptr)
+			return -1;
+		p->u.array.u.ptr = ptr;
+	}
+	/* the elements are larger: convert from the end */
+	for (i = count; i-- > 0;) {
+		if (old_kind == JS_ARRAY_KIND_INT32) {
+			int32_t v = p->u.array.u.int32_ptr[i];
+			if (kind == JS_ARRAY_KIND_FLOAT64)
+				p->u.array.u.double_ptr[i] = v;
+			else
+				p->u.array.u.values[i] = JS_NewInt32(ctx, v);
+		} else {
+			double d = p->u.array.u.double_ptr[i];
+			p->u.array.u.values[i] = JS_NewFloat64(ctx, d);
+		}
+	}
+	p->u.array.kind = kind;
+	return 0;
+}
+
+/* Store 'val' in the element 'idx' < p->u.array.size of the fast array
+   'p'. The previous value is freed unless 'is_new' is TRUE. The
+   element storage is converted if 'val' does not fit in it. 'val' is
+   always freed. Return -1 if memory alloc error. */
+static int js_fast_array_set(JSContext *ctx, JSObject *p, uint32_t idx,
+			     JSValue val, BOOL is_new) {
+	uint32_t tag;
+	int kind;
+
+	tag = JS_VALUE_GET_NORM_TAG(val);
+	switch (p->u.array.kind) {
+		case JS_ARRAY_KIND_INT32:
+			if (likely(tag == JS_TAG_INT)) {
+				p->u.array.u.int32_ptr[idx] =
+						JS_VALUE_GET_INT(val);
+				return 0;
+			} else if (tag == JS_TAG_FLOAT64) {
+				/* normalize the integer values */
+				val = JS_NewFloat64(ctx,
+						    JS_VALUE_GET_FLOAT64(val));
+				if (JS_VALUE_GET_TAG(val) == JS_TAG_INT) {
+					p->u.array.u.int32_ptr[idx] =
+							JS_VALUE_GET_INT(val);
+					return 0;
+				}
+			}
+			break;
+		case JS_ARRAY_KIND_FLOAT64:
+			if (tag == JS_TAG_INT) {
+				p->u.array.u.double_ptr[idx] =
+						JS_VALUE_GET_INT(val);
+				return 0;
+			} else if (tag == JS_TAG_FLOAT64) {
+				p->u.array.u.double_ptr[idx] =
+						JS_VALUE_GET_FLOAT64(val);
+				return 0;
+			}
+			break;
+		default:
+			if (is_new)
+				p->u.array.u.values[idx] = val;
+			else
+				set_value(ctx, &p->u.array.u.values[idx], val);
+			return 0;
+	}
+	if (tag == JS_TAG_FLOAT64)
+		kind = JS_ARRAY_KIND_FLOAT64;
+	else
+		kind = JS_ARRAY_KIND_VALUE;
+	if (js_array_convert_kind(ctx, p, kind)) {
+		JS_FreeValue(ctx, val);
+		JS_ThrowOutOfMemory(ctx);
+		return -1;
+	}
+	return js_fast_array_set(ctx, p, idx, val, is_new);
+}
+
 /* can be called on Array or Arguments objects. return < 0 if
    memory alloc error. */
 static no_inline __exception int convert_fast_array_to_array(JSContext *ctx,
@@ -8498,27 +9819,34 @@ static no_inline __exception int convert_fast_array_to_array(JSContext *ctx,
 	JSValue *tab;
 	uint32_t i, len, new_count;
 
+	if (js_array_convert_kind(ctx, p, JS_ARRAY_KIND_VALUE)) {
+		JS_ThrowOutOfMemory(ctx);
+		return -1;
+	}
 	if (js_shape_prepare_update(ctx, p, nullptr))
 		return -1;
 	len = p->u.array.count;
 	/* resize the properties once to simplify the error handling */
 	sh = p->shape;
-	new_count = sh->prop_count + len;
+	new_count = sh->prop_count + len - p->u.array.hole_count;
 	if (new_count > sh->prop_size) {
 		if (resize_properties(ctx, &p->shape, p, new_count))
 			return -1;
 	}
 
 	tab = p->u.array.u.values;
-	for (i = 0; i < len; i++) {
+	for (i = 0; i < len; i++, tab++) {
+		if (JS_VALUE_GET_TAG(*tab) == JS_TAG_UNINITIALIZED)
+			continue;
 		/* add_property cannot fail here but
 		__JS_AtomFromUInt32(i) fails for i > INT32_MAX */
 		pr = add_property(ctx, p, __JS_AtomFromUInt32(i),
 				  JS_PROP_C_W_E);
-		pr->u.value = *tab++;
+		pr->u.value = *tab;
 	}
 	js_free(ctx, p->u.array.u.values);
 	p->u.array.count = 0;
+	p->u.array.hole_count = 0;
 	p->u.array.u.values = nullptr; /* fail safe */
 	p->u.array.u1.size = 0;
 	p->fast_array = 0;
@@ -8568,6 +9896,28 @@ redo:
 			pr->atom = JS_ATOM_NULL;
 			pr1->u.value = JS_UNDEFINED;
 
+			if (sh->deleted_prop_count == sh->prop_count) {
+				/* no property left: empty the shape but keep
+				   its storage for the next additions */
+				memset(prop_hash_end(sh) -
+				       (sh->prop_hash_mask + 1), 0,
+				       sizeof(prop_hash_end(sh)[0]) *
+				       (sh->prop_hash_mask + 1));
+				sh->prop_count = 0;
+				sh->deleted_prop_count = 0;
+				return TRUE;
+			}
+			if (h == sh->prop_count) {
+				/* the deleted entries at the end are not
+				   referenced by the hash table: drop them */
+				prop = get_shape_prop(sh);
+				while (prop[sh->prop_count - 1].atom ==
+				       JS_ATOM_NULL) {
+					sh->prop_count--;
+					sh->deleted_prop_count--;
+				}
+				return TRUE;
+			}
 			/* compact the properties if too many deleted properties */
 			if (sh->deleted_prop_count >= 8 &&
 			    sh->deleted_prop_count >= (
@@ -8589,10 +9939,41 @@ redo:
 				    p->class_id == JS_CLASS_ARGUMENTS) {
 					/* Special case deleting the last element of a fast Array */
 					if (idx == p->u.array.count - 1) {
-						JS_FreeValue(
-							ctx, p->u.array.u.values
-							[idx]);
+						if (p->u.array.kind ==
+						    JS_ARRAY_KIND_VALUE)
+							JS_FreeValue(
+								ctx,
+								p->u.array.u.
+								values[idx]);
 						p->u.array.count = idx;
+						js_fast_array_trim_holes(p);
+						return TRUE;
+					}
+					/* other elements of a fast Array
+					   become holes while it stays dense
+					   enough */
+					if (p->class_id == JS_CLASS_ARRAY &&
+					    js_fast_array_holes_ok(
+						    p->u.array.count,
+						    p->u.array.hole_count + 1)) {
+						if (js_array_convert_kind(
+							ctx, p,
+							JS_ARRAY_KIND_VALUE)) {
+							JS_ThrowOutOfMemory(
+								ctx);
+							return -1;
+						}
+						if (!js_fast_array_is_hole(
+							p, idx)) {
+							JS_FreeValue(
+								ctx,
+								p->u.array.u.
+								values[idx]);
+							p->u.array.u.values[
+								idx] =
+									JS_ARRAY_HOLE;
+							p->u.array.hole_count++;
+						}
 						return TRUE;
 					}
 					if (convert_fast_array_to_array(ctx, p))
@@ -8658,11 +10039,19 @@ static int set_array_length(JSContext *ctx, JSObject *p, JSValue val,
 
 	if (likely(p->fast_array)) {
 		uint32_t old_len = p->u.array.count;
-		if (len < old_len) {
+		if (len < old_len &&
+		    p->u.array.kind == JS_ARRAY_KIND_VALUE) {
 			for (i = len; i < old_len; i++) {
-				JS_FreeValue(ctx, p->u.array.u.values[i]);
+				if (js_fast_array_is_hole(p, i))
+					p->u.array.hole_count--;
+				else
+					JS_FreeValue(
+						ctx, p->u.array.u.values[i]);
 			}
+		}
+		if (len < old_len) {
 			p->u.array.count = len;
+			js_fast_array_trim_holes(p);
 		}
 		p->prop[0].u.value = JS_NewUint32(ctx, len);
 	} else {
@@ -8745,16 +10134,17 @@ static int set_array_length(JSContext *ctx, JSObject *p, JSValue val,
 /* return -1 if exception */
 static int expand_fast_array(JSContext *ctx, JSObject *p, uint32_t new_len) {
 	uint32_t new_size;
-	size_t slack;
-	JSValue *new_array_prop;
+	size_t slack, elem_size;
+	void *new_array_prop;
 	/* XXX: potential arithmetic overflow */
 	new_size = max_int(new_len, p->u.array.u1.size * 3 / 2);
-	new_array_prop = js_realloc2(ctx, p->u.array.u.values,
-				     sizeof(JSValue) * new_size, &slack);
+	elem_size = js_array_kind_size[p->u.array.kind];
+	new_array_prop = js_realloc2(ctx, p->u.array.u.ptr,
+				     elem_size * new_size, &slack);
 	if (!new_array_prop)
 		return -1;
-	new_size += slack / sizeof(*new_array_prop);
-	p->u.array.u.values = new_array_prop;
+	new_size += slack / elem_size;
+	p->u.array.u.ptr = new_array_prop;
 	p->u.array.u1.size = new_size;
 	return 0;
 }
@@ -8788,11 +10178,115 @@ static int add_fast_array_element(JSContext *ctx, JSObject *p,
 			return -1;
 		}
 	}
-	p->u.array.u.values[new_len - 1] = val;
+	if (js_fast_array_set(ctx, p, new_len - 1, val, TRUE))
+		return -1;
 	p->u.array.count = new_len;
 	return TRUE;
 }
 
+/* Convert the normal array 'p' back to a fast array when its
+   properties other than 'length' are plain array elements which are
+   dense enough. To amortize its cost, the check is only done when the
+   number of properties reaches a power of two. Return -1 if memory
+   alloc error. */
+static int js_array_check_fast(JSContext *ctx, JSObject *p) {
+	JSShape *sh;
+	JSShapeProperty *prs;
+	JSValue *tab;
+	uint32_t i, n, len, count, idx;
+
+	sh = p->shape;
+	n = sh->prop_count - sh->deleted_prop_count - 1;
+	if (n < 8 || (n & (n - 1)) != 0 || !p->extensible ||
+	    JS_VALUE_GET_TAG(p->prop[0].u.value) != JS_TAG_INT)
+		return 0;
+	len = JS_VALUE_GET_INT(p->prop[0].u.value);
+	if (n > len || !js_fast_array_holes_ok(len, len - n))
+		return 0;
+	/* the length property is always the first one */
+	count = 0;
+	for (i = 1, prs = get_shape_prop(sh) + 1; i < sh->prop_count;
+	     i++, prs++) {
+		if (prs->atom == JS_ATOM_NULL)
+			continue;
+		if (!__JS_AtomIsTaggedInt(prs->atom) ||
+		    (prs->flags & (JS_PROP_TMASK | JS_PROP_C_W_E)) !=
+		    JS_PROP_C_W_E)
+			return 0;
+		idx = __JS_AtomToUInt32(prs->atom);
+		if (idx >= count)
+			count = idx + 1;
+	}
+	if (!js_fast_array_holes_ok(count, count - n))
+		return 0;
+
+	if (js_shape_prepare_update(ctx, p, nullptr))
+		return -1;
+	tab = js_malloc(ctx, sizeof(tab[0]) * count);
+	if (!tab)
+		return -1;
+	for (i = 0; i < count; i++)
+		tab[i] = JS_ARRAY_HOLE;
+	/* move the elements and remove them from the shape. The atoms
+	   are tagged integers so they don't need to be freed. */
+	sh = p->shape;
+	for (i = 1, prs = get_shape_prop(sh) + 1; i < sh->prop_count;
+	     i++, prs++) {
+		if (prs->atom == JS_ATOM_NULL)
+			continue;
+		tab[__JS_AtomToUInt32(prs->atom)] = p->prop[i].u.value;
+		p->prop[i].u.value = JS_UNDEFINED;
+		prs->atom = JS_ATOM_NULL;
+		prs->flags = 0;
+		sh->deleted_prop_count++;
+	}
+	p->u.array.u.values = tab;
+	p->u.array.u1.size = count;
+	p->u.array.count = count;
+	p->u.array.hole_count = count - n;
+	p->u.array.kind = JS_ARRAY_KIND_VALUE;
+	p->fast_array = 1;
+	compact_properties(ctx, p);
+	return 0;
+}
+
+/* Add the element 'idx' >= p->u.array.count to the fast array
+   'p'. The missing elements before it become holes. Same
+   preconditions as add_fast_array_element(). */
+static int add_fast_array_element_at(JSContext *ctx, JSObject *p,
+				     uint32_t idx, JSValue val, int flags) {
+	uint32_t i, count;
+
+	count = p->u.array.count;
+	if (idx > count) {
+		if (js_array_convert_kind(ctx, p, JS_ARRAY_KIND_VALUE)) {
+			JS_FreeValue(ctx, val);
+			JS_ThrowOutOfMemory(ctx);
+			return -1;
+		}
+		/* check the length before adding the holes */
+		if (JS_VALUE_GET_TAG(p->prop[0].u.value) == JS_TAG_INT &&
+		    idx >= JS_VALUE_GET_INT(p->prop[0].u.value) &&
+		    unlikely(!(get_shape_prop(p->shape)->flags &
+			       JS_PROP_WRITABLE))) {
+			JS_FreeValue(ctx, val);
+			return JS_ThrowTypeErrorReadOnly(ctx, flags,
+							 JS_ATOM_length);
+		}
+		if (idx >= p->u.array.u1.size) {
+			if (expand_fast_array(ctx, p, idx + 1)) {
+				JS_FreeValue(ctx, val);
+				return -1;
+			}
+		}
+		for (i = count; i < idx; i++)
+			p->u.array.u.values[i] = JS_ARRAY_HOLE;
+		p->u.array.hole_count += idx - count;
+		p->u.array.count = idx;
+	}
+	return add_fast_array_element(ctx, p, val, flags);
+}
+
 /* Allocate a new fast array. Its 'length' property is set to zero. It
    maximum size is 2^31-1 elements. For convenience, 'len' is a 64 bit
    integer. WARNING: the content of the array is not initialized. */
@@ -8805,8 +10299,10 @@ static JSValue js_allocate_fast_array(JSContext *ctx, int64_t len) {
 	arr = JS_NewArray(ctx);
 	if (JS_IsException(arr))
 		return arr;
+	/* the elements are initialized by the caller */
+	p = JS_VALUE_GET_OBJ(arr);
+	p->u.array.kind = JS_ARRAY_KIND_VALUE;
 	if (len > 0) {
-		p = JS_VALUE_GET_OBJ(arr);
 		if (expand_fast_array(ctx, p, len) < 0) {
 			JS_FreeValue(ctx, arr);
 			return JS_EXCEPTION;
@@ -8919,7 +10415,8 @@ retry:
 			if (p1->fast_array) {
 				if (__JS_AtomIsTaggedInt(prop)) {
 					uint32_t idx = __JS_AtomToUInt32(prop);
-					if (idx < p1->u.array.count) {
+					if (idx < p1->u.array.count &&
+					    !js_fast_array_is_hole(p1, idx)) {
 						if (unlikely(p == p1))
 							return
 									JS_SetPropertyValue(
@@ -9197,14 +10694,22 @@ static int JS_SetPropertyValue(JSContext *ctx, JSValueConst this_obj,
 		switch (p->class_id) {
 			case JS_CLASS_ARRAY:
 				if (unlikely(
-					idx >= (uint32_t)p->u.array.count)) {
+					idx >= (uint32_t)p->u.array.count ||
+					js_fast_array_is_hole(p, idx))) {
 					JSObject *p1;
 					JSShape *sh1;
+					uint32_t count;
 
-					/* fast path to add an element to the array */
-					if (idx != (uint32_t) p->u.array.count
-					    ||
-					    !p->fast_array || !p->extensible)
+					/* fast path to add an element to the
+					   array or to fill a hole */
+					if (!p->fast_array || !p->extensible)
+						goto slow_path;
+					count = p->u.array.count;
+					if (idx > count &&
+					    !js_fast_array_holes_ok(
+						    idx + 1,
+						    p->u.array.hole_count +
+						    idx - count))
 						goto slow_path;
 					/* check if prototype chain has a numeric property */
 					p1 = p->shape->proto;
@@ -9228,11 +10733,18 @@ static int JS_SetPropertyValue(JSContext *ctx, JSValueConst this_obj,
 						}
 						p1 = sh1->proto;
 					}
+					if (idx < count) {
+						p->u.array.u.values[idx] = val;
+						p->u.array.hole_count--;
+						return TRUE;
+					}
 					/* add element */
-					return add_fast_array_element(
-						ctx, p, val, flags);
+					return add_fast_array_element_at(
+						ctx, p, idx, val, flags);
 				}
-				set_value(ctx, &p->u.array.u.values[idx], val);
+				if (unlikely(js_fast_array_set(ctx, p, idx, val,
+							       FALSE)))
+					return -1;
 				break;
 			case JS_CLASS_ARGUMENTS:
 				if (unlikely(idx >= (uint32_t)p->u.array.count))
@@ -9384,25 +10896,36 @@ static int JS_CreateProperty(JSContext *ctx, JSObject *p,
 
 			if (p->fast_array) {
 				if (__JS_AtomIsTaggedInt(prop)) {
+					uint32_t count = p->u.array.count;
 					idx = __JS_AtomToUInt32(prop);
-					if (idx == p->u.array.count) {
-						if (!p->extensible)
-							goto not_extensible;
-						if (flags & (
-							    JS_PROP_HAS_GET |
-							    JS_PROP_HAS_SET))
-							goto convert_to_array;
-						prop_flags = get_prop_flags(
-							flags, 0);
-						if (prop_flags != JS_PROP_C_W_E)
-							goto convert_to_array;
-						return add_fast_array_element(
-							ctx, p,
-							JS_DupValue(ctx, val),
-							flags);
-					} else {
+					/* 'idx' is either a hole or after the
+					   last element */
+					if (idx > count &&
+					    !js_fast_array_holes_ok(
+						    idx + 1,
+						    p->u.array.hole_count +
+						    idx - count))
+						goto convert_to_array;
+					if (!p->extensible)
+						goto not_extensible;
+					if (flags & (
+						    JS_PROP_HAS_GET |
+						    JS_PROP_HAS_SET))
 						goto convert_to_array;
+					prop_flags = get_prop_flags(flags, 0);
+					if (prop_flags != JS_PROP_C_W_E)
+						goto convert_to_array;
+					if (idx < count) {
+						p->u.array.u.values[idx] =
+								JS_DupValue(
+									ctx,
+									val);
+						p->u.array.hole_count--;
+						return TRUE;
 					}
+					return add_fast_array_element_at(
+						ctx, p, idx,
+						JS_DupValue(ctx, val), flags);
 				} else if (
 					JS_AtomIsArrayIndex(ctx, &idx, prop)) {
 					/* convert the fast array to normal array */
@@ -9505,6 +11028,10 @@ static int JS_CreateProperty(JSContext *ctx, JSObject *p,
 			pr->u.value = JS_UNDEFINED;
 		}
 	}
+	if (unlikely(p->class_id == JS_CLASS_ARRAY && !p->fast_array)) {
+		if (js_array_check_fast(ctx, p))
+			return -1;
+	}
 	return TRUE;
 }
 
@@ -9556,6 +11083,7 @@ static int js_shape_prepare_update(JSContext *ctx, JSObject *p,
 	sh = p->shape;
 	if (sh->is_hashed) {
 		if (sh->header.ref_count != 1) {
+			/* the cache of the shared shape stays valid */
 			if (pprs)
 				idx = *pprs - get_shape_prop(sh);
 			/* clone the shape (the resulting one is no longer hashed) */
@@ -9569,7 +11097,10 @@ static int js_shape_prepare_update(JSContext *ctx, JSObject *p,
 		} else {
 			js_shape_hash_unlink(ctx->rt, sh);
 			sh->is_hashed = FALSE;
+			js_shape_reset_enum_cache(ctx->rt, sh);
 		}
+	} else {
+		js_shape_reset_enum_cache(ctx->rt, sh);
 	}
 	return 0;
 }
@@ -9873,7 +11404,8 @@ redo_prop_update:
 		if (p->class_id == JS_CLASS_ARRAY) {
 			if (__JS_AtomIsTaggedInt(prop)) {
 				idx = __JS_AtomToUInt32(prop);
-				if (idx < p->u.array.count) {
+				if (idx < p->u.array.count &&
+				    !js_fast_array_is_hole(p, idx)) {
 					prop_flags = get_prop_flags(
 						flags, JS_PROP_C_W_E);
 					if (prop_flags != JS_PROP_C_W_E)
@@ -9889,10 +11421,11 @@ redo_prop_update:
 							goto redo_prop_update;
 					}
 					if (flags & JS_PROP_HAS_VALUE) {
-						set_value(
-							ctx, &p->u.array.u.
-							values[idx],
-							JS_DupValue(ctx, val));
+						if (js_fast_array_set(
+							ctx, p, idx,
+							JS_DupValue(ctx, val),
+							FALSE))
+							return -1;
 					}
 					return TRUE;
 				}
@@ -10230,12 +11763,72 @@ static int JS_DefineGlobalFunction(JSContext *ctx, JSAtom prop,
 	return 0;
 }
 
+/* return the property of the global variable 'prop' if its cell is
+   valid or nullptr. */
+static force_inline JSProperty *find_global_var_cell(JSContext *ctx,
+						     JSAtom prop,
+						     JSShapeProperty **pprs) {
+	JSGlobalVarCell *cell;
+	JSObject *p;
+	JSShape *sh;
+	JSShapeProperty *prs;
+
+	cell = &ctx->global_var_cells[prop & (JS_GLOBAL_VAR_CELL_COUNT - 1)];
+	if (cell->atom != prop)
+		return nullptr;
+	p = JS_VALUE_GET_OBJ(ctx->global_var_obj);
+	if (!cell->is_lexical) {
+		if (unlikely(p->shape->prop_count != cell->lexical_count))
+			return nullptr;
+		p = JS_VALUE_GET_OBJ(ctx->global_obj);
+	}
+	sh = p->shape;
+	if (unlikely(cell->prop_idx >= sh->prop_count))
+		return nullptr;
+	prs = get_shape_prop(sh) + cell->prop_idx;
+	if (unlikely(prs->atom != prop ||
+		     (prs->flags & JS_PROP_TMASK) != JS_PROP_NORMAL))
+		return nullptr;
+	*pprs = prs;
+	return &p->prop[cell->prop_idx];
+}
+
+/* remember that the global variable 'prop' is the property 'prs' of
+   global_var_obj (is_lexical = TRUE) or of the global object */
+static void set_global_var_cell(JSContext *ctx, JSAtom prop,
+				JSShapeProperty *prs, BOOL is_lexical) {
+	JSGlobalVarCell *cell;
+	JSObject *p;
+
+	if ((prs->flags & JS_PROP_TMASK) != JS_PROP_NORMAL)
+		return;
+	if (is_lexical)
+		p = JS_VALUE_GET_OBJ(ctx->global_var_obj);
+	else
+		p = JS_VALUE_GET_OBJ(ctx->global_obj);
+	if (p->is_exotic)
+		return;
+	cell = &ctx->global_var_cells[prop & (JS_GLOBAL_VAR_CELL_COUNT - 1)];
+	if (cell->atom != prop) {
+		JS_FreeAtom(ctx, cell->atom);
+		cell->atom = JS_DupAtom(ctx, prop);
+	}
+	cell->prop_idx = prs - get_shape_prop(p->shape);
+	cell->is_lexical = is_lexical;
+	cell->lexical_count =
+			JS_VALUE_GET_OBJ(ctx->global_var_obj)->shape->prop_count;
+}
+
 static JSValue JS_GetGlobalVar(JSContext *ctx, JSAtom prop,
 			       BOOL throw_ref_error) {
 	JSObject *p;
 	JSShapeProperty *prs;
 	JSProperty *pr;
 
+	pr = find_global_var_cell(ctx, prop, &prs);
+	if (likely(pr && !JS_IsUninitialized(pr->u.value)))
+		return JS_DupValue(ctx, pr->u.value);
+
 	/* no exotic behavior is possible in global_var_obj */
 	p = JS_VALUE_GET_OBJ(ctx->global_var_obj);
 	prs = find_own_property(&pr, p, prop);
@@ -10244,6 +11837,14 @@ static JSValue JS_GetGlobalVar(JSContext *ctx, JSAtom prop,
 		if (unlikely(JS_IsUninitialized(pr->u.value)))
 			return JS_ThrowReferenceErrorUninitialized(
 				ctx, prs->atom);
+		set_global_var_cell(ctx, prop, prs, TRUE);
+		return JS_DupValue(ctx, pr->u.value);
+	}
+	p = JS_VALUE_GET_OBJ(ctx->global_obj);
+	prs = find_own_property(&pr, p, prop);
+	if (prs && (prs->flags & JS_PROP_TMASK) == JS_PROP_NORMAL &&
+	    !p->is_exotic) {
+		set_global_var_cell(ctx, prop, prs, FALSE);
 		return JS_DupValue(ctx, pr->u.value);
 	}
 	return JS_GetPropertyInternal(ctx, ctx->global_obj, prop,
@@ -10291,11 +11892,14 @@ static int JS_GetGlobalVarRef(JSContext *ctx, JSAtom prop, JSValue *sp) {
 static int JS_CheckGlobalVar(JSContext *ctx, JSAtom prop) {
 	JSObject *p;
 	JSShapeProperty *prs;
+	JSProperty *pr;
 	int ret;
 
+	if (find_global_var_cell(ctx, prop, &prs))
+		return TRUE;
 	/* no exotic behavior is possible in global_var_obj */
 	p = JS_VALUE_GET_OBJ(ctx->global_var_obj);
-	prs = find_own_property1(p, prop);
+	prs = find_own_property(&pr, p, prop);
 	if (prs) {
 		ret = TRUE;
 	} else {
@@ -10317,6 +11921,13 @@ static int JS_SetGlobalVar(JSContext *ctx, JSAtom prop, JSValue val,
 	JSProperty *pr;
 	int flags;
 
+	pr = find_global_var_cell(ctx, prop, &prs);
+	if (likely(pr && (prs->flags & JS_PROP_WRITABLE) && flag != 1 &&
+		   !JS_IsUninitialized(pr->u.value))) {
+		set_value(ctx, &pr->u.value, val);
+		return 0;
+	}
+
 	/* no exotic behavior is possible in global_var_obj */
 	p = JS_VALUE_GET_OBJ(ctx->global_var_obj);
 	prs = find_own_property(&pr, p, prop);
@@ -10335,6 +11946,15 @@ static int JS_SetGlobalVar(JSContext *ctx, JSAtom prop, JSValue val,
 					ctx, JS_PROP_THROW, prop);
 			}
 		}
+		set_global_var_cell(ctx, prop, prs, TRUE);
+		set_value(ctx, &pr->u.value, val);
+		return 0;
+	}
+	p = JS_VALUE_GET_OBJ(ctx->global_obj);
+	prs = find_own_property(&pr, p, prop);
+	if (prs && (prs->flags & JS_PROP_WRITABLE) && !p->is_exotic &&
+	    (prs->flags & JS_PROP_TMASK) == JS_PROP_NORMAL) {
+		set_global_var_cell(ctx, prop, prs, FALSE);
 		set_value(ctx, &pr->u.value, val);
 		return 0;
 	}
@@ -10602,6 +12222,8 @@ static int JS_ToBoolFree(JSContext *ctx, JSValue val) {
 			JS_FreeValue(ctx, val);
 			return ret;
 		}
+		case JS_TAG_SHORT_STRING:
+			return TRUE;
 		case JS_TAG_BIG_INT:
 #ifdef CONFIG_BIGNUM
 		case JS_TAG_BIG_FLOAT:
@@ -11136,7 +12758,8 @@ redo:
 			if (JS_IsException(val))
 				return JS_EXCEPTION;
 			goto redo;
-		case JS_TAG_STRING: {
+		case JS_TAG_STRING:
+		case JS_TAG_SHORT_STRING: {
 			const char *str;
 			const char *p;
 			size_t len;
@@ -11521,6 +13144,43 @@ int JS_ToInt64Ext(JSContext *ctx, int64_t *pres, JSValueConst val) {
 		return JS_ToInt64(ctx, pres, val);
 }
 
+/* ToInt32() of a number */
+static inline int32_t js_double_to_int32(double d) {
+	JSFloat64Union u;
+	int32_t ret;
+	int e;
+	u.d = d;
+	/* we avoid doing fmod(x, 2^32) */
+	e = (u.u64 >> 52) & 0x7ff;
+	if (likely(e <= (1023 + 30))) {
+		/* fast case */
+		ret = (int32_t) d;
+	} else if (e <= (1023 + 30 + 53)) {
+		uint64_t v;
+		/* remainder modulo 2^32 */
+		v = (u.u64 & (((uint64_t) 1 << 52) - 1)) | (
+			    (uint64_t) 1 << 52);
+		v = v << ((e - 1023) - 52 + 32);
+		ret = v >> 32;
+		/* take the sign into account */
+		if (u.u64 >> 63)
+			ret = -ret;
+	} else {
+		ret = 0; /* also handles NaN and +inf */
+	}
+	return ret;
+}
+
+/* ToUint8Clamp() of a number */
+static inline int js_double_to_uint8_clamp(double d) {
+	if (isnan(d) || d < 0)
+		return 0;
+	else if (d > 255)
+		return 255;
+	else
+		return lrint(d);
+}
+
 /* return (<0, 0) in case of exception */
 static int JS_ToInt32Free(JSContext *ctx, int32_t *pres, JSValue val) {
 	uint32_t tag;
@@ -11535,32 +13195,9 @@ redo:
 		case JS_TAG_UNDEFINED:
 			ret = JS_VALUE_GET_INT(val);
 			break;
-		case JS_TAG_FLOAT64: {
-			JSFloat64Union u;
-			double d;
-			int e;
-			d = JS_VALUE_GET_FLOAT64(val);
-			u.d = d;
-			/* we avoid doing fmod(x, 2^32) */
-			e = (u.u64 >> 52) & 0x7ff;
-			if (likely(e <= (1023 + 30))) {
-				/* fast case */
-				ret = (int32_t) d;
-			} else if (e <= (1023 + 30 + 53)) {
-				uint64_t v;
-				/* remainder modulo 2^32 */
-				v = (u.u64 & (((uint64_t) 1 << 52) - 1)) | (
-					    (uint64_t) 1 << 52);
-				v = v << ((e - 1023) - 52 + 32);
-				ret = v >> 32;
-				/* take the sign into account */
-				if (u.u64 >> 63)
-					ret = -ret;
-			} else {
-				ret = 0; /* also handles NaN and +inf */
-			}
-		}
-		break;
+		case JS_TAG_FLOAT64:
+			ret = js_double_to_int32(JS_VALUE_GET_FLOAT64(val));
+			break;
 #ifdef CONFIG_BIGNUM
 		case JS_TAG_BIG_FLOAT: {
 			JSBigFloat *p = JS_VALUE_GET_PTR(val);
@@ -11606,20 +13243,9 @@ redo:
 #endif
 			res = max_int(0, min_int(255, res));
 			break;
-		case JS_TAG_FLOAT64: {
-			double d = JS_VALUE_GET_FLOAT64(val);
-			if (isnan(d)) {
-				res = 0;
-			} else {
-				if (d < 0)
-					res = 0;
-				else if (d > 255)
-					res = 255;
-				else
-					res = lrint(d);
-			}
-		}
-		break;
+		case JS_TAG_FLOAT64:
+			res = js_double_to_uint8_clamp(JS_VALUE_GET_FLOAT64(val));
+			break;
 #ifdef CONFIG_BIGNUM
 		case JS_TAG_BIG_FLOAT: {
 			JSBigFloat *p = JS_VALUE_GET_PTR(val);
@@ -12285,6 +13911,8 @@ JSValue JS_ToStringInternal(JSContext *ctx, JSValueConst val,
 	switch (tag) {
 		case JS_TAG_STRING:
 			return JS_DupValue(ctx, val);
+		case JS_TAG_SHORT_STRING:
+			return js_short_string_to_string(ctx, val);
 		case JS_TAG_INT:
 			snprintf(buf, sizeof(buf), "%d", JS_VALUE_GET_INT(val));
 			str = buf;
@@ -12472,8 +14100,18 @@ static __maybe_unused void JS_DumpObject(JSRuntime *rt, JSObject *p) {
 			switch (p->class_id) {
 				case JS_CLASS_ARRAY:
 				case JS_CLASS_ARGUMENTS:
-					JS_DumpValueShort(
-						rt, p->u.array.u.values[i]);
+					if (p->u.array.kind ==
+					    JS_ARRAY_KIND_INT32)
+						printf("%d", p->u.array.u.
+						       int32_ptr[i]);
+					else if (p->u.array.kind ==
+						 JS_ARRAY_KIND_FLOAT64)
+						printf("%.14g", p->u.array.u.
+						       double_ptr[i]);
+					else
+						JS_DumpValueShort(
+							rt,
+							p->u.array.u.values[i]);
 					break;
 				case JS_CLASS_UINT8C_ARRAY:
 				case JS_CLASS_INT8_ARRAY:
@@ -12654,9 +14292,11 @@ static __maybe_unused void JS_DumpValueShort(JSRuntime *rt,
 		}
 		break;
 #endif
-		case JS_TAG_STRING: {
+		case JS_TAG_STRING:
+		case JS_TAG_SHORT_STRING: {
+			JSShortStringBuf sbuf;
 			JSString *p;
-			p = JS_VALUE_GET_STRING(val);
+			p = js_get_string(&sbuf, val);
 			JS_DumpString(rt, p);
 		}
 		break;
@@ -12863,6 +14503,7 @@ redo:
 			break;
 #endif
 		case JS_TAG_STRING:
+		case JS_TAG_SHORT_STRING:
 			val = JS_StringToBigIntErr(ctx, val);
 			if (JS_IsException(val))
 				return nullptr;
@@ -14280,10 +15921,10 @@ static no_inline __exception int js_add_slow(JSContext *ctx, JSValue *sp) {
 		/* try to call an overloaded operator */
 		if ((tag1 == JS_TAG_OBJECT &&
 		     (tag2 != JS_TAG_NULL && tag2 != JS_TAG_UNDEFINED &&
-		      tag2 != JS_TAG_STRING)) ||
+		      !tag_is_string(tag2))) ||
 		    (tag2 == JS_TAG_OBJECT &&
 		     (tag1 != JS_TAG_NULL && tag1 != JS_TAG_UNDEFINED &&
-		      tag1 != JS_TAG_STRING))) {
+		      !tag_is_string(tag1)))) {
 			JSValue res;
 			int ret = js_call_binary_op_fallback(
 				ctx, &res, op1, op2, OP_add,
@@ -14315,7 +15956,7 @@ static no_inline __exception int js_add_slow(JSContext *ctx, JSValue *sp) {
 		tag2 = JS_VALUE_GET_NORM_TAG(op2);
 	}
 
-	if (tag1 == JS_TAG_STRING || tag2 == JS_TAG_STRING) {
+	if (tag_is_string(tag1) || tag_is_string(tag2)) {
 		sp[-2] = JS_ConcatString(ctx, op1, op2);
 		if (JS_IsException(sp[-2]))
 			goto exception;
@@ -14616,10 +16257,11 @@ static no_inline int js_relational_slow(JSContext *ctx, JSValue *sp,
 	tag1 = JS_VALUE_GET_NORM_TAG(op1);
 	tag2 = JS_VALUE_GET_NORM_TAG(op2);
 
-	if (tag1 == JS_TAG_STRING && tag2 == JS_TAG_STRING) {
+	if (tag_is_string(tag1) && tag_is_string(tag2)) {
+		JSShortStringBuf sbuf1, sbuf2;
 		JSString *p1, *p2;
-		p1 = JS_VALUE_GET_STRING(op1);
-		p2 = JS_VALUE_GET_STRING(op2);
+		p1 = js_get_string(&sbuf1, op1);
+		p2 = js_get_string(&sbuf2, op2);
 		res = js_string_compare(ctx, p1, p2);
 		switch (op) {
 			case OP_lt:
@@ -14643,15 +16285,15 @@ static no_inline int js_relational_slow(JSContext *ctx, JSValue *sp,
 		/* fast path for float64/int */
 		goto float64_compare;
 	} else {
-		if (((tag1 == JS_TAG_BIG_INT && tag2 == JS_TAG_STRING) ||
-		     (tag2 == JS_TAG_BIG_INT && tag1 == JS_TAG_STRING)) &&
+		if (((tag1 == JS_TAG_BIG_INT && tag_is_string(tag2)) ||
+		     (tag2 == JS_TAG_BIG_INT && tag_is_string(tag1))) &&
 		    !is_math_mode(ctx)) {
-			if (tag1 == JS_TAG_STRING) {
+			if (tag_is_string(tag1)) {
 				op1 = JS_StringToBigInt(ctx, op1);
 				if (JS_VALUE_GET_TAG(op1) != JS_TAG_BIG_INT)
 					goto invalid_bigint_string;
 			}
-			if (tag2 == JS_TAG_STRING) {
+			if (tag_is_string(tag2)) {
 				op2 = JS_StringToBigInt(ctx, op2);
 				if (JS_VALUE_GET_TAG(op2) != JS_TAG_BIG_INT) {
 				invalid_bigint_string:
@@ -14805,7 +16447,8 @@ redo:
 				if (res < 0)
 					goto exception;
 			}
-	} else if (tag1 == tag2) {
+	} else if (tag1 == tag2 ||
+		   (tag_is_string(tag1) && tag_is_string(tag2))) {
 #ifdef CONFIG_BIGNUM
 		if (tag1 == JS_TAG_OBJECT) {
 			/* try the fallback operator */
@@ -14830,16 +16473,16 @@ redo:
 	} else if ((tag1 == JS_TAG_NULL && tag2 == JS_TAG_UNDEFINED) ||
 		   (tag2 == JS_TAG_NULL && tag1 == JS_TAG_UNDEFINED)) {
 		res = TRUE;
-	} else if ((tag1 == JS_TAG_STRING && tag_is_number(tag2)) ||
-		   (tag2 == JS_TAG_STRING && tag_is_number(tag1))) {
+	} else if ((tag_is_string(tag1) && tag_is_number(tag2)) ||
+		   (tag_is_string(tag2) && tag_is_number(tag1))) {
 		if ((tag1 == JS_TAG_BIG_INT || tag2 == JS_TAG_BIG_INT) &&
 		    !is_math_mode(ctx)) {
-			if (tag1 == JS_TAG_STRING) {
+			if (tag_is_string(tag1)) {
 				op1 = JS_StringToBigInt(ctx, op1);
 				if (JS_VALUE_GET_TAG(op1) != JS_TAG_BIG_INT)
 					goto invalid_bigint_string;
 			}
-			if (tag2 == JS_TAG_STRING) {
+			if (tag_is_string(tag2)) {
 				op2 = JS_StringToBigInt(ctx, op2);
 				if (JS_VALUE_GET_TAG(op2) != JS_TAG_BIG_INT) {
 				invalid_bigint_string:
@@ -14869,10 +16512,10 @@ redo:
 		op2 = JS_NewInt32(ctx, JS_VALUE_GET_INT(op2));
 		goto redo;
 	} else if ((tag1 == JS_TAG_OBJECT &&
-		    (tag_is_number(tag2) || tag2 == JS_TAG_STRING || tag2 ==
+		    (tag_is_number(tag2) || tag_is_string(tag2) || tag2 ==
 		     JS_TAG_SYMBOL)) ||
 		   (tag2 == JS_TAG_OBJECT &&
-		    (tag_is_number(tag1) || tag1 == JS_TAG_STRING || tag1 ==
+		    (tag_is_number(tag1) || tag_is_string(tag1) || tag1 ==
 		     JS_TAG_SYMBOL))) {
 #ifdef CONFIG_BIGNUM
 		/* try the fallback operator */
@@ -15042,14 +16685,21 @@ static BOOL js_strict_eq2(JSContext *ctx, JSValue op1, JSValue op2,
 		case JS_TAG_UNDEFINED:
 			res = (tag1 == tag2);
 			break;
-		case JS_TAG_STRING: {
+		case JS_TAG_STRING:
+		case JS_TAG_SHORT_STRING: {
+			JSShortStringBuf sbuf1, sbuf2;
 			JSString *p1, *p2;
-			if (tag1 != tag2) {
+			if (!tag_is_string(tag2)) {
 				res = FALSE;
+			} else if (tag1 == JS_TAG_SHORT_STRING &&
+				   tag2 == JS_TAG_SHORT_STRING) {
+				res = (js_short_string_bits(op1) ==
+				       js_short_string_bits(op2));
+				goto done_no_free;
 			} else {
-				p1 = JS_VALUE_GET_STRING(op1);
-				p2 = JS_VALUE_GET_STRING(op2);
-				res = (js_string_compare(ctx, p1, p2) == 0);
+				p1 = js_get_string(&sbuf1, op1);
+				p2 = js_get_string(&sbuf2, op2);
+				res = js_string_eq(p1, p2);
 			}
 		}
 		break;
@@ -15336,6 +16986,7 @@ static __exception int js_operator_typeof(JSContext *ctx, JSValueConst op1) {
 			atom = JS_ATOM_boolean;
 			break;
 		case JS_TAG_STRING:
+		case JS_TAG_SHORT_STRING:
 			atom = JS_ATOM_string;
 			break;
 		case JS_TAG_OBJECT: {
@@ -15595,6 +17246,7 @@ static JSValue build_for_in_iterator(JSContext *ctx, JSValue obj) {
 	it->obj = obj;
 	it->idx = 0;
 	it->tab_atom = nullptr;
+	it->enum_cache = nullptr;
 	it->atom_count = 0;
 	it->in_prototype_chain = FALSE;
 	p1 = JS_VALUE_GET_OBJ(enum_obj);
@@ -15617,6 +17269,16 @@ static JSValue build_for_in_iterator(JSContext *ctx, JSValue obj) {
 		/* for fast arrays, we only store the number of elements */
 		it->is_array = TRUE;
 		it->atom_count = p->u.array.count;
+	} else if (!p->is_exotic) {
+		/* share the key list of the shape */
+		JSShapeEnumCache *ec = js_get_enum_cache(ctx, p);
+		if (!ec) {
+			JS_FreeValue(ctx, enum_obj);
+			return JS_EXCEPTION;
+		}
+		ec->ref_count++;
+		it->enum_cache = ec;
+		it->atom_count = ec->count;
 	} else {
 	normal_case:
 		if (JS_GetOwnPropertyNamesInternal(
@@ -15661,15 +17323,24 @@ static __exception int js_for_in_prepare_prototype_chain_enum(JSContext *ctx,
 			break;
 		if (JS_IsException(obj1))
 			goto fail;
-		if (JS_GetOwnPropertyNamesInternal(
-			ctx, &tab_atom, &tab_atom_count,
-			JS_VALUE_GET_OBJ(obj1),
-			JS_GPN_STRING_MASK |
-			JS_GPN_ENUM_ONLY)) {
-			JS_FreeValue(ctx, obj1);
-			goto fail;
+		p = JS_VALUE_GET_OBJ(obj1);
+		if (!p->is_exotic) {
+			JSShapeEnumCache *ec = js_get_enum_cache(ctx, p);
+			if (!ec) {
+				JS_FreeValue(ctx, obj1);
+				goto fail;
+			}
+			tab_atom_count = ec->count;
+		} else {
+			if (JS_GetOwnPropertyNamesInternal(
+				ctx, &tab_atom, &tab_atom_count, p,
+				JS_GPN_STRING_MASK |
+				JS_GPN_ENUM_ONLY)) {
+				JS_FreeValue(ctx, obj1);
+				goto fail;
+			}
+			js_free_prop_enum(ctx, tab_atom, tab_atom_count);
 		}
-		js_free_prop_enum(ctx, tab_atom, tab_atom_count);
 		if (tab_atom_count != 0) {
 			JS_FreeValue(ctx, obj1);
 			goto slow_path;
@@ -15685,7 +17356,7 @@ static __exception int js_for_in_prepare_prototype_chain_enum(JSContext *ctx,
 
 slow_path:
 	/* add the visited properties, even if they are not enumerable */
-	if (it->is_array) {
+	if (it->is_array || it->enum_cache) {
 		if (JS_GetOwnPropertyNamesInternal(
 			ctx, &tab_atom, &tab_atom_count,
 			JS_VALUE_GET_OBJ(it->obj),
@@ -15693,6 +17364,10 @@ slow_path:
 			JS_GPN_SET_ENUM)) {
 			goto fail;
 		}
+		if (it->enum_cache) {
+			js_free_enum_cache(ctx->rt, it->enum_cache);
+			it->enum_cache = nullptr;
+		}
 		it->is_array = FALSE;
 		it->tab_atom = tab_atom;
 		it->atom_count = tab_atom_count;
@@ -15759,7 +17434,13 @@ static __exception int js_for_in_next(JSContext *ctx, JSValue *sp) {
 				JS_GPN_SET_ENUM)) {
 				return -1;
 			}
-			js_free_prop_enum(ctx, it->tab_atom, it->atom_count);
+			if (it->enum_cache) {
+				js_free_enum_cache(ctx->rt, it->enum_cache);
+				it->enum_cache = nullptr;
+			} else {
+				js_free_prop_enum(ctx, it->tab_atom,
+						  it->atom_count);
+			}
 			it->tab_atom = tab_atom;
 			it->atom_count = tab_atom_count;
 			it->idx = 0;
@@ -15767,6 +17448,12 @@ static __exception int js_for_in_next(JSContext *ctx, JSValue *sp) {
 			if (it->is_array) {
 				prop = __JS_AtomFromUInt32(it->idx);
 				it->idx++;
+			} else if (it->enum_cache) {
+				prop = it->enum_cache->atoms[it->idx++];
+				/* the object still has the keys of the cache */
+				if (JS_VALUE_GET_OBJ(it->obj)->shape->enum_cache ==
+				    it->enum_cache)
+					break;
 			} else {
 				BOOL is_enumerable;
 				prop = it->tab_atom[it->idx].atom;
@@ -16096,13 +17783,31 @@ static BOOL js_is_fast_array(JSContext *ctx, JSValueConst obj) {
 	return FALSE;
 }
 
-/* Access an Array's internal JSValue array if available */
+/* Return the Array object if it is a fast array without holes. Its
+   elements can be read with js_fast_array_get(). */
+static JSObject *js_get_fast_array_obj(JSValueConst obj) {
+	if (JS_VALUE_GET_TAG(obj) == JS_TAG_OBJECT) {
+		JSObject *p = JS_VALUE_GET_OBJ(obj);
+		if (p->class_id == JS_CLASS_ARRAY && p->fast_array &&
+		    p->u.array.hole_count == 0)
+			return p;
+	}
+	return nullptr;
+}
+
+/* Access an Array's internal JSValue array if available. Arrays with
+   holes are excluded because their missing elements must be looked up
+   in the prototype chain. Arrays with unboxed elements are excluded
+   too: use js_get_fast_array_obj() and js_fast_array_get() to read
+   them without changing their kind. */
 static BOOL js_get_fast_array(JSContext *ctx, JSValueConst obj,
 			      JSValue **arrpp, uint32_t *countp) {
 	/* Try and handle fast arrays explicitly */
 	if (JS_VALUE_GET_TAG(obj) == JS_TAG_OBJECT) {
 		JSObject *p = JS_VALUE_GET_OBJ(obj);
-		if (p->class_id == JS_CLASS_ARRAY && p->fast_array) {
+		if (p->class_id == JS_CLASS_ARRAY && p->fast_array &&
+		    p->u.array.hole_count == 0 &&
+		    p->u.array.kind == JS_ARRAY_KIND_VALUE) {
 			*countp = p->u.array.count;
 			*arrpp = p->u.array.u.values;
 			return TRUE;
@@ -16114,7 +17819,7 @@ static BOOL js_get_fast_array(JSContext *ctx, JSValueConst obj,
 static __exception int js_append_enumerate(JSContext *ctx, JSValue *sp) {
 	JSValue iterator, enumobj, method, value;
 	int is_array_iterator;
-	JSValue *arrp;
+	JSObject *p;
 	uint32_t i, count32, pos;
 
 	if (JS_VALUE_GET_TAG(sp[-2]) != JS_TAG_INT) {
@@ -16151,8 +17856,9 @@ static __exception int js_append_enumerate(JSContext *ctx, JSValue *sp) {
 	    && JS_IsCFunction(ctx, method,
 			      (JSCFunction *) js_array_iterator_next,
 			      0)
-	    && js_get_fast_array(ctx, sp[-1], &arrp, &count32)) {
+	    && (p = js_get_fast_array_obj(sp[-1])) != nullptr) {
 		uint32_t len;
+		count32 = p->u.array.count;
 		if (js_get_length32(ctx, &len, sp[-1]))
 			goto exception;
 		/* if len > count32, the elements >= count32 might be read in
@@ -16162,8 +17868,8 @@ static __exception int js_append_enumerate(JSContext *ctx, JSValue *sp) {
 		/* Handle fast arrays explicitly */
 		for (i = 0; i < count32; i++) {
 			if (JS_DefinePropertyValueUint32(ctx, sp[-3], pos++,
-							 JS_DupValue(
-								 ctx, arrp[i]),
+							 js_fast_array_get(
+								 ctx, p, i),
 							 JS_PROP_C_W_E) < 0)
 				goto exception;
 		}
@@ -16198,6 +17904,72 @@ exception:
 	return -1;
 }
 
+/* return TRUE if iterating 'obj' with the spread syntax is equivalent
+   to reading its array elements: fast arrays and arguments objects
+   using the default array iterator. No side effect is possible. */
+static BOOL js_is_fast_spread(JSContext *ctx, JSValueConst obj) {
+	JSObject *p, *p1;
+	JSShapeProperty *prs;
+	JSProperty *pr;
+
+	if (JS_VALUE_GET_TAG(obj) != JS_TAG_OBJECT)
+		return FALSE;
+	p = JS_VALUE_GET_OBJ(obj);
+	if ((p->class_id != JS_CLASS_ARRAY &&
+	     p->class_id != JS_CLASS_ARGUMENTS) || !p->fast_array ||
+	    p->u.array.hole_count != 0)
+		return FALSE;
+	prs = find_own_property(&pr, p, JS_ATOM_Symbol_iterator);
+	if (!prs) {
+		p1 = JS_VALUE_GET_OBJ(ctx->class_proto[JS_CLASS_ARRAY]);
+		if (p->shape->proto != p1)
+			return FALSE;
+		prs = find_own_property(&pr, p1, JS_ATOM_Symbol_iterator);
+		if (!prs)
+			return FALSE;
+	}
+	if ((prs->flags & JS_PROP_TMASK) != JS_PROP_NORMAL ||
+	    !js_same_value(ctx, pr->u.value, ctx->array_proto_values))
+		return FALSE;
+	p1 = JS_VALUE_GET_OBJ(ctx->class_proto[JS_CLASS_ARRAY_ITERATOR]);
+	prs = find_own_property(&pr, p1, JS_ATOM_next);
+	if (!prs || (prs->flags & JS_PROP_TMASK) != JS_PROP_NORMAL)
+		return FALSE;
+	return JS_IsCFunction(ctx, pr->u.value,
+			      (JSCFunction *) js_array_iterator_next, 0);
+}
+
+/* f(...obj): call 'func_obj' with the values produced by iterating
+   'obj'. The elements of fast arrays are read directly without
+   building an intermediate array. */
+static JSValue js_apply_spread(JSContext *ctx, JSValueConst func_obj,
+			       JSValueConst this_obj, JSValueConst obj,
+			       BOOL is_constructor) {
+	JSValue tab[3], ret;
+
+	if (js_is_fast_spread(ctx, obj)) {
+		if (check_function(ctx, func_obj))
+			return JS_EXCEPTION;
+		return js_apply_array(ctx, func_obj, this_obj, obj,
+				      is_constructor);
+	}
+	/* array pos obj, as for OP_append */
+	tab[0] = JS_NewArray(ctx);
+	if (JS_IsException(tab[0]))
+		return JS_EXCEPTION;
+	tab[1] = JS_NewInt32(ctx, 0);
+	tab[2] = (JSValue) obj;
+	if (js_append_enumerate(ctx, tab + 3) ||
+	    check_function(ctx, func_obj)) {
+		ret = JS_EXCEPTION;
+	} else {
+		ret = js_apply_array(ctx, func_obj, this_obj, tab[0],
+				     is_constructor);
+	}
+	JS_FreeValue(ctx, tab[0]);
+	return ret;
+}
+
 static __exception int JS_CopyDataProperties(JSContext *ctx,
 					     JSValueConst target,
 					     JSValueConst source,
@@ -16788,11 +18560,35 @@ typedef enum {
 	OP_SPECIAL_OBJECT_IMPORT_META,
 } OPSpecialObjectEnum;
 
+/* argument of OP_apply */
+#define OP_APPLY_CONSTRUCTOR   (1 << 0)
+#define OP_APPLY_SPREAD        (1 << 1) /* f(...obj): obj is iterated */
+
 #define FUNC_RET_AWAIT         0
 #define FUNC_RET_YIELD         1
 #define FUNC_RET_YIELD_STAR    2
 #define FUNC_RET_INITIAL_YIELD 3
 
+/* Return TRUE if the call to 'func_obj' in tail position can reuse
+   the current frame. Proper tail calls are only done from strict mode
+   code and never inside an active try block (the catch offsets are on
+   the stack below 'sp'). */
+static BOOL js_can_tail_call(JSFunctionBytecode *b, JSValueConst func_obj,
+			     const JSValue *stack_buf, const JSValue *sp) {
+	const JSValue *pval;
+
+	if (!(b->js_mode & JS_MODE_STRICT) || b->func_kind != JS_FUNC_NORMAL)
+		return FALSE;
+	if (JS_VALUE_GET_TAG(func_obj) != JS_TAG_OBJECT ||
+	    JS_VALUE_GET_OBJ(func_obj)->class_id != JS_CLASS_BYTECODE_FUNCTION)
+		return FALSE;
+	for (pval = stack_buf; pval < sp; pval++) {
+		if (JS_VALUE_GET_TAG(*pval) == JS_TAG_CATCH_OFFSET)
+			return FALSE;
+	}
+	return TRUE;
+}
+
 /* argv[] is modified if (flags & JS_CALL_FLAG_COPY_ARGV) = 0. */
 static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
 			       JSValueConst this_obj, JSValueConst new_target,
@@ -16806,7 +18602,8 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
 	int opcode, arg_allocated_size, i;
 	JSValue *local_buf, *stack_buf, *var_buf, *arg_buf, *sp, ret_val, *pval;
 	JSVarRef **var_refs;
-	size_t alloca_size;
+	size_t alloca_size, local_buf_size = 0;
+	JSValue *tail_buf = nullptr, *tail_base, tail_this;
 
 #if !DIRECT_DISPATCH
 #define SWITCH(pc)      switch (opcode = *pc++)
@@ -16891,6 +18688,7 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
 	var_refs = p->u.func.var_refs;
 
 	local_buf = alloca(alloca_size);
+	local_buf_size = alloca_size / sizeof(JSValue);
 	if (unlikely(arg_allocated_size)) {
 		int n = min_int(argc, b->arg_count);
 		arg_buf = local_buf;
@@ -17021,6 +18819,14 @@ restart:
 			if (unlikely(JS_IsException(sp[-1])))
 				goto exception;
 			BREAK;
+		CASE(OP_object_literal): {
+				uint32_t idx = get_u32(pc);
+				pc += 4;
+				*sp++ = js_new_object_literal(ctx, b->cpool[idx]);
+				if (unlikely(JS_IsException(sp[-1])))
+					goto exception;
+			}
+			BREAK;
 		CASE(OP_special_object): {
 				int arg = *pc++;
 				switch (arg) {
@@ -17265,6 +19071,13 @@ restart:
 			has_call_argc:
 				call_argv = sp - call_argc;
 				sf->cur_pc = pc;
+				if (opcode == OP_tail_call &&
+				    js_can_tail_call(b, call_argv[-1], stack_buf,
+						     call_argv - 1)) {
+					tail_base = call_argv - 1;
+					tail_this = JS_UNDEFINED;
+					goto tail_call;
+				}
 				ret_val = JS_CallInternal(
 					ctx, call_argv[-1], JS_UNDEFINED,
 					JS_UNDEFINED, call_argc, call_argv,
@@ -17302,6 +19115,13 @@ restart:
 				pc += 2;
 				call_argv = sp - call_argc;
 				sf->cur_pc = pc;
+				if (opcode == OP_tail_call_method &&
+				    js_can_tail_call(b, call_argv[-1], stack_buf,
+						     call_argv - 2)) {
+					tail_base = call_argv - 2;
+					tail_this = call_argv[-2];
+					goto tail_call;
+				}
 				ret_val = JS_CallInternal(
 					ctx, call_argv[-1], call_argv[-2],
 					JS_UNDEFINED, call_argc, call_argv,
@@ -17316,6 +19136,70 @@ restart:
 				*sp++ = ret_val;
 			}
 			BREAK;
+		tail_call: {
+				/* proper tail call: the current frame is released and
+				   reused by the callee. 'tail_base' points to the first
+				   stack slot of the call (this, func, args). The frame
+				   is laid out as: func, this, args, vars, stack. */
+				JSValue tail_func = call_argv[-1];
+				JSObject *p1 = JS_VALUE_GET_OBJ(tail_func);
+				JSFunctionBytecode *b1 = p1->u.func.function_bytecode;
+				int n_args = max_int(call_argc, b1->arg_count);
+				size_t n_slots = 2 + n_args + b1->var_count +
+						 b1->stack_size;
+				JSValue *new_buf = local_buf;
+
+				if (js_poll_interrupts(caller_ctx))
+					goto exception;
+				if (n_slots > local_buf_size) {
+					new_buf = js_malloc(ctx, sizeof(JSValue) *
+							    n_slots);
+					if (unlikely(!new_buf))
+						goto exception;
+				}
+				if (unlikely(!list_empty(&sf->var_ref_list))) {
+					close_var_refs(rt, sf);
+					init_list_head(&sf->var_ref_list);
+				}
+				/* the realm may be freed with the previous function */
+				for (pval = local_buf; pval < tail_base; pval++)
+					JS_FreeValueRT(rt, *pval);
+				memmove(new_buf + 2, call_argv,
+					sizeof(JSValue) * call_argc);
+				new_buf[0] = tail_func;
+				new_buf[1] = tail_this;
+				if (new_buf != local_buf) {
+					if (local_buf == tail_buf)
+						js_free_rt(rt, tail_buf);
+					tail_buf = local_buf = new_buf;
+					local_buf_size = n_slots;
+				}
+
+				p = p1;
+				b = b1;
+				ctx = b->realm;
+				func_obj = local_buf[0];
+				this_obj = local_buf[1];
+				new_target = JS_UNDEFINED;
+				arg_buf = local_buf + 2;
+				for (i = call_argc; i < n_args; i++)
+					arg_buf[i] = JS_UNDEFINED;
+				argc = call_argc;
+				argv = arg_buf;
+				var_buf = arg_buf + n_args;
+				for (i = 0; i < b->var_count; i++)
+					var_buf[i] = JS_UNDEFINED;
+				stack_buf = var_buf + b->var_count;
+				sp = stack_buf;
+				pc = b->byte_code_buf;
+				var_refs = p->u.func.var_refs;
+				sf->js_mode = b->js_mode;
+				sf->arg_count = n_args;
+				sf->cur_func = local_buf[0];
+				sf->arg_buf = arg_buf;
+				sf->var_buf = var_buf;
+				goto restart;
+			}
 		CASE(OP_array_from): {
 				int i, ret;
 
@@ -17347,9 +19231,16 @@ restart:
 				magic = get_u16(pc);
 				pc += 2;
 
-				ret_val = js_function_apply(ctx, sp[-3], 2,
-							    (JSValueConst *) &sp
-							    [-2], magic);
+				if (magic & OP_APPLY_SPREAD) {
+					ret_val = js_apply_spread(
+						ctx, sp[-3], sp[-2], sp[-1],
+						magic & OP_APPLY_CONSTRUCTOR);
+				} else {
+					ret_val = js_function_apply(
+						ctx, sp[-3], 2,
+						(JSValueConst *) &sp[-2],
+						magic);
+				}
 				if (unlikely(JS_IsException(ret_val)))
 					goto exception;
 				JS_FreeValue(ctx, sp[-3]);
@@ -17560,9 +19451,16 @@ restart:
 		CASE(OP_get_var): {
 				JSValue val;
 				JSAtom atom;
+				JSProperty *pr;
+				JSShapeProperty *prs;
 				atom = get_u32(pc);
 				pc += 4;
 
+				pr = find_global_var_cell(ctx, atom, &prs);
+				if (likely(pr && !JS_IsUninitialized(pr->u.value))) {
+					*sp++ = JS_DupValue(ctx, pr->u.value);
+					BREAK;
+				}
 				val = JS_GetGlobalVar(
 					ctx, atom, opcode - OP_get_var_undef);
 				if (unlikely(JS_IsException(val)))
@@ -18376,9 +20274,28 @@ restart:
 		CASE(OP_define_field): {
 				int ret;
 				JSAtom atom;
+				JSObject *p;
+				JSProperty *pr;
+				JSShapeProperty *prs;
 				atom = get_u32(pc);
 				pc += 4;
 
+				/* fast path for the properties created by
+				   OP_object_literal */
+				p = JS_VALUE_GET_OBJ(sp[-2]);
+				if (likely(JS_VALUE_GET_TAG(sp[-2]) ==
+					   JS_TAG_OBJECT &&
+					   p->class_id == JS_CLASS_OBJECT)) {
+					prs = find_own_property(&pr, p, atom);
+					if (likely(prs &&
+						   (prs->flags &
+						    (JS_PROP_TMASK | JS_PROP_C_W_E)) ==
+						   JS_PROP_C_W_E)) {
+						set_value(ctx, &pr->u.value, sp[-1]);
+						sp--;
+						BREAK;
+					}
+				}
 				ret = JS_DefinePropertyValue(
 					ctx, sp[-2], atom, sp[-1],
 					JS_PROP_C_W_E | JS_PROP_THROW);
@@ -18733,15 +20650,15 @@ restart:
 						     JS_VALUE_GET_FLOAT64(
 							     op2));
 					sp--;
-				} else if (
-					JS_VALUE_GET_TAG(*pv) ==
-					JS_TAG_STRING) {
+				} else if (JS_IsString(*pv)) {
 					sp--;
 					op2 = JS_ToPrimitiveFree(
 						ctx, op2, HINT_NONE);
 					if (JS_IsException(op2))
 						goto exception;
-					if (JS_ConcatStringInPlace(
+					if (JS_VALUE_GET_TAG(*pv) ==
+					    JS_TAG_STRING &&
+					    JS_ConcatStringInPlace(
 						ctx, JS_VALUE_GET_STRING(*pv),
 						op2)) {
 						JS_FreeValue(ctx, op2);
@@ -19288,6 +21205,7 @@ restart:
 			switch (JS_VALUE_GET_TAG(sp[-1])) {
 				case JS_TAG_INT:
 				case JS_TAG_STRING:
+				case JS_TAG_SHORT_STRING:
 				case JS_TAG_SYMBOL:
 					break;
 				default:
@@ -19310,6 +21228,7 @@ restart:
 			switch (JS_VALUE_GET_TAG(sp[-1])) {
 				case JS_TAG_INT:
 				case JS_TAG_STRING:
+				case JS_TAG_SHORT_STRING:
 				case JS_TAG_SYMBOL:
 					break;
 				default:
@@ -19559,8 +21478,10 @@ exception:
 		}
 		/* free the local variables and stack */
 		for (pval = local_buf; pval < sp; pval++) {
-			JS_FreeValue(ctx, *pval);
+			JS_FreeValueRT(rt, *pval);
 		}
+		if (tail_buf)
+			js_free_rt(rt, tail_buf);
 	}
 	rt->current_stack_frame = sf->prev_frame;
 	return ret_val;
@@ -19628,6 +21549,46 @@ static JSContext *JS_GetFunctionRealm(JSContext *ctx, JSValueConst func_obj) {
 	return realm;
 }
 
+/* create the object constructed by 'ctor'. Its property array is sized
+   from the previous objects constructed by 'ctor' so that the
+   constructor does not need to resize it. The empty shape is cached in
+   the function bytecode as long as the prototype and the size do not
+   change. */
+static JSValue js_new_object_ctor(JSContext *ctx, JSValueConst ctor,
+				  JSValueConst proto, int class_id) {
+	JSFunctionBytecode *b;
+	JSObject *p;
+	JSShape *sh;
+	int size, hash_size;
+
+	if (class_id == JS_CLASS_OBJECT &&
+	    JS_VALUE_GET_TAG(ctor) == JS_TAG_OBJECT) {
+		p = JS_VALUE_GET_OBJ(ctor);
+		if (p->class_id == JS_CLASS_BYTECODE_FUNCTION) {
+			b = p->u.func.function_bytecode;
+			size = b->ctor_prop_count;
+			if (size > JS_PROP_INITIAL_SIZE) {
+				sh = b->ctor_shape;
+				if (!sh || sh->proto != JS_VALUE_GET_OBJ(proto) ||
+				    sh->prop_size != size) {
+					hash_size = JS_PROP_INITIAL_HASH_SIZE;
+					while (hash_size < size)
+						hash_size *= 2;
+					sh = js_new_shape2(ctx, JS_VALUE_GET_OBJ(proto),
+							   hash_size, size);
+					if (!sh)
+						return JS_EXCEPTION;
+					js_free_shape_null(ctx->rt, b->ctor_shape);
+					b->ctor_shape = sh;
+				}
+				return JS_NewObjectFromShape(ctx, js_dup_shape(sh),
+							     class_id);
+			}
+		}
+	}
+	return JS_NewObjectProtoClass(ctx, proto, class_id);
+}
+
 static JSValue js_create_from_ctor(JSContext *ctx, JSValueConst ctor,
 				   int class_id) {
 	JSValue proto, obj;
@@ -19647,11 +21608,25 @@ static JSValue js_create_from_ctor(JSContext *ctx, JSValueConst ctor,
 			proto = JS_DupValue(ctx, realm->class_proto[class_id]);
 		}
 	}
-	obj = JS_NewObjectProtoClass(ctx, proto, class_id);
+	obj = js_new_object_ctor(ctx, ctor, proto, class_id);
 	JS_FreeValue(ctx, proto);
 	return obj;
 }
 
+/* remember the final property count of the object 'obj' constructed by
+   'ctor' */
+static void js_ctor_update_prop_count(JSValueConst ctor, JSValueConst obj) {
+	JSObject *p;
+
+	if (JS_VALUE_GET_TAG(obj) != JS_TAG_OBJECT)
+		return;
+	p = JS_VALUE_GET_OBJ(ctor);
+	if (p->class_id != JS_CLASS_BYTECODE_FUNCTION)
+		return;
+	p->u.func.function_bytecode->ctor_prop_count =
+		min_int(JS_VALUE_GET_OBJ(obj)->shape->prop_count, UINT16_MAX);
+}
+
 /* argv[] is modified if (flags & JS_CALL_FLAG_COPY_ARGV) = 0. */
 static JSValue JS_CallConstructorInternal(JSContext *ctx,
 					  JSValueConst func_obj,
@@ -19681,9 +21656,13 @@ static JSValue JS_CallConstructorInternal(JSContext *ctx,
 
 	b = p->u.func.function_bytecode;
 	if (b->is_derived_class_constructor) {
-		return JS_CallInternal(ctx, func_obj, JS_UNDEFINED, new_target,
-				       argc,
-				       argv, flags);
+		JSValue ret;
+		ret = JS_CallInternal(ctx, func_obj, JS_UNDEFINED, new_target,
+				      argc,
+				      argv, flags);
+		if (JS_VALUE_GET_PTR(func_obj) == JS_VALUE_GET_PTR(new_target))
+			js_ctor_update_prop_count(new_target, ret);
+		return ret;
 	} else {
 		JSValue obj, ret;
 		/* legacy constructor behavior */
@@ -19699,6 +21678,9 @@ static JSValue JS_CallConstructorInternal(JSContext *ctx,
 			return ret;
 		} else {
 			JS_FreeValue(ctx, ret);
+			if (JS_VALUE_GET_PTR(func_obj) ==
+			    JS_VALUE_GET_PTR(new_target))
+				js_ctor_update_prop_count(new_target, obj);
 			return obj;
 		}
 	}
@@ -19736,6 +21718,82 @@ static JSValue JS_InvokeFree(JSContext *ctx, JSValue this_val, JSAtom atom,
 }
 
 /* JSAsyncFunctionState (used by generator and async functions) */
+
+typedef struct JSAsyncFuncBlock {
+	struct JSAsyncFuncBlock *next;
+} JSAsyncFuncBlock;
+
+/* The pooled blocks stay allocated, but they are free memory: their
+   size is subtracted from the heap size which triggers the GC (see
+   js_gc_heap_size()). */
+static void async_func_pool_push(JSRuntime *rt, int idx, void *ptr) {
+	JSAsyncFuncBlock *b = ptr;
+
+	b->next = rt->async_func_pool[idx];
+	rt->async_func_pool[idx] = b;
+	rt->async_func_pool_count[idx]++;
+	rt->async_func_pool_size += (idx + 1) * JS_ASYNC_FUNC_POOL_GRANULE;
+}
+
+static void *async_func_pool_pop(JSRuntime *rt, int idx) {
+	JSAsyncFuncBlock *b = rt->async_func_pool[idx];
+
+	if (!b)
+		return nullptr;
+	rt->async_func_pool[idx] = b->next;
+	rt->async_func_pool_count[idx]--;
+	rt->async_func_pool_size -= (idx + 1) * JS_ASYNC_FUNC_POOL_GRANULE;
+	return b;
+}
+
+/* allocate a zeroed JSAsyncFunctionState followed by 'size' -
+   sizeof(JSAsyncFunctionState) bytes for its stack frame */
+static JSAsyncFunctionState *async_func_alloc(JSContext *ctx, size_t size) {
+	JSRuntime *rt = ctx->rt;
+	JSAsyncFunctionState *s;
+	int idx;
+
+	idx = (size - 1) / JS_ASYNC_FUNC_POOL_GRANULE;
+	if (idx < JS_ASYNC_FUNC_POOL_CLASSES) {
+		s = async_func_pool_pop(rt, idx);
+		if (!s) {
+			s = js_malloc(ctx, (idx + 1) *
+					   JS_ASYNC_FUNC_POOL_GRANULE);
+			if (!s)
+				return nullptr;
+		}
+	} else {
+		s = js_malloc(ctx, size);
+		if (!s)
+			return nullptr;
+		idx = -1;
+	}
+	memset(s, 0, sizeof(*s));
+	s->pool_idx = idx;
+	return s;
+}
+
+static void async_func_free_block(JSRuntime *rt, JSAsyncFunctionState *s) {
+	int idx = s->pool_idx;
+
+	if (idx >= 0 &&
+	    rt->async_func_pool_count[idx] < JS_ASYNC_FUNC_POOL_MAX) {
+		async_func_pool_push(rt, idx, s);
+	} else {
+		js_free_rt(rt, s);
+	}
+}
+
+static void async_func_pool_free(JSRuntime *rt) {
+	void *b;
+	int i;
+
+	for (i = 0; i < JS_ASYNC_FUNC_POOL_CLASSES; i++) {
+		while ((b = async_func_pool_pop(rt, i)) != nullptr)
+			js_free_rt(rt, b);
+	}
+}
+
 static JSAsyncFunctionState *async_func_init(JSContext *ctx,
 					     JSValueConst func_obj,
 					     JSValueConst this_obj,
@@ -19746,7 +21804,12 @@ static JSAsyncFunctionState *async_func_init(JSContext *ctx,
 	JSStackFrame *sf;
 	int local_count, i, arg_buf_len, n;
 
-	s = js_mallocz(ctx, sizeof(*s));
+	p = JS_VALUE_GET_OBJ(func_obj);
+	b = p->u.func.function_bytecode;
+	arg_buf_len = max_int(b->arg_count, argc);
+	local_count = arg_buf_len + b->var_count + b->stack_size;
+	s = async_func_alloc(ctx, sizeof(*s) + sizeof(JSValue) *
+				  max_int(local_count, 1));
 	if (!s)
 		return nullptr;
 	s->header.ref_count = 1;
@@ -19754,17 +21817,9 @@ static JSAsyncFunctionState *async_func_init(JSContext *ctx,
 
 	sf = &s->frame;
 	init_list_head(&sf->var_ref_list);
-	p = JS_VALUE_GET_OBJ(func_obj);
-	b = p->u.func.function_bytecode;
 	sf->js_mode = b->js_mode | JS_MODE_ASYNC;
 	sf->cur_pc = b->byte_code_buf;
-	arg_buf_len = max_int(b->arg_count, argc);
-	local_count = arg_buf_len + b->var_count + b->stack_size;
-	sf->arg_buf = js_malloc(ctx, sizeof(JSValue) * max_int(local_count, 1));
-	if (!sf->arg_buf) {
-		js_free(ctx, s);
-		return nullptr;
-	}
+	sf->arg_buf = (JSValue *) (s + 1);
 	sf->cur_func = JS_DupValue(ctx, func_obj);
 	s->this_val = JS_DupValue(ctx, this_obj);
 	s->argc = argc;
@@ -19792,7 +21847,7 @@ static void async_func_free_frame(JSRuntime *rt, JSAsyncFunctionState *s) {
 		for (sp = sf->arg_buf; sp < sf->cur_sp; sp++) {
 			JS_FreeValueRT(rt, *sp);
 		}
-		js_free_rt(rt, sf->arg_buf);
+		/* the memory is freed with 's' */
 		sf->arg_buf = nullptr;
 	}
 	JS_FreeValueRT(rt, sf->cur_func);
@@ -19845,7 +21900,7 @@ static void __async_func_free(JSRuntime *rt, JSAsyncFunctionState *s) {
 	    0) {
 		list_add_tail(&s->header.link, &rt->gc_zero_ref_count_list);
 	} else {
-		js_free_rt(rt, s);
+		async_func_free_block(rt, s);
 	}
 }
 
@@ -20037,46 +22092,6 @@ fail:
 
 /* AsyncFunction */
 
-static void js_async_function_resolve_finalizer(JSRuntime *rt, JSValue val) {
-	JSObject *p = JS_VALUE_GET_OBJ(val);
-	JSAsyncFunctionState *s = p->u.async_function_data;
-	if (s) {
-		async_func_free(rt, s);
-	}
-}
-
-static void js_async_function_resolve_mark(JSRuntime *rt, JSValueConst val,
-					   JS_MarkFunc *mark_func) {
-	JSObject *p = JS_VALUE_GET_OBJ(val);
-	JSAsyncFunctionState *s = p->u.async_function_data;
-	if (s) {
-		mark_func(rt, &s->header);
-	}
-}
-
-static int js_async_function_resolve_create(JSContext *ctx,
-					    JSAsyncFunctionState *s,
-					    JSValue *resolving_funcs) {
-	int i;
-	JSObject *p;
-
-	for (i = 0; i < 2; i++) {
-		resolving_funcs[i] =
-				JS_NewObjectProtoClass(ctx, ctx->function_proto,
-						       JS_CLASS_ASYNC_FUNCTION_RESOLVE
-						       + i);
-		if (JS_IsException(resolving_funcs[i])) {
-			if (i == 1)
-				JS_FreeValue(ctx, resolving_funcs[0]);
-			return -1;
-		}
-		p = JS_VALUE_GET_OBJ(resolving_funcs[i]);
-		s->header.ref_count++;
-		p->u.async_function_data = s;
-	}
-	return 0;
-}
-
 static void js_async_function_resume(JSContext *ctx, JSAsyncFunctionState *s) {
 	JSValue func_ret, ret2;
 
@@ -20100,62 +22115,45 @@ static void js_async_function_resume(JSContext *ctx, JSAsyncFunctionState *s) {
 			/* XXX: what to do if exception ? */
 		}
 	} else {
-		JSValue value, promise, resolving_funcs[2], resolving_funcs1[2];
-		int i, res;
+		JSValue value, promise;
+		int res;
 
 		value = s->frame.cur_sp[-1];
 		s->frame.cur_sp[-1] = JS_UNDEFINED;
 
 		/* await */
 		JS_FreeValue(ctx, func_ret); /* not used */
-		promise = js_promise_resolve(ctx, ctx->promise_ctor,
-					     1, (JSValueConst *) &value, 0);
-		JS_FreeValue(ctx, value);
-		if (JS_IsException(promise))
-			goto fail;
-		if (js_async_function_resolve_create(ctx, s, resolving_funcs)) {
+		if (!JS_IsObject(value)) {
+			/* same as awaiting an already fulfilled promise */
+			res = js_enqueue_await_job(ctx, s, FALSE, value);
+			JS_FreeValue(ctx, value);
+		} else {
+			promise = js_promise_resolve(
+				ctx, ctx->promise_ctor, 1,
+				(JSValueConst *) &value, 0);
+			JS_FreeValue(ctx, value);
+			if (JS_IsException(promise))
+				goto fail;
+			res = perform_promise_await(ctx, promise, s);
 			JS_FreeValue(ctx, promise);
-			goto fail;
 		}
-
-		/* Note: no need to create 'thrownawayCapability' as in
-		the spec */
-		for (i = 0; i < 2; i++)
-			resolving_funcs1[i] = JS_UNDEFINED;
-		res = perform_promise_then(ctx, promise,
-					   (JSValueConst *) resolving_funcs,
-					   (JSValueConst *) resolving_funcs1);
-		JS_FreeValue(ctx, promise);
-		for (i = 0; i < 2; i++)
-			JS_FreeValue(ctx, resolving_funcs[i]);
 		if (res)
 			goto fail;
 	}
 }
 
-static JSValue js_async_function_resolve_call(JSContext *ctx,
-					      JSValueConst func_obj,
-					      JSValueConst this_obj,
-					      int argc, JSValueConst *argv,
-					      int flags) {
-	JSObject *p = JS_VALUE_GET_OBJ(func_obj);
-	JSAsyncFunctionState *s = p->u.async_function_data;
-	BOOL is_reject = p->class_id - JS_CLASS_ASYNC_FUNCTION_RESOLVE;
-	JSValueConst arg;
-
-	if (argc > 0)
-		arg = argv[0];
-	else
-		arg = JS_UNDEFINED;
+/* resume the async function 's' with the result of an await */
+static void js_async_function_await_resume(JSContext *ctx,
+					   JSAsyncFunctionState *s,
+					   BOOL is_reject, JSValueConst value) {
 	s->throw_flag = is_reject;
 	if (is_reject) {
-		JS_Throw(ctx, JS_DupValue(ctx, arg));
+		JS_Throw(ctx, JS_DupValue(ctx, value));
 	} else {
 		/* return value of await */
-		s->frame.cur_sp[-1] = JS_DupValue(ctx, arg);
+		s->frame.cur_sp[-1] = JS_DupValue(ctx, value);
 	}
 	js_async_function_resume(ctx, s);
-	return JS_UNDEFINED;
 }
 
 static JSValue js_async_function_call(JSContext *ctx, JSValueConst func_obj,
@@ -23810,16 +25808,72 @@ static void set_object_name_computed(JSParseState *s) {
 	}
 }
 
+/* The property names of an object literal made only of data properties
+   and methods with constant names are added to a template object in
+   the constant pool. OP_object_literal creates the object directly with
+   the shape of the template, so that the following OP_define_field and
+   OP_define_method only update the property values. */
+static int js_object_literal_template_add(JSParseState *s, JSValue *ptmpl,
+					  JSAtom name) {
+	if (JS_IsUndefined(*ptmpl))
+		return 0;
+	if (JS_DefinePropertyValue(s->ctx, *ptmpl, name, JS_UNDEFINED,
+				   JS_PROP_C_W_E) < 0) {
+		JS_FreeValue(s->ctx, *ptmpl);
+		*ptmpl = JS_UNDEFINED;
+		return -1;
+	}
+	return 0;
+}
+
+static int js_object_literal_template_end(JSParseState *s, JSValue tmpl,
+					  int pos) {
+	JSFunctionDef *fd = s->cur_func;
+	JSShape *sh;
+	int idx;
+
+	if (!JS_IsUndefined(tmpl)) {
+		sh = JS_VALUE_GET_OBJ(tmpl)->shape;
+		if (sh->prop_count != 0 && sh->is_hashed) {
+			/* create the objects with the exact property count.
+			   The property arrays of the objects already using
+			   the shape are larger so it is safe. */
+			sh->prop_size = max_int(sh->prop_count,
+						JS_PROP_INITIAL_SIZE);
+			idx = cpool_add(s, tmpl);
+			if (idx < 0) {
+				JS_FreeValue(s->ctx, tmpl);
+				return -1;
+			}
+			put_u32(fd->byte_code.buf + pos + 1, idx);
+			return 0;
+		}
+		JS_FreeValue(s->ctx, tmpl);
+	}
+	/* plain OP_object: the nops are removed by resolve_variables() */
+	fd->byte_code.buf[pos] = OP_object;
+	memset(fd->byte_code.buf + pos + 1, OP_nop, 4);
+	return 0;
+}
+
 static __exception int js_parse_object_literal(JSParseState *s) {
 	JSAtom name = JS_ATOM_NULL;
 	const uint8_t *start_ptr;
-	int start_line, prop_type;
+	int start_line, prop_type, pos;
 	BOOL has_proto;
+	JSValue tmpl = JS_UNDEFINED;
 
 	if (next_token(s))
 		goto fail;
-	/* XXX: add an initial length that will be patched back */
-	emit_op(s, OP_object);
+	/* the template index is patched at the end */
+	emit_op(s, OP_object_literal);
+	pos = s->cur_func->last_opcode_pos;
+	emit_u32(s, 0);
+	tmpl = JS_NewObject(s->ctx);
+	if (JS_IsException(tmpl)) {
+		tmpl = JS_UNDEFINED;
+		goto fail;
+	}
 	has_proto = FALSE;
 	while (s->token.val != '}') {
 		/* specific case for getter/setter */
@@ -23827,10 +25881,12 @@ static __exception int js_parse_object_literal(JSParseState *s) {
 		start_line = s->token.line_num;
 
 		if (s->token.val == TOK_ELLIPSIS) {
+			JS_FreeValue(s->ctx, tmpl);
+			tmpl = JS_UNDEFINED;
 			if (next_token(s))
-				return -1;
+				goto fail;
 			if (js_parse_assign_expr(s))
-				return -1;
+				goto fail;
 			emit_op(s, OP_null); /* dummy excludeList */
 			emit_op(s, OP_copy_data_properties);
 			emit_u8(s, 2 | (1 << 2) | (0 << 5));
@@ -23850,6 +25906,8 @@ static __exception int js_parse_object_literal(JSParseState *s) {
 			emit_u16(s, s->cur_func->scope_level);
 			emit_op(s, OP_define_field);
 			emit_atom(s, name);
+			if (js_object_literal_template_add(s, &tmpl, name))
+				goto fail;
 		} else if (s->token.val == '(') {
 			BOOL is_getset = (prop_type == PROP_TYPE_GET ||
 					  prop_type == PROP_TYPE_SET);
@@ -23881,6 +25939,13 @@ static __exception int js_parse_object_literal(JSParseState *s) {
 				emit_op(s, OP_define_method);
 				emit_atom(s, name);
 			}
+			if (is_getset || name == JS_ATOM_NULL) {
+				JS_FreeValue(s->ctx, tmpl);
+				tmpl = JS_UNDEFINED;
+			} else if (js_object_literal_template_add(s, &tmpl,
+								  name)) {
+				goto fail;
+			}
 			if (is_getset) {
 				op_flags = OP_DEFINE_METHOD_GETTER +
 					   prop_type - PROP_TYPE_GET;
@@ -23897,6 +25962,8 @@ static __exception int js_parse_object_literal(JSParseState *s) {
 				set_object_name_computed(s);
 				emit_op(s, OP_define_array_el);
 				emit_op(s, OP_drop);
+				JS_FreeValue(s->ctx, tmpl);
+				tmpl = JS_UNDEFINED;
 			} else if (name == JS_ATOM___proto__) {
 				if (has_proto) {
 					js_parse_error(
@@ -23906,10 +25973,15 @@ static __exception int js_parse_object_literal(JSParseState *s) {
 				}
 				emit_op(s, OP_set_proto);
 				has_proto = TRUE;
+				JS_FreeValue(s->ctx, tmpl);
+				tmpl = JS_UNDEFINED;
 			} else {
 				set_object_name(s, name);
 				emit_op(s, OP_define_field);
 				emit_atom(s, name);
+				if (js_object_literal_template_add(s, &tmpl,
+								  name))
+					goto fail;
 			}
 		}
 		JS_FreeAtom(s->ctx, name);
@@ -23922,8 +25994,9 @@ static __exception int js_parse_object_literal(JSParseState *s) {
 	}
 	if (js_parse_expect(s, '}'))
 		goto fail;
-	return 0;
+	return js_object_literal_template_end(s, tmpl, pos);
 fail:
+	JS_FreeValue(s->ctx, tmpl);
 	JS_FreeAtom(s->ctx, name);
 	return -1;
 }
@@ -26207,10 +28280,37 @@ static __exception int js_parse_postfix_expr(JSParseState *s, int parse_flags) {
 					return -1;
 			}
 			if (s->token.val == TOK_ELLIPSIS) {
-				emit_op(s, OP_array_from);
-				emit_u16(s, arg_count);
-				emit_op(s, OP_push_i32);
-				emit_u32(s, arg_count);
+				int apply_flags = 0;
+
+				if (arg_count == 0 && opcode != OP_eval) {
+					/* f(...a): the spread object is passed
+					   to OP_apply without an intermediate
+					   array */
+					if (next_token(s))
+						return -1;
+					if (js_parse_assign_expr(s))
+						return -1;
+					if (s->token.val != ')') {
+						if (js_parse_expect(s, ','))
+							return -1;
+					}
+					if (s->token.val == ')') {
+						apply_flags = OP_APPLY_SPREAD;
+						goto emit_apply;
+					}
+					/* obj -> array idx obj */
+					emit_op(s, OP_array_from);
+					emit_u16(s, 0);
+					emit_op(s, OP_push_i32);
+					emit_u32(s, 0);
+					emit_op(s, OP_rot3l);
+					emit_op(s, OP_append);
+				} else {
+					emit_op(s, OP_array_from);
+					emit_u16(s, arg_count);
+					emit_op(s, OP_push_i32);
+					emit_u32(s, arg_count);
+				}
 
 				/* on stack: array idx */
 				while (s->token.val != ')') {
@@ -26260,11 +28360,12 @@ static __exception int js_parse_postfix_expr(JSParseState *s, int parse_flags) {
 					if (js_parse_expect(s, ','))
 						return -1;
 				}
-				if (next_token(s))
-					return -1;
 				/* drop the index */
 				emit_op(s, OP_drop);
 
+			emit_apply:
+				if (next_token(s))
+					return -1;
 				/* apply function call */
 				switch (opcode) {
 					case OP_get_field:
@@ -26274,9 +28375,9 @@ static __exception int js_parse_postfix_expr(JSParseState *s, int parse_flags) {
 						/* obj func array -> func obj array */
 						emit_op(s, OP_perm3);
 						emit_op(s, OP_apply);
-						emit_u16(
-							s, call_type ==
-							   FUNC_CALL_NEW);
+						emit_u16(s, apply_flags |
+							 (call_type ==
+							  FUNC_CALL_NEW));
 						break;
 					case OP_eval:
 						emit_op(s, OP_apply_eval);
@@ -26287,7 +28388,8 @@ static __exception int js_parse_postfix_expr(JSParseState *s, int parse_flags) {
 						if (call_type ==
 						    FUNC_CALL_SUPER_CTOR) {
 							emit_op(s, OP_apply);
-							emit_u16(s, 1);
+							emit_u16(s, apply_flags |
+								 OP_APPLY_CONSTRUCTOR);
 							/* set the 'this' value */
 							emit_op(s, OP_dup);
 							emit_op(
@@ -26306,7 +28408,8 @@ static __exception int js_parse_postfix_expr(JSParseState *s, int parse_flags) {
 							/* obj func array -> func obj array */
 							emit_op(s, OP_perm3);
 							emit_op(s, OP_apply);
-							emit_u16(s, 1);
+							emit_u16(s, apply_flags |
+								 OP_APPLY_CONSTRUCTOR);
 						} else {
 							/* func array -> func undef array */
 							emit_op(
@@ -26314,7 +28417,7 @@ static __exception int js_parse_postfix_expr(JSParseState *s, int parse_flags) {
 								OP_undefined);
 							emit_op(s, OP_swap);
 							emit_op(s, OP_apply);
-							emit_u16(s, 0);
+							emit_u16(s, apply_flags);
 						}
 						break;
 				}
@@ -33695,6 +35798,16 @@ static BOOL code_has_label(CodeContext *s, int pos, int label) {
 	return FALSE;
 }
 
+/* return TRUE if the code at 'pos' is a sequence of labels followed by
+   OP_return */
+static BOOL code_match_label_return(CodeContext *cc, int pos) {
+	if (!code_match(cc, pos, OP_label, -1))
+		return FALSE;
+	while (code_match(cc, pos, OP_label, -1))
+		pos = cc->pos;
+	return code_match(cc, pos, OP_return, -1);
+}
+
 /* return the target label, following the OP_goto jumps
    the first opcode at destination is stored in *pop
  */
@@ -33992,6 +36105,35 @@ static __exception int resolve_labels(JSContext *ctx, JSFunctionDef *s) {
 						&line_num);
 					break;
 				}
+				if (OPTIMIZE &&
+				    code_match_label_return(&cc, pos_next)) {
+					/* the return is also reached by jumps to the
+					   labels: keep it after the tail call */
+					add_pc2line_info(
+						s, bc_out.size, line_num);
+					put_short_code(&bc_out, op + 1, argc);
+					break;
+				}
+				if (OPTIMIZE &&
+				    code_match(&cc, pos_next, OP_goto, -1)) {
+					/* call followed by a jump to a return */
+					int label1 = find_jump_target(
+						s, cc.label, &op1, nullptr);
+					if (op1 == OP_return) {
+						update_label(s, label1, -1);
+						add_pc2line_info(
+							s, bc_out.size,
+							line_num);
+						put_short_code(&bc_out, op + 1,
+							       argc);
+						pos_next = skip_dead_code(
+							s, bc_buf, bc_len,
+							cc.pos, &line_num);
+						break;
+					}
+					update_label(s, label1, -1);
+					update_label(s, cc.label, +1);
+				}
 				add_pc2line_info(s, bc_out.size, line_num);
 				put_short_code(&bc_out, op, argc);
 				break;
@@ -35651,6 +37793,7 @@ static void free_function_bytecode(JSRuntime *rt, JSFunctionBytecode *b) {
 	}
 	for (i = 0; i < b->cpool_count; i++)
 		JS_FreeValueRT(rt, b->cpool[i]);
+	js_free_shape_null(rt, b->ctor_shape);
 
 	for (i = 0; i < b->closure_var_count; i++) {
 		JSClosureVar *cv = &b->closure_var[i];
@@ -36899,9 +39042,9 @@ typedef enum BCTagEnum {
 } BCTagEnum;
 
 #ifdef CONFIG_BIGNUM
-#define BC_VERSION 0x43
+#define BC_VERSION 0x45
 #else
-#define BC_VERSION 3
+#define BC_VERSION 5
 #endif
 
 typedef struct BCWriterState {
@@ -37590,8 +39733,10 @@ static int JS_WriteObjectRec(BCWriterState *s, JSValueConst obj) {
 			bc_put_u64(s, u.u64);
 		}
 		break;
-		case JS_TAG_STRING: {
-			JSString *p = JS_VALUE_GET_STRING(obj);
+		case JS_TAG_STRING:
+		case JS_TAG_SHORT_STRING: {
+			JSShortStringBuf sbuf;
+			JSString *p = js_get_string(&sbuf, obj);
 			bc_put_u8(s, BC_TAG_STRING);
 			JS_WriteString(s, p);
 		}
@@ -39313,6 +41458,15 @@ static JSValue JS_ToObject(JSContext *ctx, JSValueConst val) {
 		case JS_TAG_FLOAT64:
 			obj = JS_NewObjectClass(ctx, JS_CLASS_NUMBER);
 			goto set_value;
+		case JS_TAG_SHORT_STRING: {
+			/* the String objects hold a JS_TAG_STRING value */
+			JSValue str = js_short_string_to_string(ctx, val);
+			if (JS_IsException(str))
+				return str;
+			obj = JS_ToObject(ctx, str);
+			JS_FreeValue(ctx, str);
+			return obj;
+		}
 		case JS_TAG_STRING:
 			/* XXX: should call the string constructor */
 		{
@@ -39777,6 +41931,32 @@ exception:
 	return JS_EXCEPTION;
 }
 
+static JSValue js_object_keys_from_cache(JSContext *ctx, JSObject *p) {
+	JSShapeEnumCache *ec;
+	JSValue r, *tab;
+	uint32_t i;
+
+	ec = js_get_enum_cache(ctx, p);
+	if (!ec)
+		return JS_EXCEPTION;
+	r = js_allocate_fast_array(ctx, ec->count);
+	if (JS_IsException(r))
+		return r;
+	/* the cache cannot be freed while the array is filled */
+	p = JS_VALUE_GET_OBJ(r);
+	tab = p->u.array.u.values;
+	for (i = 0; i < ec->count; i++) {
+		tab[i] = JS_AtomToValue(ctx, ec->atoms[i]);
+		if (JS_IsException(tab[i])) {
+			p->u.array.count = i;
+			JS_FreeValue(ctx, r);
+			return JS_EXCEPTION;
+		}
+	}
+	p->prop[0].u.value = JS_NewUint32(ctx, ec->count);
+	return r;
+}
+
 static JSValue JS_GetOwnPropertyNames2(JSContext *ctx, JSValueConst obj1,
 				       int flags, int kind) {
 	JSValue obj, r, val, key, value;
@@ -39790,6 +41970,14 @@ static JSValue JS_GetOwnPropertyNames2(JSContext *ctx, JSValueConst obj1,
 	if (JS_IsException(obj))
 		return JS_EXCEPTION;
 	p = JS_VALUE_GET_OBJ(obj);
+	if (flags == (JS_GPN_ENUM_ONLY | JS_GPN_STRING_MASK) &&
+	    kind == JS_ITERATOR_KIND_KEY && !p->is_exotic) {
+		/* Object.keys(): no user code can run so the keys are
+		   directly copied from the shape */
+		r = js_object_keys_from_cache(ctx, p);
+		JS_FreeValue(ctx, obj);
+		return r;
+	}
 	if (JS_GetOwnPropertyNamesInternal(ctx, &atoms, &len, p,
 					   flags & ~JS_GPN_ENUM_ONLY))
 		goto exception;
@@ -40692,9 +42880,12 @@ static void free_arg_list(JSContext *ctx, JSValue *tab, uint32_t len) {
 	js_free(ctx, tab);
 }
 
-/* XXX: should use ValueArray */
-static JSValue *build_arg_list(JSContext *ctx, uint32_t *plen,
-			       JSValueConst array_arg) {
+/* Build the argument list of apply() from 'array_arg'. 'buf' of
+   'buf_len' elements is used if large enough, otherwise the list is
+   allocated. */
+static JSValue *build_arg_list2(JSContext *ctx, uint32_t *plen,
+				JSValueConst array_arg,
+				JSValue *buf, uint32_t buf_len) {
 	uint32_t len, i;
 	JSValue *tab, ret;
 	JSObject *p;
@@ -40713,23 +42904,30 @@ static JSValue *build_arg_list(JSContext *ctx, uint32_t *plen,
 			JS_MAX_LOCAL_VARS);
 		return nullptr;
 	}
-	/* avoid allocating 0 bytes */
-	tab = js_mallocz(ctx, sizeof(tab[0]) * max_uint32(1, len));
-	if (!tab)
-		return nullptr;
+	if (len <= buf_len) {
+		tab = buf;
+	} else {
+		/* avoid allocating 0 bytes */
+		tab = js_mallocz(ctx, sizeof(tab[0]) * max_uint32(1, len));
+		if (!tab)
+			return nullptr;
+	}
 	p = JS_VALUE_GET_OBJ(array_arg);
 	if ((p->class_id == JS_CLASS_ARRAY || p->class_id == JS_CLASS_ARGUMENTS)
 	    &&
-	    p->fast_array &&
+	    p->fast_array && p->u.array.hole_count == 0 &&
 	    len == p->u.array.count) {
 		for (i = 0; i < len; i++) {
-			tab[i] = JS_DupValue(ctx, p->u.array.u.values[i]);
+			tab[i] = js_fast_array_get(ctx, p, i);
 		}
 	} else {
 		for (i = 0; i < len; i++) {
 			ret = JS_GetPropertyUint32(ctx, array_arg, i);
 			if (JS_IsException(ret)) {
-				free_arg_list(ctx, tab, i);
+				while (i > 0)
+					JS_FreeValue(ctx, tab[--i]);
+				if (tab != buf)
+					js_free(ctx, tab);
 				return nullptr;
 			}
 			tab[i] = ret;
@@ -40739,13 +42937,47 @@ static JSValue *build_arg_list(JSContext *ctx, uint32_t *plen,
 	return tab;
 }
 
+/* XXX: should use ValueArray */
+static JSValue *build_arg_list(JSContext *ctx, uint32_t *plen,
+			       JSValueConst array_arg) {
+	return build_arg_list2(ctx, plen, array_arg, nullptr, 0);
+}
+
+#define JS_APPLY_STACK_ARGS 16
+
+/* Call 'func_obj' with the elements of 'array_arg' as arguments. Up
+   to JS_APPLY_STACK_ARGS arguments are stored on the C stack. The
+   argument list is owned by this function so it is directly used by
+   the callee frame instead of being copied again. */
+static JSValue js_apply_array(JSContext *ctx, JSValueConst func_obj,
+			      JSValueConst this_obj, JSValueConst array_arg,
+			      BOOL is_constructor) {
+	JSValue tab_buf[JS_APPLY_STACK_ARGS], *tab, ret;
+	uint32_t len, i;
+
+	tab = build_arg_list2(ctx, &len, array_arg, tab_buf,
+			      countof(tab_buf));
+	if (!tab)
+		return JS_EXCEPTION;
+	if (is_constructor) {
+		ret = JS_CallConstructorInternal(ctx, func_obj, this_obj,
+						 len, tab, 0);
+	} else {
+		ret = JS_CallInternal(ctx, func_obj, this_obj, JS_UNDEFINED,
+				      len, tab, 0);
+	}
+	for (i = 0; i < len; i++)
+		JS_FreeValue(ctx, tab[i]);
+	if (tab != tab_buf)
+		js_free(ctx, tab);
+	return ret;
+}
+
 /* magic value: 0 = normal apply, 1 = apply for constructor, 2 =
    Reflect.apply */
 static JSValue js_function_apply(JSContext *ctx, JSValueConst this_val,
 				 int argc, JSValueConst *argv, int magic) {
 	JSValueConst this_arg, array_arg;
-	uint32_t len;
-	JSValue *tab, ret;
 
 	if (check_function(ctx, this_val))
 		return JS_EXCEPTION;
@@ -40755,18 +42987,7 @@ static JSValue js_function_apply(JSContext *ctx, JSValueConst this_val,
 	     JS_VALUE_GET_TAG(array_arg) == JS_TAG_NULL) && magic != 2) {
 		return JS_Call(ctx, this_val, this_arg, 0, nullptr);
 	}
-	tab = build_arg_list(ctx, &len, array_arg);
-	if (!tab)
-		return JS_EXCEPTION;
-	if (magic & 1) {
-		ret = JS_CallConstructor2(ctx, this_val, this_arg, len,
-					  (JSValueConst *) tab);
-	} else {
-		ret = JS_Call(ctx, this_val, this_arg, len,
-			      (JSValueConst *) tab);
-	}
-	free_arg_list(ctx, tab, len);
-	return ret;
+	return js_apply_array(ctx, this_val, this_arg, array_arg, magic & 1);
 }
 
 static JSValue js_function_call(JSContext *ctx, JSValueConst this_val,
@@ -41127,7 +43348,8 @@ static int JS_CopySubArray(JSContext *ctx,
 			from = from_pos + i;
 			to = to_pos + i;
 		}
-		if (p && p->fast_array &&
+		if (p && p->fast_array && p->u.array.hole_count == 0 &&
+		    p->u.array.kind == JS_ARRAY_KIND_VALUE &&
 		    from >= 0 && from < (len = p->u.array.count) &&
 		    to >= 0 && to < len) {
 			int64_t l, j;
@@ -41442,8 +43664,7 @@ static JSValue js_array_at(JSContext *ctx, JSValueConst this_val,
 			   int argc, JSValueConst *argv) {
 	JSValue obj, ret;
 	int64_t len, idx;
-	JSValue *arrp;
-	uint32_t count;
+	JSObject *p;
 
 	obj = JS_ToObject(ctx, this_val);
 	if (js_get_length64(ctx, &len, obj))
@@ -41456,8 +43677,9 @@ static JSValue js_array_at(JSContext *ctx, JSValueConst this_val,
 		idx = len + idx;
 	if (idx < 0 || idx >= len) {
 		ret = JS_UNDEFINED;
-	} else if (js_get_fast_array(ctx, obj, &arrp, &count) && idx < count) {
-		ret = JS_DupValue(ctx, arrp[idx]);
+	} else if ((p = js_get_fast_array_obj(obj)) != nullptr &&
+		   idx < p->u.array.count) {
+		ret = js_fast_array_get(ctx, p, idx);
 	} else {
 		int present = JS_TryGetPropertyInt64(ctx, obj, idx, &ret);
 		if (present < 0)
@@ -41474,10 +43696,9 @@ exception:
 
 static JSValue js_array_with(JSContext *ctx, JSValueConst this_val,
 			     int argc, JSValueConst *argv) {
-	JSValue arr, obj, ret, *arrp, *pval;
-	JSObject *p;
+	JSValue arr, obj, ret, *pval;
+	JSObject *p, *p1;
 	int64_t i, len, idx;
-	uint32_t count32;
 
 	ret = JS_EXCEPTION;
 	arr = JS_UNDEFINED;
@@ -41503,12 +43724,13 @@ static JSValue js_array_with(JSContext *ctx, JSValueConst this_val,
 	p = JS_VALUE_GET_OBJ(arr);
 	i = 0;
 	pval = p->u.array.u.values;
-	if (js_get_fast_array(ctx, obj, &arrp, &count32) && count32 == len) {
+	p1 = js_get_fast_array_obj(obj);
+	if (p1 && p1->u.array.count == len) {
 		for (; i < idx; i++, pval++)
-			*pval = JS_DupValue(ctx, arrp[i]);
+			*pval = js_fast_array_get(ctx, p1, i);
 		*pval = JS_DupValue(ctx, argv[1]);
 		for (i++, pval++; i < len; i++, pval++)
-			*pval = JS_DupValue(ctx, arrp[i]);
+			*pval = js_fast_array_get(ctx, p1, i);
 	} else {
 		for (; i < idx; i++, pval++)
 			if (-1 == JS_TryGetPropertyInt64(ctx, obj, i, pval))
@@ -41911,11 +44133,73 @@ exception:
 	return JS_EXCEPTION;
 }
 
+/* Search the number 'val' in the elements k, k + dir, ... (excluding
+   'end') of the fast array 'p' which must have unboxed elements. The
+   range is clipped to the stored elements. NaN
+   is found only if 'same_value_zero' is TRUE. Return the index or -1. */
+static int64_t js_fast_array_find_number(JSObject *p, JSValueConst val,
+					 int64_t k, int64_t end, int dir,
+					 BOOL same_value_zero) {
+	double d;
+	int32_t v;
+
+	switch (JS_VALUE_GET_NORM_TAG(val)) {
+		case JS_TAG_INT:
+			d = JS_VALUE_GET_INT(val);
+			break;
+		case JS_TAG_FLOAT64:
+			d = JS_VALUE_GET_FLOAT64(val);
+			break;
+		default:
+			return -1;
+	}
+	/* only the first 'count' elements are stored */
+	if (dir > 0) {
+		end = min_int64(end, p->u.array.count);
+		if (k >= end)
+			return -1;
+	} else {
+		k = min_int64(k, (int64_t) p->u.array.count - 1);
+		if (k <= end)
+			return -1;
+	}
+	if (p->u.array.kind == JS_ARRAY_KIND_INT32) {
+		const int32_t *tab = p->u.array.u.int32_ptr;
+		/* -0 matches 0 */
+		if (!(d >= INT32_MIN && d <= INT32_MAX))
+			return -1;
+		v = (int32_t) d;
+		if (v != d)
+			return -1;
+		for (; k != end; k += dir) {
+			if (tab[k] == v)
+				return k;
+		}
+	} else {
+		const double *tab = p->u.array.u.double_ptr;
+		if (isnan(d)) {
+			if (!same_value_zero)
+				return -1;
+			for (; k != end; k += dir) {
+				if (isnan(tab[k]))
+					return k;
+			}
+		} else {
+			for (; k != end; k += dir) {
+				if (tab[k] == d)
+					return k;
+			}
+		}
+	}
+	return -1;
+}
+
 static JSValue js_array_includes(JSContext *ctx, JSValueConst this_val,
 				 int argc, JSValueConst *argv) {
 	JSValue obj, val;
 	int64_t len, n;
 	JSValue *arrp;
+	JSObject *p;
 	uint32_t count;
 	int res;
 
@@ -41930,7 +44214,17 @@ static JSValue js_array_includes(JSContext *ctx, JSValueConst this_val,
 			if (JS_ToInt64Clamp(ctx, &n, argv[1], 0, len, len))
 				goto exception;
 		}
-		if (js_get_fast_array(ctx, obj, &arrp, &count)) {
+		p = js_get_fast_array_obj(obj);
+		if (p && p->u.array.kind != JS_ARRAY_KIND_VALUE) {
+			count = p->u.array.count;
+			if (js_fast_array_find_number(p, argv[0], n, count, 1,
+						      TRUE) >= 0) {
+				res = TRUE;
+				goto done;
+			}
+			if (n < count)
+				n = count;
+		} else if (js_get_fast_array(ctx, obj, &arrp, &count)) {
 			for (; n < count; n++) {
 				if (js_strict_eq2(
 					ctx, JS_DupValue(ctx, argv[0]),
@@ -41966,6 +44260,7 @@ static JSValue js_array_indexOf(JSContext *ctx, JSValueConst this_val,
 	JSValue obj, val;
 	int64_t len, n, res;
 	JSValue *arrp;
+	JSObject *p;
 	uint32_t count;
 
 	obj = JS_ToObject(ctx, this_val);
@@ -41979,7 +44274,16 @@ static JSValue js_array_indexOf(JSContext *ctx, JSValueConst this_val,
 			if (JS_ToInt64Clamp(ctx, &n, argv[1], 0, len, len))
 				goto exception;
 		}
-		if (js_get_fast_array(ctx, obj, &arrp, &count)) {
+		p = js_get_fast_array_obj(obj);
+		if (p && p->u.array.kind != JS_ARRAY_KIND_VALUE) {
+			count = p->u.array.count;
+			res = js_fast_array_find_number(p, argv[0], n, count, 1,
+							FALSE);
+			if (res >= 0)
+				goto done;
+			if (n < count)
+				n = count;
+		} else if (js_get_fast_array(ctx, obj, &arrp, &count)) {
 			for (; n < count; n++) {
 				if (js_strict_eq2(
 					ctx, JS_DupValue(ctx, argv[0]),
@@ -42017,6 +44321,7 @@ static JSValue js_array_lastIndexOf(JSContext *ctx, JSValueConst this_val,
 				    int argc, JSValueConst *argv) {
 	JSValue obj, val;
 	int64_t len, n, res;
+	JSObject *p;
 	int present;
 
 	obj = JS_ToObject(ctx, this_val);
@@ -42030,7 +44335,14 @@ static JSValue js_array_lastIndexOf(JSContext *ctx, JSValueConst this_val,
 			if (JS_ToInt64Clamp(ctx, &n, argv[1], -1, len - 1, len))
 				goto exception;
 		}
-		/* XXX: should special case fast arrays */
+		/* XXX: should special case boxed fast arrays */
+		p = js_get_fast_array_obj(obj);
+		if (p && p->u.array.kind != JS_ARRAY_KIND_VALUE &&
+		    p->u.array.count == len) {
+			res = js_fast_array_find_number(p, argv[0], n, -1, -1,
+							FALSE);
+			n = -1;
+		}
 		for (; n >= 0; n--) {
 			present = JS_TryGetPropertyInt64(ctx, obj, n, &val);
 			if (present < 0)
@@ -42215,7 +44527,7 @@ static JSValue js_array_pop(JSContext *ctx, JSValueConst this_val,
 			    int argc, JSValueConst *argv, int shift) {
 	JSValue obj, res = JS_UNDEFINED;
 	int64_t len, newLen;
-	JSValue *arrp;
+	JSObject *p;
 	uint32_t count32;
 
 	obj = JS_ToObject(ctx, this_val);
@@ -42225,18 +44537,25 @@ static JSValue js_array_pop(JSContext *ctx, JSValueConst this_val,
 	if (len > 0) {
 		newLen = len - 1;
 		/* Special case fast arrays */
-		if (js_get_fast_array(ctx, obj, &arrp, &count32) && count32 ==
-		    len) {
-			JSObject *p = JS_VALUE_GET_OBJ(obj);
+		p = js_get_fast_array_obj(obj);
+		if (p && p->u.array.count == len) {
+			size_t elem_size = js_array_kind_size[p->u.array.kind];
+			count32 = p->u.array.count;
+			/* the removed element is moved to 'res' */
 			if (shift) {
-				res = arrp[0];
-				memmove(arrp, arrp + 1,
-					(count32 - 1) * sizeof(*arrp));
-				p->u.array.count--;
+				res = js_fast_array_get(ctx, p, 0);
+				if (p->u.array.kind == JS_ARRAY_KIND_VALUE)
+					JS_FreeValue(ctx, p->u.array.u.values[0]);
+				memmove(p->u.array.u.uint8_ptr,
+					p->u.array.u.uint8_ptr + elem_size,
+					(count32 - 1) * elem_size);
 			} else {
-				res = arrp[count32 - 1];
-				p->u.array.count--;
+				res = js_fast_array_get(ctx, p, count32 - 1);
+				if (p->u.array.kind == JS_ARRAY_KIND_VALUE)
+					JS_FreeValue(ctx, p->u.array.u.values[
+							     count32 - 1]);
 			}
+			p->u.array.count--;
 		} else {
 			if (shift) {
 				res = JS_GetPropertyInt64(ctx, obj, 0);
@@ -42308,25 +44627,48 @@ exception:
 static JSValue js_array_reverse(JSContext *ctx, JSValueConst this_val,
 				int argc, JSValueConst *argv) {
 	JSValue obj, lval, hval;
-	JSValue *arrp;
+	JSObject *p;
 	int64_t len, l, h;
 	int l_present, h_present;
-	uint32_t count32;
 
 	lval = JS_UNDEFINED;
 	obj = JS_ToObject(ctx, this_val);
 	if (js_get_length64(ctx, &len, obj))
 		goto exception;
 
-	/* Special case fast arrays */
-	if (js_get_fast_array(ctx, obj, &arrp, &count32) && count32 == len) {
+	/* Special case fast arrays, keeping their element kind */
+	p = js_get_fast_array_obj(obj);
+	if (p && p->u.array.count == len) {
 		uint32_t ll, hh;
 
-		if (count32 > 1) {
-			for (ll = 0, hh = count32 - 1; ll < hh; ll++, hh--) {
-				lval = arrp[ll];
-				arrp[ll] = arrp[hh];
-				arrp[hh] = lval;
+		if (len > 1) {
+			for (ll = 0, hh = len - 1; ll < hh; ll++, hh--) {
+				switch (p->u.array.kind) {
+					case JS_ARRAY_KIND_INT32: {
+						int32_t *tab =
+							p->u.array.u.int32_ptr;
+						int32_t v = tab[ll];
+						tab[ll] = tab[hh];
+						tab[hh] = v;
+					}
+					break;
+					case JS_ARRAY_KIND_FLOAT64: {
+						double *tab =
+							p->u.array.u.double_ptr;
+						double v = tab[ll];
+						tab[ll] = tab[hh];
+						tab[hh] = v;
+					}
+					break;
+					default: {
+						JSValue *tab =
+							p->u.array.u.values;
+						lval = tab[ll];
+						tab[ll] = tab[hh];
+						tab[hh] = lval;
+					}
+					break;
+				}
 			}
 		}
 		return obj;
@@ -42383,10 +44725,9 @@ exception:
 // Does not use Array[@@species], always returns a base Array.
 static JSValue js_array_toReversed(JSContext *ctx, JSValueConst this_val,
 				   int argc, JSValueConst *argv) {
-	JSValue arr, obj, ret, *arrp, *pval;
-	JSObject *p;
+	JSValue arr, obj, ret, *pval;
+	JSObject *p, *p1;
 	int64_t i, len;
-	uint32_t count32;
 
 	ret = JS_EXCEPTION;
 	arr = JS_UNDEFINED;
@@ -42403,10 +44744,10 @@ static JSValue js_array_toReversed(JSContext *ctx, JSValueConst this_val,
 
 		i = len - 1;
 		pval = p->u.array.u.values;
-		if (js_get_fast_array(ctx, obj, &arrp, &count32) && count32 ==
-		    len) {
+		p1 = js_get_fast_array_obj(obj);
+		if (p1 && p1->u.array.count == len) {
 			for (; i >= 0; i--, pval++)
-				*pval = JS_DupValue(ctx, arrp[i]);
+				*pval = js_fast_array_get(ctx, p1, i);
 		} else {
 			// Query order is observable; test262 expects descending order.
 			for (; i >= 0; i--, pval++) {
@@ -42439,7 +44780,7 @@ static JSValue js_array_slice(JSContext *ctx, JSValueConst this_val,
 	JSValue obj, arr, val, len_val;
 	int64_t len, start, k, final, n, count, del_count, new_len;
 	int kPresent;
-	JSValue *arrp;
+	JSObject *p;
 	uint32_t count32, i, item_count;
 
 	arr = JS_UNDEFINED;
@@ -42490,13 +44831,14 @@ static JSValue js_array_slice(JSContext *ctx, JSValueConst this_val,
 	JS_CreateDataPropertyUint32() won't modify obj in case arr is
 	an exotic object */
 	/* Special case fast arrays */
-	if (js_get_fast_array(ctx, obj, &arrp, &count32) &&
+	if ((p = js_get_fast_array_obj(obj)) != nullptr &&
 	    js_is_fast_array(ctx, arr)) {
 		/* XXX: should share code with fast array constructor */
+		count32 = p->u.array.count;
 		for (; k < final && k < count32; k++, n++) {
 			if (JS_CreateDataPropertyUint32(ctx, arr, n,
-							JS_DupValue(
-								ctx, arrp[k]),
+							js_fast_array_get(
+								ctx, p, k),
 							JS_PROP_THROW) < 0)
 				goto exception;
 		}
@@ -42553,10 +44895,9 @@ exception:
 
 static JSValue js_array_toSpliced(JSContext *ctx, JSValueConst this_val,
 				  int argc, JSValueConst *argv) {
-	JSValue arr, obj, ret, *arrp, *pval, *last;
-	JSObject *p;
+	JSValue arr, obj, ret, *pval, *last;
+	JSObject *p, *p1;
 	int64_t i, j, len, newlen, start, add, del;
-	uint32_t count32;
 
 	pval = nullptr;
 	last = nullptr;
@@ -42600,13 +44941,14 @@ static JSValue js_array_toSpliced(JSContext *ctx, JSValueConst this_val,
 	pval = &p->u.array.u.values[0];
 	last = &p->u.array.u.values[newlen];
 
-	if (js_get_fast_array(ctx, obj, &arrp, &count32) && count32 == len) {
+	p1 = js_get_fast_array_obj(obj);
+	if (p1 && p1->u.array.count == len) {
 		for (i = 0; i < start; i++, pval++)
-			*pval = JS_DupValue(ctx, arrp[i]);
+			*pval = js_fast_array_get(ctx, p1, i);
 		for (j = 0; j < add; j++, pval++)
 			*pval = JS_DupValue(ctx, argv[2 + j]);
 		for (i += del; i < len; i++, pval++)
-			*pval = JS_DupValue(ctx, arrp[i]);
+			*pval = js_fast_array_get(ctx, p1, i);
 	} else {
 		for (i = 0; i < start; i++, pval++)
 			if (-1 == JS_TryGetPropertyInt64(ctx, obj, i, pval))
@@ -42849,25 +45191,129 @@ static int js_array_cmp_generic(const void *a, const void *b, void *opaque) {
 		}
 		cmp = js_string_compare(ctx, ap->str, bp->str);
 	}
-	if (cmp != 0)
-		return cmp;
+	return cmp;
 cmp_same:
-	/* make sort stable: compare array offsets */
-	return (ap->pos > bp->pos) - (ap->pos < bp->pos);
+	/* timsort() is stable: no need to compare the array offsets */
+	return 0;
 
 exception:
 	psc->exception = 1;
 	return 0;
 }
 
+/* Default comparison of int32 elements: their decimal representations
+   are compared without building the strings. */
+static int js_array_cmp_int32(const void *a, const void *b, void *opaque) {
+	static const uint32_t pow10[10] = {
+		1, 10, 100, 1000, 10000, 100000, 1000000, 10000000,
+		100000000, 1000000000,
+	};
+	int32_t x = *(const int32_t *) a, y = *(const int32_t *) b;
+	uint64_t ux, uy;
+	int dx, dy;
+
+	if (x == y)
+		return 0;
+	/* '-' is before the digits */
+	if ((x < 0) != (y < 0))
+		return x < 0 ? -1 : 1;
+	ux = x < 0 ? -(int64_t) x : x;
+	uy = y < 0 ? -(int64_t) y : y;
+	for (dx = 1; dx < 10 && ux >= pow10[dx]; dx++)
+		continue;
+	for (dy = 1; dy < 10 && uy >= pow10[dy]; dy++)
+		continue;
+	/* pad the shorter number with zeros */
+	if (dx < dy)
+		ux *= pow10[dy - dx];
+	else
+		uy *= pow10[dx - dy];
+	if (ux != uy)
+		return ux < uy ? -1 : 1;
+	/* a prefix is before the longer string */
+	return dx < dy ? -1 : 1;
+}
+
+/* Sort a fast array with the default comparison if its elements are
+   primitive values: no JS code can run during the sort, so the
+   elements are permuted in place. Return 0 if not handled, -1 if
+   exception. */
+static int js_array_sort_default_fast(JSContext *ctx, JSObject *p) {
+	struct array_sort_context asc = {ctx, 0, 0, JS_UNDEFINED};
+	uint32_t i, n, len = p->u.array.count;
+	size_t elt_size = js_array_kind_size[p->u.array.kind];
+	uint8_t *elts = p->u.array.u.ptr;
+	ValueSlot *array;
+	uint8_t *tmp;
+	JSValue val;
+
+	if (len < 2)
+		return 1;
+	if (p->u.array.kind == JS_ARRAY_KIND_INT32) {
+		tmp = js_malloc(ctx, (len / 2 + 1) * sizeof(int32_t));
+		if (!tmp)
+			return -1;
+		timsort(elts, len, sizeof(int32_t), js_array_cmp_int32,
+			nullptr, tmp);
+		js_free(ctx, tmp);
+		return 1;
+	}
+	if (p->u.array.kind == JS_ARRAY_KIND_VALUE) {
+		for (i = 0; i < len; i++) {
+			if (JS_IsObject(p->u.array.u.values[i]))
+				return 0;
+		}
+	}
+
+	/* the slots are followed by the temporary buffer of timsort(),
+	   which is then used to permute the elements */
+	array = js_malloc(ctx, (len + len / 2 + 1) * sizeof(*array));
+	if (!array)
+		return -1;
+	tmp = (uint8_t *) (array + len);
+	n = 0;
+	for (i = 0; i < len; i++) {
+		val = js_fast_array_get(ctx, p, i);
+		if (JS_IsUndefined(val))
+			continue;
+		array[n].val = val;
+		array[n].str = nullptr;
+		if (JS_VALUE_GET_TAG(val) == JS_TAG_STRING)
+			array[n].str = JS_VALUE_GET_STRING(JS_DupValue(ctx, val));
+		array[n].pos = i;
+		n++;
+	}
+	timsort(array, n, sizeof(*array), js_array_cmp_generic, &asc, tmp);
+	if (!asc.exception) {
+		/* the undefined values go to the end */
+		memcpy(tmp, elts, len * elt_size);
+		for (i = 0; i < n; i++) {
+			memcpy(elts + i * elt_size,
+			       tmp + array[i].pos * elt_size, elt_size);
+		}
+		for (; i < len; i++)
+			p->u.array.u.values[i] = JS_UNDEFINED;
+	}
+	for (i = 0; i < n; i++) {
+		JS_FreeValue(ctx, array[i].val);
+		if (array[i].str)
+			JS_FreeValue(
+				ctx, JS_MKPTR(JS_TAG_STRING, array[i].str));
+	}
+	js_free(ctx, array);
+	return asc.exception ? -1 : 1;
+}
+
 static JSValue js_array_sort(JSContext *ctx, JSValueConst this_val,
 			     int argc, JSValueConst *argv) {
 	struct array_sort_context asc = {ctx, 0, 0, argv[0]};
 	JSValue obj = JS_UNDEFINED;
 	ValueSlot *array = nullptr;
+	void *tmp;
 	size_t array_size = 0, pos = 0, n = 0;
 	int64_t i, len, undefined_count = 0;
-	int present;
+	JSObject *p;
+	int present, ret;
 
 	if (!JS_IsUndefined(asc.method)) {
 		if (check_function(ctx, asc.method))
@@ -42878,7 +45324,17 @@ static JSValue js_array_sort(JSContext *ctx, JSValueConst this_val,
 	if (js_get_length64(ctx, &len, obj))
 		goto exception;
 
-	/* XXX: should special case fast arrays */
+	p = js_get_fast_array_obj(obj);
+	if (p && p->u.array.count != len)
+		p = nullptr;
+	if (p && !asc.has_method) {
+		ret = js_array_sort_default_fast(ctx, p);
+		if (ret < 0)
+			goto exception;
+		if (ret > 0)
+			return obj;
+	}
+
 	for (i = 0; i < len; i++) {
 		if (pos >= array_size) {
 			size_t new_size, slack;
@@ -42893,11 +45349,17 @@ static JSValue js_array_sort(JSContext *ctx, JSValueConst this_val,
 			array = new_array;
 			array_size = new_size;
 		}
-		present = JS_TryGetPropertyInt64(ctx, obj, i, &array[pos].val);
-		if (present < 0)
-			goto exception;
-		if (present == 0)
-			continue;
+		if (p) {
+			/* the array cannot be modified before the sort */
+			array[pos].val = js_fast_array_get(ctx, p, i);
+		} else {
+			present = JS_TryGetPropertyInt64(ctx, obj, i,
+							 &array[pos].val);
+			if (present < 0)
+				goto exception;
+			if (present == 0)
+				continue;
+		}
 		if (JS_IsUndefined(array[pos].val)) {
 			undefined_count++;
 			continue;
@@ -42906,11 +45368,17 @@ static JSValue js_array_sort(JSContext *ctx, JSValueConst this_val,
 		array[pos].pos = i;
 		pos++;
 	}
-	rqsort(array, pos, sizeof(*array), js_array_cmp_generic, &asc);
-	if (asc.exception)
-		goto exception;
+	if (pos > 1) {
+		tmp = js_malloc(ctx, (pos / 2 + 1) * sizeof(*array));
+		if (!tmp)
+			goto exception;
+		timsort(array, pos, sizeof(*array), js_array_cmp_generic,
+			&asc, tmp);
+		js_free(ctx, tmp);
+		if (asc.exception)
+			goto exception;
+	}
 
-	/* XXX: should special case fast arrays */
 	while (n < pos) {
 		if (array[n].str)
 			JS_FreeValue(
@@ -42956,10 +45424,9 @@ fail:
 // Does not use Array[@@species], always returns a base Array.
 static JSValue js_array_toSorted(JSContext *ctx, JSValueConst this_val,
 				 int argc, JSValueConst *argv) {
-	JSValue arr, obj, ret, *arrp, *pval;
-	JSObject *p;
+	JSValue arr, obj, ret, *pval;
+	JSObject *p, *p1;
 	int64_t i, len;
-	uint32_t count32;
 	int ok;
 
 	ok = JS_IsUndefined(argv[0]) || JS_IsFunction(ctx, argv[0]);
@@ -42980,10 +45447,10 @@ static JSValue js_array_toSorted(JSContext *ctx, JSValueConst this_val,
 		p = JS_VALUE_GET_OBJ(arr);
 		i = 0;
 		pval = p->u.array.u.values;
-		if (js_get_fast_array(ctx, obj, &arrp, &count32) && count32 ==
-		    len) {
+		p1 = js_get_fast_array_obj(obj);
+		if (p1 && p1->u.array.count == len) {
 			for (; i < len; i++, pval++)
-				*pval = JS_DupValue(ctx, arrp[i]);
+				*pval = js_fast_array_get(ctx, p1, i);
 		} else {
 			for (; i < len; i++, pval++) {
 				if (-1 == JS_TryGetPropertyInt64(
@@ -43608,6 +46075,7 @@ static int js_string_define_own_property(JSContext *ctx,
 	uint32_t idx;
 	JSObject *p;
 	JSString *p1, *p2;
+	JSShortStringBuf sbuf;
 
 	if (__JS_AtomIsTaggedInt(prop)) {
 		idx = __JS_AtomToUInt32(prop);
@@ -43621,9 +46089,9 @@ static int js_string_define_own_property(JSContext *ctx,
 			goto fail;
 		/* check that the same value is configured */
 		if (flags & JS_PROP_HAS_VALUE) {
-			if (JS_VALUE_GET_TAG(val) != JS_TAG_STRING)
+			if (!JS_IsString(val))
 				goto fail;
-			p2 = JS_VALUE_GET_STRING(val);
+			p2 = js_get_string(&sbuf, val);
 			if (p2->len != 1)
 				goto fail;
 			if (string_get(p1, idx) != string_get(p2, 0)) {
@@ -43696,7 +46164,7 @@ static JSValue js_string_constructor(JSContext *ctx, JSValueConst new_target,
 }
 
 static JSValue js_thisStringValue(JSContext *ctx, JSValueConst this_val) {
-	if (JS_VALUE_GET_TAG(this_val) == JS_TAG_STRING)
+	if (JS_IsString(this_val))
 		return JS_DupValue(ctx, this_val);
 
 	if (JS_VALUE_GET_TAG(this_val) == JS_TAG_OBJECT) {
@@ -43933,6 +46401,8 @@ static JSValue js_string_concat(JSContext *ctx, JSValueConst this_val,
 
 static int string_cmp(JSString *p1, JSString *p2, int x1, int x2, int len) {
 	int i, c1, c2;
+	if (!p1->is_wide_char && !p2->is_wide_char)
+		return memcmp(p1->u.str8 + x1, p2->u.str8 + x2, len);
 	for (i = 0; i < len; i++) {
 		if ((c1 = string_get(p1, x1 + i)) != (
 			    c2 = string_get(p2, x2 + i)))
@@ -43941,30 +46411,138 @@ static int string_cmp(JSString *p1, JSString *p2, int x1, int x2, int len) {
 	return 0;
 }
 
+/* 16 bit version of memchr() */
+static const uint16_t *js_memchr16(const uint16_t *s, uint16_t c, size_t n) {
+	size_t i = 0;
+#if defined(__SSE2__)
+	__m128i vc = _mm_set1_epi16(c);
+	int mask;
+	for (; i + 8 <= n; i += 8) {
+		mask = _mm_movemask_epi8(_mm_cmpeq_epi16(
+			_mm_loadu_si128((const __m128i *) (s + i)), vc));
+		if (mask)
+			return s + i + (ctz32(mask) >> 1);
+	}
+#endif
+	for (; i < n; i++) {
+		if (s[i] == c)
+			return s + i;
+	}
+	return nullptr;
+}
+
 static int string_indexof_char(JSString *p, int c, int from) {
 	/* assuming 0 <= from <= p->len */
-	int i, len = p->len;
+	int len = p->len;
 	if (p->is_wide_char) {
-		for (i = from; i < len; i++) {
-			if (p->u.str16[i] == c)
-				return i;
+		const uint16_t *q;
+		if ((c & ~0xffff) == 0) {
+			q = js_memchr16(p->u.str16 + from, c, len - from);
+			if (q)
+				return q - p->u.str16;
 		}
 	} else {
+		const uint8_t *q;
 		if ((c & ~0xff) == 0) {
-			for (i = from; i < len; i++) {
-				if (p->u.str8[i] == (uint8_t) c)
-					return i;
-			}
+			q = memchr(p->u.str8 + from, c, len - from);
+			if (q)
+				return q - p->u.str8;
 		}
 	}
 	return -1;
 }
 
+/* Search the 8 bit string s2 (len2 >= 2) in s1 starting at 'from'.
+   The candidate positions are filtered by comparing the first and
+   last characters of s2 at 16 positions at a time. */
+static int string_indexof8(const uint8_t *s1, int len1, const uint8_t *s2,
+			   int len2, int from) {
+	int i, end = len1 - len2;
+	const uint8_t *q;
+#if defined(__SSE2__)
+	__m128i vfirst = _mm_set1_epi8(s2[0]);
+	__m128i vlast = _mm_set1_epi8(s2[len2 - 1]);
+	unsigned int mask;
+	int k;
+	for (i = from; i + 15 <= end; i += 16) {
+		mask = _mm_movemask_epi8(_mm_and_si128(
+			_mm_cmpeq_epi8(_mm_loadu_si128(
+				(const __m128i *) (s1 + i)), vfirst),
+			_mm_cmpeq_epi8(_mm_loadu_si128(
+				(const __m128i *) (s1 + i + len2 - 1)), vlast)));
+		while (mask) {
+			k = ctz32(mask);
+			if (!memcmp(s1 + i + k + 1, s2 + 1, len2 - 2))
+				return i + k;
+			mask &= mask - 1;
+		}
+	}
+	from = i;
+#endif
+	for (i = from; i <= end; i++) {
+		q = memchr(s1 + i, s2[0], end - i + 1);
+		if (!q)
+			break;
+		i = q - s1;
+		if (!memcmp(s1 + i + 1, s2 + 1, len2 - 1))
+			return i;
+	}
+	return -1;
+}
+
+/* 16 bit version of string_indexof8() */
+static int string_indexof16(const uint16_t *s1, int len1, const uint16_t *s2,
+			    int len2, int from) {
+	int i, end = len1 - len2;
+	const uint16_t *q;
+#if defined(__SSE2__)
+	__m128i vfirst = _mm_set1_epi16(s2[0]);
+	__m128i vlast = _mm_set1_epi16(s2[len2 - 1]);
+	unsigned int mask;
+	int k;
+	for (i = from; i + 7 <= end; i += 8) {
+		mask = _mm_movemask_epi8(_mm_and_si128(
+			_mm_cmpeq_epi16(_mm_loadu_si128(
+				(const __m128i *) (s1 + i)), vfirst),
+			_mm_cmpeq_epi16(_mm_loadu_si128(
+				(const __m128i *) (s1 + i + len2 - 1)), vlast)));
+		while (mask) {
+			k = ctz32(mask) >> 1;
+			if (!memcmp(s1 + i + k + 1, s2 + 1, (len2 - 2) * 2))
+				return i + k;
+			mask &= ~(3U << (k * 2));
+		}
+	}
+	from = i;
+#endif
+	for (i = from; i <= end; i++) {
+		q = js_memchr16(s1 + i, s2[0], end - i + 1);
+		if (!q)
+			break;
+		i = q - s1;
+		if (!memcmp(s1 + i + 1, s2 + 1, (len2 - 1) * 2))
+			return i;
+	}
+	return -1;
+}
+
 static int string_indexof(JSString *p1, JSString *p2, int from) {
 	/* assuming 0 <= from <= p1->len */
 	int c, i, j, len1 = p1->len, len2 = p2->len;
 	if (len2 == 0)
 		return from;
+	if (len2 > len1 - from)
+		return -1;
+	if (len2 == 1)
+		return string_indexof_char(p1, string_get(p2, 0), from);
+	if (p1->is_wide_char == p2->is_wide_char) {
+		if (p1->is_wide_char)
+			return string_indexof16(p1->u.str16, len1,
+						p2->u.str16, len2, from);
+		else
+			return string_indexof8(p1->u.str8, len1,
+					       p2->u.str8, len2, from);
+	}
 	for (i = from, c = string_get(p2, 0); i + len2 <= len1; i = j + 1) {
 		j = string_indexof_char(p1, c, i);
 		if (j < 0 || j + len2 > len1)
@@ -44103,6 +46681,10 @@ static JSValue js_string_indexOf(JSContext *ctx, JSValueConst this_val,
 	}
 	ret = -1;
 	if (len >= v_len && inc * (stop - start) >= 0) {
+		if (inc > 0) {
+			ret = string_indexof(p, p1, start);
+			goto done;
+		}
 		for (i = start;; i += inc) {
 			if (!string_cmp(p, p1, i, 0, v_len)) {
 				ret = i;
@@ -44112,6 +46694,7 @@ static JSValue js_string_indexOf(JSContext *ctx, JSValueConst this_val,
 				break;
 		}
 	}
+done:
 	JS_FreeValue(ctx, str);
 	JS_FreeValue(ctx, v);
 	return JS_NewInt32(ctx, ret);
@@ -44128,7 +46711,7 @@ static int js_is_regexp(JSContext *ctx, JSValueConst obj);
 static JSValue js_string_includes(JSContext *ctx, JSValueConst this_val,
 				  int argc, JSValueConst *argv, int magic) {
 	JSValue str, v = JS_UNDEFINED;
-	int i, len, v_len, pos, start, stop, ret;
+	int len, v_len, pos, start, stop, ret;
 	JSString *p;
 	JSString *p1;
 
@@ -44168,14 +46751,10 @@ static JSValue js_string_includes(JSContext *ctx, JSValueConst this_val,
 		start = stop = pos;
 	}
 	if (start >= 0 && start <= stop) {
-		for (i = start;; i++) {
-			if (!string_cmp(p, p1, i, 0, v_len)) {
-				ret = 1;
-				break;
-			}
-			if (i == stop)
-				break;
-		}
+		if (magic == 0)
+			ret = string_indexof(p, p1, start) >= 0;
+		else
+			ret = !string_cmp(p, p1, start, 0, v_len);
 	}
 done:
 	JS_FreeValue(ctx, str);
@@ -44275,6 +46854,7 @@ static JSValue js_string___GetSubstitution(JSContext *ctx,
 	int i, j, j0, k, k1;
 	int c, c1;
 	StringBuffer b_s, *b = &b_s;
+	JSShortStringBuf sbuf1, sbuf2;
 	JSString *sp, *rp;
 
 	matched = argv[0];
@@ -44286,8 +46866,10 @@ static JSValue js_string___GetSubstitution(JSContext *ctx,
 	if (!JS_IsString(rep) || !JS_IsString(str))
 		return JS_ThrowTypeError(ctx, "not a string");
 
-	sp = JS_VALUE_GET_STRING(str);
-	rp = JS_VALUE_GET_STRING(rep);
+	/* 'rp' is only given to js_sub_string() for a strict substring, so
+	   it never escapes if it is a short string copy */
+	sp = js_get_string(&sbuf1, str);
+	rp = js_get_string(&sbuf2, rep);
 
 	string_buffer_init(ctx, b, 0);
 
@@ -47684,6 +50266,7 @@ static JSValue js_json_check(JSContext *ctx, JSONStringifyContext *jsc,
 			if (JS_IsFunction(ctx, val))
 				break;
 		case JS_TAG_STRING:
+		case JS_TAG_SHORT_STRING:
 		case JS_TAG_INT:
 		case JS_TAG_FLOAT64:
 		case JS_TAG_BOOL:
@@ -47872,6 +50455,7 @@ static int js_json_to_str(JSContext *ctx, JSONStringifyContext *jsc,
 concat_primitive:
 	switch (JS_VALUE_GET_NORM_TAG(val)) {
 		case JS_TAG_STRING:
+		case JS_TAG_SHORT_STRING:
 			val = JS_ToQuotedStringFree(ctx, val);
 			if (JS_IsException(val))
 				goto exception;
@@ -48003,6 +50587,8 @@ JSValue JS_JSONStringify(JSContext *ctx, JSValueConst obj,
 		if (JS_ToInt32Clamp(ctx, &n, space, 0, 10, 0))
 			goto exception;
 		jsc->gap = JS_NewStringLen(ctx, "          ", n);
+	} else if (JS_VALUE_GET_TAG(space) == JS_TAG_SHORT_STRING) {
+		jsc->gap = JS_DupValue(ctx, space);
 	} else if (JS_IsString(space)) {
 		JSString *p = JS_VALUE_GET_STRING(space);
 		jsc->gap = js_sub_string(ctx, p, 0, min_int(p->len, 10));
@@ -48081,8 +50667,6 @@ static JSValue js_reflect_apply(JSContext *ctx, JSValueConst this_val,
 static JSValue js_reflect_construct(JSContext *ctx, JSValueConst this_val,
 				    int argc, JSValueConst *argv) {
 	JSValueConst func, array_arg, new_target;
-	JSValue *tab, ret;
-	uint32_t len;
 
 	func = argv[0];
 	array_arg = argv[1];
@@ -48093,13 +50677,7 @@ static JSValue js_reflect_construct(JSContext *ctx, JSValueConst this_val,
 	} else {
 		new_target = func;
 	}
-	tab = build_arg_list(ctx, &len, array_arg);
-	if (!tab)
-		return JS_EXCEPTION;
-	ret = JS_CallConstructor2(ctx, func, new_target, len,
-				  (JSValueConst *) tab);
-	free_arg_list(ctx, tab, len);
-	return ret;
+	return js_apply_array(ctx, func, new_target, array_arg, TRUE);
 }
 
 static JSValue js_reflect_deleteProperty(JSContext *ctx, JSValueConst this_val,
@@ -49382,27 +51960,232 @@ static const JSCFunctionListEntry js_symbol_funcs[] = {
 
 /* Set/Map/WeakSet/WeakMap */
 
+/* The records of a Map/Set are stored in insertion order in a dense
+   array. A deleted record stays in place with a JS_UNINITIALIZED key
+   until the next compaction in map_hash_resize(). 'hash_table' is an
+   open addressing (linear probing) index containing the record index
+   + 1, 0 meaning an empty slot. The slots of the deleted records act
+   as tombstones. */
 typedef struct JSMapRecord {
-	int ref_count; /* used during enumeration to avoid freeing the record */
-	BOOL empty; /* TRUE if the record is deleted */
-	struct JSMapState *map;
-	struct JSMapRecord *next_weak_ref;
-	struct list_head link;
-	struct list_head hash_link;
-	JSValue key;
+	JSValue key; /* JS_UNINITIALIZED if the record is deleted */
 	JSValue value;
 } JSMapRecord;
 
+typedef enum {
+	JS_WEAK_REF_KIND_MAP, /* key of a WeakMap/WeakSet */
+	JS_WEAK_REF_KIND_WEAK_REF, /* target of a WeakRef */
+	JS_WEAK_REF_KIND_FIN_REG_TARGET, /* target of a registration */
+	JS_WEAK_REF_KIND_FIN_REG_TOKEN, /* unregister token */
+} JSWeakRefKindEnum;
+
+/* weak reference to an object. The weak references to a given object
+   are listed in its slot of rt->weak_ref_hash */
+typedef struct JSWeakRefRecord {
+	struct JSWeakRefRecord *next_weak_ref;
+	JSWeakRefKindEnum kind;
+	union {
+		void *ptr;
+		struct JSMapState *map;
+		struct JSWeakRefData *weak_ref;
+		struct JSFinRegEntry *fin_reg;
+	} u;
+	JSValue value; /* only used in reset_weak_ref() */
+} JSWeakRefRecord;
+
+typedef struct JSWeakRefSlot {
+	JSObject *obj; /* nullptr if the slot is empty */
+	JSWeakRefRecord *first_weak_ref;
+} JSWeakRefSlot;
+
+typedef struct JSWeakRefData {
+	JSValue target; /* weak reference, JS_UNDEFINED once collected */
+	/* TRUE if 'target' is also a strong reference kept until the end
+	   of the job (AddToKeptObjects) */
+	BOOL kept;
+	struct list_head kept_link; /* in rt->weak_ref_kept_list */
+} JSWeakRefData;
+
+typedef struct JSFinRegData {
+	JSContext *realm; /* context of the cleanup jobs */
+	JSValue cleanup_func;
+	struct list_head entries; /* list of JSFinRegEntry.link */
+	BOOL cleanup_pending; /* a cleanup job is enqueued */
+} JSFinRegData;
+
+/* FinalizationRegistry cell. It stays in the registry once its target
+   is collected, until the cleanup job removes it. */
+typedef struct JSFinRegEntry {
+	struct list_head link;
+	JSObject *fin_reg; /* the FinalizationRegistry object */
+	JSValue target; /* weak reference, JS_UNDEFINED once collected */
+	JSValue held_value;
+	JSValue token; /* weak reference or JS_UNDEFINED */
+} JSFinRegEntry;
+
+static inline uint32_t weak_ref_hash(JSObject *p, uint32_t size) {
+	return (uint32_t) (((uint64_t) (uintptr_t) p * 0x9e3779b97f4a7c15) >>
+			   32) & (size - 1);
+}
+
+/* return the slot of 'p' which must have weak references */
+static JSWeakRefSlot *weak_ref_find_slot(JSRuntime *rt, JSObject *p) {
+	uint32_t h, mask = rt->weak_ref_hash_size - 1;
+
+	h = weak_ref_hash(p, rt->weak_ref_hash_size);
+	while (rt->weak_ref_hash[h].obj != p)
+		h = (h + 1) & mask;
+	return &rt->weak_ref_hash[h];
+}
+
+static int weak_ref_hash_resize(JSRuntime *rt, uint32_t new_size) {
+	JSWeakRefSlot *new_hash, *e;
+	uint32_t i, h, mask = new_size - 1;
+
+	new_hash = js_mallocz_rt(rt, sizeof(new_hash[0]) * new_size);
+	if (!new_hash)
+		return -1;
+	for (i = 0; i < rt->weak_ref_hash_size; i++) {
+		e = &rt->weak_ref_hash[i];
+		if (e->obj) {
+			h = weak_ref_hash(e->obj, new_size);
+			while (new_hash[h].obj)
+				h = (h + 1) & mask;
+			new_hash[h] = *e;
+		}
+	}
+	js_free_rt(rt, rt->weak_ref_hash);
+	rt->weak_ref_hash = new_hash;
+	rt->weak_ref_hash_size = new_size;
+	return 0;
+}
+
+/* remove the slot 'e' by moving back the next entries of its
+   cluster (no tombstones) */
+static void weak_ref_remove_slot(JSRuntime *rt, JSWeakRefSlot *e) {
+	JSWeakRefSlot *tab = rt->weak_ref_hash;
+	uint32_t i, j, h, mask = rt->weak_ref_hash_size - 1;
+
+	e->obj->has_weak_ref = 0;
+	i = e - tab;
+	j = i;
+	for (;;) {
+		j = (j + 1) & mask;
+		if (!tab[j].obj)
+			break;
+		h = weak_ref_hash(tab[j].obj, rt->weak_ref_hash_size);
+		/* the entry stays if its home slot is in ]i, j] */
+		if (i <= j ? (h > i && h <= j) : (h > i || h <= j))
+			continue;
+		tab[i] = tab[j];
+		i = j;
+	}
+	tab[i].obj = nullptr;
+	tab[i].first_weak_ref = nullptr;
+	rt->weak_ref_count--;
+}
+
+/* shrink the table if it is mostly empty. It is not done when
+   removing slots to avoid resizing it back and forth when a set of
+   objects repeatedly gains and loses weak references. */
+static void weak_ref_hash_shrink(JSRuntime *rt) {
+	uint32_t new_size;
+
+	if (rt->weak_ref_count == 0) {
+		js_free_rt(rt, rt->weak_ref_hash);
+		rt->weak_ref_hash = nullptr;
+		rt->weak_ref_hash_size = 0;
+	} else if (rt->weak_ref_hash_size > 16 &&
+		   rt->weak_ref_count * 8 < rt->weak_ref_hash_size) {
+		new_size = rt->weak_ref_hash_size;
+		while (new_size > 16 && rt->weak_ref_count * 8 < new_size)
+			new_size /= 2;
+		/* the table is kept if the allocation fails */
+		weak_ref_hash_resize(rt, new_size);
+	}
+}
+
+/* Add a weak reference of kind 'kind' from 'holder' to the object
+   'p'. Return -1 if memory error. */
+static int add_weak_ref(JSContext *ctx, JSObject *p, JSWeakRefKindEnum kind,
+			void *holder) {
+	JSRuntime *rt = ctx->rt;
+	JSWeakRefRecord *wr;
+	JSWeakRefSlot *e;
+	uint32_t h, mask;
+
+	wr = js_malloc(ctx, sizeof(*wr));
+	if (!wr)
+		return -1;
+	if (p->has_weak_ref) {
+		e = weak_ref_find_slot(rt, p);
+	} else {
+		/* maximum load factor of 1/2 */
+		if (2 * (rt->weak_ref_count + 1) > rt->weak_ref_hash_size &&
+		    weak_ref_hash_resize(rt, max_int(
+				                 rt->weak_ref_hash_size * 2, 16))) {
+			js_free(ctx, wr);
+			JS_ThrowOutOfMemory(ctx);
+			return -1;
+		}
+		mask = rt->weak_ref_hash_size - 1;
+		h = weak_ref_hash(p, rt->weak_ref_hash_size);
+		while (rt->weak_ref_hash[h].obj)
+			h = (h + 1) & mask;
+		e = &rt->weak_ref_hash[h];
+		e->obj = p;
+		e->first_weak_ref = nullptr;
+		rt->weak_ref_count++;
+		p->has_weak_ref = 1;
+	}
+	wr->kind = kind;
+	wr->u.ptr = holder;
+	wr->next_weak_ref = e->first_weak_ref;
+	e->first_weak_ref = wr;
+	return 0;
+}
+
+/* Remove the weak reference of kind 'kind' from 'holder' to the
+   object 'p'. We don't use a doubly linked list to save space,
+   assuming a given object has few weak references to it */
+static void delete_weak_ref(JSRuntime *rt, JSObject *p, JSWeakRefKindEnum kind,
+			    void *holder) {
+	JSWeakRefRecord **pwr, *wr;
+	JSWeakRefSlot *e;
+
+	e = weak_ref_find_slot(rt, p);
+	pwr = &e->first_weak_ref;
+	for (;;) {
+		wr = *pwr;
+		assert(wr != nullptr);
+		if (wr->u.ptr == holder && wr->kind == kind)
+			break;
+		pwr = &wr->next_weak_ref;
+	}
+	*pwr = wr->next_weak_ref;
+	js_free_rt(rt, wr);
+	if (!e->first_weak_ref)
+		weak_ref_remove_slot(rt, e);
+}
+
 typedef struct JSMapState {
 	BOOL is_weak; /* TRUE if WeakSet/WeakMap */
-	struct list_head records; /* list of JSMapRecord.link */
-	uint32_t record_count;
-	struct list_head *hash_table;
-	uint32_t hash_size; /* must be a power of two */
-	uint32_t record_count_threshold; /* count at which a hash table
-                                        resize is needed */
+	uint32_t record_count; /* number of live records */
+	uint32_t records_count; /* number of used records, including the
+                               deleted ones */
+	uint32_t records_size; /* allocated records */
+	JSMapRecord *records;
+	uint32_t *hash_table; /* 2 * records_size entries */
+	int hash_bits; /* log2 of the hash table size */
+	struct list_head iterators; /* list of JSMapIteratorData.link */
 } JSMapState;
 
+typedef struct JSMapIteratorData {
+	JSValue obj;
+	JSIteratorKindEnum kind;
+	struct list_head link; /* in JSMapState.iterators */
+	uint32_t cur_pos; /* index of the next record */
+} JSMapIteratorData;
+
 #define MAGIC_SET (1 << 0)
 #define MAGIC_WEAK (1 << 1)
 
@@ -49422,15 +52205,9 @@ static JSValue js_map_constructor(JSContext *ctx, JSValueConst new_target,
 	s = js_mallocz(ctx, sizeof(*s));
 	if (!s)
 		goto fail;
-	init_list_head(&s->records);
+	init_list_head(&s->iterators);
 	s->is_weak = is_weak;
 	JS_SetOpaque(obj, s);
-	s->hash_size = 1;
-	s->hash_table = js_malloc(ctx, sizeof(s->hash_table[0]) * s->hash_size);
-	if (!s->hash_table)
-		goto fail;
-	init_list_head(&s->hash_table[0]);
-	s->record_count_threshold = 4;
 
 	arr = JS_UNDEFINED;
 	if (argc > 0)
@@ -49529,8 +52306,29 @@ static JSValueConst map_normalize_key(JSContext *ctx, JSValueConst key) {
 	return key;
 }
 
+/* Hash a BigInt consistently with SameValueZero. The low zero limbs
+   are ignored because the mantissa is not necessarily trimmed. */
+static uint32_t map_hash_bigint(const bf_t *a) {
+	uint32_t h;
+	limb_t i, v;
+
+	if (a->expn == BF_EXP_ZERO)
+		return 0;
+	h = ((uint32_t) a->expn << 1) | a->sign;
+	for (i = 0; i < a->len && a->tab[i] == 0; i++)
+		continue;
+	for (; i < a->len; i++) {
+		v = a->tab[i];
+#if LIMB_BITS == 64
+		h = (h ^ (uint32_t) (v >> 32)) * 0x01000193;
+#endif
+		h = (h ^ (uint32_t) v) * 0x01000193;
+	}
+	return h;
+}
+
 /* XXX: better hash ? */
-static uint32_t map_hash_key(JSContext *ctx, JSValueConst key) {
+static uint32_t map_hash_key(JSValueConst key) {
 	uint32_t tag = JS_VALUE_GET_NORM_TAG(key);
 	uint32_t h;
 	double d;
@@ -49540,8 +52338,13 @@ static uint32_t map_hash_key(JSContext *ctx, JSValueConst key) {
 		case JS_TAG_BOOL:
 			h = JS_VALUE_GET_INT(key);
 			break;
+		case JS_TAG_SHORT_STRING:
+			/* same hash as the JS_TAG_STRING form */
+			h = js_short_string_hash(key);
+			tag = JS_TAG_STRING;
+			break;
 		case JS_TAG_STRING:
-			h = hash_string(JS_VALUE_GET_STRING(key), 0);
+			h = js_string_hash(JS_VALUE_GET_STRING(key));
 			break;
 		case JS_TAG_OBJECT:
 		case JS_TAG_SYMBOL:
@@ -49559,166 +52362,342 @@ static uint32_t map_hash_key(JSContext *ctx, JSValueConst key) {
 			u.d = d;
 			h = (u.u32[0] ^ u.u32[1]) * 3163;
 			return h ^= JS_TAG_FLOAT64;
+		case JS_TAG_BIG_INT: {
+			JSBigFloat *p = JS_VALUE_GET_PTR(key);
+			h = map_hash_bigint(&p->num);
+		}
+		break;
 		default:
-			h = 0; /* XXX: bignum support */
+			h = 0; /* XXX: BigFloat and BigDecimal support */
 			break;
 	}
 	h ^= tag;
 	return h;
 }
 
+/* The low bits of map_hash_key() are poorly distributed (e.g. they
+   are zero for small integers), so the slot is taken from the high
+   bits of a multiplicative hash. */
+static inline uint32_t map_hash_slot(uint32_t h, int hash_bits) {
+	return (h * 0x9e3779b1) >> (32 - hash_bits);
+}
+
+static inline BOOL map_record_is_deleted(const JSMapRecord *mr) {
+	return JS_VALUE_GET_TAG(mr->key) == JS_TAG_UNINITIALIZED;
+}
+
+/* SameValueZero with fast paths for the common key types */
+static inline BOOL map_key_equal(JSContext *ctx, JSValueConst key1,
+				 JSValueConst key2) {
+	uint32_t tag = JS_VALUE_GET_TAG(key1);
+
+	if (tag == JS_VALUE_GET_TAG(key2)) {
+		switch (tag) {
+			case JS_TAG_INT:
+			case JS_TAG_BOOL:
+				return JS_VALUE_GET_INT(key1) ==
+				       JS_VALUE_GET_INT(key2);
+			case JS_TAG_OBJECT:
+			case JS_TAG_SYMBOL:
+				return JS_VALUE_GET_PTR(key1) ==
+				       JS_VALUE_GET_PTR(key2);
+			case JS_TAG_STRING:
+				return js_string_eq(JS_VALUE_GET_STRING(key1),
+						    JS_VALUE_GET_STRING(key2));
+			case JS_TAG_SHORT_STRING:
+				return js_short_string_bits(key1) ==
+				       js_short_string_bits(key2);
+			default:
+				break;
+		}
+	}
+	if (tag == JS_TAG_UNINITIALIZED)
+		return FALSE; /* deleted record */
+	return js_same_value_zero(ctx, key1, key2);
+}
+
 static JSMapRecord *map_find_record(JSContext *ctx, JSMapState *s,
 				    JSValueConst key) {
-	struct list_head *el;
+	uint32_t h, idx, mask;
 	JSMapRecord *mr;
-	uint32_t h;
-	h = map_hash_key(ctx, key) & (s->hash_size - 1);
-	list_for_each(el, &s->hash_table[h]) {
-		mr = list_entry(el, JSMapRecord, hash_link);
-		if (js_same_value_zero(ctx, mr->key, key))
+
+	if (!s->hash_table)
+		return nullptr;
+	mask = ((uint32_t) 1 << s->hash_bits) - 1;
+	h = map_hash_slot(map_hash_key(key), s->hash_bits);
+	for (;;) {
+		idx = s->hash_table[h];
+		if (idx == 0)
+			return nullptr;
+		mr = &s->records[idx - 1];
+		if (map_key_equal(ctx, mr->key, key))
 			return mr;
+		h = (h + 1) & mask;
 	}
-	return nullptr;
 }
 
-static void map_hash_resize(JSContext *ctx, JSMapState *s) {
-	uint32_t new_hash_size, i, h;
-	size_t slack;
-	struct list_head *new_hash_table, *el;
+/* same as map_find_record() for a WeakMap/WeakSet key. Does not need
+   a context so that it can be used when the key object is freed. */
+static JSMapRecord *map_find_weak_record(JSMapState *s, JSObject *p) {
+	uint32_t h, idx, mask;
 	JSMapRecord *mr;
+	JSValue key = JS_MKPTR(JS_TAG_OBJECT, p);
 
-	/* XXX: no reporting of memory allocation failure */
-	if (s->hash_size == 1)
-		new_hash_size = 4;
-	else
-		new_hash_size = s->hash_size * 2;
-	new_hash_table = js_realloc2(ctx, s->hash_table,
-				     sizeof(new_hash_table[0]) *
-				     new_hash_size,
-				     &slack);
-	if (!new_hash_table)
-		return;
-	new_hash_size += slack / sizeof(*new_hash_table);
+	mask = ((uint32_t) 1 << s->hash_bits) - 1;
+	h = map_hash_slot(map_hash_key(key), s->hash_bits);
+	for (;;) {
+		idx = s->hash_table[h];
+		if (idx == 0)
+			return nullptr;
+		mr = &s->records[idx - 1];
+		if (JS_VALUE_GET_TAG(mr->key) == JS_TAG_OBJECT &&
+		    JS_VALUE_GET_OBJ(mr->key) == p)
+			return mr;
+		h = (h + 1) & mask;
+	}
+}
 
-	for (i = 0; i < new_hash_size; i++)
-		init_list_head(&new_hash_table[i]);
+/* Remove the deleted records, resize the record array so that it is
+   at most half full and rebuild the hash table. The position of the
+   live iterators is updated. Return -1 if memory allocation error. */
+static int map_hash_resize(JSContext *ctx, JSMapState *s) {
+	uint32_t new_size, i, j, h, mask, *new_hash_table;
+	int hash_bits;
+	JSMapRecord *new_records, *mr;
+	struct list_head *el;
+	JSMapIteratorData *it;
 
-	list_for_each(el, &s->records) {
-		mr = list_entry(el, JSMapRecord, link);
-		if (!mr->empty) {
-			h = map_hash_key(ctx, mr->key) & (new_hash_size - 1);
-			list_add_tail(&mr->hash_link, &new_hash_table[h]);
+	new_size = 4;
+	while (new_size < s->record_count * 2)
+		new_size *= 2;
+	hash_bits = 1;
+	while (((uint32_t) 1 << hash_bits) < new_size * 2)
+		hash_bits++;
+	new_hash_table = js_mallocz(ctx, sizeof(new_hash_table[0]) << hash_bits);
+	if (!new_hash_table)
+		return -1;
+	new_records = js_malloc(ctx, sizeof(new_records[0]) * new_size);
+	if (!new_records) {
+		js_free(ctx, new_hash_table);
+		return -1;
+	}
+
+	mask = ((uint32_t) 1 << hash_bits) - 1;
+	j = 0;
+	for (i = 0; i < s->records_count; i++) {
+		mr = &s->records[i];
+		if (!map_record_is_deleted(mr)) {
+			new_records[j] = *mr;
+			h = map_hash_slot(map_hash_key(mr->key), hash_bits);
+			while (new_hash_table[h] != 0)
+				h = (h + 1) & mask;
+			new_hash_table[h] = j + 1;
+			j++;
 		}
+		/* the old records are no longer used: remember the new
+		position for the iterators */
+		mr->key = JS_NewInt32(ctx, j);
 	}
+	assert(j == s->record_count);
+	list_for_each(el, &s->iterators) {
+		it = list_entry(el, JSMapIteratorData, link);
+		if (it->cur_pos > 0)
+			it->cur_pos = JS_VALUE_GET_INT(
+				s->records[it->cur_pos - 1].key);
+	}
+
+	js_free(ctx, s->records);
+	js_free(ctx, s->hash_table);
+	s->records = new_records;
+	s->records_count = j;
+	s->records_size = new_size;
 	s->hash_table = new_hash_table;
-	s->hash_size = new_hash_size;
-	s->record_count_threshold = new_hash_size * 2;
+	s->hash_bits = hash_bits;
+	return 0;
 }
 
 static JSMapRecord *map_add_record(JSContext *ctx, JSMapState *s,
 				   JSValueConst key) {
-	uint32_t h;
+	uint32_t h, mask;
 	JSMapRecord *mr;
 
-	mr = js_malloc(ctx, sizeof(*mr));
-	if (!mr)
-		return nullptr;
-	mr->ref_count = 1;
-	mr->map = s;
-	mr->empty = FALSE;
+	if (s->records_count >= s->records_size) {
+		if (map_hash_resize(ctx, s))
+			return nullptr;
+	}
 	if (s->is_weak) {
-		JSObject *p = JS_VALUE_GET_OBJ(key);
-		/* Add the weak reference */
-		mr->next_weak_ref = p->first_weak_ref;
-		p->first_weak_ref = mr;
+		if (add_weak_ref(ctx, JS_VALUE_GET_OBJ(key),
+				 JS_WEAK_REF_KIND_MAP, s))
+			return nullptr;
 	} else {
 		JS_DupValue(ctx, key);
 	}
+	mr = &s->records[s->records_count];
 	mr->key = (JSValue) key;
-	h = map_hash_key(ctx, key) & (s->hash_size - 1);
-	list_add_tail(&mr->hash_link, &s->hash_table[h]);
-	list_add_tail(&mr->link, &s->records);
+	mr->value = JS_UNDEFINED;
+	mask = ((uint32_t) 1 << s->hash_bits) - 1;
+	h = map_hash_slot(map_hash_key(key), s->hash_bits);
+	while (s->hash_table[h] != 0)
+		h = (h + 1) & mask;
+	s->hash_table[h] = ++s->records_count;
 	s->record_count++;
-	if (s->record_count >= s->record_count_threshold) {
-		map_hash_resize(ctx, s);
-	}
 	return mr;
 }
 
-/* Remove the weak reference from the object weak
-   reference list. we don't use a doubly linked list to
-   save space, assuming a given object has few weak
-       references to it */
-static void delete_weak_ref(JSRuntime *rt, JSMapRecord *mr) {
-	JSMapRecord **pmr, *mr1;
-	JSObject *p;
-
-	p = JS_VALUE_GET_OBJ(mr->key);
-	pmr = &p->first_weak_ref;
-	for (;;) {
-		mr1 = *pmr;
-		assert(mr1 != nullptr);
-		if (mr1 == mr)
-			break;
-		pmr = &mr1->next_weak_ref;
-	}
-	*pmr = mr1->next_weak_ref;
-}
-
 static void map_delete_record(JSRuntime *rt, JSMapState *s, JSMapRecord *mr) {
-	if (mr->empty)
+	JSValue key, value;
+
+	if (map_record_is_deleted(mr))
 		return;
-	list_del(&mr->hash_link);
+	/* the record is marked as deleted before freeing its contents
+	because a finalizer may modify the map */
+	key = mr->key;
+	value = mr->value;
+	mr->key = JS_UNINITIALIZED;
+	mr->value = JS_UNDEFINED;
+	s->record_count--;
 	if (s->is_weak) {
-		delete_weak_ref(rt, mr);
+		delete_weak_ref(rt, JS_VALUE_GET_OBJ(key),
+				JS_WEAK_REF_KIND_MAP, s);
 	} else {
-		JS_FreeValueRT(rt, mr->key);
+		JS_FreeValueRT(rt, key);
 	}
-	JS_FreeValueRT(rt, mr->value);
-	if (--mr->ref_count == 0) {
-		list_del(&mr->link);
-		js_free_rt(rt, mr);
-	} else {
-		/* keep a zombie record for iterators */
-		mr->empty = TRUE;
-		mr->key = JS_UNDEFINED;
-		mr->value = JS_UNDEFINED;
+	JS_FreeValueRT(rt, value);
+}
+
+/* FALSE if the FinalizationRegistry object 'p' is being freed, either
+   directly or as part of a garbage cycle */
+static BOOL fin_reg_is_live(JSRuntime *rt, JSObject *p) {
+	return !p->free_mark && !(rt->gc_phase == JS_GC_PHASE_REMOVE_CYCLES &&
+				  p->header.mark);
+}
+
+/* call the cleanup function for the cells of the FinalizationRegistry
+   argv[0] whose target was collected */
+static JSValue js_fin_reg_cleanup_job(JSContext *ctx, int argc,
+				      JSValueConst *argv) {
+	JSRuntime *rt = ctx->rt;
+	JSFinRegData *fd = JS_VALUE_GET_OBJ(argv[0])->u.fin_reg_data;
+	struct list_head *el;
+	JSFinRegEntry *fe;
+	JSValue held_value, ret;
+
+	fd->cleanup_pending = FALSE;
+	for (;;) {
+		/* the cleanup function may modify the list */
+		fe = nullptr;
+		list_for_each(el, &fd->entries) {
+			fe = list_entry(el, JSFinRegEntry, link);
+			if (JS_IsUndefined(fe->target))
+				break;
+			fe = nullptr;
+		}
+		if (!fe)
+			break;
+		list_del(&fe->link);
+		if (JS_IsObject(fe->token)) {
+			delete_weak_ref(rt, JS_VALUE_GET_OBJ(fe->token),
+					JS_WEAK_REF_KIND_FIN_REG_TOKEN, fe);
+		}
+		held_value = fe->held_value;
+		js_free_rt(rt, fe);
+		ret = JS_Call(ctx, fd->cleanup_func, JS_UNDEFINED, 1,
+			      (JSValueConst *) &held_value);
+		JS_FreeValue(ctx, held_value);
+		if (JS_IsException(ret)) {
+			/* the remaining cells are cleaned up by the next
+			   job */
+			fin_reg_enqueue_cleanup(rt, JS_VALUE_GET_OBJ(argv[0]));
+			return ret;
+		}
+		JS_FreeValue(ctx, ret);
 	}
-	s->record_count--;
+	return JS_UNDEFINED;
 }
 
-static void map_decref_record(JSRuntime *rt, JSMapRecord *mr) {
-	if (--mr->ref_count == 0) {
-		/* the record can be safely removed */
-		assert(mr->empty);
-		list_del(&mr->link);
-		js_free_rt(rt, mr);
+/* enqueue the cleanup job of the FinalizationRegistry 'p' if it has
+   collected cells */
+static void fin_reg_enqueue_cleanup(JSRuntime *rt, JSObject *p) {
+	JSFinRegData *fd = p->u.fin_reg_data;
+	struct list_head *el;
+	JSValueConst arg;
+
+	if (fd->cleanup_pending)
+		return;
+	list_for_each(el, &fd->entries) {
+		if (JS_IsUndefined(list_entry(el, JSFinRegEntry,
+					      link)->target)) {
+			arg = JS_MKPTR(JS_TAG_OBJECT, p);
+			/* XXX: the cleanup is delayed until the next
+			   collected target if memory error */
+			if (JS_EnqueueJob(fd->realm, js_fin_reg_cleanup_job,
+					  1, &arg)) {
+				JS_FreeValueRT(rt, JS_GetException(fd->realm));
+			} else {
+				fd->cleanup_pending = TRUE;
+			}
+			break;
+		}
 	}
 }
 
+/* called when the object 'p' is freed */
 static void reset_weak_ref(JSRuntime *rt, JSObject *p) {
-	JSMapRecord *mr, *mr_next;
+	JSWeakRefRecord *first_weak_ref, *wr, *wr_next;
+	JSWeakRefSlot *e;
+	JSMapRecord *mr;
 	JSMapState *s;
-
-	/* first pass to remove the records from the WeakMap/WeakSet
-	lists */
-	for (mr = p->first_weak_ref; mr != nullptr; mr = mr->next_weak_ref) {
-		s = mr->map;
-		assert(s->is_weak);
-		assert(!mr->empty); /* no iterator on WeakMap/WeakSet */
-		list_del(&mr->hash_link);
-		list_del(&mr->link);
+	JSFinRegEntry *fe;
+
+	e = weak_ref_find_slot(rt, p);
+	first_weak_ref = e->first_weak_ref;
+	weak_ref_remove_slot(rt, e);
+
+	/* first pass to detach the weak references from their holders
+	without freeing any value, so that no other weak reference
+	list is modified */
+	for (wr = first_weak_ref; wr != nullptr; wr = wr->next_weak_ref) {
+		switch (wr->kind) {
+			case JS_WEAK_REF_KIND_MAP:
+				s = wr->u.map;
+				assert(s->is_weak);
+				mr = map_find_weak_record(s, p);
+				assert(mr != nullptr);
+				wr->value = mr->value;
+				mr->key = JS_UNINITIALIZED;
+				mr->value = JS_UNDEFINED;
+				s->record_count--;
+				break;
+			case JS_WEAK_REF_KIND_WEAK_REF:
+				wr->u.weak_ref->target = JS_UNDEFINED;
+				break;
+			case JS_WEAK_REF_KIND_FIN_REG_TARGET:
+				/* the cell stays in the registry so that
+				   unregister() can still remove it */
+				fe = wr->u.fin_reg;
+				fe->target = JS_UNDEFINED;
+				/* no cleanup if the registry is being freed */
+				if (fin_reg_is_live(rt, fe->fin_reg))
+					fin_reg_enqueue_cleanup(rt, fe->fin_reg);
+				break;
+			case JS_WEAK_REF_KIND_FIN_REG_TOKEN:
+				wr->u.fin_reg->token = JS_UNDEFINED;
+				break;
+		}
 	}
 
-	/* second pass to free the values to avoid modifying the weak
-	reference list while traversing it. */
-	for (mr = p->first_weak_ref; mr != nullptr; mr = mr_next) {
-		mr_next = mr->next_weak_ref;
-		JS_FreeValueRT(rt, mr->value);
-		js_free_rt(rt, mr);
+	/* second pass to free the values */
+	for (wr = first_weak_ref; wr != nullptr; wr = wr_next) {
+		wr_next = wr->next_weak_ref;
+		switch (wr->kind) {
+			case JS_WEAK_REF_KIND_MAP:
+				JS_FreeValueRT(rt, wr->value);
+				break;
+			default:
+				break;
+		}
+		js_free_rt(rt, wr);
 	}
-
-	p->first_weak_ref = nullptr; /* fail safe */
 }
 
 static JSValue js_map_set(JSContext *ctx, JSValueConst this_val,
@@ -49726,6 +52705,7 @@ static JSValue js_map_set(JSContext *ctx, JSValueConst this_val,
 	JSMapState *s = JS_GetOpaque2(ctx, this_val, JS_CLASS_MAP + magic);
 	JSMapRecord *mr;
 	JSValueConst key, value;
+	JSValue old_value;
 
 	if (!s)
 		return JS_EXCEPTION;
@@ -49738,13 +52718,15 @@ static JSValue js_map_set(JSContext *ctx, JSValueConst this_val,
 		value = argv[1];
 	mr = map_find_record(ctx, s, key);
 	if (mr) {
-		JS_FreeValue(ctx, mr->value);
+		old_value = mr->value;
+		mr->value = JS_DupValue(ctx, value);
+		JS_FreeValue(ctx, old_value);
 	} else {
 		mr = map_add_record(ctx, s, key);
 		if (!mr)
 			return JS_EXCEPTION;
+		mr->value = JS_DupValue(ctx, value);
 	}
-	mr->value = JS_DupValue(ctx, value);
 	return JS_DupValue(ctx, this_val);
 }
 
@@ -49796,15 +52778,26 @@ static JSValue js_map_delete(JSContext *ctx, JSValueConst this_val,
 static JSValue js_map_clear(JSContext *ctx, JSValueConst this_val,
 			    int argc, JSValueConst *argv, int magic) {
 	JSMapState *s = JS_GetOpaque2(ctx, this_val, JS_CLASS_MAP + magic);
-	struct list_head *el, *el1;
-	JSMapRecord *mr;
+	struct list_head *el;
+	JSMapIteratorData *it;
+	uint32_t i;
 
 	if (!s)
 		return JS_EXCEPTION;
-	list_for_each_safe(el, el1, &s->records) {
-		mr = list_entry(el, JSMapRecord, link);
-		map_delete_record(ctx->rt, s, mr);
-	}
+	for (i = 0; i < s->records_count; i++)
+		map_delete_record(ctx->rt, s, &s->records[i]);
+	/* the live iterators continue with the records added later */
+	list_for_each(el, &s->iterators) {
+		it = list_entry(el, JSMapIteratorData, link);
+		it->cur_pos = 0;
+	}
+	js_free(ctx, s->records);
+	js_free(ctx, s->hash_table);
+	s->records = nullptr;
+	s->hash_table = nullptr;
+	s->records_count = 0;
+	s->records_size = 0;
+	s->hash_bits = 0;
 	return JS_UNDEFINED;
 }
 
@@ -49821,7 +52814,7 @@ static JSValue js_map_forEach(JSContext *ctx, JSValueConst this_val,
 	JSMapState *s = JS_GetOpaque2(ctx, this_val, JS_CLASS_MAP + magic);
 	JSValueConst func, this_arg;
 	JSValue ret, args[3];
-	struct list_head *el;
+	JSMapIteratorData it_s, *it = &it_s;
 	JSMapRecord *mr;
 
 	if (!s)
@@ -49833,34 +52826,32 @@ static JSValue js_map_forEach(JSContext *ctx, JSValueConst this_val,
 		this_arg = JS_UNDEFINED;
 	if (check_function(ctx, func))
 		return JS_EXCEPTION;
-	/* Note: the list can be modified while traversing it, but the
-	current element is locked */
-	el = s->records.next;
-	while (el != &s->records) {
-		mr = list_entry(el, JSMapRecord, link);
-		if (!mr->empty) {
-			mr->ref_count++;
-			/* must duplicate in case the record is deleted */
-			args[1] = JS_DupValue(ctx, mr->key);
-			if (magic)
-				args[0] = args[1];
-			else
-				args[0] = JS_DupValue(ctx, mr->value);
-			args[2] = (JSValue) this_val;
-			ret = JS_Call(ctx, func, this_arg, 3,
-				      (JSValueConst *) args);
-			JS_FreeValue(ctx, args[0]);
-			if (!magic)
-				JS_FreeValue(ctx, args[1]);
-			el = el->next;
-			map_decref_record(ctx->rt, mr);
-			if (JS_IsException(ret))
-				return ret;
-			JS_FreeValue(ctx, ret);
-		} else {
-			el = el->next;
+	/* Note: the map can be modified while traversing it, so the
+	position is kept in an iterator updated by map_hash_resize() */
+	it->cur_pos = 0;
+	list_add_tail(&it->link, &s->iterators);
+	while (it->cur_pos < s->records_count) {
+		mr = &s->records[it->cur_pos++];
+		if (map_record_is_deleted(mr))
+			continue;
+		/* must duplicate in case the record is deleted */
+		args[1] = JS_DupValue(ctx, mr->key);
+		if (magic)
+			args[0] = args[1];
+		else
+			args[0] = JS_DupValue(ctx, mr->value);
+		args[2] = (JSValue) this_val;
+		ret = JS_Call(ctx, func, this_arg, 3, (JSValueConst *) args);
+		JS_FreeValue(ctx, args[0]);
+		if (!magic)
+			JS_FreeValue(ctx, args[1]);
+		if (JS_IsException(ret)) {
+			list_del(&it->link);
+			return ret;
 		}
+		JS_FreeValue(ctx, ret);
 	}
+	list_del(&it->link);
 	return JS_UNDEFINED;
 }
 
@@ -49988,23 +52979,35 @@ static void js_map_finalizer(JSRuntime *rt, JSValue val) {
 	JSMapState *s;
 	struct list_head *el, *el1;
 	JSMapRecord *mr;
+	JSValue key, value;
+	uint32_t i;
 
 	p = JS_VALUE_GET_OBJ(val);
 	s = p->u.map_state;
 	if (s) {
-		/* if the object is deleted we are sure that no iterator is
-		using it */
-		list_for_each_safe(el, el1, &s->records) {
-			mr = list_entry(el, JSMapRecord, link);
-			if (!mr->empty) {
+		/* During the GC sweep phase the Map finalizer may be
+		called before the Map iterator finalizer */
+		list_for_each_safe(el, el1, &s->iterators) {
+			init_list_head(el);
+		}
+		for (i = 0; i < s->records_count; i++) {
+			mr = &s->records[i];
+			if (!map_record_is_deleted(mr)) {
+				key = mr->key;
+				value = mr->value;
+				mr->key = JS_UNINITIALIZED;
+				mr->value = JS_UNDEFINED;
 				if (s->is_weak)
-					delete_weak_ref(rt, mr);
+					delete_weak_ref(rt,
+							JS_VALUE_GET_OBJ(key),
+							JS_WEAK_REF_KIND_MAP,
+							s);
 				else
-					JS_FreeValueRT(rt, mr->key);
-				JS_FreeValueRT(rt, mr->value);
+					JS_FreeValueRT(rt, key);
+				JS_FreeValueRT(rt, value);
 			}
-			js_free_rt(rt, mr);
 		}
+		js_free_rt(rt, s->records);
 		js_free_rt(rt, s->hash_table);
 		js_free_rt(rt, s);
 	}
@@ -50014,13 +53017,15 @@ static void js_map_mark(JSRuntime *rt, JSValueConst val,
 			JS_MarkFunc *mark_func) {
 	JSObject *p = JS_VALUE_GET_OBJ(val);
 	JSMapState *s;
-	struct list_head *el;
 	JSMapRecord *mr;
+	uint32_t i;
 
 	s = p->u.map_state;
 	if (s) {
-		list_for_each(el, &s->records) {
-			mr = list_entry(el, JSMapRecord, link);
+		for (i = 0; i < s->records_count; i++) {
+			mr = &s->records[i];
+			if (map_record_is_deleted(mr))
+				continue;
 			if (!s->is_weak)
 				JS_MarkValue(rt, mr->key, mark_func);
 			JS_MarkValue(rt, mr->value, mark_func);
@@ -50030,12 +53035,6 @@ static void js_map_mark(JSRuntime *rt, JSValueConst val,
 
 /* Map Iterator */
 
-typedef struct JSMapIteratorData {
-	JSValue obj;
-	JSIteratorKindEnum kind;
-	JSMapRecord *cur_record;
-} JSMapIteratorData;
-
 static void js_map_iterator_finalizer(JSRuntime *rt, JSValue val) {
 	JSObject *p;
 	JSMapIteratorData *it;
@@ -50043,11 +53042,10 @@ static void js_map_iterator_finalizer(JSRuntime *rt, JSValue val) {
 	p = JS_VALUE_GET_OBJ(val);
 	it = p->u.map_iterator_data;
 	if (it) {
-		/* During the GC sweep phase the Map finalizer may be
-		called before the Map iterator finalizer */
-		if (JS_IsLiveObject(rt, it->obj) && it->cur_record) {
-			map_decref_record(rt, it->cur_record);
-		}
+		/* the iterator is no longer linked to the map once the
+		enumeration is finished */
+		if (!JS_IsUndefined(it->obj))
+			list_del(&it->link);
 		JS_FreeValueRT(rt, it->obj);
 		js_free_rt(rt, it);
 	}
@@ -50059,7 +53057,7 @@ static void js_map_iterator_mark(JSRuntime *rt, JSValueConst val,
 	JSMapIteratorData *it;
 	it = p->u.map_iterator_data;
 	if (it) {
-		/* the record is already marked by the object */
+		/* the records are marked by the object */
 		JS_MarkValue(rt, it->obj, mark_func);
 	}
 }
@@ -50087,7 +53085,8 @@ static JSValue js_create_map_iterator(JSContext *ctx, JSValueConst this_val,
 	}
 	it->obj = JS_DupValue(ctx, this_val);
 	it->kind = kind;
-	it->cur_record = nullptr;
+	it->cur_pos = 0;
+	list_add_tail(&it->link, &s->iterators);
 	JS_SetOpaque(enum_obj, it);
 	return enum_obj;
 fail:
@@ -50100,7 +53099,6 @@ static JSValue js_map_iterator_next(JSContext *ctx, JSValueConst this_val,
 	JSMapIteratorData *it;
 	JSMapState *s;
 	JSMapRecord *mr;
-	struct list_head *el;
 
 	it = JS_GetOpaque2(ctx, this_val, JS_CLASS_MAP_ITERATOR + magic);
 	if (!it) {
@@ -50111,18 +53109,10 @@ static JSValue js_map_iterator_next(JSContext *ctx, JSValueConst this_val,
 		goto done;
 	s = JS_GetOpaque(it->obj, JS_CLASS_MAP + magic);
 	assert(s != nullptr);
-	if (!it->cur_record) {
-		el = s->records.next;
-	} else {
-		mr = it->cur_record;
-		el = mr->link.next;
-		map_decref_record(ctx->rt, mr);
-		/* the record can be freed here */
-	}
 	for (;;) {
-		if (el == &s->records) {
+		if (it->cur_pos >= s->records_count) {
 			/* no more record  */
-			it->cur_record = nullptr;
+			list_del(&it->link);
 			JS_FreeValue(ctx, it->obj);
 			it->obj = JS_UNDEFINED;
 		done:
@@ -50130,16 +53120,11 @@ static JSValue js_map_iterator_next(JSContext *ctx, JSValueConst this_val,
 			*pdone = TRUE;
 			return JS_UNDEFINED;
 		}
-		mr = list_entry(el, JSMapRecord, link);
-		if (!mr->empty)
+		mr = &s->records[it->cur_pos++];
+		if (!map_record_is_deleted(mr))
 			break;
-		/* get the next record */
-		el = mr->link.next;
 	}
 
-	/* lock the record so that it won't be freed */
-	mr->ref_count++;
-	it->cur_record = mr;
 	*pdone = FALSE;
 
 	if (it->kind == JS_ITERATOR_KIND_KEY) {
@@ -50245,6 +53230,287 @@ static const uint8_t js_map_proto_funcs_count[6] = {
 	countof(js_set_iterator_proto_funcs),
 };
 
+/* WeakRef */
+
+/* AddToKeptObjects(): the target is kept alive until the end of the
+   current job */
+static void js_weak_ref_keep(JSRuntime *rt, JSWeakRefData *wrd) {
+	if (!wrd->kept) {
+		wrd->kept = TRUE;
+		JS_DupValueRT(rt, wrd->target);
+		list_add_tail(&wrd->kept_link, &rt->weak_ref_kept_list);
+	}
+}
+
+/* ClearKeptObjects() */
+static void js_weak_ref_clear_kept(JSRuntime *rt) {
+	JSWeakRefData *wrd;
+
+	while (!list_empty(&rt->weak_ref_kept_list)) {
+		wrd = list_entry(rt->weak_ref_kept_list.next, JSWeakRefData,
+				 kept_link);
+		list_del(&wrd->kept_link);
+		wrd->kept = FALSE;
+		JS_FreeValueRT(rt, wrd->target);
+	}
+}
+
+static void js_weak_ref_finalizer(JSRuntime *rt, JSValue val) {
+	JSObject *p = JS_VALUE_GET_OBJ(val);
+	JSWeakRefData *wrd = p->u.weak_ref_data;
+
+	if (wrd) {
+		/* the target is undefined if it was freed in the same
+		cycle */
+		if (JS_IsObject(wrd->target)) {
+			delete_weak_ref(rt, JS_VALUE_GET_OBJ(wrd->target),
+					JS_WEAK_REF_KIND_WEAK_REF, wrd);
+		}
+		if (wrd->kept) {
+			list_del(&wrd->kept_link);
+			JS_FreeValueRT(rt, wrd->target);
+		}
+		js_free_rt(rt, wrd);
+	}
+}
+
+static void js_weak_ref_mark(JSRuntime *rt, JSValueConst val,
+			     JS_MarkFunc *mark_func) {
+	JSObject *p = JS_VALUE_GET_OBJ(val);
+	JSWeakRefData *wrd = p->u.weak_ref_data;
+
+	if (wrd && wrd->kept)
+		JS_MarkValue(rt, wrd->target, mark_func);
+}
+
+static JSValue js_weak_ref_constructor(JSContext *ctx,
+				       JSValueConst new_target,
+				       int argc, JSValueConst *argv) {
+	JSValueConst target = argv[0];
+	JSWeakRefData *wrd;
+	JSValue obj;
+
+	if (!JS_IsObject(target))
+		return JS_ThrowTypeErrorNotAnObject(ctx);
+	obj = js_create_from_ctor(ctx, new_target, JS_CLASS_WEAK_REF);
+	if (JS_IsException(obj))
+		return JS_EXCEPTION;
+	wrd = js_mallocz(ctx, sizeof(*wrd));
+	if (!wrd)
+		goto fail;
+	wrd->target = (JSValue) target;
+	if (add_weak_ref(ctx, JS_VALUE_GET_OBJ(target),
+			 JS_WEAK_REF_KIND_WEAK_REF, wrd)) {
+		js_free(ctx, wrd);
+		goto fail;
+	}
+	JS_SetOpaque(obj, wrd);
+	js_weak_ref_keep(ctx->rt, wrd);
+	return obj;
+fail:
+	JS_FreeValue(ctx, obj);
+	return JS_EXCEPTION;
+}
+
+static JSValue js_weak_ref_deref(JSContext *ctx, JSValueConst this_val,
+				 int argc, JSValueConst *argv) {
+	JSWeakRefData *wrd = JS_GetOpaque2(ctx, this_val, JS_CLASS_WEAK_REF);
+
+	if (!wrd)
+		return JS_EXCEPTION;
+	if (JS_IsUndefined(wrd->target))
+		return JS_UNDEFINED;
+	js_weak_ref_keep(ctx->rt, wrd);
+	return JS_DupValue(ctx, wrd->target);
+}
+
+/* FinalizationRegistry */
+
+/* remove the weak references of a registry cell */
+static void fin_reg_entry_detach(JSRuntime *rt, JSFinRegEntry *fe) {
+	if (JS_IsObject(fe->target)) {
+		delete_weak_ref(rt, JS_VALUE_GET_OBJ(fe->target),
+				JS_WEAK_REF_KIND_FIN_REG_TARGET, fe);
+	}
+	if (JS_IsObject(fe->token)) {
+		delete_weak_ref(rt, JS_VALUE_GET_OBJ(fe->token),
+				JS_WEAK_REF_KIND_FIN_REG_TOKEN, fe);
+	}
+}
+
+/* free the cells of 'entries' which must be detached */
+static void fin_reg_free_entries(JSRuntime *rt, struct list_head *entries) {
+	struct list_head *el, *el1;
+	JSFinRegEntry *fe;
+
+	list_for_each_safe(el, el1, entries) {
+		fe = list_entry(el, JSFinRegEntry, link);
+		JS_FreeValueRT(rt, fe->held_value);
+		js_free_rt(rt, fe);
+	}
+}
+
+static void js_fin_reg_finalizer(JSRuntime *rt, JSValue val) {
+	JSObject *p = JS_VALUE_GET_OBJ(val);
+	JSFinRegData *fd = p->u.fin_reg_data;
+	struct list_head *el;
+
+	if (fd) {
+		/* the weak references are removed before freeing the held
+		values so that the list is no longer modified */
+		list_for_each(el, &fd->entries) {
+			fin_reg_entry_detach(
+				rt, list_entry(el, JSFinRegEntry, link));
+		}
+		fin_reg_free_entries(rt, &fd->entries);
+		JS_FreeValueRT(rt, fd->cleanup_func);
+		JS_FreeContext(fd->realm);
+		js_free_rt(rt, fd);
+	}
+}
+
+static void js_fin_reg_mark(JSRuntime *rt, JSValueConst val,
+			    JS_MarkFunc *mark_func) {
+	JSObject *p = JS_VALUE_GET_OBJ(val);
+	JSFinRegData *fd = p->u.fin_reg_data;
+	struct list_head *el;
+
+	if (fd) {
+		mark_func(rt, &fd->realm->header);
+		JS_MarkValue(rt, fd->cleanup_func, mark_func);
+		list_for_each(el, &fd->entries) {
+			JS_MarkValue(rt, list_entry(el, JSFinRegEntry, link)->
+				     held_value, mark_func);
+		}
+	}
+}
+
+static JSValue js_fin_reg_constructor(JSContext *ctx, JSValueConst new_target,
+				      int argc, JSValueConst *argv) {
+	JSValueConst cleanup_func = argv[0];
+	JSFinRegData *fd;
+	JSValue obj;
+
+	if (!JS_IsFunction(ctx, cleanup_func))
+		return JS_ThrowTypeError(ctx, "not a function");
+	obj = js_create_from_ctor(ctx, new_target,
+				  JS_CLASS_FINALIZATION_REGISTRY);
+	if (JS_IsException(obj))
+		return JS_EXCEPTION;
+	fd = js_malloc(ctx, sizeof(*fd));
+	if (!fd) {
+		JS_FreeValue(ctx, obj);
+		return JS_EXCEPTION;
+	}
+	fd->realm = JS_DupContext(ctx);
+	fd->cleanup_func = JS_DupValue(ctx, cleanup_func);
+	init_list_head(&fd->entries);
+	fd->cleanup_pending = FALSE;
+	JS_SetOpaque(obj, fd);
+	return obj;
+}
+
+static JSValue js_fin_reg_register(JSContext *ctx, JSValueConst this_val,
+				   int argc, JSValueConst *argv) {
+	JSFinRegData *fd = JS_GetOpaque2(ctx, this_val,
+					 JS_CLASS_FINALIZATION_REGISTRY);
+	JSValueConst target, held_value, token;
+	JSFinRegEntry *fe;
+
+	if (!fd)
+		return JS_EXCEPTION;
+	target = argv[0];
+	held_value = argv[1];
+	token = argc > 2 ? argv[2] : JS_UNDEFINED;
+	if (!JS_IsObject(target))
+		return JS_ThrowTypeErrorNotAnObject(ctx);
+	if (js_same_value(ctx, target, held_value))
+		return JS_ThrowTypeError(ctx,
+					 "held value cannot be the target");
+	if (!JS_IsObject(token) && !JS_IsUndefined(token))
+		return JS_ThrowTypeError(ctx, "invalid unregister token");
+	fe = js_malloc(ctx, sizeof(*fe));
+	if (!fe)
+		return JS_EXCEPTION;
+	fe->fin_reg = JS_VALUE_GET_OBJ(this_val);
+	fe->target = (JSValue) target;
+	fe->token = (JSValue) token;
+	if (add_weak_ref(ctx, JS_VALUE_GET_OBJ(target),
+			 JS_WEAK_REF_KIND_FIN_REG_TARGET, fe))
+		goto fail;
+	if (JS_IsObject(token) &&
+	    add_weak_ref(ctx, JS_VALUE_GET_OBJ(token),
+			 JS_WEAK_REF_KIND_FIN_REG_TOKEN, fe)) {
+		delete_weak_ref(ctx->rt, JS_VALUE_GET_OBJ(target),
+				JS_WEAK_REF_KIND_FIN_REG_TARGET, fe);
+		goto fail;
+	}
+	fe->held_value = JS_DupValue(ctx, held_value);
+	list_add_tail(&fe->link, &fd->entries);
+	return JS_UNDEFINED;
+fail:
+	js_free(ctx, fe);
+	return JS_EXCEPTION;
+}
+
+static JSValue js_fin_reg_unregister(JSContext *ctx, JSValueConst this_val,
+				     int argc, JSValueConst *argv) {
+	JSFinRegData *fd = JS_GetOpaque2(ctx, this_val,
+					 JS_CLASS_FINALIZATION_REGISTRY);
+	JSValueConst token = argv[0];
+	struct list_head *el, removed;
+	JSWeakRefRecord *wr;
+	JSFinRegEntry *fe;
+	JSObject *p;
+
+	if (!fd)
+		return JS_EXCEPTION;
+	if (!JS_IsObject(token))
+		return JS_ThrowTypeError(ctx, "invalid unregister token");
+	p = JS_VALUE_GET_OBJ(token);
+	if (!p->has_weak_ref)
+		return JS_FALSE;
+	/* the cells are found from the weak references to the token */
+	init_list_head(&removed);
+	for (wr = weak_ref_find_slot(ctx->rt, p)->first_weak_ref; wr != nullptr;
+	     wr = wr->next_weak_ref) {
+		fe = wr->u.fin_reg;
+		if (wr->kind == JS_WEAK_REF_KIND_FIN_REG_TOKEN &&
+		    fe->fin_reg == JS_VALUE_GET_OBJ(this_val)) {
+			list_del(&fe->link);
+			list_add_tail(&fe->link, &removed);
+		}
+	}
+	if (list_empty(&removed))
+		return JS_FALSE;
+	list_for_each(el, &removed) {
+		fin_reg_entry_detach(ctx->rt,
+				     list_entry(el, JSFinRegEntry, link));
+	}
+	fin_reg_free_entries(ctx->rt, &removed);
+	return JS_TRUE;
+}
+
+static const JSCFunctionListEntry js_weak_ref_proto_funcs[] = {
+	JS_CFUNC_DEF("deref", 0, js_weak_ref_deref),
+	JS_PROP_STRING_DEF("[Symbol.toStringTag]", "WeakRef",
+			   JS_PROP_CONFIGURABLE),
+};
+
+static const JSCFunctionListEntry js_fin_reg_proto_funcs[] = {
+	JS_CFUNC_DEF("register", 2, js_fin_reg_register),
+	JS_CFUNC_DEF("unregister", 1, js_fin_reg_unregister),
+	JS_PROP_STRING_DEF("[Symbol.toStringTag]", "FinalizationRegistry",
+			   JS_PROP_CONFIGURABLE),
+};
+
+static JSClassShortDef const js_weak_ref_class_def[] = {
+	{JS_ATOM_WeakRef, js_weak_ref_finalizer, js_weak_ref_mark},
+	/* JS_CLASS_WEAK_REF */
+	{JS_ATOM_FinalizationRegistry, js_fin_reg_finalizer, js_fin_reg_mark},
+	/* JS_CLASS_FINALIZATION_REGISTRY */
+};
+
 void JS_AddIntrinsicMapSet(JSContext *ctx) {
 	int i;
 	JSValue obj1;
@@ -50276,6 +53542,26 @@ void JS_AddIntrinsicMapSet(JSContext *ctx) {
 			js_map_proto_funcs_ptr[i + 4],
 			js_map_proto_funcs_count[i + 4]);
 	}
+
+	/* WeakRef, FinalizationRegistry */
+	if (!JS_IsRegisteredClass(ctx->rt, JS_CLASS_WEAK_REF)) {
+		init_class_range(ctx->rt, js_weak_ref_class_def,
+				 JS_CLASS_WEAK_REF,
+				 countof(js_weak_ref_class_def));
+	}
+	ctx->class_proto[JS_CLASS_WEAK_REF] = JS_NewObject(ctx);
+	JS_SetPropertyFunctionList(ctx, ctx->class_proto[JS_CLASS_WEAK_REF],
+				   js_weak_ref_proto_funcs,
+				   countof(js_weak_ref_proto_funcs));
+	JS_NewGlobalCConstructorOnly(ctx, "WeakRef", js_weak_ref_constructor, 1,
+				     ctx->class_proto[JS_CLASS_WEAK_REF]);
+	ctx->class_proto[JS_CLASS_FINALIZATION_REGISTRY] = JS_NewObject(ctx);
+	JS_SetPropertyFunctionList(
+		ctx, ctx->class_proto[JS_CLASS_FINALIZATION_REGISTRY],
+		js_fin_reg_proto_funcs, countof(js_fin_reg_proto_funcs));
+	JS_NewGlobalCConstructorOnly(
+		ctx, "FinalizationRegistry", js_fin_reg_constructor, 1,
+		ctx->class_proto[JS_CLASS_FINALIZATION_REGISTRY]);
 }
 
 /* Generator */
@@ -50316,6 +53602,9 @@ typedef struct JSPromiseReactionData {
 	struct list_head link; /* not used in promise_reaction_job */
 	JSValue resolving_funcs[2];
 	JSValue handler;
+	/* if not nullptr, the reaction resumes this async function and
+	   the other fields are undefined */
+	JSAsyncFunctionState *async_func;
 } JSPromiseReactionData;
 
 JSPromiseStateEnum JS_PromiseState(JSContext *ctx, JSValue promise) {
@@ -50340,6 +53629,8 @@ static void promise_reaction_data_free(JSRuntime *rt,
 	JS_FreeValueRT(rt, rd->resolving_funcs[0]);
 	JS_FreeValueRT(rt, rd->resolving_funcs[1]);
 	JS_FreeValueRT(rt, rd->handler);
+	if (rd->async_func)
+		async_func_free(rt, rd->async_func);
 	js_free_rt(rt, rd);
 }
 
@@ -50417,12 +53708,17 @@ static void fulfill_or_reject_promise(JSContext *ctx, JSValueConst promise,
 
 	list_for_each_safe(el, el1, &s->promise_reactions[is_reject]) {
 		rd = list_entry(el, JSPromiseReactionData, link);
-		args[0] = rd->resolving_funcs[0];
-		args[1] = rd->resolving_funcs[1];
-		args[2] = rd->handler;
-		args[3] = JS_NewBool(ctx, is_reject);
-		args[4] = value;
-		JS_EnqueueJob(ctx, promise_reaction_job, 5, args);
+		if (rd->async_func) {
+			js_enqueue_await_job(ctx, rd->async_func, is_reject,
+					     value);
+		} else {
+			args[0] = rd->resolving_funcs[0];
+			args[1] = rd->resolving_funcs[1];
+			args[2] = rd->handler;
+			args[3] = JS_NewBool(ctx, is_reject);
+			args[4] = value;
+			JS_EnqueueJob(ctx, promise_reaction_job, 5, args);
+		}
 		list_del(&rd->link);
 		promise_reaction_data_free(ctx->rt, rd);
 	}
@@ -50624,6 +53920,8 @@ static void js_promise_mark(JSRuntime *rt, JSValueConst val,
 			JS_MarkValue(rt, rd->resolving_funcs[0], mark_func);
 			JS_MarkValue(rt, rd->resolving_funcs[1], mark_func);
 			JS_MarkValue(rt, rd->handler, mark_func);
+			if (rd->async_func)
+				mark_func(rt, &rd->async_func->header);
 		}
 	}
 	JS_MarkValue(rt, s->promise_result, mark_func);
@@ -51196,6 +54494,52 @@ static __exception int perform_promise_then(JSContext *ctx,
 	return 0;
 }
 
+/* Same as perform_promise_then() with handlers resuming the async
+   function 's': no function object is created. */
+static __exception int perform_promise_await(JSContext *ctx,
+					     JSValueConst promise,
+					     JSAsyncFunctionState *s) {
+	JSPromiseData *p = JS_GetOpaque(promise, JS_CLASS_PROMISE);
+	JSPromiseReactionData *rd_array[2];
+	int i;
+
+	if (p->promise_state == JS_PROMISE_PENDING) {
+		for (i = 0; i < 2; i++) {
+			rd_array[i] = js_malloc(ctx, sizeof(*rd_array[i]));
+			if (!rd_array[i]) {
+				if (i == 1)
+					js_free(ctx, rd_array[0]);
+				return -1;
+			}
+		}
+		for (i = 0; i < 2; i++) {
+			rd_array[i]->resolving_funcs[0] = JS_UNDEFINED;
+			rd_array[i]->resolving_funcs[1] = JS_UNDEFINED;
+			rd_array[i]->handler = JS_UNDEFINED;
+			rd_array[i]->async_func = s;
+			s->header.ref_count++;
+			list_add_tail(&rd_array[i]->link,
+				      &p->promise_reactions[i]);
+		}
+	} else {
+		if (p->promise_state == JS_PROMISE_REJECTED && !p->is_handled) {
+			JSRuntime *rt = ctx->rt;
+			if (rt->host_promise_rejection_tracker) {
+				rt->host_promise_rejection_tracker(
+					ctx, promise, p->promise_result,
+					TRUE, rt->
+					host_promise_rejection_tracker_opaque);
+			}
+		}
+		if (js_enqueue_await_job(ctx, s, p->promise_state ==
+					 JS_PROMISE_REJECTED,
+					 p->promise_result))
+			return -1;
+	}
+	p->is_handled = TRUE;
+	return 0;
+}
+
 static JSValue js_promise_then(JSContext *ctx, JSValueConst this_val,
 			       int argc, JSValueConst *argv) {
 	JSValue ctor, result_promise, resolving_funcs[2];
@@ -51573,16 +54917,6 @@ static JSClassShortDef const js_async_class_def[] = {
 		JS_ATOM_AsyncFunction, js_bytecode_function_finalizer,
 		js_bytecode_function_mark
 	}, /* JS_CLASS_ASYNC_FUNCTION */
-	{
-		JS_ATOM_AsyncFunctionResolve,
-		js_async_function_resolve_finalizer,
-		js_async_function_resolve_mark
-	}, /* JS_CLASS_ASYNC_FUNCTION_RESOLVE */
-	{
-		JS_ATOM_AsyncFunctionReject,
-		js_async_function_resolve_finalizer,
-		js_async_function_resolve_mark
-	}, /* JS_CLASS_ASYNC_FUNCTION_REJECT */
 	{
 		JS_ATOM_empty_string, js_async_from_sync_iterator_finalizer,
 		js_async_from_sync_iterator_mark
@@ -51610,10 +54944,6 @@ void JS_AddIntrinsicPromise(JSContext *ctx) {
 				js_promise_resolve_function_call;
 		rt->class_array[JS_CLASS_ASYNC_FUNCTION].call =
 				js_async_function_call;
-		rt->class_array[JS_CLASS_ASYNC_FUNCTION_RESOLVE].call =
-				js_async_function_resolve_call;
-		rt->class_array[JS_CLASS_ASYNC_FUNCTION_REJECT].call =
-				js_async_function_resolve_call;
 		rt->class_array[JS_CLASS_ASYNC_GENERATOR_FUNCTION].call =
 				js_async_generator_function_call;
 	}
@@ -53544,6 +56874,7 @@ redo:
 			goto redo;
 #endif
 		case JS_TAG_STRING:
+		case JS_TAG_SHORT_STRING:
 			val = JS_StringToBigIntErr(ctx, val);
 			break;
 		case JS_TAG_OBJECT:
@@ -54089,7 +57420,8 @@ static JSValue js_bigfloat_constructor(JSContext *ctx,
 				if (JS_IsException(val))
 					break;
 				goto redo;
-			case JS_TAG_STRING: {
+			case JS_TAG_STRING:
+			case JS_TAG_SHORT_STRING: {
 				const char *str, *p;
 				size_t len;
 				int err;
@@ -54789,7 +58121,8 @@ redo:
 			if (JS_IsException(val))
 				break;
 			goto redo;
-		case JS_TAG_STRING: {
+		case JS_TAG_STRING:
+		case JS_TAG_SHORT_STRING: {
 			const char *str, *p;
 			size_t len;
 			int err;
@@ -56070,6 +59403,587 @@ static JSValue js_typed_array_get_toStringTag(JSContext *ctx,
 		ctx, ctx->rt->class_array[p->class_id].class_name);
 }
 
+/* Store the element value 'v64' in the elements [k, final) of the
+   typed array data 'buf' */
+static void typed_array_fill_elements(uint8_t *buf, int size_log2,
+				      int k, int final, uint64_t v64) {
+	if (k >= final)
+		return;
+	if (size_log2 == 0) {
+		memset(buf + k, v64, final - k);
+		return;
+	}
+#if defined(__SSE2__)
+	{
+		size_t i, end;
+		__m128i v;
+		if (size_log2 == 1)
+			v = _mm_set1_epi16(v64);
+		else if (size_log2 == 2)
+			v = _mm_set1_epi32(v64);
+		else
+			v = _mm_set1_epi64x(v64);
+		i = (size_t) k << size_log2;
+		end = (size_t) final << size_log2;
+		for (; i + 16 <= end; i += 16)
+			_mm_storeu_si128((__m128i *) (buf + i), v);
+		k = i >> size_log2;
+	}
+#endif
+	switch (size_log2) {
+		case 1:
+			for (; k < final; k++)
+				((uint16_t *) buf)[k] = v64;
+			break;
+		case 2:
+			for (; k < final; k++)
+				((uint32_t *) buf)[k] = v64;
+			break;
+		default:
+			for (; k < final; k++)
+				((uint64_t *) buf)[k] = v64;
+			break;
+	}
+}
+
+typedef enum {
+	TA_FIND_BITS, /* bitwise equality */
+	TA_FIND_FLOAT, /* floating point equality */
+	TA_FIND_NAN, /* any NaN, 'v64' is ignored */
+} TypedArrayFindEnum;
+
+#if defined(__SSE2__)
+/* return a byte mask of the elements of the 16 bytes at 'p' which
+   match 'v' */
+static force_inline unsigned int typed_array_find_mask(const uint8_t *p,
+						       __m128i v,
+						       int size_log2,
+						       TypedArrayFindEnum kind) {
+	__m128i x = _mm_loadu_si128((const __m128i *) p);
+	if (kind != TA_FIND_BITS) {
+		if (size_log2 == 2) {
+			__m128 f = _mm_castsi128_ps(x);
+			if (kind == TA_FIND_NAN)
+				f = _mm_cmpunord_ps(f, f);
+			else
+				f = _mm_cmpeq_ps(f, _mm_castsi128_ps(v));
+			x = _mm_castps_si128(f);
+		} else {
+			__m128d d = _mm_castsi128_pd(x);
+			if (kind == TA_FIND_NAN)
+				d = _mm_cmpunord_pd(d, d);
+			else
+				d = _mm_cmpeq_pd(d, _mm_castsi128_pd(v));
+			x = _mm_castpd_si128(d);
+		}
+	} else {
+		switch (size_log2) {
+			case 0:
+				x = _mm_cmpeq_epi8(x, v);
+				break;
+			case 1:
+				x = _mm_cmpeq_epi16(x, v);
+				break;
+			case 2:
+				x = _mm_cmpeq_epi32(x, v);
+				break;
+			default:
+				x = _mm_cmpeq_epi32(x, v);
+				x = _mm_and_si128(x, _mm_shuffle_epi32(
+					x, _MM_SHUFFLE(2, 3, 0, 1)));
+				break;
+		}
+	}
+	return _mm_movemask_epi8(x);
+}
+#endif
+
+static inline BOOL typed_array_find_match(const uint8_t *buf, int size_log2,
+					  int k, uint64_t v64,
+					  TypedArrayFindEnum kind) {
+	switch (size_log2) {
+		case 0:
+			return buf[k] == (uint8_t) v64;
+		case 1:
+			return ((const uint16_t *) buf)[k] == (uint16_t) v64;
+		case 2:
+			if (kind == TA_FIND_BITS) {
+				return ((const uint32_t *) buf)[k] ==
+					(uint32_t) v64;
+			} else {
+				float f = ((const float *) buf)[k];
+				union {
+					float f;
+					uint32_t u32;
+				} u;
+				u.u32 = v64;
+				return kind == TA_FIND_NAN ? isnan(f) : f == u.f;
+			}
+		default:
+			if (kind == TA_FIND_BITS) {
+				return ((const uint64_t *) buf)[k] == v64;
+			} else {
+				double d = ((const double *) buf)[k];
+				JSFloat64Union u;
+				u.u64 = v64;
+				return kind == TA_FIND_NAN ? isnan(d) : d == u.d;
+			}
+	}
+}
+
+#if defined(__SSE2__)
+/* SIMD part of typed_array_find() for whole blocks of 16 bytes.
+   'size_log2' and 'kind' are constants once inlined. Return -1 and
+   update '*pk' to the next element to test if no match. */
+static force_inline int typed_array_find_simd(const uint8_t *buf,
+					      int size_log2, int *pk,
+					      int stop, int inc, __m128i v,
+					      TypedArrayFindEnum kind) {
+	int k = *pk, n = 16 >> size_log2;
+	unsigned int mask;
+	if (inc > 0) {
+		for (; k + n <= stop; k += n) {
+			mask = typed_array_find_mask(
+				buf + ((size_t) k << size_log2), v, size_log2,
+				kind);
+			if (mask)
+				return k + (ctz32(mask) >> size_log2);
+		}
+	} else {
+		for (; k - n >= stop; k -= n) {
+			mask = typed_array_find_mask(
+				buf + ((size_t) (k - n + 1) << size_log2), v,
+				size_log2, kind);
+			if (mask)
+				return k - n + 1 +
+					((31 - clz32(mask)) >> size_log2);
+		}
+	}
+	*pk = k;
+	return -1;
+}
+#endif
+
+/* Return the index of the first element in [k, stop) (inc > 0) or of
+   the last element in (stop, k] (inc < 0) of the typed array data
+   'buf' matching 'v64', or -1 if none. For TA_FIND_FLOAT, 'v64' holds
+   the bits of the float or double value. */
+static int typed_array_find(const uint8_t *buf, int size_log2, int k,
+			    int stop, int inc, uint64_t v64,
+			    TypedArrayFindEnum kind) {
+#if defined(__SSE2__)
+	int res;
+	switch (size_log2) {
+		case 0:
+			res = typed_array_find_simd(buf, 0, &k, stop, inc,
+						    _mm_set1_epi8(v64),
+						    TA_FIND_BITS);
+			break;
+		case 1:
+			res = typed_array_find_simd(buf, 1, &k, stop, inc,
+						    _mm_set1_epi16(v64),
+						    TA_FIND_BITS);
+			break;
+		case 2:
+			if (kind == TA_FIND_BITS) {
+				res = typed_array_find_simd(
+					buf, 2, &k, stop, inc,
+					_mm_set1_epi32(v64), TA_FIND_BITS);
+			} else if (kind == TA_FIND_FLOAT) {
+				res = typed_array_find_simd(
+					buf, 2, &k, stop, inc,
+					_mm_set1_epi32(v64), TA_FIND_FLOAT);
+			} else {
+				res = typed_array_find_simd(
+					buf, 2, &k, stop, inc,
+					_mm_setzero_si128(), TA_FIND_NAN);
+			}
+			break;
+		default:
+			if (kind == TA_FIND_BITS) {
+				res = typed_array_find_simd(
+					buf, 3, &k, stop, inc,
+					_mm_set1_epi64x(v64), TA_FIND_BITS);
+			} else if (kind == TA_FIND_FLOAT) {
+				res = typed_array_find_simd(
+					buf, 3, &k, stop, inc,
+					_mm_set1_epi64x(v64), TA_FIND_FLOAT);
+			} else {
+				res = typed_array_find_simd(
+					buf, 3, &k, stop, inc,
+					_mm_setzero_si128(), TA_FIND_NAN);
+			}
+			break;
+	}
+	if (res >= 0)
+		return res;
+#endif
+	for (; k != stop; k += inc) {
+		if (typed_array_find_match(buf, size_log2, k, v64, kind))
+			return k;
+	}
+	return -1;
+}
+
+static inline int js_int_to_uint8_clamp(int64_t v) {
+	return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+#define TA_CONVERT_CAST(v) (v)
+
+#define TA_CONVERT_LOOP(dst_type, src_type, conv) do { \
+	dst_type *d = (dst_type *) dst; \
+	const src_type *s = (const src_type *) src; \
+	for (; i < end; i++) \
+		d[i] = conv(s[i]); \
+} while (0)
+
+#define TA_CONVERT(dst_type, int_conv, float_conv) do { \
+	switch (src_class) { \
+		case JS_CLASS_UINT8C_ARRAY: \
+		case JS_CLASS_UINT8_ARRAY: \
+			TA_CONVERT_LOOP(dst_type, uint8_t, int_conv); \
+			break; \
+		case JS_CLASS_INT8_ARRAY: \
+			TA_CONVERT_LOOP(dst_type, int8_t, int_conv); \
+			break; \
+		case JS_CLASS_INT16_ARRAY: \
+			TA_CONVERT_LOOP(dst_type, int16_t, int_conv); \
+			break; \
+		case JS_CLASS_UINT16_ARRAY: \
+			TA_CONVERT_LOOP(dst_type, uint16_t, int_conv); \
+			break; \
+		case JS_CLASS_INT32_ARRAY: \
+			TA_CONVERT_LOOP(dst_type, int32_t, int_conv); \
+			break; \
+		case JS_CLASS_UINT32_ARRAY: \
+			TA_CONVERT_LOOP(dst_type, uint32_t, int_conv); \
+			break; \
+		case JS_CLASS_FLOAT32_ARRAY: \
+			TA_CONVERT_LOOP(dst_type, float, float_conv); \
+			break; \
+		default: \
+			TA_CONVERT_LOOP(dst_type, double, float_conv); \
+			break; \
+	} \
+} while (0)
+
+/* convert the Number elements [i, end) */
+static void typed_array_convert_scalar(int dst_class, uint8_t *dst,
+				       int src_class, const uint8_t *src,
+				       uint32_t i, uint32_t end) {
+	switch (dst_class) {
+		case JS_CLASS_UINT8C_ARRAY:
+			TA_CONVERT(uint8_t, js_int_to_uint8_clamp,
+				   js_double_to_uint8_clamp);
+			break;
+		case JS_CLASS_INT8_ARRAY:
+		case JS_CLASS_UINT8_ARRAY:
+			TA_CONVERT(uint8_t, TA_CONVERT_CAST, js_double_to_int32);
+			break;
+		case JS_CLASS_INT16_ARRAY:
+		case JS_CLASS_UINT16_ARRAY:
+			TA_CONVERT(uint16_t, TA_CONVERT_CAST,
+				   js_double_to_int32);
+			break;
+		case JS_CLASS_INT32_ARRAY:
+		case JS_CLASS_UINT32_ARRAY:
+			TA_CONVERT(uint32_t, TA_CONVERT_CAST,
+				   js_double_to_int32);
+			break;
+		case JS_CLASS_FLOAT32_ARRAY:
+			TA_CONVERT(float, TA_CONVERT_CAST, TA_CONVERT_CAST);
+			break;
+		default:
+			TA_CONVERT(double, TA_CONVERT_CAST, TA_CONVERT_CAST);
+			break;
+	}
+}
+
+#undef TA_CONVERT
+#undef TA_CONVERT_LOOP
+#undef TA_CONVERT_CAST
+
+#if defined(__SSE2__)
+/* number of elements converted at a time by typed_array_convert_simd() */
+#define TA_CONVERT_BLOCK 256
+
+/* Load the elements [4 * j, 4 * j + 3] of 'src' as 32 bit integers.
+   Floating point elements are truncated, or rounded to nearest if
+   'round' is set: out of range and NaN values give INT32_MIN. */
+static force_inline __m128i typed_array_load4(const uint8_t *src, uint32_t j,
+					      int src_class, BOOL round) {
+	__m128i x, zero = _mm_setzero_si128();
+	int32_t w;
+	switch (src_class) {
+		case JS_CLASS_UINT8_ARRAY:
+			memcpy(&w, src + j * 4, 4);
+			x = _mm_unpacklo_epi8(_mm_cvtsi32_si128(w), zero);
+			return _mm_unpacklo_epi16(x, zero);
+		case JS_CLASS_INT8_ARRAY:
+			memcpy(&w, src + j * 4, 4);
+			x = _mm_cvtsi32_si128(w);
+			x = _mm_unpacklo_epi8(x, x);
+			return _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 24);
+		case JS_CLASS_INT16_ARRAY:
+			x = _mm_loadl_epi64((const __m128i *) (src + j * 8));
+			return _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+		case JS_CLASS_UINT16_ARRAY:
+			x = _mm_loadl_epi64((const __m128i *) (src + j * 8));
+			return _mm_unpacklo_epi16(x, zero);
+		case JS_CLASS_INT32_ARRAY:
+			return _mm_loadu_si128((const __m128i *) (src + j * 16));
+		case JS_CLASS_FLOAT32_ARRAY: {
+			__m128 f = _mm_loadu_ps((const float *) (src + j * 16));
+			return round ? _mm_cvtps_epi32(f) : _mm_cvttps_epi32(f);
+		}
+		default: {
+			const double *p = (const double *) (src + j * 32);
+			__m128d d0 = _mm_loadu_pd(p);
+			__m128d d1 = _mm_loadu_pd(p + 2);
+			if (round) {
+				return _mm_unpacklo_epi64(_mm_cvtpd_epi32(d0),
+							  _mm_cvtpd_epi32(d1));
+			} else {
+				return _mm_unpacklo_epi64(_mm_cvttpd_epi32(d0),
+							  _mm_cvttpd_epi32(d1));
+			}
+		}
+	}
+}
+
+/* Store 4 32 bit integers as the elements [4 * j, 4 * j + 3] of 'dst' */
+static force_inline void typed_array_store4(uint8_t *dst, uint32_t j,
+					    int dst_class, __m128i x) {
+	int32_t w;
+	switch (dst_class) {
+		case JS_CLASS_UINT8C_ARRAY:
+			/* the saturations do the clamping */
+			x = _mm_packs_epi32(x, x);
+			w = _mm_cvtsi128_si32(_mm_packus_epi16(x, x));
+			memcpy(dst + j * 4, &w, 4);
+			break;
+		case JS_CLASS_UINT8_ARRAY:
+			x = _mm_and_si128(x, _mm_set1_epi32(0xff));
+			x = _mm_packs_epi32(x, x);
+			w = _mm_cvtsi128_si32(_mm_packus_epi16(x, x));
+			memcpy(dst + j * 4, &w, 4);
+			break;
+		case JS_CLASS_UINT16_ARRAY:
+			x = _mm_srai_epi32(_mm_slli_epi32(x, 16), 16);
+			_mm_storel_epi64((__m128i *) (dst + j * 8),
+					 _mm_packs_epi32(x, x));
+			break;
+		case JS_CLASS_UINT32_ARRAY:
+			_mm_storeu_si128((__m128i *) (dst + j * 16), x);
+			break;
+		case JS_CLASS_FLOAT32_ARRAY:
+			_mm_storeu_ps((float *) (dst + j * 16),
+				      _mm_cvtepi32_ps(x));
+			break;
+		default:
+			_mm_storeu_pd((double *) (dst + j * 32),
+				      _mm_cvtepi32_pd(x));
+			_mm_storeu_pd((double *) (dst + j * 32) + 2,
+				      _mm_cvtepi32_pd(_mm_unpackhi_epi64(x, x)));
+			break;
+	}
+}
+
+/* Convert the Number elements [0, n) where n is a multiple of 4 and
+   at most TA_CONVERT_BLOCK. The elements go through 32 bit integers
+   so that only one loop is needed per source and per destination
+   type. Return FALSE if the conversion must be done by
+   typed_array_convert_scalar(). */
+static BOOL typed_array_convert_simd(int dst_class, uint8_t *dst,
+				     int src_class, const uint8_t *src,
+				     uint32_t n) {
+	__m128i tmp[TA_CONVERT_BLOCK / 4], bad;
+	BOOL round = (dst_class == JS_CLASS_UINT8C_ARRAY);
+	uint32_t j, n4 = n / 4;
+
+	if (src_class == JS_CLASS_FLOAT32_ARRAY &&
+	    dst_class == JS_CLASS_FLOAT64_ARRAY) {
+		for (j = 0; j < n; j += 4) {
+			__m128 f = _mm_loadu_ps((const float *) src + j);
+			_mm_storeu_pd((double *) dst + j, _mm_cvtps_pd(f));
+			_mm_storeu_pd((double *) dst + j + 2,
+				      _mm_cvtps_pd(_mm_movehl_ps(f, f)));
+		}
+		return TRUE;
+	}
+	if (src_class == JS_CLASS_FLOAT64_ARRAY &&
+	    dst_class == JS_CLASS_FLOAT32_ARRAY) {
+		for (j = 0; j < n; j += 4) {
+			__m128 f0 = _mm_cvtpd_ps(
+				_mm_loadu_pd((const double *) src + j));
+			__m128 f1 = _mm_cvtpd_ps(
+				_mm_loadu_pd((const double *) src + j + 2));
+			_mm_storeu_ps((float *) dst + j, _mm_movelh_ps(f0, f1));
+		}
+		return TRUE;
+	}
+	/* the uint32 elements above INT32_MAX are only converted
+	   correctly by the modular conversions */
+	if (src_class == JS_CLASS_UINT32_ARRAY &&
+	    (round || dst_class >= JS_CLASS_FLOAT32_ARRAY))
+		return FALSE;
+
+	switch (src_class) {
+		case JS_CLASS_UINT8C_ARRAY:
+		case JS_CLASS_UINT8_ARRAY:
+			for (j = 0; j < n4; j++)
+				tmp[j] = typed_array_load4(
+					src, j, JS_CLASS_UINT8_ARRAY, FALSE);
+			break;
+		case JS_CLASS_INT8_ARRAY:
+			for (j = 0; j < n4; j++)
+				tmp[j] = typed_array_load4(
+					src, j, JS_CLASS_INT8_ARRAY, FALSE);
+			break;
+		case JS_CLASS_INT16_ARRAY:
+			for (j = 0; j < n4; j++)
+				tmp[j] = typed_array_load4(
+					src, j, JS_CLASS_INT16_ARRAY, FALSE);
+			break;
+		case JS_CLASS_UINT16_ARRAY:
+			for (j = 0; j < n4; j++)
+				tmp[j] = typed_array_load4(
+					src, j, JS_CLASS_UINT16_ARRAY, FALSE);
+			break;
+		case JS_CLASS_INT32_ARRAY:
+		case JS_CLASS_UINT32_ARRAY:
+			for (j = 0; j < n4; j++)
+				tmp[j] = typed_array_load4(
+					src, j, JS_CLASS_INT32_ARRAY, FALSE);
+			break;
+		case JS_CLASS_FLOAT32_ARRAY:
+		case JS_CLASS_FLOAT64_ARRAY:
+			if (src_class == JS_CLASS_FLOAT32_ARRAY) {
+				for (j = 0; j < n4; j++)
+					tmp[j] = typed_array_load4(
+						src, j, JS_CLASS_FLOAT32_ARRAY,
+						round);
+			} else {
+				for (j = 0; j < n4; j++)
+					tmp[j] = typed_array_load4(
+						src, j, JS_CLASS_FLOAT64_ARRAY,
+						round);
+			}
+			bad = _mm_setzero_si128();
+			for (j = 0; j < n4; j++) {
+				bad = _mm_or_si128(bad, _mm_cmpeq_epi32(
+					tmp[j], _mm_set1_epi32(INT32_MIN)));
+			}
+			if (_mm_movemask_epi8(bad))
+				return FALSE;
+			break;
+		default:
+			return FALSE;
+	}
+
+	switch (dst_class) {
+		case JS_CLASS_UINT8C_ARRAY:
+			for (j = 0; j < n4; j++)
+				typed_array_store4(dst, j, JS_CLASS_UINT8C_ARRAY,
+						   tmp[j]);
+			break;
+		case JS_CLASS_INT8_ARRAY:
+		case JS_CLASS_UINT8_ARRAY:
+			for (j = 0; j < n4; j++)
+				typed_array_store4(dst, j, JS_CLASS_UINT8_ARRAY,
+						   tmp[j]);
+			break;
+		case JS_CLASS_INT16_ARRAY:
+		case JS_CLASS_UINT16_ARRAY:
+			for (j = 0; j < n4; j++)
+				typed_array_store4(dst, j, JS_CLASS_UINT16_ARRAY,
+						   tmp[j]);
+			break;
+		case JS_CLASS_INT32_ARRAY:
+		case JS_CLASS_UINT32_ARRAY:
+			for (j = 0; j < n4; j++)
+				typed_array_store4(dst, j, JS_CLASS_UINT32_ARRAY,
+						   tmp[j]);
+			break;
+		case JS_CLASS_FLOAT32_ARRAY:
+			for (j = 0; j < n4; j++)
+				typed_array_store4(dst, j, JS_CLASS_FLOAT32_ARRAY,
+						   tmp[j]);
+			break;
+		default:
+			for (j = 0; j < n4; j++)
+				typed_array_store4(dst, j, JS_CLASS_FLOAT64_ARRAY,
+						   tmp[j]);
+			break;
+	}
+	return TRUE;
+}
+#endif
+
+static inline BOOL typed_array_is_bigint(int class_id) {
+	return (class_id == JS_CLASS_BIG_INT64_ARRAY ||
+		class_id == JS_CLASS_BIG_UINT64_ARRAY);
+}
+
+/* Convert 'len' elements of the typed array data 'src' of class
+   'src_class' to the elements of 'dst' of class 'dst_class' as
+   TypedArray.prototype.set() would do. Both classes must hold numbers
+   or both BigInts. 'src' and 'dst' must not overlap. */
+static void typed_array_convert(int dst_class, uint8_t *dst, int src_class,
+				const uint8_t *src, uint32_t len) {
+	uint32_t i;
+
+	if (typed_array_is_bigint(dst_class)) {
+		/* same representation */
+		memcpy(dst, src, (size_t) len << 3);
+		return;
+	}
+	i = 0;
+#if defined(__SSE2__)
+	{
+		int dst_log2 = typed_array_size_log2(dst_class);
+		int src_log2 = typed_array_size_log2(src_class);
+		uint32_t n;
+		while (len - i >= 4) {
+			n = min_uint32(len - i, TA_CONVERT_BLOCK) & ~3;
+			if (!typed_array_convert_simd(
+				    dst_class, dst + ((size_t) i << dst_log2),
+				    src_class, src + ((size_t) i << src_log2),
+				    n)) {
+				typed_array_convert_scalar(dst_class, dst,
+							   src_class, src, i,
+							   i + n);
+			}
+			i += n;
+		}
+	}
+#endif
+	typed_array_convert_scalar(dst_class, dst, src_class, src, i, len);
+}
+
+/* Same as typed_array_convert() but 'src' and 'dst' may overlap (they
+   can share the same ArrayBuffer). Return -1 if memory error. */
+static int typed_array_convert_overlap(JSContext *ctx, int dst_class,
+				       uint8_t *dst, int src_class,
+				       const uint8_t *src, uint32_t len) {
+	size_t dst_size = (size_t) len << typed_array_size_log2(dst_class);
+	size_t src_size = (size_t) len << typed_array_size_log2(src_class);
+	uint8_t *tmp;
+
+	if (dst + dst_size <= src || src + src_size <= dst) {
+		typed_array_convert(dst_class, dst, src_class, src, len);
+		return 0;
+	}
+	tmp = js_malloc(ctx, src_size);
+	if (!tmp)
+		return -1;
+	memcpy(tmp, src, src_size);
+	typed_array_convert(dst_class, dst, src_class, tmp, len);
+	js_free(ctx, tmp);
+	return 0;
+}
+
 static JSValue js_typed_array_set_internal(JSContext *ctx,
 					   JSValueConst dst,
 					   JSValueConst src,
@@ -56121,11 +60035,21 @@ static JSValue js_typed_array_set_internal(JSContext *ctx,
 				src_len << shift);
 			goto done;
 		}
-		if (dest_abuf->data == src_abuf->data) {
-			/* copying between the same buffer using different types of mappings
-			would require a temporary buffer */
+		/* Number and BigInt elements cannot be mixed: the default
+		   behavior raises the exception */
+		if (typed_array_is_bigint(src_p->class_id) ==
+		    typed_array_is_bigint(p->class_id)) {
+			if (typed_array_convert_overlap(
+				    ctx, p->class_id,
+				    dest_abuf->data + dest_ta->offset +
+				    (offset << shift),
+				    src_p->class_id,
+				    src_abuf->data + src_ta->offset,
+				    src_len)) {
+				goto fail;
+			}
+			goto done;
 		}
-		/* otherwise, default behavior is slow but correct */
 	} else {
 		if (js_get_length64(ctx, &src_len, src_obj))
 			goto fail;
@@ -56536,31 +60460,8 @@ static JSValue js_typed_array_fill(JSContext *ctx, JSValueConst this_val,
 		return JS_ThrowTypeErrorDetachedArrayBuffer(ctx);
 
 	shift = typed_array_size_log2(p->class_id);
-	switch (shift) {
-		case 0:
-			if (k < final) {
-				memset(p->u.array.u.uint8_ptr + k, v64,
-				       final - k);
-			}
-			break;
-		case 1:
-			for (; k < final; k++) {
-				p->u.array.u.uint16_ptr[k] = v64;
-			}
-			break;
-		case 2:
-			for (; k < final; k++) {
-				p->u.array.u.uint32_ptr[k] = v64;
-			}
-			break;
-		case 3:
-			for (; k < final; k++) {
-				p->u.array.u.uint64_ptr[k] = v64;
-			}
-			break;
-		default:
-			abort();
-	}
+	typed_array_fill_elements(p->u.array.u.uint8_ptr, shift, k, final,
+				  v64);
 	return JS_DupValue(ctx, this_val);
 }
 
@@ -56729,21 +60630,15 @@ static JSValue js_typed_array_indexOf(JSContext *ctx, JSValueConst this_val,
 		case JS_CLASS_UINT8_ARRAY:
 			if (is_int && (uint8_t) v64 == v64) {
 				const uint8_t *pv, *pp;
-				uint16_t v;
 			scan8:
 				pv = p->u.array.u.uint8_ptr;
-				v = v64;
 				if (inc > 0) {
-					pp = memchr(pv + k, v, len - k);
+					pp = memchr(pv + k, (uint8_t) v64, len - k);
 					if (pp)
 						res = pp - pv;
 				} else {
-					for (; k != stop; k += inc) {
-						if (pv[k] == v) {
-							res = k;
-							break;
-						}
-					}
+					res = typed_array_find(pv, 0, k, stop, inc,
+							       v64, TA_FIND_BITS);
 				}
 			}
 			break;
@@ -56753,17 +60648,10 @@ static JSValue js_typed_array_indexOf(JSContext *ctx, JSValueConst this_val,
 			break;
 		case JS_CLASS_UINT16_ARRAY:
 			if (is_int && (uint16_t) v64 == v64) {
-				const uint16_t *pv;
-				uint16_t v;
 			scan16:
-				pv = p->u.array.u.uint16_ptr;
-				v = v64;
-				for (; k != stop; k += inc) {
-					if (pv[k] == v) {
-						res = k;
-						break;
-					}
-				}
+				res = typed_array_find(p->u.array.u.uint8_ptr, 1, k,
+						       stop, inc, v64,
+						       TA_FIND_BITS);
 			}
 			break;
 		case JS_CLASS_INT32_ARRAY:
@@ -56772,65 +60660,47 @@ static JSValue js_typed_array_indexOf(JSContext *ctx, JSValueConst this_val,
 			break;
 		case JS_CLASS_UINT32_ARRAY:
 			if (is_int && (uint32_t) v64 == v64) {
-				const uint32_t *pv;
-				uint32_t v;
 			scan32:
-				pv = p->u.array.u.uint32_ptr;
-				v = v64;
-				for (; k != stop; k += inc) {
-					if (pv[k] == v) {
-						res = k;
-						break;
-					}
-				}
+				res = typed_array_find(p->u.array.u.uint8_ptr, 2, k,
+						       stop, inc, v64,
+						       TA_FIND_BITS);
 			}
 			break;
 		case JS_CLASS_FLOAT32_ARRAY:
 			if (is_bigint)
 				break;
 			if (isnan(d)) {
-				const float *pv = p->u.array.u.float_ptr;
 				/* special case: indexOf returns -1, includes finds NaN */
 				if (special != special_includes)
 					goto done;
-				for (; k != stop; k += inc) {
-					if (isnan(pv[k])) {
-						res = k;
-						break;
-					}
-				}
+				res = typed_array_find(p->u.array.u.uint8_ptr, 2, k,
+						       stop, inc, 0, TA_FIND_NAN);
 			} else if ((f = (float) d) == d) {
-				const float *pv = p->u.array.u.float_ptr;
-				for (; k != stop; k += inc) {
-					if (pv[k] == f) {
-						res = k;
-						break;
-					}
-				}
+				union {
+					float f;
+					uint32_t u32;
+				} u;
+				u.f = f;
+				res = typed_array_find(p->u.array.u.uint8_ptr, 2, k,
+						       stop, inc, u.u32,
+						       TA_FIND_FLOAT);
 			}
 			break;
 		case JS_CLASS_FLOAT64_ARRAY:
 			if (is_bigint)
 				break;
 			if (isnan(d)) {
-				const double *pv = p->u.array.u.double_ptr;
 				/* special case: indexOf returns -1, includes finds NaN */
 				if (special != special_includes)
 					goto done;
-				for (; k != stop; k += inc) {
-					if (isnan(pv[k])) {
-						res = k;
-						break;
-					}
-				}
+				res = typed_array_find(p->u.array.u.uint8_ptr, 3, k,
+						       stop, inc, 0, TA_FIND_NAN);
 			} else {
-				const double *pv = p->u.array.u.double_ptr;
-				for (; k != stop; k += inc) {
-					if (pv[k] == d) {
-						res = k;
-						break;
-					}
-				}
+				JSFloat64Union u;
+				u.d = d;
+				res = typed_array_find(p->u.array.u.uint8_ptr, 3, k,
+						       stop, inc, u.u64,
+						       TA_FIND_FLOAT);
 			}
 			break;
 		case JS_CLASS_BIG_INT64_ARRAY:
@@ -56844,17 +60714,10 @@ static JSValue js_typed_array_indexOf(JSContext *ctx, JSValueConst this_val,
 			if (is_bigint || (is_math_mode(ctx) && is_int &&
 					  v64 >= 0 && v64 <=
 					  MAX_SAFE_INTEGER)) {
-				const uint64_t *pv;
-				uint64_t v;
 			scan64:
-				pv = p->u.array.u.uint64_ptr;
-				v = v64;
-				for (; k != stop; k += inc) {
-					if (pv[k] == v) {
-						res = k;
-						break;
-					}
-				}
+				res = typed_array_find(p->u.array.u.uint8_ptr, 3, k,
+						       stop, inc, v64,
+						       TA_FIND_BITS);
 			}
 			break;
 	}
@@ -57047,6 +60910,20 @@ static JSValue js_typed_array_slice(JSContext *ctx, JSValueConst this_val,
 			memcpy(p1->u.array.u.uint8_ptr,
 			       p->u.array.u.uint8_ptr + (start << shift),
 			       count << shift);
+		} else if (p1 != nullptr &&
+			   p1->u.typed_array->buffer !=
+			   p->u.typed_array->buffer &&
+			   typed_array_is_bigint(p->class_id) ==
+			   typed_array_is_bigint(p1->class_id) &&
+			   typed_array_get_length(ctx, p1) >= count &&
+			   typed_array_get_length(ctx, p) >= start + count) {
+			/* the element by element copy is only observable
+			   if the buffers are shared */
+			typed_array_convert(p1->class_id,
+					    p1->u.array.u.uint8_ptr,
+					    p->class_id,
+					    p->u.array.u.uint8_ptr +
+					    (start << shift), count);
 		} else {
 			for (n = 0; n < count; n++) {
 				val = JS_GetPropertyValue(ctx, this_val,
@@ -57210,6 +61087,313 @@ static JSValue js_TA_get_float64(JSContext *ctx, const void *a) {
 	return __JS_NewFloat64(ctx, *(const double *) a);
 }
 
+/* Default comparison: the elements are mapped in place to unsigned
+   integer keys having the same order and sorted with a LSD radix sort
+   (a counting sort for the 8 bit types). Large arrays are sorted by
+   several threads. */
+
+/* smaller arrays are sorted with rqsort() */
+#define TA_RADIX_MIN_LEN 64
+
+#ifdef CONFIG_ATOMICS
+/* minimum number of elements per thread */
+#define TA_RADIX_THREAD_MIN_LEN (1 << 19)
+#define TA_RADIX_MAX_THREADS 8
+#else
+#define TA_RADIX_MAX_THREADS 1
+#endif
+
+typedef struct TARadixTask {
+	const uint8_t *src;
+	uint8_t *dst;
+	size_t start, end;
+	int size_log2;
+	int shift;
+	BOOL scatter;
+	/* digit histogram, then output positions */
+	size_t count[256];
+} TARadixTask;
+
+static force_inline uint64_t ta_radix_get(const uint8_t *p, size_t i,
+					  int size_log2) {
+	switch (size_log2) {
+		case 1:
+			return ((const uint16_t *) p)[i];
+		case 2:
+			return ((const uint32_t *) p)[i];
+		default:
+			return ((const uint64_t *) p)[i];
+	}
+}
+
+static force_inline void ta_radix_put(uint8_t *p, size_t i, uint64_t v,
+				      int size_log2) {
+	switch (size_log2) {
+		case 1:
+			((uint16_t *) p)[i] = v;
+			break;
+		case 2:
+			((uint32_t *) p)[i] = v;
+			break;
+		default:
+			((uint64_t *) p)[i] = v;
+			break;
+	}
+}
+
+static force_inline void ta_radix_pass(TARadixTask *t, int size_log2) {
+	const uint8_t *src = t->src;
+	uint8_t *dst = t->dst;
+	int shift = t->shift;
+	size_t i, end = t->end, count[256];
+	uint64_t v;
+
+	/* local copy of the counts so that they can stay in the cache
+	   lines of the stack */
+	if (t->scatter) {
+		memcpy(count, t->count, sizeof(count));
+		for (i = t->start; i < end; i++) {
+			v = ta_radix_get(src, i, size_log2);
+			ta_radix_put(dst, count[(v >> shift) & 0xff]++, v,
+				     size_log2);
+		}
+	} else {
+		memset(count, 0, sizeof(count));
+		for (i = t->start; i < end; i++)
+			count[(ta_radix_get(src, i, size_log2) >> shift) & 0xff]++;
+		memcpy(t->count, count, sizeof(count));
+	}
+}
+
+static void ta_radix_run(TARadixTask *t) {
+	switch (t->size_log2) {
+		case 1:
+			ta_radix_pass(t, 1);
+			break;
+		case 2:
+			ta_radix_pass(t, 2);
+			break;
+		default:
+			ta_radix_pass(t, 3);
+			break;
+	}
+}
+
+#ifdef CONFIG_ATOMICS
+static void *ta_radix_thread(void *opaque) {
+	ta_radix_run(opaque);
+	return nullptr;
+}
+#endif
+
+static void ta_radix_run_tasks(TARadixTask *tasks, int n) {
+#ifdef CONFIG_ATOMICS
+	pthread_t tid[TA_RADIX_MAX_THREADS];
+	BOOL started[TA_RADIX_MAX_THREADS];
+	int i;
+
+	for (i = 1; i < n; i++) {
+		started[i] = !pthread_create(&tid[i], nullptr, ta_radix_thread,
+					     &tasks[i]);
+	}
+	ta_radix_run(&tasks[0]);
+	for (i = 1; i < n; i++) {
+		/* the task is run by this thread if no thread could be
+		   created */
+		if (started[i])
+			pthread_join(tid[i], nullptr);
+		else
+			ta_radix_run(&tasks[i]);
+	}
+#else
+	ta_radix_run(&tasks[0]);
+#endif
+}
+
+static int ta_radix_thread_count(size_t len) {
+#ifdef CONFIG_ATOMICS
+	long n;
+	if (len < 2 * TA_RADIX_THREAD_MIN_LEN)
+		return 1;
+	n = sysconf(_SC_NPROCESSORS_ONLN);
+	n = min_int64(n, len / TA_RADIX_THREAD_MIN_LEN);
+	return max_int(min_int(n, TA_RADIX_MAX_THREADS), 1);
+#else
+	return 1;
+#endif
+}
+
+/* Sort the 'len' unsigned integer keys of 1 << size_log2 bytes of 'a'.
+   'tmp' is a buffer of the same size. Each pass is split between
+   'nthreads' threads: the output position of a key depends on its
+   digit and on the task which handles it. */
+static void ta_radix_sort(uint8_t *a, uint8_t *tmp, size_t len,
+			  int size_log2, int nthreads) {
+	TARadixTask tasks[TA_RADIX_MAX_THREADS];
+	uint8_t *src = a, *dst = tmp, *t;
+	size_t pos, c;
+	int i, d, shift;
+
+	for (i = 0; i < nthreads; i++) {
+		tasks[i].start = len * i / nthreads;
+		tasks[i].end = len * (i + 1) / nthreads;
+		tasks[i].size_log2 = size_log2;
+	}
+	for (shift = 0; shift < (8 << size_log2); shift += 8) {
+		for (i = 0; i < nthreads; i++) {
+			tasks[i].src = src;
+			tasks[i].dst = dst;
+			tasks[i].shift = shift;
+			tasks[i].scatter = FALSE;
+		}
+		ta_radix_run_tasks(tasks, nthreads);
+		pos = 0;
+		for (d = 0; d < 256; d++) {
+			for (i = 0; i < nthreads; i++) {
+				c = tasks[i].count[d];
+				tasks[i].count[d] = pos;
+				pos += c;
+			}
+			/* no need to move the keys if they have the same
+			   digit */
+			if (pos == len && tasks[0].count[d] == 0)
+				break;
+		}
+		if (d < 256)
+			continue;
+		for (i = 0; i < nthreads; i++)
+			tasks[i].scatter = TRUE;
+		ta_radix_run_tasks(tasks, nthreads);
+		t = src;
+		src = dst;
+		dst = t;
+	}
+	if (src != a)
+		memcpy(a, src, len << size_log2);
+}
+
+/* The floating point keys: the sign bit is inverted for positive
+   numbers and all the bits for negative numbers, so that -0 is
+   before +0. */
+#define TA_FLOAT_KEY(v, sign) \
+	((v) ^ ((sign) | -((v) >> (sizeof(v) * 8 - 1))))
+#define TA_FLOAT_UNKEY(v, sign) \
+	((v) ^ ((sign) | (((v) >> (sizeof(v) * 8 - 1)) - 1)))
+
+/* Sort with the default comparison. Return FALSE if not done because
+   the array is too small or because of a memory error. */
+static BOOL js_TA_sort_default(JSContext *ctx, int class_id, uint8_t *a,
+			       size_t len) {
+	int size_log2 = typed_array_size_log2(class_id);
+	size_t i, j, n;
+	uint8_t *tmp;
+
+	if (len < TA_RADIX_MIN_LEN)
+		return FALSE;
+	if (size_log2 == 0) {
+		size_t count[256];
+		int first;
+
+		memset(count, 0, sizeof(count));
+		for (i = 0; i < len; i++)
+			count[a[i]]++;
+		/* the negative values come first */
+		first = (class_id == JS_CLASS_INT8_ARRAY) ? 128 : 0;
+		j = 0;
+		for (i = 0; i < 256; i++) {
+			n = count[(i + first) & 0xff];
+			memset(a + j, (i + first) & 0xff, n);
+			j += n;
+		}
+		return TRUE;
+	}
+
+	tmp = js_malloc_rt(ctx->rt, len << size_log2);
+	if (!tmp)
+		return FALSE;
+	n = len;
+	switch (class_id) {
+		case JS_CLASS_INT16_ARRAY:
+			for (i = 0; i < len; i++)
+				((uint16_t *) a)[i] ^= 0x8000;
+			break;
+		case JS_CLASS_INT32_ARRAY:
+			for (i = 0; i < len; i++)
+				((uint32_t *) a)[i] ^= 0x80000000;
+			break;
+		case JS_CLASS_BIG_INT64_ARRAY:
+			for (i = 0; i < len; i++)
+				((uint64_t *) a)[i] ^= (uint64_t) 1 << 63;
+			break;
+		case JS_CLASS_FLOAT32_ARRAY: {
+			uint32_t *p = (uint32_t *) a, *q = (uint32_t *) tmp;
+			/* NaNs go to the end, keeping their bits */
+			j = 0;
+			for (i = 0; i < len; i++) {
+				if ((p[i] & 0x7fffffff) > 0x7f800000)
+					q[j++] = p[i];
+				else
+					p[i - j] = TA_FLOAT_KEY(p[i], 0x80000000);
+			}
+			n = len - j;
+			memcpy(p + n, q, j * sizeof(p[0]));
+		}
+		break;
+		case JS_CLASS_FLOAT64_ARRAY: {
+			uint64_t *p = (uint64_t *) a, *q = (uint64_t *) tmp;
+			j = 0;
+			for (i = 0; i < len; i++) {
+				if ((p[i] & INT64_MAX) > 0x7ff0000000000000)
+					q[j++] = p[i];
+				else
+					p[i - j] = TA_FLOAT_KEY(p[i],
+							       (uint64_t) 1 << 63);
+			}
+			n = len - j;
+			memcpy(p + n, q, j * sizeof(p[0]));
+		}
+		break;
+		default:
+			break;
+	}
+
+	ta_radix_sort(a, tmp, n, size_log2, ta_radix_thread_count(n));
+
+	switch (class_id) {
+		case JS_CLASS_INT16_ARRAY:
+			for (i = 0; i < len; i++)
+				((uint16_t *) a)[i] ^= 0x8000;
+			break;
+		case JS_CLASS_INT32_ARRAY:
+			for (i = 0; i < len; i++)
+				((uint32_t *) a)[i] ^= 0x80000000;
+			break;
+		case JS_CLASS_BIG_INT64_ARRAY:
+			for (i = 0; i < len; i++)
+				((uint64_t *) a)[i] ^= (uint64_t) 1 << 63;
+			break;
+		case JS_CLASS_FLOAT32_ARRAY: {
+			uint32_t *p = (uint32_t *) a;
+			for (i = 0; i < n; i++)
+				p[i] = TA_FLOAT_UNKEY(p[i], 0x80000000);
+		}
+		break;
+		case JS_CLASS_FLOAT64_ARRAY: {
+			uint64_t *p = (uint64_t *) a;
+			for (i = 0; i < n; i++)
+				p[i] = TA_FLOAT_UNKEY(p[i], (uint64_t) 1 << 63);
+		}
+		break;
+		default:
+			break;
+	}
+	js_free_rt(ctx->rt, tmp);
+	return TRUE;
+}
+
+#undef TA_FLOAT_KEY
+#undef TA_FLOAT_UNKEY
+
 struct TA_sort_context {
 	JSContext *ctx;
 	int exception; /* 1 = exception, 2 = detached typed array */
@@ -57257,10 +61441,6 @@ static int js_TA_cmp_generic(const void *a, const void *b, void *opaque) {
 				cmp = (val > 0) - (val < 0);
 			}
 		}
-		if (cmp == 0) {
-			/* make sort stable: compare array offsets */
-			cmp = (a_idx > b_idx) - (a_idx < b_idx);
-		}
 		if (unlikely(typed_array_is_detached(ctx,
 			JS_VALUE_GET_PTR(psc->arr)))) {
 			psc->exception = 2;
@@ -57346,16 +61526,18 @@ static JSValue js_typed_array_sort(JSContext *ctx, JSValueConst this_val,
 			void *array_tmp;
 			size_t i, j;
 
-			/* XXX: a stable sort would use less memory */
-			array_idx = js_malloc(ctx, len * sizeof(array_idx[0]));
+			/* the indexes are followed by the temporary buffer of
+			   timsort() */
+			array_idx = js_malloc(ctx, (len + len / 2 + 1) *
+					      sizeof(array_idx[0]));
 			if (!array_idx)
 				return JS_EXCEPTION;
 			for (i = 0; i < len; i++)
 				array_idx[i] = i;
 			tsc.array_ptr = array_ptr;
 			tsc.elt_size = elt_size;
-			rqsort(array_idx, len, sizeof(array_idx[0]),
-			       js_TA_cmp_generic, &tsc);
+			timsort(array_idx, len, sizeof(array_idx[0]),
+				js_TA_cmp_generic, &tsc, array_idx + len);
 			if (tsc.exception) {
 				if (tsc.exception == 1)
 					goto fail;
@@ -57420,7 +61602,7 @@ static JSValue js_typed_array_sort(JSContext *ctx, JSValueConst this_val,
 				js_free(ctx, array_tmp);
 			}
 			js_free(ctx, array_idx);
-		} else {
+		} else if (!js_TA_sort_default(ctx, p->class_id, array_ptr, len)) {
 			rqsort(array_ptr, len, elt_size, cmpfun, &tsc);
 			if (tsc.exception)
 				return JS_EXCEPTION;
@@ -57683,6 +61865,10 @@ static JSValue js_typed_array_constructor_ta(JSContext *ctx,
 		/* same type: copy the content */
 		memcpy(abuf->data, src_abuf->data + ta->offset,
 		       abuf->byte_length);
+	} else if (typed_array_is_bigint(p->class_id) ==
+		   typed_array_is_bigint(classid)) {
+		typed_array_convert(classid, abuf->data, p->class_id,
+				    src_abuf->data + ta->offset, len);
 	} else {
 		for (i = 0; i < len; i++) {
 			JSValue val;
@@ -58089,6 +62275,526 @@ static const JSCFunctionListEntry js_dataview_proto_funcs[] = {
 			   JS_PROP_CONFIGURABLE),
 };
 
+/* TextEncoder, TextDecoder */
+
+typedef struct JSTextDecoder {
+	uint8_t fatal;
+	uint8_t ignore_bom;
+	uint8_t bom_seen; /* TRUE if the first code point was decoded */
+	/* incomplete UTF-8 sequence at the end of the previous chunk */
+	uint8_t bytes_needed;
+	uint8_t bytes_seen;
+	uint8_t lower_boundary;
+	uint8_t upper_boundary;
+	uint32_t code_point;
+} JSTextDecoder;
+
+static int js_text_check_class(JSContext *ctx, JSValueConst this_val,
+			       int class_id) {
+	if (JS_VALUE_GET_TAG(this_val) != JS_TAG_OBJECT ||
+	    JS_VALUE_GET_OBJ(this_val)->class_id != class_id) {
+		JS_ThrowTypeErrorInvalidClass(ctx, class_id);
+		return -1;
+	}
+	return 0;
+}
+
+static JSValue js_text_get_encoding(JSContext *ctx, JSValueConst this_val,
+				    int magic) {
+	if (js_text_check_class(ctx, this_val, magic))
+		return JS_EXCEPTION;
+	return JS_NewString(ctx, "utf-8");
+}
+
+static JSValue js_text_encoder_constructor(JSContext *ctx,
+					   JSValueConst new_target,
+					   int argc, JSValueConst *argv) {
+	return js_create_from_ctor(ctx, new_target, JS_CLASS_TEXT_ENCODER);
+}
+
+/* create a Uint8Array using 'buf' (allocated with js_malloc()) as
+   storage. 'buf' is freed in case of exception. */
+static JSValue js_new_uint8_array(JSContext *ctx, uint8_t *buf, size_t len) {
+	JSValue buffer, obj;
+
+	buffer = js_array_buffer_constructor3(ctx, JS_UNDEFINED, len,
+					      JS_CLASS_ARRAY_BUFFER, buf,
+					      js_array_buffer_free, nullptr,
+					      FALSE);
+	if (JS_IsException(buffer)) {
+		js_free(ctx, buf);
+		return JS_EXCEPTION;
+	}
+	obj = js_create_from_ctor(ctx, JS_UNDEFINED, JS_CLASS_UINT8_ARRAY);
+	if (JS_IsException(obj)) {
+		JS_FreeValue(ctx, buffer);
+		return JS_EXCEPTION;
+	}
+	if (typed_array_init(ctx, obj, buffer, 0, len)) {
+		JS_FreeValue(ctx, obj);
+		return JS_EXCEPTION;
+	}
+	return obj;
+}
+
+static JSValue js_text_encoder_encode(JSContext *ctx, JSValueConst this_val,
+				      int argc, JSValueConst *argv) {
+	JSValue str;
+	JSString *p;
+	uint8_t *buf;
+	size_t size;
+	int pos;
+
+	if (js_text_check_class(ctx, this_val, JS_CLASS_TEXT_ENCODER))
+		return JS_EXCEPTION;
+	if (argc < 1 || JS_IsUndefined(argv[0]))
+		str = JS_AtomToString(ctx, JS_ATOM_empty_string);
+	else
+		str = JS_ToString(ctx, argv[0]);
+	if (JS_IsException(str))
+		return JS_EXCEPTION;
+	p = JS_VALUE_GET_STRING(str);
+	if (!p->is_wide_char) {
+		pos = ascii_prefix_len(p->u.str8, p->len);
+		size = p->len + latin1_non_ascii_count(p->u.str8 + pos,
+						       p->len - pos);
+	} else {
+		size = utf16_to_utf8_len(p->u.str16, p->len, FALSE);
+	}
+	buf = js_malloc(ctx, max_int(size, 1));
+	if (!buf) {
+		JS_FreeValue(ctx, str);
+		return JS_EXCEPTION;
+	}
+	if (!p->is_wide_char) {
+		utf8_encode8(buf, size, p->u.str8, p->len, &pos);
+	} else {
+		utf8_encode16(buf, size, p->u.str16, p->len, &pos,
+			      UTF8_ENCODE_REPLACE);
+	}
+	JS_FreeValue(ctx, str);
+	return js_new_uint8_array(ctx, buf, size);
+}
+
+static JSValue js_text_encoder_encodeInto(JSContext *ctx,
+					  JSValueConst this_val,
+					  int argc, JSValueConst *argv) {
+	JSValue str, obj;
+	JSString *p;
+	JSObject *pa;
+	size_t written;
+	int read;
+
+	if (js_text_check_class(ctx, this_val, JS_CLASS_TEXT_ENCODER))
+		return JS_EXCEPTION;
+	str = JS_ToString(ctx, argv[0]);
+	if (JS_IsException(str))
+		return JS_EXCEPTION;
+	if (JS_VALUE_GET_TAG(argv[1]) != JS_TAG_OBJECT ||
+	    JS_VALUE_GET_OBJ(argv[1])->class_id != JS_CLASS_UINT8_ARRAY) {
+		JS_FreeValue(ctx, str);
+		return JS_ThrowTypeError(ctx, "not a Uint8Array");
+	}
+	/* the length is 0 if the array buffer is detached */
+	pa = JS_VALUE_GET_OBJ(argv[1]);
+	p = JS_VALUE_GET_STRING(str);
+	if (!p->is_wide_char) {
+		written = utf8_encode8(pa->u.array.u.uint8_ptr,
+				       pa->u.array.count, p->u.str8, p->len,
+				       &read);
+	} else {
+		written = utf8_encode16(pa->u.array.u.uint8_ptr,
+					pa->u.array.count, p->u.str16, p->len,
+					&read, UTF8_ENCODE_REPLACE);
+	}
+	JS_FreeValue(ctx, str);
+	obj = JS_NewObject(ctx);
+	if (JS_IsException(obj))
+		return obj;
+	if (JS_DefinePropertyValue(ctx, obj, JS_ATOM_read,
+				   JS_NewInt32(ctx, read), JS_PROP_C_W_E) < 0 ||
+	    JS_DefinePropertyValue(ctx, obj, JS_ATOM_written,
+				   JS_NewInt64(ctx, written),
+				   JS_PROP_C_W_E) < 0) {
+		JS_FreeValue(ctx, obj);
+		return JS_EXCEPTION;
+	}
+	return obj;
+}
+
+static void text_decoder_reset(JSTextDecoder *s) {
+	s->bytes_needed = 0;
+	s->bytes_seen = 0;
+	s->lower_boundary = 0x80;
+	s->upper_boundary = 0xbf;
+	s->code_point = 0;
+}
+
+/* output the code point 'c' to 'buf'. Return the number of 16 bit
+   characters. */
+static int text_decoder_output(JSTextDecoder *s, uint16_t *buf, uint32_t c) {
+	if (!s->bom_seen) {
+		s->bom_seen = TRUE;
+		if (c == 0xfeff && !s->ignore_bom)
+			return 0;
+	}
+	if (c >= 0x10000) {
+		buf[0] = get_hi_surrogate(c);
+		buf[1] = get_lo_surrogate(c);
+		return 2;
+	}
+	buf[0] = c;
+	return 1;
+}
+
+static int text_decoder_error(JSContext *ctx, JSTextDecoder *s,
+			      uint16_t *buf) {
+	text_decoder_reset(s);
+	if (s->fatal) {
+		s->bom_seen = FALSE;
+		JS_ThrowTypeError(ctx, "invalid UTF-8 data");
+		return -1;
+	}
+	return text_decoder_output(s, buf, 0xfffd);
+}
+
+/* Decode the byte at '*pp' as specified by the WHATWG Encoding
+   standard and output at most 2 characters to 'buf'. The byte is not
+   consumed if it is an invalid continuation byte so that it is
+   decoded again as the start of a sequence. Return the number of
+   output characters or -1 if exception. */
+static int text_decoder_feed(JSContext *ctx, JSTextDecoder *s, uint16_t *buf,
+			     const uint8_t **pp) {
+	const uint8_t *p = *pp;
+	uint32_t c, b = *p;
+
+	if (s->bytes_needed == 0) {
+		p++;
+		*pp = p;
+		if (b < 0x80) {
+			return text_decoder_output(s, buf, b);
+		} else if (b >= 0xc2 && b <= 0xdf) {
+			s->bytes_needed = 1;
+			s->code_point = b & 0x1f;
+		} else if (b >= 0xe0 && b <= 0xef) {
+			if (b == 0xe0)
+				s->lower_boundary = 0xa0;
+			else if (b == 0xed)
+				s->upper_boundary = 0x9f;
+			s->bytes_needed = 2;
+			s->code_point = b & 0xf;
+		} else if (b >= 0xf0 && b <= 0xf4) {
+			if (b == 0xf0)
+				s->lower_boundary = 0x90;
+			else if (b == 0xf4)
+				s->upper_boundary = 0x8f;
+			s->bytes_needed = 3;
+			s->code_point = b & 0x7;
+		} else {
+			return text_decoder_error(ctx, s, buf);
+		}
+		return 0;
+	}
+	if (b < s->lower_boundary || b > s->upper_boundary)
+		return text_decoder_error(ctx, s, buf);
+	*pp = p + 1;
+	s->lower_boundary = 0x80;
+	s->upper_boundary = 0xbf;
+	s->code_point = (s->code_point << 6) | (b & 0x3f);
+	if (++s->bytes_seen < s->bytes_needed)
+		return 0;
+	c = s->code_point;
+	text_decoder_reset(s);
+	return text_decoder_output(s, buf, c);
+}
+
+/* end of the stream */
+static int text_decoder_flush(JSContext *ctx, JSTextDecoder *s,
+			      uint16_t *buf) {
+	int n = 0;
+	if (s->bytes_needed != 0)
+		n = text_decoder_error(ctx, s, buf);
+	s->bom_seen = FALSE;
+	return n;
+}
+
+static JSValue js_text_decode(JSContext *ctx, JSTextDecoder *s,
+			      const uint8_t *p, size_t size, BOOL stream) {
+	const uint8_t *p_end = p + size, *p_body_end, *q;
+	uint16_t prefix[8], suffix[8], buf[2];
+	int prefix_len = 0, suffix_len = 0, n, i, c_or = 0;
+	int64_t len;
+	BOOL is_wide;
+	JSString *str;
+	StringBuffer b_s, *b = &b_s;
+
+	/* complete the sequence of the previous chunk */
+	while (s->bytes_needed != 0 && p < p_end && prefix_len <= 4) {
+		n = text_decoder_feed(ctx, s, prefix + prefix_len, &p);
+		if (n < 0)
+			return JS_EXCEPTION;
+		prefix_len += n;
+	}
+	if (s->bytes_needed != 0 && p < p_end)
+		goto slow_path;
+
+	/* in streaming mode, an incomplete sequence at the end of the
+	   chunk is kept for the next call */
+	p_body_end = p_end;
+	if (stream) {
+		for (q = p_end; q > p && p_end - q < 3;) {
+			q--;
+			if (*q >= 0xc0) {
+				n = *q >= 0xf0 ? 4 : *q >= 0xe0 ? 3 : 2;
+				if (p_end - q < n)
+					p_body_end = q;
+				break;
+			} else if (*q < 0x80) {
+				break;
+			}
+		}
+	}
+	if (!s->bom_seen && p < p_body_end) {
+		s->bom_seen = TRUE;
+		if (!s->ignore_bom && p_body_end - p >= 3 && p[0] == 0xef &&
+		    p[1] == 0xbb && p[2] == 0xbf)
+			p += 3;
+	}
+	len = utf8_decode_len(p, p_body_end, &is_wide);
+	if (len < 0)
+		goto slow_path;
+	for (q = p_body_end; q < p_end;) {
+		n = text_decoder_feed(ctx, s, suffix + suffix_len, &q);
+		if (n < 0)
+			return JS_EXCEPTION;
+		suffix_len += n;
+	}
+	if (!stream) {
+		n = text_decoder_flush(ctx, s, suffix + suffix_len);
+		if (n < 0)
+			return JS_EXCEPTION;
+		suffix_len += n;
+	}
+	for (i = 0; i < prefix_len; i++)
+		c_or |= prefix[i];
+	for (i = 0; i < suffix_len; i++)
+		c_or |= suffix[i];
+	is_wide |= (c_or >= 0x100);
+	len += prefix_len + suffix_len;
+	if (len > JS_STRING_LEN_MAX)
+		return JS_ThrowInternalError(ctx, "string too long");
+	if (len == 0)
+		return JS_AtomToString(ctx, JS_ATOM_empty_string);
+	str = js_alloc_string(ctx, len, is_wide);
+	if (!str)
+		return JS_EXCEPTION;
+	if (is_wide) {
+		memcpy(str->u.str16, prefix, prefix_len * 2);
+		utf8_decode16(str->u.str16 + prefix_len, p, p_body_end);
+		memcpy(str->u.str16 + len - suffix_len, suffix, suffix_len * 2);
+	} else {
+		for (i = 0; i < prefix_len; i++)
+			str->u.str8[i] = prefix[i];
+		utf8_decode8(str->u.str8 + prefix_len, p, p_body_end);
+		for (i = 0; i < suffix_len; i++)
+			str->u.str8[len - suffix_len + i] = suffix[i];
+		str->u.str8[len] = '\0';
+	}
+	return JS_MKPTR(JS_TAG_STRING, str);
+
+slow_path:
+	/* invalid sequences are replaced with U+FFFD */
+	if (string_buffer_init(ctx, b, p_end - p + prefix_len))
+		return JS_EXCEPTION;
+	string_buffer_write16(b, prefix, prefix_len);
+	while (p < p_end) {
+		if (s->bytes_needed == 0 && *p < 0x80) {
+			q = p + ascii_prefix_len(p, p_end - p);
+			string_buffer_write8(b, p, q - p);
+			s->bom_seen = TRUE;
+			p = q;
+			continue;
+		}
+		n = text_decoder_feed(ctx, s, buf, &p);
+		if (n < 0)
+			goto fail;
+		string_buffer_write16(b, buf, n);
+	}
+	if (!stream) {
+		n = text_decoder_flush(ctx, s, buf);
+		if (n < 0)
+			goto fail;
+		string_buffer_write16(b, buf, n);
+	}
+	return string_buffer_end(b);
+fail:
+	string_buffer_free(b);
+	return JS_EXCEPTION;
+}
+
+/* return TRUE if 'label' is a label of the UTF-8 encoding */
+static BOOL is_utf8_label(const char *label, size_t len) {
+	static const char utf8_labels[] =
+		"unicode-1-1-utf-8\0unicode11utf8\0unicode20utf8\0utf-8\0"
+		"utf8\0x-unicode20utf8\0";
+	const char *p;
+
+	/* remove the leading and trailing ASCII whitespace */
+	while (len > 0 && strchr(" \t\n\f\r", label[0]) && label[0] != '\0') {
+		label++;
+		len--;
+	}
+	while (len > 0 && strchr(" \t\n\f\r", label[len - 1]) &&
+	       label[len - 1] != '\0')
+		len--;
+	for (p = utf8_labels; *p != '\0'; p += strlen(p) + 1) {
+		if (strlen(p) == len && !strncasecmp(p, label, len))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static JSValue js_text_decoder_constructor(JSContext *ctx,
+					   JSValueConst new_target,
+					   int argc, JSValueConst *argv) {
+	JSValueConst label_val, options;
+	JSValue obj, val;
+	JSTextDecoder *s;
+	const char *label;
+	size_t len;
+	BOOL is_utf8 = TRUE;
+	int fatal = FALSE, ignore_bom = FALSE;
+
+	label_val = argc > 0 ? argv[0] : JS_UNDEFINED;
+	options = argc > 1 ? argv[1] : JS_UNDEFINED;
+	if (!JS_IsUndefined(label_val)) {
+		label = JS_ToCStringLen(ctx, &len, label_val);
+		if (!label)
+			return JS_EXCEPTION;
+		is_utf8 = is_utf8_label(label, len);
+		JS_FreeCString(ctx, label);
+	}
+	if (JS_IsObject(options)) {
+		val = JS_GetProperty(ctx, options, JS_ATOM_fatal);
+		if (JS_IsException(val))
+			return JS_EXCEPTION;
+		fatal = JS_ToBoolFree(ctx, val);
+		val = JS_GetProperty(ctx, options, JS_ATOM_ignoreBOM);
+		if (JS_IsException(val))
+			return JS_EXCEPTION;
+		ignore_bom = JS_ToBoolFree(ctx, val);
+	} else if (!JS_IsUndefined(options) && !JS_IsNull(options)) {
+		return JS_ThrowTypeError(ctx, "options must be an object");
+	}
+	if (!is_utf8)
+		return JS_ThrowRangeError(ctx, "unsupported encoding");
+
+	obj = js_create_from_ctor(ctx, new_target, JS_CLASS_TEXT_DECODER);
+	if (JS_IsException(obj))
+		return obj;
+	s = js_mallocz(ctx, sizeof(*s));
+	if (!s) {
+		JS_FreeValue(ctx, obj);
+		return JS_EXCEPTION;
+	}
+	s->fatal = fatal;
+	s->ignore_bom = ignore_bom;
+	text_decoder_reset(s);
+	JS_SetOpaque(obj, s);
+	return obj;
+}
+
+static void js_text_decoder_finalizer(JSRuntime *rt, JSValue val) {
+	JSObject *p = JS_VALUE_GET_OBJ(val);
+	js_free_rt(rt, p->u.text_decoder);
+}
+
+static JSValue js_text_decoder_get_flag(JSContext *ctx, JSValueConst this_val,
+					int magic) {
+	JSTextDecoder *s = JS_GetOpaque2(ctx, this_val, JS_CLASS_TEXT_DECODER);
+	if (!s)
+		return JS_EXCEPTION;
+	return JS_NewBool(ctx, magic ? s->ignore_bom : s->fatal);
+}
+
+static JSValue js_text_decoder_decode(JSContext *ctx, JSValueConst this_val,
+				      int argc, JSValueConst *argv) {
+	JSTextDecoder *s = JS_GetOpaque2(ctx, this_val, JS_CLASS_TEXT_DECODER);
+	JSValueConst input, options;
+	JSArrayBuffer *abuf;
+	JSObject *p;
+	JSValue val;
+	const uint8_t *buf = nullptr;
+	size_t len = 0;
+	BOOL stream = FALSE;
+
+	if (!s)
+		return JS_EXCEPTION;
+	input = argc > 0 ? argv[0] : JS_UNDEFINED;
+	options = argc > 1 ? argv[1] : JS_UNDEFINED;
+	/* the options are read first because the getters may detach the
+	   buffer */
+	if (JS_IsObject(options)) {
+		val = JS_GetProperty(ctx, options, JS_ATOM_stream);
+		if (JS_IsException(val))
+			return JS_EXCEPTION;
+		stream = JS_ToBoolFree(ctx, val);
+	} else if (!JS_IsUndefined(options) && !JS_IsNull(options)) {
+		return JS_ThrowTypeError(ctx, "options must be an object");
+	}
+	if (!JS_IsUndefined(input)) {
+		if (JS_VALUE_GET_TAG(input) != JS_TAG_OBJECT)
+			goto invalid_buffer;
+		p = JS_VALUE_GET_OBJ(input);
+		if (p->class_id == JS_CLASS_ARRAY_BUFFER ||
+		    p->class_id == JS_CLASS_SHARED_ARRAY_BUFFER) {
+			abuf = p->u.array_buffer;
+			if (!abuf->detached) {
+				buf = abuf->data;
+				len = abuf->byte_length;
+			}
+		} else if (p->class_id >= JS_CLASS_UINT8C_ARRAY &&
+			   p->class_id <= JS_CLASS_DATAVIEW) {
+			JSTypedArray *ta = p->u.typed_array;
+			abuf = ta->buffer->u.array_buffer;
+			if (!abuf->detached) {
+				buf = abuf->data + ta->offset;
+				len = ta->length;
+			}
+		} else {
+		invalid_buffer:
+			return JS_ThrowTypeError(
+				ctx, "not an ArrayBuffer or an ArrayBufferView");
+		}
+	}
+	return js_text_decode(ctx, s, buf, len, stream);
+}
+
+static const JSCFunctionListEntry js_text_encoder_proto_funcs[] = {
+	JS_CGETSET_MAGIC_DEF("encoding", js_text_get_encoding, nullptr,
+			     JS_CLASS_TEXT_ENCODER),
+	JS_CFUNC_DEF("encode", 0, js_text_encoder_encode),
+	JS_CFUNC_DEF("encodeInto", 2, js_text_encoder_encodeInto),
+	JS_PROP_STRING_DEF("[Symbol.toStringTag]", "TextEncoder",
+			   JS_PROP_CONFIGURABLE),
+};
+
+static const JSCFunctionListEntry js_text_decoder_proto_funcs[] = {
+	JS_CGETSET_MAGIC_DEF("encoding", js_text_get_encoding, nullptr,
+			     JS_CLASS_TEXT_DECODER),
+	JS_CGETSET_MAGIC_DEF("fatal", js_text_decoder_get_flag, nullptr, 0),
+	JS_CGETSET_MAGIC_DEF("ignoreBOM", js_text_decoder_get_flag, nullptr, 1),
+	JS_CFUNC_DEF("decode", 0, js_text_decoder_decode),
+	JS_PROP_STRING_DEF("[Symbol.toStringTag]", "TextDecoder",
+			   JS_PROP_CONFIGURABLE),
+};
+
+static JSClassShortDef const js_text_class_def[] = {
+	{JS_ATOM_TextEncoder, nullptr, nullptr}, /* JS_CLASS_TEXT_ENCODER */
+	{JS_ATOM_TextDecoder, js_text_decoder_finalizer, nullptr},
+	/* JS_CLASS_TEXT_DECODER */
+};
+
 /* Atomics */
 #ifdef CONFIG_ATOMICS
 
@@ -58670,6 +63376,27 @@ void JS_AddIntrinsicTypedArrays(JSContext *ctx) {
 	JS_NewGlobalCConstructorOnly(ctx, "DataView",
 				     js_dataview_constructor, 1,
 				     ctx->class_proto[JS_CLASS_DATAVIEW]);
+
+	/* TextEncoder, TextDecoder */
+	if (!JS_IsRegisteredClass(ctx->rt, JS_CLASS_TEXT_ENCODER)) {
+		init_class_range(ctx->rt, js_text_class_def,
+				 JS_CLASS_TEXT_ENCODER,
+				 countof(js_text_class_def));
+	}
+	ctx->class_proto[JS_CLASS_TEXT_ENCODER] = JS_NewObject(ctx);
+	JS_SetPropertyFunctionList(ctx, ctx->class_proto[JS_CLASS_TEXT_ENCODER],
+				   js_text_encoder_proto_funcs,
+				   countof(js_text_encoder_proto_funcs));
+	JS_NewGlobalCConstructorOnly(ctx, "TextEncoder",
+				     js_text_encoder_constructor, 0,
+				     ctx->class_proto[JS_CLASS_TEXT_ENCODER]);
+	ctx->class_proto[JS_CLASS_TEXT_DECODER] = JS_NewObject(ctx);
+	JS_SetPropertyFunctionList(ctx, ctx->class_proto[JS_CLASS_TEXT_DECODER],
+				   js_text_decoder_proto_funcs,
+				   countof(js_text_decoder_proto_funcs));
+	JS_NewGlobalCConstructorOnly(ctx, "TextDecoder",
+				     js_text_decoder_constructor, 0,
+				     ctx->class_proto[JS_CLASS_TEXT_DECODER]);
 	/* Atomics */
 #ifdef CONFIG_ATOMICS
 	JS_AddIntrinsicAtomics(ctx);
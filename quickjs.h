@@ -85,6 +85,11 @@ enum {
 	JS_TAG_EXCEPTION = 6,
 	JS_TAG_FLOAT64 = 7,
 	/* any larger tag is FLOAT64 if JS_NAN_BOXING */
+	/* short Latin-1 string stored in the value. It is a string like
+	   JS_TAG_STRING but has no JSString pointer: test strings with
+	   JS_IsString() and read them with JS_ToCString(). Never used with
+	   JS_NAN_BOXING */
+	JS_TAG_SHORT_STRING = 8,
 };
 
 typedef struct JSRefCountHeader {
@@ -246,6 +251,7 @@ static inline JS_BOOL JS_VALUE_IS_NAN(JSValue v) {
 #define JS_VALUE_IS_BOTH_FLOAT(v1, v2) (JS_TAG_IS_FLOAT64(JS_VALUE_GET_TAG(v1)) && JS_TAG_IS_FLOAT64(JS_VALUE_GET_TAG(v2)))
 
 #define JS_VALUE_GET_OBJ(v) ((JSObject *)JS_VALUE_GET_PTR(v))
+/* only valid for JS_TAG_STRING, not for JS_TAG_SHORT_STRING */
 #define JS_VALUE_GET_STRING(v) ((JSString *)JS_VALUE_GET_PTR(v))
 #define JS_VALUE_HAS_REF_COUNT(v) ((unsigned)JS_VALUE_GET_TAG(v) >= (unsigned)JS_TAG_FIRST)
 
@@ -371,6 +377,10 @@ void JS_MarkValue(JSRuntime *rt, JSValueConst val, JS_MarkFunc *mark_func);
 
 void JS_RunGC(JSRuntime *rt);
 
+/* shrink the runtime hash tables after many atoms or shapes were
+   freed. Meant to be called when the runtime is idle. */
+void JS_CompactMemory(JSRuntime *rt);
+
 JS_BOOL JS_IsLiveObject(JSRuntime *rt, JSValueConst obj);
 
 JSContext *JS_NewContext(JSRuntime *rt);
@@ -476,6 +486,69 @@ void JS_ComputeMemoryUsage(JSRuntime *rt, JSMemoryUsage *s);
 
 void JS_DumpMemoryUsage(FILE *fp, const JSMemoryUsage *s, JSRuntime *rt);
 
+/* GC and allocation counters. Unlike JS_ComputeMemoryUsage(), they are
+   maintained incrementally so reading them is cheap. */
+#define JS_GC_PAUSE_HISTOGRAM_SIZE 24
+
+typedef struct JSGCStats {
+	int64_t malloc_size, malloc_limit, malloc_count;
+	/* free blocks kept for reuse, included in malloc_size */
+	int64_t pool_size, pool_count;
+	/* malloc_size - pool_size triggering the next GC */
+	int64_t gc_threshold;
+	int64_t obj_count; /* live objects */
+	int64_t obj_alloc_count; /* objects allocated since startup */
+	int64_t hashed_shape_count; /* shapes which may be shared */
+	int64_t gc_count; /* number of JS_RunGC() calls */
+	int64_t gc_auto_count; /* number of GCs triggered by gc_threshold */
+	int64_t gc_freed_count; /* GC objects freed by the cycle removal */
+	int64_t gc_pause_total; /* total GC pause time in ns */
+	int64_t gc_pause_max; /* longest GC pause in ns */
+	/* number of pauses of less than 1 us for index 0, between 2^(i-1)
+	   and 2^i us for index i, and longer for the last index */
+	int64_t gc_pause_histogram[JS_GC_PAUSE_HISTOGRAM_SIZE];
+} JSGCStats;
+
+typedef struct JSClassStats {
+	JSAtom class_name; /* JS_ATOM_NULL if the class is not registered */
+	int64_t obj_alloc_count; /* objects allocated since startup */
+	int64_t obj_count; /* live objects */
+} JSClassStats;
+
+void JS_GetGCStats(JSRuntime *rt, JSGCStats *s);
+
+/* return FALSE if 'class_id' is larger than the registered class ids */
+JS_BOOL JS_GetClassStats(JSRuntime *rt, JSClassID class_id, JSClassStats *s);
+
+void JS_DumpGCStats(FILE *fp, JSRuntime *rt);
+
+/* policy computing the malloc_size triggering the next automatic GC. It
+   is applied after each GC triggered by the threshold. */
+typedef enum JSGCPolicyEnum {
+	/* the heap may grow by 'growth' percent of the live size (default) */
+	JS_GC_POLICY_GROWTH,
+	/* keep the GC time around 'overhead' percent of the running time */
+	JS_GC_POLICY_OVERHEAD,
+	/* run the GC after about 'interval' ms of allocation */
+	JS_GC_POLICY_ALLOC_RATE,
+	/* the threshold is returned by 'threshold_func' */
+	JS_GC_POLICY_CUSTOM,
+} JSGCPolicyEnum;
+
+typedef struct JSGCPolicy {
+	JSGCPolicyEnum kind;
+	int growth; /* in percent, default = 50 */
+	int overhead; /* in percent, default = 5 */
+	int interval; /* in ms, default = 100 */
+	size_t min_threshold; /* lower bound of the threshold, default = 256 KB */
+	size_t (*threshold_func)(JSRuntime *rt, const JSGCStats *s,
+				 void *opaque);
+	void *opaque;
+} JSGCPolicy;
+
+void JS_GetGCPolicy(JSRuntime *rt, JSGCPolicy *policy);
+void JS_SetGCPolicy(JSRuntime *rt, const JSGCPolicy *policy);
+
 /* atom support */
 #define JS_ATOM_NULL 0
 
@@ -684,7 +757,8 @@ static inline JS_BOOL JS_IsUninitialized(JSValueConst v) {
 }
 
 static inline JS_BOOL JS_IsString(JSValueConst v) {
-	return JS_VALUE_GET_TAG(v) == JS_TAG_STRING;
+	int tag = JS_VALUE_GET_TAG(v);
+	return tag == JS_TAG_STRING || tag == JS_TAG_SHORT_STRING;
 }
 
 static inline JS_BOOL JS_IsSymbol(JSValueConst v) {
@@ -1076,6 +1150,7 @@ int JS_EnqueueJob(JSContext *ctx, JSJobFunc *job_func, int argc,
 JS_BOOL JS_IsJobPending(JSRuntime *rt);
 
 int JS_ExecutePendingJob(JSRuntime *rt, JSContext **pctx);
+int JS_ExecutePendingJobs(JSRuntime *rt, int max, JSContext **pctx);
 
 /* Object Writer/Reader (currently only used to handle precompiled code) */
 #define JS_WRITE_OBJ_BYTECODE  (1 << 0) /* allow function/module */
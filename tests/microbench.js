@@ -136,7 +136,7 @@ function log_one(text, n, ti) {
     }
 }
 
-function bench(f, text) {
+async function bench(f, text) {
     var i, j, n, t, ti, nb_its, ref, ti_n, ti_n1;
 
     nb_its = n = 1;
@@ -151,6 +151,8 @@ function bench(f, text) {
             for (j = 0; j < max_iterations; j++) {
                 t = get_clock();
                 nb_its = f(n);
+                if (f.async)
+                    nb_its = await nb_its;
                 t = get_clock() - t;
                 if (nb_its < 0)
                     return; // test failure
@@ -297,6 +299,34 @@ function prop_create(n) {
     return n * 20;
 }
 
+function prop_create_literal(n) {
+    var obj, j;
+    for (j = 0; j < n; j++) {
+        obj = { a: j, b: 2, c: 3, d: 4, e: 5, f: 6, g: 7, h: 8, i: 9, j: 10 };
+    }
+    return n * 10;
+}
+
+function prop_create_ctor(n) {
+    var obj, j;
+    function Point(x) {
+        this.a = x;
+        this.b = 2;
+        this.c = 3;
+        this.d = 4;
+        this.e = 5;
+        this.f = 6;
+        this.g = 7;
+        this.h = 8;
+        this.i = 9;
+        this.j = 10;
+    }
+    for (j = 0; j < n; j++) {
+        obj = new Point(j);
+    }
+    return n * 10;
+}
+
 function prop_clone(n) {
     var ref, obj, j, k;
     ref = {a: 1, b: 2, c: 3, d: 4, e: 5, f: 6, g: 7, h: 8, i: 9, j: 10};
@@ -334,6 +364,43 @@ function prop_delete(n) {
     return n * 20;
 }
 
+function prop_map_add(n) {
+    var keys, obj, j, k;
+    keys = [];
+    for (k = 0; k < 200; k++) {
+        keys[k] = "key" + k;
+    }
+    for (j = 0; j < n; j++) {
+        obj = {};
+        for (k = 0; k < 200; k++) {
+            obj[keys[k]] = k;
+        }
+    }
+    global_res = obj;
+    return n * 200;
+}
+
+function prop_map_churn(n) {
+    var keys, obj, j, k;
+    keys = [];
+    for (k = 0; k < 200; k++) {
+        keys[k] = "key" + k;
+    }
+    obj = {};
+    for (k = 0; k < 100; k++) {
+        obj[keys[k]] = k;
+    }
+    for (j = 0; j < n; j++) {
+        /* sliding window of 100 live keys */
+        for (k = 0; k < 200; k++) {
+            obj[keys[(k + 100) % 200]] = k;
+            delete obj[keys[k]];
+        }
+    }
+    global_res = obj;
+    return n * 200;
+}
+
 function array_read(n) {
     var tab, len, sum, i, j;
     tab = [];
@@ -434,6 +501,35 @@ function array_hole_length_decr(n) {
     return len * n;
 }
 
+function array_reverse_create(n) {
+    var tab, i, j, len;
+    len = 1000;
+    for (j = 0; j < n; j++) {
+        tab = new Array(len);
+        for (i = len; i-- > 0;)
+            tab[i] = i;
+    }
+    return len * n;
+}
+
+function array_hole_delete(n) {
+    var tab, ref, i, j, len, sum;
+    len = 1000;
+    ref = [];
+    for (i = 0; i < len; i++)
+        ref[i] = i;
+    sum = 0;
+    for (j = 0; j < n; j++) {
+        tab = ref.slice();
+        for (i = 0; i < len; i += 2)
+            delete tab[i];
+        for (i = 1; i < len; i += 2)
+            sum += tab[i];
+    }
+    global_res = sum;
+    return len * n;
+}
+
 function array_push(n) {
     var tab, i, j, len;
     len = 500;
@@ -445,6 +541,34 @@ function array_push(n) {
     return len * n;
 }
 
+function array_push_float(n) {
+    var tab, i, j, len, sum;
+    len = 500;
+    sum = 0;
+    for (j = 0; j < n; j++) {
+        tab = [];
+        for (i = 0; i < len; i++)
+            tab.push(i * 0.5);
+        for (i = 0; i < len; i++)
+            sum += tab[i];
+    }
+    global_res = sum;
+    return len * n;
+}
+
+function array_indexOf_int(n) {
+    var tab, i, j, len, sum;
+    len = 500;
+    tab = [];
+    for (i = 0; i < len; i++)
+        tab.push(i);
+    sum = 0;
+    for (j = 0; j < n; j++)
+        sum += tab.indexOf(len - 1);
+    global_res = sum;
+    return len * n;
+}
+
 function array_pop(n) {
     var tab, ref, i, j, len, sum;
     len = 500;
@@ -505,6 +629,154 @@ function typed_array_write(n) {
     return len * n;
 }
 
+function typed_array_fill(n) {
+    var tab, len, j;
+    len = 1000;
+    tab = new Float32Array(len);
+    for (j = 0; j < n; j++)
+        tab.fill(j);
+    global_res = tab[len - 1];
+    return len * n;
+}
+
+function typed_array_indexOf(n) {
+    var tab, len, i, j, sum;
+    len = 1000;
+    tab = new Int16Array(len);
+    for (i = 0; i < len; i++)
+        tab[i] = i;
+    sum = 0;
+    for (j = 0; j < n; j++) {
+        sum += tab.indexOf(len - 1);
+        sum += tab.lastIndexOf(0);
+    }
+    global_res = sum;
+    return len * n * 2;
+}
+
+function typed_array_includes(n) {
+    var tab, len, i, j, sum;
+    len = 1000;
+    tab = new Float64Array(len);
+    for (i = 0; i < len; i++)
+        tab[i] = i / 2;
+    sum = 0;
+    for (j = 0; j < n; j++) {
+        sum += tab.includes(-1);
+        sum += tab.includes(NaN);
+    }
+    global_res = sum;
+    return len * n * 2;
+}
+
+function typed_array_set(n) {
+    var src, dst, len, i, j;
+    len = 1000;
+    src = new Int32Array(len);
+    dst = new Int32Array(len * 2);
+    for (i = 0; i < len; i++)
+        src[i] = i;
+    for (j = 0; j < n; j++)
+        dst.set(src, j & 1);
+    global_res = dst[len];
+    return len * n;
+}
+
+function typed_array_set_convert(n) {
+    var src, dst, len, i, j;
+    len = 1000;
+    src = new Int16Array(len);
+    dst = new Float32Array(len);
+    for (i = 0; i < len; i++)
+        src[i] = i * 31 - 15000;
+    for (j = 0; j < n; j++)
+        dst.set(src);
+    global_res = dst[len - 1];
+    return len * n;
+}
+
+function typed_array_set_narrow(n) {
+    var src, dst, len, i, j;
+    len = 1000;
+    src = new Float64Array(len);
+    dst = new Uint8ClampedArray(len);
+    for (i = 0; i < len; i++)
+        src[i] = i * 0.3 - 10;
+    for (j = 0; j < n; j++)
+        dst.set(src);
+    global_res = dst[len - 1];
+    return len * n;
+}
+
+function typed_array_from_typed(n) {
+    var src, dst, len, i, j;
+    len = 1000;
+    src = new Uint8Array(len);
+    for (i = 0; i < len; i++)
+        src[i] = i;
+    for (j = 0; j < n; j++)
+        dst = new Float64Array(src);
+    global_res = dst[len - 1];
+    return len * n;
+}
+
+function typed_array_copyWithin(n) {
+    var tab, len, j;
+    len = 1000;
+    tab = new Float64Array(len);
+    for (j = 0; j < n; j++)
+        tab.copyWithin(j & 7, 8, len - 8);
+    global_res = tab[0];
+    return len * n;
+}
+
+function typed_array_slice(n) {
+    var tab, len, i, j, sum;
+    len = 1000;
+    tab = new Uint16Array(len);
+    for (i = 0; i < len; i++)
+        tab[i] = i;
+    sum = 0;
+    for (j = 0; j < n; j++)
+        sum += tab.slice(j & 7).length + tab.subarray(8).slice().length;
+    global_res = sum;
+    return len * n * 2;
+}
+
+function typed_array_sort(n, array_type, gen) {
+    var ref, tab, len, i, j;
+    len = 10000;
+    ref = new array_type(len);
+    for (i = 0; i < len; i++)
+        ref[i] = gen(i);
+    tab = new array_type(len);
+    for (j = 0; j < n; j++) {
+        tab.set(ref);
+        tab.sort();
+    }
+    global_res = tab[0];
+    return len * n;
+}
+
+function typed_array_sort_uint8(n) {
+    return typed_array_sort(n, Uint8Array, (i) => Math.random() * 256);
+}
+
+function typed_array_sort_int32(n) {
+    return typed_array_sort(n, Int32Array,
+                            (i) => (Math.random() - 0.5) * 2 ** 32);
+}
+
+function typed_array_sort_float64(n) {
+    return typed_array_sort(n, Float64Array,
+                            (i) => (Math.random() - 0.5) * 1e6);
+}
+
+function typed_array_sort_timestamp(n) {
+    return typed_array_sort(n, Float64Array,
+                            (i) => 1.7e12 + Math.floor(Math.random() * 1e9));
+}
+
 var global_var0;
 
 function global_read(n) {
@@ -640,6 +912,83 @@ function func_closure_call(n) {
     return n * 4;
 }
 
+function func_apply(n) {
+    function f(a, b, c) {
+        return 1;
+    }
+    function g() {
+        return f.apply(this, arguments);
+    }
+
+    var j, sum, args;
+    args = [1, 2, 3];
+    sum = 0;
+    for (j = 0; j < n; j++) {
+        sum += f.apply(null, args);
+        sum += f.apply(null, args);
+        sum += g(1, 2, 3);
+        sum += g(1, 2, 3);
+    }
+    global_res = sum;
+    return n * 4;
+}
+
+function func_spread_call(n) {
+    function f(a, b, c) {
+        return 1;
+    }
+    function g(...args) {
+        return f(...args);
+    }
+
+    var j, sum, args;
+    args = [1, 2, 3];
+    sum = 0;
+    for (j = 0; j < n; j++) {
+        sum += f(...args);
+        sum += f(...args);
+        sum += g(1, 2, 3);
+        sum += g(1, 2, 3);
+    }
+    global_res = sum;
+    return n * 4;
+}
+
+function func_tail_call(n) {
+    "use strict";
+    function f(i, acc) {
+        if (i == 0)
+            return acc;
+        return f(i - 1, acc + 1);
+    }
+
+    var j, sum;
+    sum = 0;
+    for (j = 0; j < n; j++) {
+        sum += f(100, 0);
+    }
+    global_res = sum;
+    return n * 100;
+}
+
+// non strict version: the calls do not reuse the frame
+var func_tail_call_sloppy =
+    (1, eval)(`(function func_tail_call_sloppy(n)
+           {
+               function f(i, acc) {
+                   if (i == 0)
+                       return acc;
+                   return f(i - 1, acc + 1);
+               }
+               var j, sum;
+               sum = 0;
+               for(j = 0; j < n; j++) {
+                   sum += f(100, 0);
+               }
+               global_res = sum;
+               return n * 100;
+           })`);
+
 function int_arith(n) {
     var i, j, sum;
     global_res = 0;
@@ -716,6 +1065,29 @@ function bigint256_arith(n) {
     return bigint_arith(n, 256);
 }
 
+var bigint_map, bigint_keys;
+
+function map_get_bigint(n) {
+    var m, i, j, sum, len = 1000000;
+    if (!bigint_map) {
+        /* 64 bit snowflake like ids */
+        bigint_map = new Map();
+        bigint_keys = [];
+        for (i = 0; i < len; i++) {
+            bigint_keys[i] = (BigInt(1600000000000 + i * 3) << 22n) | BigInt(i & 4095);
+            bigint_map.set(bigint_keys[i], i);
+        }
+    }
+    m = bigint_map;
+    sum = 0;
+    for (j = 0; j < n; j++) {
+        for (i = 0; i < 1000; i++)
+            sum += m.get(bigint_keys[(i * 4099 + j) % len]);
+    }
+    global_res = sum;
+    return n * 1000;
+}
+
 function set_collection_add(n) {
     var s, i, j, len = 100;
     for (j = 0; j < n; j++) {
@@ -731,6 +1103,132 @@ function set_collection_add(n) {
     return n * len;
 }
 
+function map_set(n) {
+    var m, i, j, len = 1000;
+    for (j = 0; j < n; j++) {
+        m = new Map();
+        for (i = 0; i < len; i++)
+            m.set(i, i);
+    }
+    global_res = m;
+    return n * len;
+}
+
+var large_map;
+
+function map_get_large(n) {
+    var m, i, j, sum, len = 200000;
+    if (!large_map) {
+        large_map = new Map();
+        for (i = 0; i < len; i++)
+            large_map.set(i * 7919, i);
+    }
+    m = large_map;
+    sum = 0;
+    for (j = 0; j < n; j++) {
+        for (i = 0; i < 1000; i++)
+            sum += m.get(((i * 4099 + j) % len) * 7919);
+    }
+    global_res = sum;
+    return n * 1000;
+}
+
+function map_delete_add(n) {
+    var m, i, j, len = 1000;
+    m = new Map();
+    for (i = 0; i < len; i++)
+        m.set(i, i);
+    for (j = 0; j < n; j++) {
+        for (i = 0; i < len; i++) {
+            m.delete(j * len + i);
+            m.set((j + 1) * len + i, i);
+        }
+    }
+    global_res = m;
+    return n * len;
+}
+
+function map_get_string(n) {
+    var m, i, j, keys, sum, len = 1000;
+    m = new Map();
+    keys = [];
+    for (i = 0; i < len; i++) {
+        m.set("key_" + i + "_suffix", i);
+        keys[i] = "key_" + i + "_suffix";
+    }
+    sum = 0;
+    for (j = 0; j < n; j++) {
+        for (i = 0; i < len; i++)
+            sum += m.get(keys[i]);
+    }
+    global_res = sum;
+    return n * len;
+}
+
+function weak_map_set(n) {
+    var m, i, j, keys, len = 1000;
+    keys = [];
+    for (i = 0; i < len; i++)
+        keys[i] = {};
+    for (j = 0; j < n; j++) {
+        m = new WeakMap();
+        for (i = 0; i < len; i++)
+            m.set(keys[i], i);
+    }
+    global_res = m;
+    return n * len;
+}
+
+function weak_ref_deref(n) {
+    var objs, refs, i, j, sum, len = 1000;
+    objs = [];
+    refs = [];
+    for (i = 0; i < len; i++) {
+        objs[i] = { v: i };
+        refs[i] = new WeakRef(objs[i]);
+    }
+    sum = 0;
+    for (j = 0; j < n; j++) {
+        for (i = 0; i < len; i++)
+            sum += refs[i].deref().v;
+    }
+    global_res = sum;
+    return n * len;
+}
+
+function finalization_registry(n) {
+    var fr, objs, i, j, len = 1000;
+    fr = new FinalizationRegistry(function (v) { });
+    objs = [];
+    for (i = 0; i < len; i++)
+        objs[i] = {};
+    for (j = 0; j < n; j++) {
+        for (i = 0; i < len; i++)
+            fr.register(objs[i], i, objs[i]);
+        for (i = 0; i < len; i++)
+            fr.unregister(objs[i]);
+    }
+    global_res = fr;
+    return n * len;
+}
+
+function prop_read_string_key(n) {
+    var obj, i, j, keys, sum, len = 100;
+    obj = {};
+    keys = [];
+    for (i = 0; i < len; i++) {
+        obj["property_name_" + i] = i;
+        keys[i] = "property_name_" + i;
+    }
+    sum = 0;
+    for (j = 0; j < n; j++) {
+        for (i = 0; i < len; i++)
+            sum += obj[keys[i]];
+    }
+    global_res = sum;
+    return n * len;
+}
+
 function array_for(n) {
     var r, i, j, sum, len = 100;
     r = [];
@@ -776,6 +1274,37 @@ function array_for_of(n) {
     return n * len;
 }
 
+function object_for_in(n) {
+    var objs, i, j, k, sum, len = 100;
+    objs = [];
+    for (i = 0; i < len; i++)
+        objs[i] = {a: i, b: 1, c: 2, d: 3, e: 4, f: 5, g: 6, h: 7};
+    for (j = 0; j < n; j++) {
+        sum = 0;
+        for (i = 0; i < len; i++) {
+            for (k in objs[i])
+                sum++;
+        }
+        global_res = sum;
+    }
+    return n * len;
+}
+
+function object_keys(n) {
+    var objs, i, j, sum, len = 100;
+    objs = [];
+    for (i = 0; i < len; i++)
+        objs[i] = {a: i, b: 1, c: 2, d: 3, e: 4, f: 5, g: 6, h: 7};
+    for (j = 0; j < n; j++) {
+        sum = 0;
+        for (i = 0; i < len; i++) {
+            sum += Object.keys(objs[i]).length;
+        }
+        global_res = sum;
+    }
+    return n * len;
+}
+
 function math_min(n) {
     var i, j, r;
     r = 0;
@@ -883,6 +1412,291 @@ function string_build4(n) {
     return n * 1000;
 }
 
+var string_text8, string_text16;
+
+function string_text(wide) {
+    var i, r, words = ["lorem", "ipsum", "dolor", "sit", "amet", "consectetur"];
+    if (!string_text8) {
+        r = [];
+        for (i = 0; i < 2000; i++)
+            r.push(words[(i * 7) % words.length] + i);
+        string_text8 = r.join(" ") + " ~";
+        string_text16 = r.join(" ") + " \u2026";
+    }
+    return wide ? string_text16 : string_text8;
+}
+
+/* 'n' searches in a 20K character text, the result is the number of
+   scanned characters */
+function string_search(n, wide, needle) {
+    var j, r, text = string_text(wide);
+    r = 0;
+    for (j = 0; j < n; j++)
+        r += text.indexOf(needle);
+    global_res = r;
+    return n * r / j;
+}
+
+function string_indexOf_char(n) {
+    return string_search(n, false, "~");
+}
+
+function string_indexOf_char16(n) {
+    return string_search(n, true, "\u2026");
+}
+
+function string_indexOf(n) {
+    return string_search(n, false, "ipsum1999");
+}
+
+function string_indexOf16(n) {
+    return string_search(n, true, "ipsum1999");
+}
+
+function string_includes(n) {
+    var j, r, text = string_text(false);
+    r = 0;
+    for (j = 0; j < n; j++)
+        r += text.includes("dolor" + (j & 1023), 10000);
+    global_res = r;
+    return n * 10000;
+}
+
+function string_split(n) {
+    var j, i, r, lines = [];
+    for (i = 0; i < 100; i++)
+        lines.push(i + ",field" + i + ",\"quoted text\"," + i * 3.5);
+    r = 0;
+    for (j = 0; j < n; j++) {
+        for (i = 0; i < lines.length; i++)
+            r += lines[i].split(",").length;
+    }
+    global_res = r;
+    return n * lines.length;
+}
+
+function string_char_scan(n) {
+    var i, j, c, r, text = string_text(false);
+    r = 0;
+    for (j = 0; j < n; j++) {
+        for (i = 0; i < 1000; i++) {
+            c = text[i];
+            if (c === " " || c === text.charAt(i + 1))
+                r++;
+        }
+    }
+    global_res = r;
+    return n * 1000;
+}
+
+function string_split_chars(n) {
+    var j, r, counts, text = string_text(false).substring(0, 1000);
+    for (j = 0; j < n; j++) {
+        counts = {};
+        r = text.split("");
+        for (var c of r)
+            counts[c] = (counts[c] | 0) + 1;
+    }
+    global_res = counts;
+    return n * 1000;
+}
+
+/* UTF-8 transcoding of a 20K character text through a temporary
+   file, the result is the number of characters */
+var utf8_texts;
+
+function utf8_text(kind) {
+    var text;
+    if (!utf8_texts) {
+        text = string_text(false);
+        utf8_texts = [ text, text.replace(/o/g, "\u00f6"),
+                       text.replace(/o/g, "\u00f6").replace(/s/g, "\u0161") ];
+    }
+    return utf8_texts[kind];
+}
+
+function utf8_decode(n, kind) {
+    var j, r, f, text = utf8_text(kind);
+    var filename = "microbench-utf8.tmp";
+    f = std.open(filename, "w");
+    f.puts(text);
+    f.close();
+    for (j = 0; j < n; j++) {
+        r = std.loadFile(filename);
+    }
+    os.remove(filename);
+    global_res = r;
+    return n * text.length;
+}
+
+function utf8_encode(n, kind) {
+    var j, f, text = utf8_text(kind);
+    f = std.tmpfile();
+    for (j = 0; j < n; j++) {
+        f.seek(0, std.SEEK_SET);
+        f.puts(text);
+    }
+    f.close();
+    return n * text.length;
+}
+
+function utf8_decode_ascii(n) {
+    return utf8_decode(n, 0);
+}
+
+function utf8_decode_latin1(n) {
+    return utf8_decode(n, 1);
+}
+
+function utf8_decode_bmp(n) {
+    return utf8_decode(n, 2);
+}
+
+function utf8_encode_ascii(n) {
+    return utf8_encode(n, 0);
+}
+
+function utf8_encode_latin1(n) {
+    return utf8_encode(n, 1);
+}
+
+function utf8_encode_bmp(n) {
+    return utf8_encode(n, 2);
+}
+
+/* TextEncoder / TextDecoder of a 20K character text, the result is
+   the number of characters */
+function text_encode(n, kind) {
+    var j, r, enc = new TextEncoder(), text = utf8_text(kind);
+    for (j = 0; j < n; j++)
+        r = enc.encode(text);
+    global_res = r;
+    return n * text.length;
+}
+
+function text_decode(n, kind) {
+    var j, r, dec = new TextDecoder(), text = utf8_text(kind);
+    var buf = new TextEncoder().encode(text);
+    for (j = 0; j < n; j++)
+        r = dec.decode(buf);
+    global_res = r;
+    return n * text.length;
+}
+
+function text_encode_ascii(n) {
+    return text_encode(n, 0);
+}
+
+function text_encode_bmp(n) {
+    return text_encode(n, 2);
+}
+
+function text_encodeInto(n) {
+    var j, r, enc = new TextEncoder(), text = utf8_text(2);
+    var buf = new Uint8Array(text.length * 3);
+    for (j = 0; j < n; j++)
+        r = enc.encodeInto(text, buf);
+    global_res = r;
+    return n * text.length;
+}
+
+function text_decode_ascii(n) {
+    return text_decode(n, 0);
+}
+
+function text_decode_latin1(n) {
+    return text_decode(n, 1);
+}
+
+function text_decode_bmp(n) {
+    return text_decode(n, 2);
+}
+
+/* decode by chunks of 1000 bytes which split the sequences */
+function text_decode_stream(n) {
+    var j, i, r, dec = new TextDecoder(), text = utf8_text(2);
+    var buf = new TextEncoder().encode(text);
+    for (j = 0; j < n; j++) {
+        r = "";
+        for (i = 0; i < buf.length; i += 1000)
+            r += dec.decode(buf.subarray(i, i + 1000), { stream: true });
+        r += dec.decode();
+    }
+    global_res = r;
+    return n * text.length;
+}
+
+function generator_create(n) {
+    function* g(a, b) {
+        yield a;
+        yield b;
+    }
+    var j, v, r = 0;
+    for (j = 0; j < n; j++) {
+        for (v of g(j, 1))
+            r += v;
+    }
+    global_res = r;
+    return n;
+}
+
+/* promise jobs: the asynchronous tests return a promise resolved when
+   all their jobs are done */
+
+async function promise_then(n) {
+    var j, p = Promise.resolve(0);
+    for (j = 0; j < n; j++)
+        p = p.then((x) => x + 1);
+    global_res = await p;
+    return n;
+}
+promise_then.async = true;
+
+async function promise_await(n) {
+    var j, r = 0;
+    for (j = 0; j < n; j++)
+        r += await j;
+    global_res = r;
+    return n;
+}
+promise_await.async = true;
+
+async function promise_await_call(n) {
+    async function add1(x) {
+        return x + 1;
+    }
+    var j, r = 0;
+    for (j = 0; j < n; j++)
+        r = await add1(r);
+    global_res = r;
+    return n;
+}
+promise_await_call.async = true;
+
+/* chain of 10 nested async calls awaiting resolved values */
+async function async_call_chain(n) {
+    async function f(depth) {
+        if (depth == 0)
+            return await 1;
+        return (await f(depth - 1)) + (await depth);
+    }
+    var j, r = 0;
+    for (j = 0; j < n; j++)
+        r += await f(10);
+    global_res = r;
+    return n * 10;
+}
+async_call_chain.async = true;
+
+async function promise_all(n) {
+    var j, tab = [];
+    for (j = 0; j < n; j++)
+        tab.push(Promise.resolve(j));
+    global_res = await Promise.all(tab);
+    return n;
+}
+promise_all.async = true;
+
 /* sort bench */
 
 function sort_bench(text) {
@@ -965,9 +1779,52 @@ function sort_bench(text) {
             arr[n - 1] = def[0];
     }
 
+    // sorted with n / 64 random swaps
+    function partial(arr, n, def) {
+        for (var i = 0; i < n; i++)
+            arr[i] = def[i];
+        for (var i = 0; i < n >> 6; i++) {
+            var j = (Math.random() * n) >> 0;
+            var k = (Math.random() * n) >> 0;
+            var t = arr[j];
+            arr[j] = arr[k];
+            arr[k] = t;
+        }
+    }
+
+    // 16 interleaved sorted runs
+    function runs(arr, n, def) {
+        var len = n >> 4;
+        for (var i = 0; i < n; i++)
+            arr[i] = def[(i % len) * 16 + ((i / len) >> 0)];
+    }
+
+    // sorted with 1/16 random elements appended
+    function append(arr, n, def) {
+        var m = n - (n >> 4);
+        for (var i = 0; i < m; i++)
+            arr[i] = def[i];
+        for (var i = m; i < n; i++)
+            arr[i] = def[(Math.random() * n) >> 0];
+    }
+
+    // sorted runs in reverse order
+    function revruns(arr, n, def) {
+        var len = n >> 4;
+        for (var i = 0; i < n; i++) {
+            var r = (i / len) >> 0;
+            arr[i] = def[r < 16 ? (15 - r) * len + i % len : i];
+        }
+    }
+
+    function compare(a, b) {
+        return a < b ? -1 : a > b ? 1 : 0;
+    }
+
     var sort_cases = [random, random8, random1, jigsaw, hill, comb,
         crisscross, zero, increasing, decreasing, alternate,
-        incbutone, incbutlast, incbutfirst];
+        incbutone, incbutlast, incbutfirst, partial, runs, append,
+        revruns];
 
     var n = sort_bench.array_size || 10000;
     var array_type = sort_bench.array_type || Array;
@@ -996,7 +1853,10 @@ function sort_bench(text) {
             arr = new array_type(n);
             f(arr, n, def);
             var t1 = get_clock();
-            arr.sort();
+            if (sort_bench.compare)
+                arr.sort(compare);
+            else
+                arr.sort();
             t1 = get_clock() - t1;
             tx += t1;
             if (!ti || ti > t1)
@@ -1035,6 +1895,7 @@ function sort_bench(text) {
 
 sort_bench.bench = true;
 sort_bench.verbose = false;
+sort_bench.compare = false;
 
 function int_to_string(n) {
     var s, j;
@@ -1142,7 +2003,7 @@ function save_result(filename, obj) {
         console.log("cannot save " + filename);
 }
 
-function main(argc, argv, g) {
+async function main(argc, argv, g) {
     var test_list = [
         empty_loop,
         empty_down_loop,
@@ -1154,18 +2015,39 @@ function main(argc, argv, g) {
         prop_write,
         prop_update,
         prop_create,
+        prop_create_literal,
+        prop_create_ctor,
         prop_clone,
         prop_delete,
+        prop_map_add,
+        prop_map_churn,
         array_read,
         array_write,
         array_prop_create,
         array_slice,
         array_length_decr,
         array_hole_length_decr,
+        array_reverse_create,
+        array_hole_delete,
         array_push,
+        array_push_float,
+        array_indexOf_int,
         array_pop,
         typed_array_read,
         typed_array_write,
+        typed_array_fill,
+        typed_array_indexOf,
+        typed_array_includes,
+        typed_array_set,
+        typed_array_set_convert,
+        typed_array_set_narrow,
+        typed_array_from_typed,
+        typed_array_copyWithin,
+        typed_array_slice,
+        typed_array_sort_uint8,
+        typed_array_sort_int32,
+        typed_array_sort_float64,
+        typed_array_sort_timestamp,
         global_read,
         global_write,
         global_write_strict,
@@ -1175,12 +2057,26 @@ function main(argc, argv, g) {
         global_func_call,
         func_call,
         func_closure_call,
+        func_tail_call,
+        func_tail_call_sloppy,
+        func_apply,
+        func_spread_call,
         int_arith,
         float_arith,
         set_collection_add,
+        map_set,
+        map_get_large,
+        map_delete_add,
+        map_get_string,
+        weak_map_set,
+        weak_ref_deref,
+        finalization_registry,
+        prop_read_string_key,
         array_for,
         array_for_in,
         array_for_of,
+        object_for_in,
+        object_keys,
         math_min,
         regexp_ascii,
         regexp_utf16,
@@ -1190,6 +2086,14 @@ function main(argc, argv, g) {
         string_build2,
         string_build3,
         string_build4,
+        string_indexOf_char,
+        string_indexOf_char16,
+        string_indexOf,
+        string_indexOf16,
+        string_includes,
+        string_split,
+        string_char_scan,
+        string_split_chars,
         int_to_string,
         float_to_string,
         string_to_int,
@@ -1203,11 +2107,37 @@ function main(argc, argv, g) {
         /* BigInt test */
         test_list.push(bigint64_arith);
         test_list.push(bigint256_arith);
+        test_list.push(map_get_bigint);
     }
     if (typeof BigFloat === "function") {
         /* BigFloat test */
         test_list.push(float256_arith);
     }
+    if (typeof std !== "undefined") {
+        /* UTF-8 transcoding tests */
+        test_list.push(utf8_decode_ascii);
+        test_list.push(utf8_decode_latin1);
+        test_list.push(utf8_decode_bmp);
+        test_list.push(utf8_encode_ascii);
+        test_list.push(utf8_encode_latin1);
+        test_list.push(utf8_encode_bmp);
+    }
+    if (typeof TextEncoder === "function") {
+        /* TextEncoder / TextDecoder tests */
+        test_list.push(text_encode_ascii);
+        test_list.push(text_encode_bmp);
+        test_list.push(text_encodeInto);
+        test_list.push(text_decode_ascii);
+        test_list.push(text_decode_latin1);
+        test_list.push(text_decode_bmp);
+        test_list.push(text_decode_stream);
+    }
+    test_list.push(generator_create);
+    test_list.push(promise_then);
+    test_list.push(promise_await);
+    test_list.push(promise_await_call);
+    test_list.push(async_call_chain);
+    test_list.push(promise_all);
     test_list.push(sort_bench);
 
     for (i = 1; i < argc;) {
@@ -1216,6 +2146,10 @@ function main(argc, argv, g) {
             sort_bench.verbose = true;
             continue;
         }
+        if (name == "-c") {
+            sort_bench.compare = true;
+            continue;
+        }
         if (name == "-t") {
             name = argv[i++];
             sort_bench.array_type = g[name];
@@ -1259,7 +2193,7 @@ function main(argc, argv, g) {
 
     for (i = 0; i < tests.length; i++) {
         f = tests[i];
-        bench(f, f.name, ref_data, log_data);
+        await bench(f, f.name, ref_data, log_data);
         if (ref_data && ref_data[f.name])
             n++;
     }
@@ -210,6 +210,52 @@ function test_enum() {
     assert(tab, ["1", "4294967294", "x", "18014398509481984", "9007199254740992", "9007199254740991", "4294967296", "4294967295", "y"], "keys");
 }
 
+function test_object_dict() {
+    var a, b, i, s, keys;
+
+    /* deleting the last properties */
+    a = {x: 1, y: 2, z: 3};
+    delete a.z;
+    delete a.y;
+    a.w = 4;
+    a.y = 5;
+    assert(Object.keys(a), ["x", "w", "y"], "delete last");
+    delete a.x;
+    assert(Object.keys(a), ["w", "y"], "delete first");
+    delete a.y;
+    delete a.w;
+    assert(Object.keys(a).length, 0, "delete all");
+    assert(a.w, undefined, "delete all");
+    a.y = 6;
+    a.x = 7;
+    assert(Object.keys(a), ["y", "x"], "delete all");
+    assert(a.y + a.x, 13, "delete all");
+
+    /* object used as a dictionary */
+    a = {};
+    b = {};
+    for(i = 0; i < 200; i++) {
+        a["k" + i] = i;
+        b["k" + i] = i;
+    }
+    for(i = 0; i < 200; i += 2)
+        delete a["k" + i];
+    for(i = 0; i < 10; i++)
+        a["k" + i] = -i;
+    keys = Object.keys(a);
+    assert(keys.length, 105, "dictionary");
+    assert(keys[0], "k1", "dictionary");
+    assert(keys[100], "k0", "dictionary");
+    assert(a.k199 + a.k1 + a.k2, 196, "dictionary");
+    s = 0;
+    for(i in b)
+        s += b[i];
+    assert(s, 199 * 100, "dictionary");
+    b.k300 = 1;
+    assert(a.k300, undefined, "dictionary");
+    assert(Object.keys(b).length, 201, "dictionary");
+}
+
 function test_array() {
     var a, err;
 
@@ -253,6 +299,237 @@ function test_array() {
     assert(err && a.toString() === "1,2,3,4");
 }
 
+function test_array_holes() {
+    var a, i, n, s, k;
+
+    a = [1, 2, 3, 4, 5];
+    delete a[1];
+    assert(a.length, 5);
+    assert(1 in a, false);
+    assert(a[1], undefined);
+    assert(Object.keys(a).join(), "0,2,3,4");
+    s = "";
+    for (k in a)
+        s += k;
+    assert(s, "0234");
+    assert(a.indexOf(undefined), -1);
+    assert(a.includes(undefined), true);
+    assert(a.slice().hasOwnProperty(1), false);
+
+    /* holes are looked up in the prototype chain */
+    Array.prototype[1] = "p";
+    assert(a[1], "p");
+    assert([...a].join(), "1,p,3,4,5");
+    delete Array.prototype[1];
+
+    a[1] = 2;
+    assert(a.join(), "1,2,3,4,5");
+
+    a = [1, , 3];
+    assert(a.hasOwnProperty(1), false);
+    assert(Object.getOwnPropertyDescriptor(a, 1), undefined);
+    Object.defineProperty(a, 1, { value: 2, writable: true,
+                                  enumerable: true, configurable: true });
+    assert(a.join(), "1,2,3");
+
+    a = [];
+    a[5] = 1;
+    a[2] = 2;
+    assert(a.length, 6);
+    assert(Object.keys(a).join(), "2,5");
+    assert(JSON.stringify(a), "[null,null,2,null,null,1]");
+
+    a = [0, 1, 2, 3];
+    delete a[3];
+    delete a[1];
+    assert(a.length, 4);
+    assert(Object.keys(a).join(), "0,2");
+    a.length = 2;
+    a.push(7);
+    assert(a.join(), "0,,7");
+
+    Object.defineProperty(Array.prototype, 3, {
+        set: function(v) { this.x = v; }, configurable: true });
+    a = [0, 1, 2, 3, 4];
+    delete a[3];
+    a[3] = 5;
+    assert(a.x, 5);
+    assert(a.hasOwnProperty(3), false);
+    delete Array.prototype[3];
+
+    /* filled in reverse order */
+    n = 10000;
+    a = new Array(n);
+    for (i = n - 1; i >= 0; i--)
+        a[i] = i;
+    s = 0;
+    for (i = 0; i < n; i++)
+        s += a[i];
+    assert(s, n * (n - 1) / 2);
+    assert(Object.keys(a).length, n);
+
+    /* sparse array filled up again */
+    a = [];
+    a[n] = n;
+    for (i = 0; i < n; i++)
+        a[i] = i;
+    assert(a.length, n + 1);
+    assert(a.indexOf(n - 1), n - 1);
+    assert(a.lastIndexOf(n), n);
+}
+
+function test_array_kinds() {
+    var a, i, s;
+
+    a = [1, 2, 3];
+    a.push(4);
+    assert(a.join(), "1,2,3,4");
+    a[1] = 2.5;
+    assert(a[1], 2.5);
+    assert(a[0], 1);
+    a[2] = -0;
+    assert(Object.is(a[2], -0), true);
+    assert(a.indexOf(0), 2);
+    assert(a.includes(-0), true);
+    a.push(NaN);
+    assert(a.includes(NaN), true);
+    assert(a.indexOf(NaN), -1);
+    assert(a.lastIndexOf(4), 3);
+    assert(a.indexOf("4"), -1);
+    a.push("x");
+    assert(a[5], "x");
+    assert(a.join(), "1,2.5,0,4,NaN,x");
+
+    a = [1.5, 2.5];
+    a[0] = 1;
+    assert(a.indexOf(1), 0);
+    a[0] = 2 ** 31;
+    assert(a.indexOf(2 ** 31), 0);
+
+    a = [];
+    for (i = 0; i < 100; i++)
+        a.push(i * i);
+    assert(a.indexOf(81), 9);
+    assert(a.lastIndexOf(81), 9);
+    assert(a.includes(81.5), false);
+    assert(a.pop(), 99 * 99);
+    assert(a.shift(), 0);
+    assert(a[0], 1);
+    assert(a.at(-1), 98 * 98);
+    assert(a.slice(1, 3).join(), "4,9");
+    assert([...a].length, 98);
+    assert(Math.max.apply(null, a), 98 * 98);
+    a.reverse();
+    assert(a[0], 98 * 98);
+    a.copyWithin(0, 96);
+    assert(a.slice(0, 3).join(), "4,1,9216");
+    a[1] = {};
+    assert(typeof a[1], "object");
+
+    a = [];
+    for (i = 0; i < 1000; i++)
+        a.push(i + 0.5);
+    s = 0;
+    for (i of a)
+        s += i;
+    assert(s, 1000 * 999 / 2 + 500);
+    delete a[1];
+    assert(1 in a, false);
+    assert(a[2], 2.5);
+
+    /* copies and in place reversal of unboxed arrays */
+    a = [1, 2, 3, 4];
+    assert(a.reverse().join(), "4,3,2,1");
+    assert(a.with(1, 2.5).join(), "4,2.5,2,1");
+    assert(a.toReversed().join(), "1,2,3,4");
+    assert(a.toSpliced(1, 2, 0.5).join(), "4,0.5,1");
+    assert(a.toSorted().join(), "1,2,3,4");
+    a.push(-1);
+    assert(a.join(), "4,3,2,1,-1");
+    a = [0.5, 1.5, -0];
+    a.reverse();
+    assert(Object.is(a[0], -0), true);
+    assert(a.toReversed().join(), "0.5,1.5,0");
+    a[1] = 2.25;
+    assert(a.join(), "0,2.25,0.5");
+
+    /* search starting after the stored elements */
+    a = [1, 2, 3];
+    a.length = 10;
+    assert(a.indexOf(5, 5), -1);
+    assert(a.includes(5, 5), false);
+    assert(a.includes(undefined, 5), true);
+    assert(a.lastIndexOf(3, 8), 2);
+    a = [1.5, 2.5, 3.5];
+    a.length = 10;
+    assert(a.indexOf(5.5, 5), -1);
+    assert(a.includes(NaN, 5), false);
+    assert(a.indexOf(2.5, 1), 1);
+}
+
+function test_array_sort() {
+    var a, b, i, n, r;
+
+    /* default order of the int32 fast arrays */
+    a = [10, 9, 1, -1, -10, 100, 0, -2147483648, 2147483647, 21, 2, -9];
+    b = a.map(String).sort();
+    a.sort();
+    assert(a.join(), b.join());
+
+    a = [3, "b", undefined, 1.5, "a", , -0, null, 2];
+    a.sort();
+    assert(a.join(), "0,1.5,2,3,a,b,,,");
+    assert(a.length, 9);
+    assert(Object.is(a[0], -0));
+    assert(a[6], null);
+    assert(7 in a && !(8 in a));
+
+    a = [1.5, "x", 0.5, undefined, -1.5];
+    a.sort();
+    assert(a.join(), "-1.5,0.5,1.5,x,");
+    assert(a[4], undefined);
+
+    /* stability, with runs and galloping merges */
+    n = 2000;
+    a = [];
+    for (i = 0; i < n; i++)
+        a.push({ k: i % 256 < 200 ? i >> 4 : (i * 7919) % 97, i: i });
+    a.sort((x, y) => x.k - y.k);
+    for (i = 1; i < n; i++) {
+        assert(a[i - 1].k < a[i].k ||
+               (a[i - 1].k === a[i].k && a[i - 1].i < a[i].i));
+    }
+
+    /* presorted and reversed inputs need n - 1 comparisons */
+    for (b of [false, true]) {
+        a = [];
+        for (i = 0; i < n; i++)
+            a.push(b ? n - i : i);
+        r = 0;
+        a.sort((x, y) => (r++, x - y));
+        assert(r, n - 1);
+        assert(a[0], b ? 1 : 0);
+    }
+
+    /* the elements are not written back if the comparison throws */
+    a = [3, 2, 1];
+    assert_throws(Error, () => a.sort(() => { throw new Error(); }));
+    assert(a.join(), "3,2,1");
+    a = [3, Symbol(), 1];
+    assert_throws(TypeError, () => a.sort());
+    assert(a[0], 3);
+
+    /* inconsistent comparisons keep the elements */
+    a = [];
+    for (i = 0; i < n; i++)
+        a.push(i);
+    r = 1;
+    a.sort(() => (r = (r * 1103515245 + 12345) & 0x7fffffff) % 3 - 1);
+    a.sort((x, y) => x - y);
+    for (i = 0; i < n; i++)
+        assert(a[i], i);
+}
+
 function test_string() {
     var a;
     a = String("abc");
@@ -286,6 +563,24 @@ function test_string() {
     assert("abcabc".indexOf("cab2"), -1);
     assert("abc".indexOf("c"), 2);
 
+    /* long strings use the vectorized search */
+    a = "x".repeat(40) + "abcab" + "x".repeat(40);
+    assert(a.indexOf("abcab"), 40);
+    assert(a.indexOf("abcab", 41), -1);
+    assert(a.indexOf("bca"), 41);
+    assert(a.indexOf("xa"), 39);
+    assert(a.indexOf("bx"), 44);
+    assert(a.indexOf("x".repeat(40)), 0);
+    assert(a.indexOf("x".repeat(40), 1), 45);
+    assert(a.includes("cabx", 20), true);
+    a = "\u2026".repeat(30) + "ab\u2026c" + "\u2026".repeat(30);
+    assert(a.indexOf("b\u2026c"), 31);
+    assert(a.indexOf("bc"), -1);
+    assert(a.indexOf("c\u2026"), 33);
+    assert(a.indexOf("c"), 33);
+    assert(("y".repeat(50) + "\u2026").indexOf("\u2026"), 50);
+    assert(a.split("\u2026\u2026").length, 31);
+
     assert("aaa".indexOf("a"), 0);
     assert("aaa".indexOf("a", NaN), 0);
     assert("aaa".indexOf("a", -Infinity), 0);
@@ -361,6 +656,67 @@ function test_string() {
     assert("abc".padStart(Infinity, ""), "abc");
 }
 
+/* substrings and concatenations of up to 7 Latin-1 characters are
+   stored in the value: they must behave like the other strings */
+function test_short_string() {
+    var a, s, t, m, o, i;
+
+    a = "xxabcdefgxx\u00e9\u00fc\u2026";
+    s = a.substring(2, 5);
+    t = "abc"; /* atom string with the same contents */
+    assert(typeof s, "string");
+    assert(s.length, 3);
+    assert(s[1], "b");
+    assert(s.charCodeAt(2), 0x63);
+    assert(s === t && t === s && s == t);
+    assert(Object.is(s, t));
+    assert(s !== a.substring(2, 6));
+    assert(s < "abd" && s > "abb" && s <= t && s >= t);
+    assert(s + "d", "abcd");
+    assert(s + a.substring(5, 9), "abcdefg");
+    assert(s + s + s, "abcabcabc");
+    assert(a.substring(11, 13), "\u00e9\u00fc");
+    assert(a.substring(12, 14), "\u00fc\u2026");
+    assert(s.toUpperCase(), "ABC");
+    assert(s.split(""), ["a", "b", "c"]);
+    assert(s.valueOf(), "abc");
+    assert(new String(s).length, 3);
+    assert(Object(s) instanceof String);
+    assert(JSON.stringify({ k: s }), '{"k":"abc"}');
+    assert(JSON.stringify([1], null, a.substring(0, 2)), '[\nxx1\n]');
+    assert(Number(a.substring(0, 0) + "12"), 12);
+    assert(!!s);
+    assert(`${s}!`, "abc!");
+    assert(s.replace("b", a.substring(0, 2) + "$`"), "axxac");
+    assert(s.replace(/b/, a.substring(5, 6) + "$&$'"), "adbcc");
+
+    o = { abc: 1 };
+    assert(o[s], 1);
+    o[a.substring(5, 7)] = 2;
+    assert(o.de, 2);
+    assert(s in o);
+
+    m = new Map();
+    m.set(t, 1);
+    m.set("x" + "y", 2);
+    assert(m.get(s), 1);
+    assert(m.get("xy"), 2);
+    assert(new Set([s, t, "ab" + "c"]).size, 1);
+
+    switch (s) {
+    case "abc":
+        break;
+    default:
+        assert(false);
+    }
+
+    t = "";
+    for (i = 0; i < 10; i++)
+        t += String.fromCharCode(0x41 + i);
+    assert(t, "ABCDEFGHIJ");
+    assert(t.length, 10);
+}
+
 function test_math() {
     var a;
     a = 1.4;
@@ -522,6 +878,209 @@ function test_typed_array() {
     assert(a.toString(), "1,2,10,11");
 }
 
+function test_typed_array_kernels() {
+    var a, b, i, buffer;
+
+    /* conversions between element types, long enough for the
+       vectorized paths, with out of range values in some blocks */
+    a = new Float64Array(1000);
+    for (i = 0; i < a.length; i++)
+        a[i] = i * 1.5 - 300;
+    a[600] = NaN;
+    a[601] = -Infinity;
+    a[602] = 2 ** 32 + 5;
+    a[603] = -0.5;
+    b = new Int32Array(a);
+    assert(b[0], -300);
+    assert(b[999], 1198);
+    assert(b[600], 0);
+    assert(b[601], 0);
+    assert(b[602], 5);
+    assert(b[603], 0);
+    b = new Uint8ClampedArray(a);
+    assert(b[0], 0);
+    assert(b[201], 2);
+    assert(b[203], 4); /* 4.5 rounds to even */
+    assert(b[999], 255);
+    assert(b[600], 0);
+    assert(b[602], 255);
+    b = new Int8Array(a);
+    assert(b[999], 1198 << 24 >> 24);
+    b = new Uint16Array(1000);
+    b.set(new Int8Array([-1, 2, -3, 4, -5]), 995);
+    assert(b.slice(995).join(), "65535,2,65533,4,65531");
+    b = new Float32Array(new Uint32Array([0xffffffff, 1, 2, 3, 4]));
+    assert(b[0], 4294967296);
+    b = new Float64Array(new Float32Array([0.1, -0, NaN, 3, 4]));
+    assert(b[0], Math.fround(0.1));
+    assert(Object.is(b[1], -0));
+    assert(isNaN(b[2]));
+    assert(new Int16Array(a).slice(998).join(), "1197,1198");
+    assert(new Float32Array(a).subarray(998).slice().join(), "1197,1198.5");
+    assert_throws(TypeError, () => new Float64Array(2).set(new BigInt64Array(1)));
+    b = new BigUint64Array(new BigInt64Array([-1n, 2n]));
+    assert(b.join(), "18446744073709551615,2");
+
+    /* set() between overlapping views of the same buffer */
+    buffer = new ArrayBuffer(32);
+    a = new Uint8Array(buffer);
+    for (i = 0; i < a.length; i++)
+        a[i] = i;
+    b = new Uint16Array(buffer);
+    b.set(a.subarray(0, 16));
+    assert(b.join(), "0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15");
+
+    a = new Int16Array(100);
+    a.fill(-2, 3, 97);
+    assert(a[2], 0);
+    assert(a[3], -2);
+    assert(a[96], -2);
+    assert(a[97], 0);
+    a[50] = 7;
+    assert(a.indexOf(-2), 3);
+    assert(a.lastIndexOf(-2), 96);
+    assert(a.indexOf(7), 50);
+    assert(a.lastIndexOf(7), 50);
+    assert(a.indexOf(7, 51), -1);
+    assert(a.lastIndexOf(7, 49), -1);
+    assert(a.indexOf(65534), -1);
+
+    a = new Float64Array(50);
+    a[40] = NaN;
+    a[41] = -0;
+    assert(a.indexOf(NaN), -1);
+    assert(a.includes(NaN), true);
+    assert(a.lastIndexOf(0), 49);
+    assert(a.indexOf(-0, 1), 1);
+    a = new Float32Array(50);
+    a[45] = 0.1;
+    assert(a.indexOf(0.1), -1);
+    assert(a.indexOf(Math.fround(0.1)), 45);
+    a = new BigInt64Array(20);
+    a[17] = -5n;
+    assert(a.indexOf(-5n), 17);
+    assert(a.lastIndexOf(-5n), 17);
+    a.fill(3n, 10);
+    assert(a.lastIndexOf(3n), 19);
+    assert(a.indexOf(3n), 10);
+}
+
+function test_typed_array_sort() {
+    var a, b, i, n, T, types;
+
+    /* large enough for the radix sort */
+    n = 1000;
+    types = [Int8Array, Uint8Array, Uint8ClampedArray, Int16Array,
+             Uint16Array, Int32Array, Uint32Array, Float32Array,
+             Float64Array];
+    for (T of types) {
+        a = new T(n);
+        for (i = 0; i < n; i++)
+            a[i] = (i * 7919 % 1009 - 500) * 3;
+        b = Array.from(a).sort((x, y) => x - y);
+        a.sort();
+        assert(a.join(), b.join());
+    }
+
+    a = new Float64Array(n);
+    for (i = 0; i < n; i++)
+        a[i] = (i * 7919 % 1009 - 500) / 7;
+    a[10] = NaN;
+    a[20] = -0;
+    a[30] = 0;
+    a[40] = -Infinity;
+    a[50] = Infinity;
+    a[60] = -0;
+    a.sort();
+    assert(a[0], -Infinity);
+    assert(a[n - 2], Infinity);
+    assert(isNaN(a[n - 1]));
+    i = a.indexOf(0);
+    assert(Object.is(a[i], -0) && Object.is(a[i + 1], -0));
+    assert(Object.is(a[i + 2], 0) && Object.is(a[i + 3], 0));
+    for (i = 1; i < n - 1; i++)
+        assert(a[i - 1] <= a[i]);
+
+    a = new Float32Array(n);
+    for (i = 0; i < n; i++)
+        a[i] = i % 3 ? NaN : -i;
+    a.sort();
+    assert(a[0], -(n - 1) + (n - 1) % 3);
+    assert(Object.is(a[333], -0));
+    assert(isNaN(a[334]) && isNaN(a[n - 1]));
+
+    a = new BigInt64Array(n);
+    for (i = 0; i < n; i++)
+        a[i] = BigInt(i % 2 ? i : -i) * 0x100000001n;
+    a.sort();
+    assert(a[0], -998n * 0x100000001n);
+    assert(a[n - 1], 999n * 0x100000001n);
+    a = new BigUint64Array([2n ** 64n - 1n, 0n, 2n ** 63n, 1n]);
+    a.sort();
+    assert(a.join(), "0,1,9223372036854775808,18446744073709551615");
+}
+
+function test_text_codec() {
+    var enc, dec, a, s, r, i, j;
+
+    enc = new TextEncoder();
+    assert(enc.encoding, "utf-8");
+    assert(enc.encode().length, 0);
+    assert(enc.encode("a\u00e9\u20ac\ud83d\ude00").join(","),
+           "97,195,169,226,130,172,240,159,152,128");
+    /* lone surrogates are replaced */
+    assert(enc.encode("a\ud800b\udc00").join(","),
+           "97,239,191,189,98,239,191,189");
+
+    a = new Uint8Array(5);
+    r = enc.encodeInto("a\u20acbc", a);
+    assert(r.read, 3);
+    assert(r.written, 5);
+    /* a character is never split */
+    r = enc.encodeInto("\ud83d\ude00\ud83d\ude00", a);
+    assert(r.read, 2);
+    assert(r.written, 4);
+    assert_throws(TypeError, () => enc.encodeInto("a", []));
+
+    dec = new TextDecoder();
+    assert(dec.encoding, "utf-8");
+    assert(dec.fatal, false);
+    assert(dec.ignoreBOM, false);
+    assert(new TextDecoder(" UTF8 ").encoding, "utf-8");
+    assert_throws(RangeError, () => new TextDecoder("latin1"));
+
+    s = "x".repeat(40) + "\u00e9\u20ac\ud83d\ude00" + "\u00ff".repeat(20);
+    assert(dec.decode(enc.encode(s)), s);
+    assert(dec.decode(enc.encode(s).buffer), s);
+    assert(dec.decode(new DataView(enc.encode(s).buffer, 40, 2)), "\u00e9");
+    assert(dec.decode(new Uint8Array([0xef, 0xbb, 0xbf, 0x61])), "a");
+    assert(new TextDecoder("utf-8", { ignoreBOM: true }).decode(
+        new Uint8Array([0xef, 0xbb, 0xbf, 0x61])), "\ufeffa");
+    /* one U+FFFD per maximal subpart of an invalid sequence */
+    assert(dec.decode(new Uint8Array([0x61, 0xff, 0x62, 0xc3])),
+           "a\ufffdb\ufffd");
+    assert(dec.decode(new Uint8Array([0xed, 0xa0, 0x80])),
+           "\ufffd\ufffd\ufffd");
+    assert(dec.decode(new Uint8Array([0xf0, 0x9f, 0x98, 0x41])), "\ufffdA");
+    assert_throws(TypeError, () => new TextDecoder("utf-8", { fatal: true }).decode(
+        new Uint8Array([0xc3])));
+
+    /* streaming across chunk boundaries */
+    a = enc.encode(s);
+    for (i = 0; i < 48; i++) {
+        for (j = i; j < 48; j++) {
+            dec = new TextDecoder();
+            r = dec.decode(a.subarray(0, i), { stream: true }) +
+                dec.decode(a.subarray(i, j), { stream: true }) +
+                dec.decode(a.subarray(j));
+            assert(r, s);
+        }
+    }
+    dec = new TextDecoder();
+    assert(dec.decode(new Uint8Array([0xe2, 0x82]), { stream: true }), "");
+    assert(dec.decode(), "\ufffd");
+}
+
 function test_json() {
     var a, s;
     s = '{"x":1,"y":true,"z":null,"a":[1,2,3],"s":"str"}';
@@ -744,6 +1303,27 @@ function test_map() {
     a.set(1n, 1n);
     assert(a.get(1n), 1n);
     assert(a.get(2n ** 1000n - (2n ** 1000n - 1n)), 1n);
+    for (i = 0; i < n; i++)
+        a.set((BigInt(i) << 40n) - 7n, i);
+    for (i = 0; i < n; i++)
+        assert(a.get(BigInt(i) * 2n ** 40n - 7n), i);
+    a.set(0n, 0);
+    assert(a.get(-0n), 0);
+    a.set(2n ** 64n, 64);
+    assert(a.get(2n ** 32n * 2n ** 32n), 64);
+    assert(a.has(2n ** 64n + 1n), false);
+
+    /* string keys with a cached hash, modified by in place concatenation */
+    a = new Map();
+    v = "key" + n;
+    assert(a.get(v), undefined);
+    for (i = 0; i < 10; i++) {
+        v += "x";
+        a.set(v, i);
+    }
+    assert(a.get("key" + n + "xxx"), 2);
+    assert(a.has("key" + n + "x".repeat(10)), true);
+    assert(("key" + n + "xx") === "key" + n + "x" + "x", true);
 
     a = new Map();
     tab = [];
@@ -770,6 +1350,63 @@ function test_map() {
     assert(a.size, 0);
 }
 
+function test_map_iterator() {
+    var a, it, i, n, r, keys;
+
+    /* deleting records and adding new ones compacts the table while
+       the iterators are live */
+    n = 100;
+    a = new Map();
+    for (i = 0; i < n; i++)
+        a.set(i, i * 2);
+    it = a.keys();
+    assert(it.next().value, 0);
+    assert(it.next().value, 1);
+    for (i = 0; i < n - 10; i++)
+        a.delete(i);
+    for (i = n; i < 3 * n; i++)
+        a.set(i, i * 2);
+    r = it.next();
+    assert(r.value, n - 10);
+    for (i = n - 9; i < 3 * n; i++)
+        assert(it.next().value, i);
+    assert(it.next().done, true);
+
+    /* records added while iterating are visited */
+    a = new Set([1, 2, 3]);
+    keys = [];
+    for (var k of a) {
+        keys.push(k);
+        if (k < 20) {
+            a.delete(k);
+            a.add(k * 2 + 10);
+        }
+    }
+    assert(keys.join(), "1,2,3,12,14,16,34,38,42");
+
+    /* clear() restarts the live iterators */
+    a = new Map([[1, 1], [2, 2]]);
+    it = a.entries();
+    assert(it.next().value.join(), "1,1");
+    a.clear();
+    assert(a.size, 0);
+    a.set(3, 3);
+    assert(it.next().value.join(), "3,3");
+    assert(it.next().done, true);
+
+    /* forEach across a resize */
+    a = new Map([[0, 0]]);
+    i = 0;
+    a.forEach(function (v, k) {
+        if (k < 100)
+            a.set(k + 1, v);
+        a.delete(k);
+        i++;
+    });
+    assert(i, 101);
+    assert(a.size, 0);
+}
+
 function test_weak_map() {
     var a, i, n, tab, o, v, n2;
     a = new WeakMap();
@@ -858,16 +1495,25 @@ function test_generator() {
 test();
 test_function();
 test_enum();
+test_object_dict();
 test_array();
+test_array_holes();
+test_array_kinds();
+test_array_sort();
 test_string();
+test_short_string();
 test_math();
 test_number();
 test_eval();
 test_typed_array();
+test_typed_array_kernels();
+test_typed_array_sort();
+test_text_codec();
 test_json();
 test_date();
 test_regexp();
 test_symbol();
 test_map();
+test_map_iterator();
 test_weak_map();
 test_generator();
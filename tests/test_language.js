@@ -394,6 +394,35 @@ function test_object_literal() {
 
     a = {x, get, set, async};
     assert(JSON.stringify(a), '{"x":0,"get":1,"set":2,"async":3}');
+
+    /* literals sharing a shape template */
+    var i, b = [];
+    for(i = 0; i < 3; i++)
+        b.push({ p: i, q: i + 1, p: i * 2, m() { return this.q; } });
+    assert(Object.keys(b[2]).join(), "p,q,m");
+    assert(b[2].p === 4 && b[2].m() === 3);
+    b[0].r = 1;
+    delete b[1].q;
+    assert(Object.keys(b[0]).join(), "p,q,m,r");
+    assert(Object.keys(b[1]).join(), "p,m");
+    assert(Object.keys(b[2]).join(), "p,q,m");
+    a = { u: 1, ...{ v: 2 }, ["w"]: 3, get z() { return 4; } };
+    assert(JSON.stringify(a), '{"u":1,"v":2,"w":3,"z":4}');
+
+    /* constructors sharing a presized shape */
+    function C(n) { for(var j = 0; j < n; j++) this["f" + j] = j; }
+    for(i = 0; i < 3; i++)
+        b[i] = new C(10);
+    delete b[1].f0;
+    b[2].g = 1;
+    assert(Object.keys(b[0]).length, 10);
+    assert(Object.keys(b[1]).length, 9);
+    assert(Object.keys(b[2]).length, 11);
+    C.prototype = { k: 1 };
+    a = new C(10);
+    assert(Object.getPrototypeOf(a) === C.prototype && a.k === 1);
+    assert(Object.getPrototypeOf(b[0]) !== C.prototype);
+    assert(Object.keys(new C(20)).length, 20);
 }
 
 function test_regexp_skip() {
@@ -442,6 +471,47 @@ function test_spread() {
 
     x = [...[,]];
     assert(Object.getOwnPropertyNames(x).toString(), "0,length");
+
+    function f() {
+        return Array.prototype.join.call(arguments, ",");
+    }
+    function g() {
+        return f(...arguments);
+    }
+    x = [1, 2, 3];
+    assert(f(...x), "1,2,3");
+    assert(f(...x,), "1,2,3");
+    assert(f(0, ...x), "0,1,2,3");
+    assert(f(...x, 4), "1,2,3,4");
+    assert(f(...x, ...x), "1,2,3,1,2,3");
+    assert(g(...x), "1,2,3");
+    assert(f(...[,1]), ",1");
+    assert(f(..."ab"), "a,b");
+    assert(f(...new Set([5, 6])), "5,6");
+    assert(new Array(...[1, 2]).toString(), "1,2");
+    assert_throws(TypeError, () => f(...1));
+    assert_throws(TypeError, () => f(...undefined));
+    assert_throws(TypeError, () => (1)(...x));
+
+    /* a modified iterator must be used */
+    x = [1, 2];
+    x[Symbol.iterator] = function* () { yield 3; };
+    assert(f(...x), "3");
+
+    class A {
+        constructor(...args) {
+            this.args = args;
+        }
+    }
+    class B extends A {
+        constructor(...args) {
+            super(...args);
+        }
+    }
+    class C extends A {
+    }
+    assert(new B(1, 2).args.toString(), "1,2");
+    assert(new C(3, 4).args.toString(), "3,4");
 }
 
 function test_function_length() {
@@ -649,6 +719,117 @@ function test_optional_chaining() {
     assert((a?.["b"])().c, 42);
 }
 
+var global_cell_var = 1;
+
+function test_global_var() {
+    function read() {
+        return typeof global_cell_var === "undefined" ? "undef" : global_cell_var;
+    }
+    function write(v) {
+        global_cell_var = v;
+    }
+    function write_strict(v) {
+        "use strict";
+        global_cell_var = v;
+    }
+    assert(read(), 1);
+    write(2);
+    assert(read(), 2);
+    assert(globalThis.global_cell_var, 2);
+
+    /* the cached variable location must follow the property changes */
+    globalThis.global_cell_tmp = 1;
+    delete globalThis.global_cell_tmp;
+    write(3);
+    assert(read(), 3);
+
+    Object.defineProperty(globalThis, "global_cell_var2", { value: 1, writable: true, configurable: true });
+    var read2 = () => global_cell_var2;
+    assert(read2(), 1);
+    delete globalThis.global_cell_var2;
+    assert_throws(ReferenceError, read2);
+    globalThis.global_cell_var2 = 4;
+    assert(read2(), 4);
+    Object.defineProperty(globalThis, "global_cell_var2", { get() { return 5; }, configurable: true });
+    assert(read2(), 5);
+    Object.defineProperty(globalThis, "global_cell_var2", { value: 6, writable: false, configurable: true });
+    assert(read2(), 6);
+    assert_throws(TypeError, () => { "use strict"; global_cell_var2 = 7; });
+    assert(read2(), 6);
+    delete globalThis.global_cell_var2;
+    assert_throws(ReferenceError, () => { "use strict"; global_cell_var2 = 8; });
+
+    write_strict(9);
+    assert(read(), 9);
+}
+
+function test_tail_call() {
+    "use strict";
+    var n = 1000000;
+
+    function count(i, acc) {
+        if (i == 0)
+            return acc;
+        return count(i - 1, acc + 1);
+    }
+    assert(count(n, 0), n, "self tail call");
+
+    function is_even(i) {
+        return i == 0 ? true : is_odd(i - 1);
+    }
+    function is_odd(i) {
+        if (i == 0)
+            return false;
+        return is_even(i - 1);
+    }
+    assert(is_even(n), true, "mutual tail calls");
+
+    var obj = {
+        sum(i, acc) {
+            if (i == 0)
+                return [this === obj, acc];
+            return this.sum(i - 1, acc + i);
+        }
+    };
+    assert(obj.sum(n, 0), [true, n * (n + 1) / 2], "method tail call");
+
+    /* fewer arguments than parameters and a different frame size */
+    function grow(i, a, b, c, d) {
+        var x = [a, b, c, d];
+        if (i == 0)
+            return x.length + (b === undefined ? 0 : 1);
+        return shrink(i - 1);
+    }
+    function shrink(i) {
+        return grow(i, 1);
+    }
+    assert(shrink(n), 4, "tail calls with different frame sizes");
+
+    /* closures over the arguments of the released frame */
+    function make(i, fns) {
+        fns.push(() => i);
+        if (i == 0)
+            return fns;
+        return make(i - 1, fns);
+    }
+    var fns = make(10, []);
+    assert(fns[0](), 10, "closure over tail called frame");
+    assert(fns[10](), 0, "closure over tail called frame");
+
+    /* a pending catch handler prevents the tail call */
+    function thrower() {
+        throw Error("thrown");
+    }
+    function catcher() {
+        try {
+            return thrower();
+        } catch (e) {
+            return e.message;
+        }
+    }
+    assert(catcher(), "thrown", "tail call inside try block");
+}
+
 test_op1();
 test_cvt();
 test_eq();
@@ -671,3 +852,5 @@ test_function_expr_name();
 test_parse_semicolon();
 test_optional_chaining();
 test_parse_arrow_function();
+test_tail_call();
+test_global_var();
@@ -164,6 +164,60 @@ function test_for_in2() {
     assert(tab.toString() == "x,y");
 }
 
+function test_for_in_shape() {
+    var i, j, tab, a, b, objs;
+
+    /* objects sharing the same shape share their key list */
+    objs = [];
+    for (i = 0; i < 3; i++)
+        objs.push({x: i, y: i, "2": i});
+    for (j = 0; j < objs.length; j++) {
+        tab = [];
+        for (i in objs[j])
+            tab.push(i);
+        assert(tab.toString(), "2,x,y", "for_in");
+        assert(Object.keys(objs[j]).toString(), "2,x,y", "keys");
+    }
+
+    /* modification of the object during the enumeration */
+    a = {x: 1, y: 2, z: 3};
+    b = {x: 1, y: 2, z: 3};
+    tab = [];
+    for (i in a) {
+        if (i === "x") {
+            delete a.y;
+            a.w = 4;
+        }
+        tab.push(i);
+    }
+    assert(tab.toString(), "x,z", "for_in");
+    assert(Object.keys(a).toString(), "x,z,w", "keys");
+    assert(Object.keys(b).toString(), "x,y,z", "keys");
+
+    /* change of enumerability */
+    Object.defineProperty(b, "y", {enumerable: false});
+    assert(Object.keys(b).toString(), "x,z", "keys");
+    b = {x: 1, y: 2, z: 3};
+    assert(Object.keys(b).toString(), "x,y,z", "keys");
+
+    /* enumerable property added to the prototype */
+    a = {x: 1};
+    tab = [];
+    for (i in a)
+        tab.push(i);
+    assert(tab.toString(), "x", "for_in");
+    Object.prototype.p = 1;
+    tab = [];
+    for (i in a)
+        tab.push(i);
+    delete Object.prototype.p;
+    assert(tab.toString(), "x,p", "for_in");
+    tab = [];
+    for (i in a)
+        tab.push(i);
+    assert(tab.toString(), "x", "for_in");
+}
+
 function test_for_in_proxy() {
     let removed_key = "";
     let target = {}
@@ -367,6 +421,7 @@ test_switch1();
 test_switch2();
 test_for_in();
 test_for_in2();
+test_for_in_shape();
 test_for_in_proxy();
 
 test_try_catch1();
@@ -269,6 +269,31 @@ function test_timer() {
         os.clearTimeout(th[i]);
 }
 
+function test_idle_callback() {
+    var log = [], t0, id;
+
+    os.requestIdleCallback(function (deadline) {
+        assert(deadline.didTimeout, false);
+        assert(deadline.timeRemaining() <= 50, true);
+        assert(log.join(), "timeout true");
+    });
+    id = os.requestIdleCallback(function () {
+        log.push("cancelled");
+    });
+    os.cancelIdleCallback(id);
+    /* keep the event loop busy: the callback must time out */
+    os.requestIdleCallback(function (deadline) {
+        log.push("timeout " + deadline.didTimeout);
+    }, { timeout: 5 });
+    function busy() {
+        if (!t0)
+            t0 = Date.now();
+        if (Date.now() - t0 < 30)
+            os.setTimeout(busy, 0);
+    }
+    os.setTimeout(busy, 0);
+}
+
 /* test closure variable handling when freeing asynchronous
    function */
 function test_async_gc() {
@@ -289,6 +314,224 @@ function test_async_gc() {
     })();
 }
 
+/* the jobs run in order while the queue grows and wraps around */
+function test_job_queue() {
+    var log = [], n = 3000, i;
+
+    function job(i) {
+        log.push(i);
+        if (i < n && (i & 1) == 0)
+            Promise.resolve(n + i).then(job);
+    }
+    for (i = 0; i < n; i++)
+        Promise.resolve(i).then(job);
+    os.setTimeout(function () {
+        assert(log.length, n + n / 2);
+        for (i = 0; i < n; i++)
+            assert(log[i], i);
+        for (i = 0; i < n / 2; i++)
+            assert(log[n + i], n + 2 * i);
+    }, 0);
+}
+
+/* number of jobs run before an await resumes */
+function test_await_order() {
+    var log = [];
+
+    async function f(name, v) {
+        try {
+            await v;
+            log.push(name);
+        } catch (e) {
+            log.push(name + " catch");
+        }
+    }
+    f("prim", 1);
+    f("resolved", Promise.resolve(2));
+    f("rejected", Promise.reject(3));
+    f("thenable", { then(r) { r(4); } });
+    f("pending", new Promise((r) => Promise.resolve().then(r)));
+    Promise.resolve().then(() => log.push("tick1"))
+        .then(() => log.push("tick2"))
+        .then(() => log.push("tick3"));
+    os.setTimeout(function () {
+        assert(log.join(), "prim,resolved,rejected catch,tick1,thenable," +
+               "pending,tick2,tick3");
+    }, 0);
+}
+
+function test_gc_stats() {
+    var s0, s1, a, i, cl, o1, o2;
+    s0 = std.gcStats();
+    a = [];
+    for(i = 0; i < 100; i++)
+        a.push({ self: null });
+    for(i = 0; i < 100; i++)
+        a[i].self = a[i];
+    a = null;
+    std.gc();
+    s1 = std.gcStats();
+    assert(s1.gcCount > s0.gcCount, true);
+    assert(s1.gcFreedCount - s0.gcFreedCount >= 100, true);
+    assert(s1.objectAllocCount - s0.objectAllocCount >= 101, true);
+    assert(s1.gcPauseHistogram.length, 24);
+    assert(s1.gcPauseHistogram.reduce((x, y) => x + y), s1.gcCount);
+    assert(s1.gcPauseMax <= s1.gcPauseTotal, true);
+    cl = s1.classes.find((c) => c.name === "Array");
+    assert(cl.allocCount >= cl.count, true);
+
+    /* objects created the same way share a hashed shape */
+    function make(v) {
+        var o = {};
+        o["gc_stats_" + "x"] = v;
+        return o;
+    }
+    s0 = std.gcStats();
+    o1 = make(1);
+    s1 = std.gcStats();
+    assert(s1.hashedShapeCount - s0.hashedShapeCount, 1);
+    o2 = make(2);
+    s0 = std.gcStats();
+    assert(s0.hashedShapeCount, s1.hashedShapeCount);
+}
+
+function test_dict_shape_sharing() {
+    var a, i, k, h0, n = 200;
+    function hashed_shape_count() {
+        return std.gcStats().hashedShapeCount;
+    }
+    /* objects used as dictionaries: past JS_PROP_DICT_THRESHOLD
+       properties their shape is private and no longer hashed */
+    std.gc();
+    h0 = hashed_shape_count();
+    a = [];
+    for(i = 0; i < n; i++) {
+        a.push({});
+        for(k = 0; k < 64; k++)
+            a[i]["p" + k] = k;
+        for(k = 0; k < 16; k++)
+            a[i]["k" + i + "_" + k] = k;
+    }
+    assert(hashed_shape_count() - h0 < 10, true);
+    assert(Object.keys(a[n - 1]).length, 80);
+    assert(a[n - 1]["k" + (n - 1) + "_15"], 15);
+    delete a[3].k3_10;
+    a[3].x = 1;
+    assert(Object.keys(a[3]).length, 80);
+    assert(Object.keys(a[3])[79], "x");
+    assert(a[3].k3_15 + a[3].x, 16);
+    assert(a[4].k4_10, 10);
+
+    /* a shape shared by several objects keeps extending the transition
+       tree */
+    a = null;
+    std.gc();
+    h0 = hashed_shape_count();
+    a = [];
+    for(i = 0; i < n; i++)
+        a.push({});
+    for(k = 0; k < 80; k++) {
+        for(i = 0; i < n; i++)
+            a[i]["q" + k] = k;
+    }
+    assert(hashed_shape_count() - h0 < 10, true);
+    a[0].r = 0;
+    assert(Object.keys(a[0]).length, 81);
+    assert(Object.keys(a[1]).length, 80);
+    assert(a[n - 1].q79, 79);
+}
+
+function test_async_func_pool() {
+    var c0, p0, a, i, r, v;
+    function* g(x) {
+        yield x;
+    }
+    function run(n) {
+        r = 0;
+        for (i = 0; i < n; i++) {
+            for (v of g(i))
+                r += v;
+        }
+    }
+    /* the stats object is freed before returning */
+    function malloc_count() {
+        return std.gcStats().mallocCount;
+    }
+    function pool_count() {
+        return std.gcStats().poolCount;
+    }
+    /* the freed generator states are kept for reuse */
+    run(1);
+    c0 = malloc_count();
+    p0 = pool_count();
+    assert(p0 >= 1, true);
+    assert(std.gcStats().poolSize > 0, true);
+    run(100);
+    assert(r, 4950);
+    assert(malloc_count(), c0);
+    assert(pool_count(), p0);
+
+    /* live states are taken from the pool, then given back */
+    a = [];
+    for (i = 0; i < 10; i++) {
+        a.push(g(i));
+        assert(a[i].next().value, i);
+    }
+    p0 = pool_count();
+    a = null;
+    assert(pool_count() - p0, 10);
+    c0 = malloc_count();
+    run(100);
+    assert(malloc_count(), c0);
+}
+
+function test_weak_ref() {
+    var log = [], fr, r1, r2, o, token, cyc;
+
+    fr = new FinalizationRegistry(function (v) { log.push(v); });
+    /* the target of a new WeakRef is kept until the end of the job */
+    r1 = new WeakRef({});
+    assert(typeof r1.deref(), "object");
+    o = {};
+    r2 = new WeakRef(o);
+    fr.register(o, "o");
+    fr.register({}, "tmp");
+    token = {};
+    fr.register(r2, "unregistered", token);
+    fr.register(token, "token", token);
+    assert(fr.unregister(token), true);
+    assert(fr.unregister(token), false);
+    cyc = {};
+    cyc.self = cyc;
+    fr.register(cyc, "cyc");
+    cyc = null;
+    /* a collected cell stays registered until the cleanup job runs */
+    fr.register({}, "dead", token);
+    std.gc();
+    assert(fr.unregister(token), true);
+    [() => new WeakRef(1), () => fr.register(o, o),
+     () => fr.register(o, 1, 2)].forEach(function (f) {
+        var ex;
+        try {
+            f();
+        } catch (e) {
+            ex = e;
+        }
+        assert(ex instanceof TypeError);
+    });
+    os.setTimeout(function () {
+        assert(r1.deref(), undefined);
+        assert(r2.deref(), o);
+        o = null;
+        os.setTimeout(function () {
+            assert(r2.deref(), undefined);
+            assert(log.sort().join(), "cyc,o,tmp");
+            /* the registry must be alive to get the cleanup calls */
+            assert(fr.unregister(token), false);
+        }, 0);
+    }, 0);
+}
+
 test_printf();
 test_file1();
 test_file2();
@@ -297,5 +540,12 @@ test_popen();
 test_os();
 test_os_exec();
 test_timer();
+test_idle_callback();
 test_ext_json();
 test_async_gc();
+test_job_queue();
+test_await_order();
+test_weak_ref();
+test_gc_stats();
+test_dict_shape_sharing();
+test_async_func_pool();